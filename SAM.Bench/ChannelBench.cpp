@@ -0,0 +1,196 @@
+#include "../SAM.Picker/EmulatorChannel.h"
+#include "../SAM.Picker/Achievement.h"
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/**
+ * Measures how many commands per second a child can be sent through an
+ * EmulatorChannel, against the pipe protocol it replaced, where each field
+ * of a command was a write of its own.
+ *
+ * Each run forks a child reading the given number of commands, which then
+ * answers with their count so the parent knows they all went through.
+ */
+
+/**
+ * Same size as EmulatorCommand_t
+ */
+struct BenchCommand_t {
+    char type;
+    double value;
+    char id[MAX_ACHIEVEMENT_ID_LENGTH];
+};
+
+typedef struct BenchCommand_t BenchCommand_t;
+
+static bool
+pipe_write(int fd, const void* buf, size_t count) {
+    const char* ptr = (const char*)buf;
+
+    while (count > 0) {
+        const ssize_t written = write(fd, ptr, count);
+
+        if (written == -1 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+
+        ptr += written;
+        count -= written;
+    }
+
+    return true;
+}
+// => pipe_write
+
+static bool
+pipe_read(int fd, void* buf, size_t count) {
+    char* ptr = (char*)buf;
+
+    while (count > 0) {
+        const ssize_t got = read(fd, ptr, count);
+
+        if (got == -1 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return false;
+        }
+
+        ptr += got;
+        count -= got;
+    }
+
+    return true;
+}
+// => pipe_read
+
+static double
+seconds_since(const std::chrono::steady_clock::time_point& start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+// => seconds_since
+
+/**
+ * Commands through the rings, one copy per command
+ */
+static double
+bench_channel(unsigned long count) {
+    EmulatorChannel* channel = EmulatorChannel::create();
+    BenchCommand_t command;
+    unsigned long received = 0;
+
+    if (!channel) {
+        exit(EXIT_FAILURE);
+    }
+
+    const pid_t pid = fork();
+    if (pid == 0) {
+        channel->use_as_child();
+        for (unsigned long i = 0; i < count; i++) {
+            if (!channel->read(&command, sizeof(BenchCommand_t))) {
+                _exit(EXIT_FAILURE);
+            }
+        }
+        channel->write(&count, sizeof(unsigned long));
+        _exit(EXIT_SUCCESS);
+    }
+
+    channel->use_as_parent();
+    memset(&command, 0, sizeof(BenchCommand_t));
+    command.type = 'a';
+
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < count; i++) {
+        command.value = i;
+        channel->write(&command, sizeof(BenchCommand_t));
+    }
+    channel->read(&received, sizeof(unsigned long));
+    const double elapsed = seconds_since(start);
+
+    waitpid(pid, NULL, 0);
+    delete channel;
+    return received == count ? elapsed : -1;
+}
+// => bench_channel
+
+/**
+ * Commands through a pair of pipes, one write and one read per field
+ */
+static double
+bench_pipes(unsigned long count) {
+    int commands[2];
+    int results[2];
+    BenchCommand_t command;
+    unsigned long received = 0;
+
+    if (pipe(commands) == -1 || pipe(results) == -1) {
+        exit(EXIT_FAILURE);
+    }
+
+    const pid_t pid = fork();
+    if (pid == 0) {
+        close(commands[1]);
+        close(results[0]);
+        for (unsigned long i = 0; i < count; i++) {
+            if (!pipe_read(commands[0], &command.type, sizeof(char))
+                || !pipe_read(commands[0], &command.value, sizeof(double))
+                || !pipe_read(commands[0], command.id, MAX_ACHIEVEMENT_ID_LENGTH)) {
+                _exit(EXIT_FAILURE);
+            }
+        }
+        pipe_write(results[1], &count, sizeof(unsigned long));
+        _exit(EXIT_SUCCESS);
+    }
+
+    close(commands[0]);
+    close(results[1]);
+    memset(&command, 0, sizeof(BenchCommand_t));
+    command.type = 'a';
+
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < count; i++) {
+        command.value = i;
+        pipe_write(commands[1], &command.type, sizeof(char));
+        pipe_write(commands[1], &command.value, sizeof(double));
+        pipe_write(commands[1], command.id, MAX_ACHIEVEMENT_ID_LENGTH);
+    }
+    pipe_read(results[0], &received, sizeof(unsigned long));
+    const double elapsed = seconds_since(start);
+
+    waitpid(pid, NULL, 0);
+    close(commands[1]);
+    close(results[0]);
+    return received == count ? elapsed : -1;
+}
+// => bench_pipes
+
+static void
+report(const char* name, unsigned long count, double elapsed) {
+    if (elapsed < 0) {
+        std::cerr << name << ": the child did not get every command" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::cout << name << ": " << count / elapsed / 1e6 << " M commands/s ("
+              << elapsed * 1e3 << " ms)" << std::endl;
+}
+// => report
+
+int
+main(int argc, char* argv[]) {
+    const unsigned long count = argc > 1 ? strtoul(argv[1], NULL, 10) : 2000000;
+
+    std::cout << count << " commands of " << sizeof(BenchCommand_t) << " bytes" << std::endl;
+    report("channel", count, bench_channel(count));
+    report("pipes", count, bench_pipes(count));
+    return EXIT_SUCCESS;
+}
+// => main
@@ -0,0 +1,124 @@
+#include "../SAM.Picker/MySteam.h"
+#include "../SAM.Picker/MainPickerWindow.h"
+#include "../SAM.Picker/GameEmulator.h"
+#include "../SAM.Picker/globals.h"
+#include "../common/functions.h"
+#include <gtk/gtk.h>
+#include <iostream>
+#include <string>
+#include <cstdlib>
+
+/**
+ * Measures the time-to-interactive of the achievement list: from a click
+ * on a game, as on_game_row_activated handles it, to the first frame drawn
+ * with its achievements in the list.
+ *
+ * It is linked to the mock Steam API (see SAM.MockSteam), serving 2000
+ * achievements unless MOCK_STEAM_ACHIEVEMENTS says otherwise. The window
+ * is loaded from glade/, so it runs from the root of the repo:
+ *   ./bin/bench/interactivebench [run count]
+ *
+ * Each run opens another app id, so none finds its game process kept in
+ * the background, nor its icons or percentages in the cache. Like a first
+ * click, they get the spare process forked by warm_up.
+ */
+
+MySteam* g_steam = nullptr;
+MainPickerWindow* g_main_gui = nullptr;
+char* g_cache_folder = nullptr;
+
+/**
+ * Far from the ids of real games, so their cache is left alone
+ */
+#define BENCH_FIRST_APP_ID 900000000
+
+struct BenchState_t {
+    unsigned runs;
+    unsigned run;
+    bool waiting;
+    gint64 start;
+    gint64 total;
+};
+
+typedef struct BenchState_t BenchState_t;
+
+/**
+ * Goes back to the games list if a game is open, then opens the next one
+ */
+static gboolean
+start_run(gpointer data) {
+    BenchState_t* state = (BenchState_t*)data;
+
+    if (g_steam->is_game_running()) {
+        g_steam->quit_game();
+        g_main_gui->switch_to_games_page();
+    }
+
+    if (state->run == state->runs) {
+        std::cout << "Average: " << state->total / state->runs / 1000.0 << " ms" << std::endl;
+        gtk_main_quit();
+        return G_SOURCE_REMOVE;
+    }
+
+    state->start = g_get_monotonic_time();
+    state->waiting = true;
+    g_main_gui->switch_to_stats_page();
+    g_steam->launch_game(std::to_string(BENCH_FIRST_APP_ID + state->run));
+
+    return G_SOURCE_REMOVE;
+}
+// => start_run
+
+/**
+ * The first frame painted once the achievements are in, ends the run
+ */
+static void
+on_after_paint(GdkFrameClock* clock, gpointer data) {
+    BenchState_t* state = (BenchState_t*)data;
+
+    if (!state->waiting || GameEmulator::get_instance()->get_achievement_count() == 0) {
+        return;
+    }
+
+    const gint64 elapsed = g_get_monotonic_time() - state->start;
+    std::cout << "Run " << state->run + 1 << ": "
+              << GameEmulator::get_instance()->get_achievement_count() << " achievements interactive in "
+              << elapsed / 1000.0 << " ms" << std::endl;
+
+    state->waiting = false;
+    state->total += elapsed;
+    state->run++;
+    g_idle_add(start_run, state);
+}
+// => on_after_paint
+
+int
+main(int argc, char* argv[]) {
+    BenchState_t state = {};
+
+    state.runs = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 5;
+    if (state.runs == 0) {
+        std::cerr << "Usage: " << argv[0] << " [run count]" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // Inherited by the game processes, where the mock reads it
+    setenv("MOCK_STEAM_ACHIEVEMENTS", "2000", 0);
+    g_cache_folder = concat( getenv("HOME"), "/.SamRewritten" );
+
+    gtk_init(&argc, &argv);
+
+    g_steam = MySteam::get_instance();
+    g_main_gui = new MainPickerWindow();
+    GameEmulator::get_instance()->warm_up();
+
+    gtk_widget_show( g_main_gui->get_main_window() );
+    g_signal_connect(gtk_widget_get_frame_clock( g_main_gui->get_main_window() ), "after-paint", (GCallback)on_after_paint, &state);
+
+    // Once the games list is up, as if the user clicked then
+    g_idle_add(start_run, &state);
+    gtk_main();
+
+    return 0;
+}
+// => main
@@ -0,0 +1,193 @@
+#include "../common/lodepng.h"
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <cstdint>
+
+/**
+ * Checks the SIMD unfiltering of lodepng against the scalar code. make.sh
+ * builds this twice, with and without LODEPNG_NO_COMPILE_SIMD, and both
+ * must print the same hashes:
+ *   diff <(./bin/bench/unfiltercheck) <(./bin/bench/unfiltercheck-scalar)
+ *
+ * The PNGs are made of random scanlines, each with a random filter type,
+ * so every filter is unfiltered from and onto any bytes. Every image is
+ * decoded twice:
+ *  - not interlaced, the rows are unfiltered to another buffer
+ *  - Adam7 interlaced, each pass is unfiltered in place, so the row
+ *    written and the row read alias
+ */
+
+/**
+ * Same seed in both builds, so they decode the same images
+ */
+static uint64_t g_random_state = 88172645463325252ULL;
+
+static unsigned char
+random_byte() {
+    g_random_state ^= g_random_state << 13;
+    g_random_state ^= g_random_state >> 7;
+    g_random_state ^= g_random_state << 17;
+    return g_random_state >> 56;
+}
+// => random_byte
+
+/**
+ * 64 bits FNV-1a
+ */
+static uint64_t
+hash_bytes(const unsigned char* data, size_t size, uint64_t hash = 14695981039346656037ULL) {
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+// => hash_bytes
+
+/**
+ * Appends height random scanlines of width pixels, each behind a random
+ * filter type byte
+ */
+static void
+add_random_scanlines(std::vector<unsigned char>& scanlines, unsigned width, unsigned height, unsigned bpp) {
+    const size_t line_bytes = ((size_t)width * bpp + 7) / 8;
+
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    for (unsigned y = 0; y < height; y++) {
+        scanlines.push_back(random_byte() % 5);
+        for (size_t i = 0; i < line_bytes; i++) {
+            scanlines.push_back(random_byte());
+        }
+    }
+}
+// => add_random_scanlines
+
+/**
+ * A PNG of the given scanlines, stored without compression, as the check
+ * is about the filters
+ */
+static std::vector<unsigned char>
+make_png(const std::vector<unsigned char>& scanlines, unsigned width, unsigned height,
+         LodePNGColorType color_type, unsigned bit_depth, bool adam7) {
+    const unsigned char signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    unsigned char header[13] = {
+        (unsigned char)(width >> 24), (unsigned char)(width >> 16), (unsigned char)(width >> 8), (unsigned char)width,
+        (unsigned char)(height >> 24), (unsigned char)(height >> 16), (unsigned char)(height >> 8), (unsigned char)height,
+        (unsigned char)bit_depth, (unsigned char)color_type, 0, 0, (unsigned char)adam7
+    };
+    LodePNGCompressSettings settings = lodepng_default_compress_settings;
+    unsigned char* zlib = nullptr;
+    size_t zlib_size = 0;
+    unsigned char* chunks = nullptr;
+    size_t chunks_size = 0;
+    unsigned error;
+
+    settings.btype = 0;
+
+    error = lodepng_zlib_compress(&zlib, &zlib_size, scanlines.data(), scanlines.size(), &settings);
+    if (!error) error = lodepng_chunk_create(&chunks, &chunks_size, sizeof(header), "IHDR", header);
+    if (!error) error = lodepng_chunk_create(&chunks, &chunks_size, zlib_size, "IDAT", zlib);
+    if (!error) error = lodepng_chunk_create(&chunks, &chunks_size, 0, "IEND", nullptr);
+
+    if (error) {
+        std::cerr << "Could not make a PNG: " << lodepng_error_text(error) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<unsigned char> png(signature, signature + sizeof(signature));
+    png.insert(png.end(), chunks, chunks + chunks_size);
+
+    lodepng_free(zlib);
+    lodepng_free(chunks);
+    return png;
+}
+// => make_png
+
+/**
+ * Decodes a random image, and prints the hash of its pixels
+ */
+static uint64_t
+check_image(const char* name, LodePNGColorType color_type, unsigned channels, unsigned bit_depth, unsigned width, unsigned height, bool adam7) {
+    // The passes of Adam7, see the PNG specification
+    static const unsigned pass_x[7] = {0, 4, 0, 2, 0, 1, 0};
+    static const unsigned pass_y[7] = {0, 0, 4, 0, 2, 0, 1};
+    static const unsigned pass_dx[7] = {8, 8, 4, 4, 2, 2, 1};
+    static const unsigned pass_dy[7] = {8, 8, 8, 4, 4, 2, 2};
+
+    const unsigned bpp = channels * bit_depth;
+    std::vector<unsigned char> scanlines;
+    unsigned char* pixels = nullptr;
+    unsigned decoded_width, decoded_height;
+
+    if (adam7) {
+        for (unsigned i = 0; i < 7; i++) {
+            add_random_scanlines(
+                scanlines,
+                (width + pass_dx[i] - pass_x[i] - 1) / pass_dx[i],
+                (height + pass_dy[i] - pass_y[i] - 1) / pass_dy[i],
+                bpp);
+        }
+    } else {
+        add_random_scanlines(scanlines, width, height, bpp);
+    }
+
+    const std::vector<unsigned char> png = make_png(scanlines, width, height, color_type, bit_depth, adam7);
+    const unsigned error = lodepng_decode_memory(&pixels, &decoded_width, &decoded_height, png.data(), png.size(), color_type, bit_depth);
+
+    if (error) {
+        std::cerr << name << " " << width << "x" << height << ": " << lodepng_error_text(error) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    const uint64_t hash = hash_bytes(pixels, ((size_t)width * bpp + 7) / 8 * height);
+    std::cout << name << " " << width << "x" << height << (adam7 ? " adam7 " : " ") << std::hex << hash << std::dec << std::endl;
+
+    lodepng_free(pixels);
+    return hash;
+}
+// => check_image
+
+int
+main(int argc, char* argv[]) {
+    struct Format_t {
+        const char* name;
+        LodePNGColorType color_type;
+        unsigned channels;
+        unsigned bit_depth;
+    };
+
+    // 1 to 8 bytes per pixel. The SIMD code handles 3 and 4, and Up for all
+    static const Format_t formats[] = {
+        {"grey8", LCT_GREY, 1, 8},
+        {"rgb8", LCT_RGB, 3, 8},
+        {"rgba8", LCT_RGBA, 4, 8},
+        {"rgb16", LCT_RGB, 3, 16},
+        {"rgba16", LCT_RGBA, 4, 16},
+    };
+
+    // Around the 16 and 32 bytes of the SIMD registers, and a screen wide
+    static const unsigned widths[] = {1, 2, 3, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 100, 257, 1920};
+
+    const unsigned height = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 1200;
+    uint64_t total = 14695981039346656037ULL;
+    unsigned long rows = 0;
+
+    for (const Format_t& format : formats) {
+        for (unsigned width : widths) {
+            for (bool adam7 : {false, true}) {
+                const uint64_t hash = check_image(format.name, format.color_type, format.channels, format.bit_depth, width, height, adam7);
+                total = hash_bytes((const unsigned char*)&hash, sizeof(hash), total);
+                rows += height;
+            }
+        }
+    }
+
+    std::cout << rows << " rows, all: " << std::hex << total << std::dec << std::endl;
+    return EXIT_SUCCESS;
+}
+// => main
@@ -0,0 +1,55 @@
+#!/bin/bash
+
+# Builds the benchmarks and checks in bin/bench.
+#
+# The channel benchmark, see ChannelBench.cpp:
+#   ./bin/bench/channelbench [message count]
+#
+# The SIMD unfiltering of lodepng against the scalar code, see
+# UnfilterCheck.cpp. Both must print the same:
+#   diff <(./bin/bench/unfiltercheck) <(./bin/bench/unfiltercheck-scalar)
+#
+# The time-to-interactive of a 2000 achievements list, against the mock
+# Steam API, see InteractiveBench.cpp. Only built if gtk is there. From
+# the root of the repo:
+#   ./bin/bench/interactivebench [run count]
+
+SCRIPT=`realpath $0`
+SCRIPTPATH=`dirname $SCRIPT`
+
+mkdir -p $SCRIPTPATH/../bin/bench
+
+g++ -std=c++17 -g -O2 -Wall \
+$SCRIPTPATH/ChannelBench.cpp \
+$SCRIPTPATH/../SAM.Picker/EmulatorChannel.cpp \
+-o $SCRIPTPATH/../bin/bench/channelbench
+
+g++ -std=c++17 -g -O2 -Wall -pthread \
+$SCRIPTPATH/UnfilterCheck.cpp \
+$SCRIPTPATH/../common/lodepng.cpp \
+-o $SCRIPTPATH/../bin/bench/unfiltercheck
+
+g++ -std=c++17 -g -O2 -Wall -pthread \
+-DLODEPNG_NO_COMPILE_SIMD \
+$SCRIPTPATH/UnfilterCheck.cpp \
+$SCRIPTPATH/../common/lodepng.cpp \
+-o $SCRIPTPATH/../bin/bench/unfiltercheck-scalar
+
+if ! pkg-config --exists gtk+-3.0; then
+    echo "gtk+-3.0 not found, interactivebench is not built" >&2
+    exit 0
+fi
+
+$SCRIPTPATH/../SAM.MockSteam/make.sh
+
+g++ -std=c++17 -g -O2 \
+`pkg-config --cflags gtk+-3.0` \
+-rdynamic -export-dynamic -pthread -Wall \
+$SCRIPTPATH/InteractiveBench.cpp \
+`ls $SCRIPTPATH/../SAM.Picker/*.cpp | grep -v /main.cpp` \
+$SCRIPTPATH/../common/*.cpp \
+-L$SCRIPTPATH/../bin/mock \
+-Wl,-rpath,$SCRIPTPATH/../bin/mock \
+-o $SCRIPTPATH/../bin/bench/interactivebench \
+`pkg-config --libs gtk+-3.0` \
+-lpthread -lgmodule-2.0 -lsteam_api -lcurl -lyajl
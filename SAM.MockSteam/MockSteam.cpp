@@ -0,0 +1,663 @@
+#include "MockSteam.h"
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+#include <unistd.h>
+
+/**
+ * Achievement names are ACH_<index>
+ */
+#define MOCK_ACHIEVEMENT_PREFIX "ACH_"
+
+MockUserStats::MockUserStats()
+:
+m_stats_requested(false)
+{
+    const MockConfig_t& config = mock_get_config();
+
+    m_achieved.resize(config.achievements);
+    m_icon_fetched.resize(config.achievements * 2);
+
+    // Spread evenly, so every filter and sort has something to show
+    for (unsigned i = 0; i < config.achievements; i++) {
+        m_achieved[i] = (i * 100 / config.achievements) < config.unlocked_percent;
+    }
+}
+
+bool
+MockUserStats::RequestCurrentStats() {
+    UserStatsReceived_t result;
+
+    simulate_call();
+    m_stats_requested = true;
+    result.m_nGameID = mock_get_app_id();
+    result.m_eResult = k_EResultOK;
+    result.m_steamIDUser = CSteamID();
+    mock_post_callback(UserStatsReceived_t::k_iCallback, &result, sizeof(result));
+    return true;
+}
+// => RequestCurrentStats
+
+bool
+MockUserStats::GetStat(const char *pchName, int32 *pData) {
+    simulate_call();
+    // The stats themselves are listed in the schema file, any of them exists
+    *pData = (int32)m_stats[pchName];
+    return m_stats_requested;
+}
+// => GetStat
+
+bool
+MockUserStats::GetStat(const char *pchName, float *pData) {
+    simulate_call();
+    *pData = (float)m_stats[pchName];
+    return m_stats_requested;
+}
+// => GetStat
+
+bool
+MockUserStats::SetStat(const char *pchName, int32 nData) {
+    simulate_call();
+    m_stats[pchName] = nData;
+    return m_stats_requested;
+}
+// => SetStat
+
+bool
+MockUserStats::SetStat(const char *pchName, float fData) {
+    simulate_call();
+    m_stats[pchName] = fData;
+    return m_stats_requested;
+}
+// => SetStat
+
+bool
+MockUserStats::UpdateAvgRateStat(const char *pchName, float flCountThisSession, double dSessionLength) {
+    return false;
+}
+// => UpdateAvgRateStat
+
+bool
+MockUserStats::GetAchievement(const char *pchName, bool *pbAchieved) {
+    const int index = find_achievement(pchName);
+
+    simulate_call();
+    if (index < 0 || !m_stats_requested) {
+        return false;
+    }
+
+    *pbAchieved = m_achieved[index];
+    return true;
+}
+// => GetAchievement
+
+bool
+MockUserStats::SetAchievement(const char *pchName) {
+    const int index = find_achievement(pchName);
+
+    simulate_call();
+    if (index < 0 || !m_stats_requested) {
+        return false;
+    }
+
+    m_achieved[index] = true;
+    return true;
+}
+// => SetAchievement
+
+bool
+MockUserStats::ClearAchievement(const char *pchName) {
+    const int index = find_achievement(pchName);
+
+    simulate_call();
+    if (index < 0 || !m_stats_requested) {
+        return false;
+    }
+
+    m_achieved[index] = false;
+    return true;
+}
+// => ClearAchievement
+
+bool
+MockUserStats::GetAchievementAndUnlockTime(const char *pchName, bool *pbAchieved, uint32 *punUnlockTime) {
+    if (!GetAchievement(pchName, pbAchieved)) {
+        return false;
+    }
+
+    *punUnlockTime = *pbAchieved ? (uint32)time(nullptr) : 0;
+    return true;
+}
+// => GetAchievementAndUnlockTime
+
+bool
+MockUserStats::StoreStats() {
+    UserStatsStored_t result;
+
+    simulate_call();
+    if (!m_stats_requested) {
+        return false;
+    }
+
+    result.m_nGameID = mock_get_app_id();
+    result.m_eResult = k_EResultOK;
+    mock_post_callback(UserStatsStored_t::k_iCallback, &result, sizeof(result));
+    return true;
+}
+// => StoreStats
+
+/**
+ * Like Steam, the first call for an icon gives 0, and the handle comes
+ * later in a UserAchievementIconFetched_t.
+ */
+int
+MockUserStats::GetAchievementIcon(const char *pchName) {
+    const int index = find_achievement(pchName);
+    UserAchievementIconFetched_t result = UserAchievementIconFetched_t();
+
+    simulate_call();
+    if (index < 0 || mock_get_config().icon_size == 0) {
+        return 0;
+    }
+
+    const int handle = 2 * index + 1 + (m_achieved[index] ? 1 : 0);
+    if (m_icon_fetched[handle - 1]) {
+        return handle;
+    }
+
+    result.m_nGameID = CGameID((uint64)mock_get_app_id());
+    strncpy(result.m_rgchAchievementName, pchName, k_cchStatNameMax - 1);
+    result.m_bAchieved = m_achieved[index];
+    result.m_nIconHandle = handle;
+    m_icon_fetched[handle - 1] = true;
+    mock_post_callback(UserAchievementIconFetched_t::k_iCallback, &result, sizeof(result));
+    return 0;
+}
+// => GetAchievementIcon
+
+const char *
+MockUserStats::GetAchievementDisplayAttribute(const char *pchName, const char *pchKey) {
+    const int index = find_achievement(pchName);
+
+    simulate_call();
+    if (index < 0) {
+        return "";
+    }
+
+    // Valid until the next call, same as Steam
+    if (strcmp(pchKey, "name") == 0) {
+        m_display_attribute = "Achievement " + std::to_string(index);
+    }
+    else if (strcmp(pchKey, "desc") == 0) {
+        m_display_attribute = "Synthetic achievement number " + std::to_string(index) + " of the mock Steam API";
+    }
+    else if (strcmp(pchKey, "hidden") == 0) {
+        m_display_attribute = (index % 10 == 9) ? "1" : "0";
+    }
+    else {
+        m_display_attribute = "";
+    }
+
+    return m_display_attribute.c_str();
+}
+// => GetAchievementDisplayAttribute
+
+bool
+MockUserStats::IndicateAchievementProgress(const char *pchName, uint32 nCurProgress, uint32 nMaxProgress) {
+    return false;
+}
+// => IndicateAchievementProgress
+
+uint32
+MockUserStats::GetNumAchievements() {
+    simulate_call();
+    return m_achieved.size();
+}
+// => GetNumAchievements
+
+const char *
+MockUserStats::GetAchievementName(uint32 iAchievement) {
+    simulate_call();
+    if (iAchievement >= m_achieved.size()) {
+        return "";
+    }
+
+    m_name = MOCK_ACHIEVEMENT_PREFIX + std::to_string(iAchievement);
+    return m_name.c_str();
+}
+// => GetAchievementName
+
+SteamAPICall_t
+MockUserStats::RequestUserStats(CSteamID steamIDUser) {
+    return k_uAPICallInvalid;
+}
+// => RequestUserStats
+
+bool
+MockUserStats::GetUserStat(CSteamID steamIDUser, const char *pchName, int32 *pData) {
+    return false;
+}
+// => GetUserStat
+
+bool
+MockUserStats::GetUserStat(CSteamID steamIDUser, const char *pchName, float *pData) {
+    return false;
+}
+// => GetUserStat
+
+bool
+MockUserStats::GetUserAchievement(CSteamID steamIDUser, const char *pchName, bool *pbAchieved) {
+    return false;
+}
+// => GetUserAchievement
+
+bool
+MockUserStats::GetUserAchievementAndUnlockTime(CSteamID steamIDUser, const char *pchName, bool *pbAchieved, uint32 *punUnlockTime) {
+    return false;
+}
+// => GetUserAchievementAndUnlockTime
+
+bool
+MockUserStats::ResetAllStats(bool bAchievementsToo) {
+    simulate_call();
+    m_stats.clear();
+    if (bAchievementsToo) {
+        m_achieved.assign(m_achieved.size(), false);
+    }
+    return true;
+}
+// => ResetAllStats
+
+SteamAPICall_t
+MockUserStats::FindOrCreateLeaderboard(const char *pchLeaderboardName, ELeaderboardSortMethod eLeaderboardSortMethod, ELeaderboardDisplayType eLeaderboardDisplayType) {
+    return k_uAPICallInvalid;
+}
+// => FindOrCreateLeaderboard
+
+SteamAPICall_t
+MockUserStats::FindLeaderboard(const char *pchLeaderboardName) {
+    return k_uAPICallInvalid;
+}
+// => FindLeaderboard
+
+const char *
+MockUserStats::GetLeaderboardName(SteamLeaderboard_t hSteamLeaderboard) {
+    return "";
+}
+// => GetLeaderboardName
+
+int
+MockUserStats::GetLeaderboardEntryCount(SteamLeaderboard_t hSteamLeaderboard) {
+    return 0;
+}
+// => GetLeaderboardEntryCount
+
+ELeaderboardSortMethod
+MockUserStats::GetLeaderboardSortMethod(SteamLeaderboard_t hSteamLeaderboard) {
+    return k_ELeaderboardSortMethodNone;
+}
+// => GetLeaderboardSortMethod
+
+ELeaderboardDisplayType
+MockUserStats::GetLeaderboardDisplayType(SteamLeaderboard_t hSteamLeaderboard) {
+    return k_ELeaderboardDisplayTypeNone;
+}
+// => GetLeaderboardDisplayType
+
+SteamAPICall_t
+MockUserStats::DownloadLeaderboardEntries(SteamLeaderboard_t hSteamLeaderboard, ELeaderboardDataRequest eLeaderboardDataRequest, int nRangeStart, int nRangeEnd) {
+    return k_uAPICallInvalid;
+}
+// => DownloadLeaderboardEntries
+
+SteamAPICall_t
+MockUserStats::DownloadLeaderboardEntriesForUsers(SteamLeaderboard_t hSteamLeaderboard, CSteamID *prgUsers, int cUsers) {
+    return k_uAPICallInvalid;
+}
+// => DownloadLeaderboardEntriesForUsers
+
+bool
+MockUserStats::GetDownloadedLeaderboardEntry(SteamLeaderboardEntries_t hSteamLeaderboardEntries, int index, LeaderboardEntry_t *pLeaderboardEntry, int32 *pDetails, int cDetailsMax) {
+    return false;
+}
+// => GetDownloadedLeaderboardEntry
+
+SteamAPICall_t
+MockUserStats::UploadLeaderboardScore(SteamLeaderboard_t hSteamLeaderboard, ELeaderboardUploadScoreMethod eLeaderboardUploadScoreMethod, int32 nScore, const int32 *pScoreDetails, int cScoreDetailsCount) {
+    return k_uAPICallInvalid;
+}
+// => UploadLeaderboardScore
+
+SteamAPICall_t
+MockUserStats::AttachLeaderboardUGC(SteamLeaderboard_t hSteamLeaderboard, UGCHandle_t hUGC) {
+    return k_uAPICallInvalid;
+}
+// => AttachLeaderboardUGC
+
+SteamAPICall_t
+MockUserStats::GetNumberOfCurrentPlayers() {
+    return k_uAPICallInvalid;
+}
+// => GetNumberOfCurrentPlayers
+
+SteamAPICall_t
+MockUserStats::RequestGlobalAchievementPercentages() {
+    GlobalAchievementPercentagesReady_t result;
+
+    simulate_call();
+    result.m_nGameID = mock_get_app_id();
+    result.m_eResult = k_EResultOK;
+    return mock_post_call_result(GlobalAchievementPercentagesReady_t::k_iCallback, &result, sizeof(result));
+}
+// => RequestGlobalAchievementPercentages
+
+/**
+ * The achievements are already sorted from the most to the least
+ * achieved, so the iterator is just the index.
+ */
+int
+MockUserStats::GetMostAchievedAchievementInfo(char *pchName, uint32 unNameBufLen, float *pflPercent, bool *pbAchieved) {
+    return GetNextMostAchievedAchievementInfo(-1, pchName, unNameBufLen, pflPercent, pbAchieved);
+}
+// => GetMostAchievedAchievementInfo
+
+int
+MockUserStats::GetNextMostAchievedAchievementInfo(int iIteratorPrevious, char *pchName, uint32 unNameBufLen, float *pflPercent, bool *pbAchieved) {
+    const int index = iIteratorPrevious + 1;
+
+    simulate_call();
+    if (index < 0 || (unsigned)index >= m_achieved.size()) {
+        return -1;
+    }
+
+    get_achievement_info(index, pchName, unNameBufLen, pflPercent, pbAchieved);
+    return index;
+}
+// => GetNextMostAchievedAchievementInfo
+
+bool
+MockUserStats::GetAchievementAchievedPercent(const char *pchName, float *pflPercent) {
+    const int index = find_achievement(pchName);
+    bool achieved;
+
+    simulate_call();
+    if (index < 0) {
+        return false;
+    }
+
+    get_achievement_info(index, nullptr, 0, pflPercent, &achieved);
+    return true;
+}
+// => GetAchievementAchievedPercent
+
+SteamAPICall_t
+MockUserStats::RequestGlobalStats(int nHistoryDays) {
+    return k_uAPICallInvalid;
+}
+// => RequestGlobalStats
+
+bool
+MockUserStats::GetGlobalStat(const char *pchStatName, int64 *pData) {
+    return false;
+}
+// => GetGlobalStat
+
+bool
+MockUserStats::GetGlobalStat(const char *pchStatName, double *pData) {
+    return false;
+}
+// => GetGlobalStat
+
+int32
+MockUserStats::GetGlobalStatHistory(const char *pchStatName, int64 *pData, uint32 cubData) {
+    return 0;
+}
+// => GetGlobalStatHistory
+
+int32
+MockUserStats::GetGlobalStatHistory(const char *pchStatName, double *pData, uint32 cubData) {
+    return 0;
+}
+// => GetGlobalStatHistory
+
+int
+MockUserStats::find_achievement(const char* name) const {
+    const size_t prefix_length = strlen(MOCK_ACHIEVEMENT_PREFIX);
+    char* end;
+
+    if (strncmp(name, MOCK_ACHIEVEMENT_PREFIX, prefix_length) != 0 || name[prefix_length] == '\0') {
+        return -1;
+    }
+
+    const unsigned long index = strtoul(name + prefix_length, &end, 10);
+    if (*end != '\0' || index >= m_achieved.size()) {
+        return -1;
+    }
+
+    return (int)index;
+}
+// => find_achievement
+
+void
+MockUserStats::get_achievement_info(int index, char* name, uint32 name_length, float* percent, bool* achieved) const {
+    if (name != nullptr && name_length > 0) {
+        snprintf(name, name_length, MOCK_ACHIEVEMENT_PREFIX "%d", index);
+    }
+
+    *percent = 100.f * (m_achieved.size() - index) / (m_achieved.size() + 1);
+    *achieved = m_achieved[index];
+}
+// => get_achievement_info
+
+void
+MockUserStats::simulate_call() const {
+    const unsigned latency = mock_get_config().call_latency_us;
+
+    if (latency > 0) {
+        usleep(latency);
+    }
+}
+// => simulate_call
+
+uint32
+MockUtils::GetSecondsSinceAppActive() {
+    return 0;
+}
+// => GetSecondsSinceAppActive
+
+uint32
+MockUtils::GetSecondsSinceComputerActive() {
+    return 0;
+}
+// => GetSecondsSinceComputerActive
+
+EUniverse
+MockUtils::GetConnectedUniverse() {
+    return k_EUniverseDev;
+}
+// => GetConnectedUniverse
+
+uint32
+MockUtils::GetServerRealTime() {
+    return (uint32)time(nullptr);
+}
+// => GetServerRealTime
+
+const char *
+MockUtils::GetIPCountry() {
+    return "";
+}
+// => GetIPCountry
+
+bool
+MockUtils::GetImageSize(int iImage, uint32 *pnWidth, uint32 *pnHeight) {
+    const unsigned size = mock_get_config().icon_size;
+
+    if (iImage <= 0 || (unsigned)iImage > mock_get_config().achievements * 2 || size == 0) {
+        return false;
+    }
+
+    *pnWidth = size;
+    *pnHeight = size;
+    return true;
+}
+// => GetImageSize
+
+/**
+ * Every handle gets its own pixels, so the icon cache can't merge them.
+ * Locked icons are darker.
+ */
+bool
+MockUtils::GetImageRGBA(int iImage, uint8 *pubDest, int nDestBufferSize) {
+    uint32 width, height;
+
+    if (!GetImageSize(iImage, &width, &height) || (size_t)nDestBufferSize < (size_t)width * height * 4) {
+        return false;
+    }
+
+    const unsigned shift = (iImage % 2 == 1) ? 1 : 0;
+    for (uint32 y = 0; y < height; y++) {
+        for (uint32 x = 0; x < width; x++) {
+            uint8* pixel = pubDest + ((size_t)y * width + x) * 4;
+            pixel[0] = (uint8)(iImage + x * 4) >> shift;
+            pixel[1] = (uint8)((iImage >> 8) + y * 4) >> shift;
+            pixel[2] = (uint8)((iImage >> 16) + (x ^ y)) >> shift;
+            pixel[3] = 255;
+        }
+    }
+
+    return true;
+}
+// => GetImageRGBA
+
+bool
+MockUtils::GetCSERIPPort(uint32 *unIP, uint16 *usPort) {
+    return false;
+}
+// => GetCSERIPPort
+
+uint8
+MockUtils::GetCurrentBatteryPower() {
+    return 255;
+}
+// => GetCurrentBatteryPower
+
+uint32
+MockUtils::GetAppID() {
+    return mock_get_app_id();
+}
+// => GetAppID
+
+void
+MockUtils::SetOverlayNotificationPosition(ENotificationPosition eNotificationPosition) {
+}
+// => SetOverlayNotificationPosition
+
+bool
+MockUtils::IsAPICallCompleted(SteamAPICall_t hSteamAPICall, bool *pbFailed) {
+    return false;
+}
+// => IsAPICallCompleted
+
+ESteamAPICallFailure
+MockUtils::GetAPICallFailureReason(SteamAPICall_t hSteamAPICall) {
+    return k_ESteamAPICallFailureInvalidHandle;
+}
+// => GetAPICallFailureReason
+
+bool
+MockUtils::GetAPICallResult(SteamAPICall_t hSteamAPICall, void *pCallback, int cubCallback, int iCallbackExpected, bool *pbFailed) {
+    return false;
+}
+// => GetAPICallResult
+
+void
+MockUtils::RunFrame() {
+}
+// => RunFrame
+
+uint32
+MockUtils::GetIPCCallCount() {
+    return 0;
+}
+// => GetIPCCallCount
+
+void
+MockUtils::SetWarningMessageHook(SteamAPIWarningMessageHook_t pFunction) {
+}
+// => SetWarningMessageHook
+
+bool
+MockUtils::IsOverlayEnabled() {
+    return false;
+}
+// => IsOverlayEnabled
+
+bool
+MockUtils::BOverlayNeedsPresent() {
+    return false;
+}
+// => BOverlayNeedsPresent
+
+SteamAPICall_t
+MockUtils::CheckFileSignature(const char *szFileName) {
+    return k_uAPICallInvalid;
+}
+// => CheckFileSignature
+
+bool
+MockUtils::ShowGamepadTextInput(EGamepadTextInputMode eInputMode, EGamepadTextInputLineMode eLineInputMode, const char *pchDescription, uint32 unCharMax, const char *pchExistingText) {
+    return false;
+}
+// => ShowGamepadTextInput
+
+uint32
+MockUtils::GetEnteredGamepadTextLength() {
+    return 0;
+}
+// => GetEnteredGamepadTextLength
+
+bool
+MockUtils::GetEnteredGamepadTextInput(char *pchText, uint32 cchText) {
+    return false;
+}
+// => GetEnteredGamepadTextInput
+
+const char *
+MockUtils::GetSteamUILanguage() {
+    return "english";
+}
+// => GetSteamUILanguage
+
+bool
+MockUtils::IsSteamRunningInVR() {
+    return false;
+}
+// => IsSteamRunningInVR
+
+void
+MockUtils::SetOverlayNotificationInset(int nHorizontalInset, int nVerticalInset) {
+}
+// => SetOverlayNotificationInset
+
+bool
+MockUtils::IsSteamInBigPictureMode() {
+    return false;
+}
+// => IsSteamInBigPictureMode
+
+void
+MockUtils::StartVRDashboard() {
+}
+// => StartVRDashboard
+
+bool
+MockUtils::IsVRHeadsetStreamingEnabled() {
+    return false;
+}
+// => IsVRHeadsetStreamingEnabled
+
+void
+MockUtils::SetVRHeadsetStreamingEnabled(bool bEnabled) {
+}
+// => SetVRHeadsetStreamingEnabled
\ No newline at end of file
@@ -0,0 +1,212 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include "../steam/steam_api.h"
+
+/**
+ * Stand-in for libsteam_api.so, for running SAM Rewritten without Steam.
+ *
+ * Every app id gets the same synthetic schema, described by these
+ * environment variables, read once by SteamAPI_Init:
+ *
+ * MOCK_STEAM_ACHIEVEMENTS      number of achievements (100)
+ * MOCK_STEAM_UNLOCKED_PERCENT  share of them already unlocked (30)
+ * MOCK_STEAM_ICON_SIZE         width and height of the icons, 0 for none (64)
+ * MOCK_STEAM_LATENCY_MS        delay before any callback or call result (0)
+ * MOCK_STEAM_CALL_LATENCY_US   time spent in every ISteamUserStats call (0)
+ * MOCK_STEAM_FAIL_INIT         if set, SteamAPI_Init fails
+ *
+ * Nothing is saved, a new process starts over from the schema.
+ */
+struct MockConfig_t {
+    unsigned achievements;
+    unsigned unlocked_percent;
+    unsigned icon_size;
+    unsigned latency_ms;
+    unsigned call_latency_us;
+    bool fail_init;
+};
+
+typedef struct MockConfig_t MockConfig_t;
+
+/**
+ * Gives the configuration, read from the environment on the first call
+ */
+const MockConfig_t& mock_get_config();
+
+/**
+ * The app id given in SteamAppId, as the real library reads it
+ */
+uint32 mock_get_app_id();
+
+/**
+ * Queues a callback, run by SteamAPI_RunCallbacks once the latency elapsed
+ */
+void mock_post_callback(int callback_id, const void* data, size_t size);
+
+/**
+ * Queues a call result, and returns the handle given to CCallResult::Set
+ */
+SteamAPICall_t mock_post_call_result(int callback_id, const void* data, size_t size);
+
+/**
+ * Synthetic achievements and stats of the running app.
+ * Achievement i is called ACH_<i>, its icons have the handles
+ * 2 * i + 1 (locked) and 2 * i + 2 (unlocked).
+ */
+class MockUserStats final : public ISteamUserStats {
+public:
+    MockUserStats();
+
+    virtual bool RequestCurrentStats();
+    virtual bool GetStat(const char *pchName, int32 *pData);
+    virtual bool GetStat(const char *pchName, float *pData);
+    virtual bool SetStat(const char *pchName, int32 nData);
+    virtual bool SetStat(const char *pchName, float fData);
+    virtual bool UpdateAvgRateStat(const char *pchName, float flCountThisSession, double dSessionLength);
+    virtual bool GetAchievement(const char *pchName, bool *pbAchieved);
+    virtual bool SetAchievement(const char *pchName);
+    virtual bool ClearAchievement(const char *pchName);
+    virtual bool GetAchievementAndUnlockTime(const char *pchName, bool *pbAchieved, uint32 *punUnlockTime);
+    virtual bool StoreStats();
+    virtual int GetAchievementIcon(const char *pchName);
+    virtual const char *GetAchievementDisplayAttribute(const char *pchName, const char *pchKey);
+    virtual bool IndicateAchievementProgress(const char *pchName, uint32 nCurProgress, uint32 nMaxProgress);
+    virtual uint32 GetNumAchievements();
+    virtual const char *GetAchievementName(uint32 iAchievement);
+    virtual SteamAPICall_t RequestUserStats(CSteamID steamIDUser);
+    virtual bool GetUserStat(CSteamID steamIDUser, const char *pchName, int32 *pData);
+    virtual bool GetUserStat(CSteamID steamIDUser, const char *pchName, float *pData);
+    virtual bool GetUserAchievement(CSteamID steamIDUser, const char *pchName, bool *pbAchieved);
+    virtual bool GetUserAchievementAndUnlockTime(CSteamID steamIDUser, const char *pchName, bool *pbAchieved, uint32 *punUnlockTime);
+    virtual bool ResetAllStats(bool bAchievementsToo);
+    virtual SteamAPICall_t FindOrCreateLeaderboard(const char *pchLeaderboardName, ELeaderboardSortMethod eLeaderboardSortMethod, ELeaderboardDisplayType eLeaderboardDisplayType);
+    virtual SteamAPICall_t FindLeaderboard(const char *pchLeaderboardName);
+    virtual const char *GetLeaderboardName(SteamLeaderboard_t hSteamLeaderboard);
+    virtual int GetLeaderboardEntryCount(SteamLeaderboard_t hSteamLeaderboard);
+    virtual ELeaderboardSortMethod GetLeaderboardSortMethod(SteamLeaderboard_t hSteamLeaderboard);
+    virtual ELeaderboardDisplayType GetLeaderboardDisplayType(SteamLeaderboard_t hSteamLeaderboard);
+    virtual SteamAPICall_t DownloadLeaderboardEntries(SteamLeaderboard_t hSteamLeaderboard, ELeaderboardDataRequest eLeaderboardDataRequest, int nRangeStart, int nRangeEnd);
+    virtual SteamAPICall_t DownloadLeaderboardEntriesForUsers(SteamLeaderboard_t hSteamLeaderboard, CSteamID *prgUsers, int cUsers);
+    virtual bool GetDownloadedLeaderboardEntry(SteamLeaderboardEntries_t hSteamLeaderboardEntries, int index, LeaderboardEntry_t *pLeaderboardEntry, int32 *pDetails, int cDetailsMax);
+    virtual SteamAPICall_t UploadLeaderboardScore(SteamLeaderboard_t hSteamLeaderboard, ELeaderboardUploadScoreMethod eLeaderboardUploadScoreMethod, int32 nScore, const int32 *pScoreDetails, int cScoreDetailsCount);
+    virtual SteamAPICall_t AttachLeaderboardUGC(SteamLeaderboard_t hSteamLeaderboard, UGCHandle_t hUGC);
+    virtual SteamAPICall_t GetNumberOfCurrentPlayers();
+    virtual SteamAPICall_t RequestGlobalAchievementPercentages();
+    virtual int GetMostAchievedAchievementInfo(char *pchName, uint32 unNameBufLen, float *pflPercent, bool *pbAchieved);
+    virtual int GetNextMostAchievedAchievementInfo(int iIteratorPrevious, char *pchName, uint32 unNameBufLen, float *pflPercent, bool *pbAchieved);
+    virtual bool GetAchievementAchievedPercent(const char *pchName, float *pflPercent);
+    virtual SteamAPICall_t RequestGlobalStats(int nHistoryDays);
+    virtual bool GetGlobalStat(const char *pchStatName, int64 *pData);
+    virtual bool GetGlobalStat(const char *pchStatName, double *pData);
+    virtual int32 GetGlobalStatHistory(const char *pchStatName, int64 *pData, uint32 cubData);
+    virtual int32 GetGlobalStatHistory(const char *pchStatName, double *pData, uint32 cubData);
+
+private:
+    /**
+     * Index of the achievement with the given name, or -1
+     */
+    int find_achievement(const char* name) const;
+    void get_achievement_info(int index, char* name, uint32 name_length, float* percent, bool* achieved) const;
+    void simulate_call() const;
+
+    std::vector<bool> m_achieved;
+    std::vector<bool> m_icon_fetched;
+    std::map<std::string, double> m_stats;
+    std::string m_display_attribute;
+    std::string m_name;
+    bool m_stats_requested;
+};
+
+/**
+ * Draws the synthetic icons, as long as their handle is valid
+ */
+class MockUtils final : public ISteamUtils {
+public:
+    virtual uint32 GetSecondsSinceAppActive();
+    virtual uint32 GetSecondsSinceComputerActive();
+    virtual EUniverse GetConnectedUniverse();
+    virtual uint32 GetServerRealTime();
+    virtual const char *GetIPCountry();
+    virtual bool GetImageSize(int iImage, uint32 *pnWidth, uint32 *pnHeight);
+    virtual bool GetImageRGBA(int iImage, uint8 *pubDest, int nDestBufferSize);
+    virtual bool GetCSERIPPort(uint32 *unIP, uint16 *usPort);
+    virtual uint8 GetCurrentBatteryPower();
+    virtual uint32 GetAppID();
+    virtual void SetOverlayNotificationPosition(ENotificationPosition eNotificationPosition);
+    virtual bool IsAPICallCompleted(SteamAPICall_t hSteamAPICall, bool *pbFailed);
+    virtual ESteamAPICallFailure GetAPICallFailureReason(SteamAPICall_t hSteamAPICall);
+    virtual bool GetAPICallResult(SteamAPICall_t hSteamAPICall, void *pCallback, int cubCallback, int iCallbackExpected, bool *pbFailed);
+    virtual void RunFrame();
+    virtual uint32 GetIPCCallCount();
+    virtual void SetWarningMessageHook(SteamAPIWarningMessageHook_t pFunction);
+    virtual bool IsOverlayEnabled();
+    virtual bool BOverlayNeedsPresent();
+    virtual SteamAPICall_t CheckFileSignature(const char *szFileName);
+    virtual bool ShowGamepadTextInput(EGamepadTextInputMode eInputMode, EGamepadTextInputLineMode eLineInputMode, const char *pchDescription, uint32 unCharMax, const char *pchExistingText);
+    virtual uint32 GetEnteredGamepadTextLength();
+    virtual bool GetEnteredGamepadTextInput(char *pchText, uint32 cchText);
+    virtual const char *GetSteamUILanguage();
+    virtual bool IsSteamRunningInVR();
+    virtual void SetOverlayNotificationInset(int nHorizontalInset, int nVerticalInset);
+    virtual bool IsSteamInBigPictureMode();
+    virtual void StartVRDashboard();
+    virtual bool IsVRHeadsetStreamingEnabled();
+    virtual void SetVRHeadsetStreamingEnabled(bool bEnabled);
+};
+
+/**
+ * Hands out MockUserStats and MockUtils. CSteamAPIContext::Init gives up
+ * if any interface is missing, so the other ones are a placeholder that
+ * must never be called: SAM Rewritten doesn't use them.
+ */
+class MockClient final : public ISteamClient {
+public:
+    MockClient(MockUserStats* stats, MockUtils* utils) : m_stats(stats), m_utils(utils) {};
+
+    virtual HSteamPipe CreateSteamPipe();
+    virtual bool BReleaseSteamPipe(HSteamPipe hSteamPipe);
+    virtual HSteamUser ConnectToGlobalUser(HSteamPipe hSteamPipe);
+    virtual HSteamUser CreateLocalUser(HSteamPipe *phSteamPipe, EAccountType eAccountType);
+    virtual void ReleaseUser(HSteamPipe hSteamPipe, HSteamUser hUser);
+    virtual ISteamUser *GetISteamUser(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion);
+    virtual ISteamGameServer *GetISteamGameServer(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion);
+    virtual void SetLocalIPBinding(uint32 unIP, uint16 usPort);
+    virtual ISteamFriends *GetISteamFriends(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion);
+    virtual ISteamUtils *GetISteamUtils(HSteamPipe hSteamPipe, const char *pchVersion);
+    virtual ISteamMatchmaking *GetISteamMatchmaking(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion);
+    virtual ISteamMatchmakingServers *GetISteamMatchmakingServers(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion);
+    virtual void *GetISteamGenericInterface(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion);
+    virtual ISteamUserStats *GetISteamUserStats(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion);
+    virtual ISteamGameServerStats *GetISteamGameServerStats(HSteamUser hSteamuser, HSteamPipe hSteamPipe, const char *pchVersion);
+    virtual ISteamApps *GetISteamApps(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion);
+    virtual ISteamNetworking *GetISteamNetworking(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion);
+    virtual ISteamRemoteStorage *GetISteamRemoteStorage(HSteamUser hSteamuser, HSteamPipe hSteamPipe, const char *pchVersion);
+    virtual ISteamScreenshots *GetISteamScreenshots(HSteamUser hSteamuser, HSteamPipe hSteamPipe, const char *pchVersion);
+    virtual void RunFrame();
+    virtual uint32 GetIPCCallCount();
+    virtual void SetWarningMessageHook(SteamAPIWarningMessageHook_t pFunction);
+    virtual bool BShutdownIfAllPipesClosed();
+    virtual ISteamHTTP *GetISteamHTTP(HSteamUser hSteamuser, HSteamPipe hSteamPipe, const char *pchVersion);
+    virtual void *DEPRECATED_GetISteamUnifiedMessages(HSteamUser hSteamuser, HSteamPipe hSteamPipe, const char *pchVersion);
+    virtual ISteamController *GetISteamController(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion);
+    virtual ISteamUGC *GetISteamUGC(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion);
+    virtual ISteamAppList *GetISteamAppList(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion);
+    virtual ISteamMusic *GetISteamMusic(HSteamUser hSteamuser, HSteamPipe hSteamPipe, const char *pchVersion);
+    virtual ISteamMusicRemote *GetISteamMusicRemote(HSteamUser hSteamuser, HSteamPipe hSteamPipe, const char *pchVersion);
+    virtual ISteamHTMLSurface *GetISteamHTMLSurface(HSteamUser hSteamuser, HSteamPipe hSteamPipe, const char *pchVersion);
+    virtual void DEPRECATED_Set_SteamAPI_CPostAPIResultInProcess(void (*)());
+    virtual void DEPRECATED_Remove_SteamAPI_CPostAPIResultInProcess(void (*)());
+    virtual void Set_SteamAPI_CCheckCallbackRegisteredInProcess(SteamAPI_CheckCallbackRegistered_t func);
+    virtual ISteamInventory *GetISteamInventory(HSteamUser hSteamuser, HSteamPipe hSteamPipe, const char *pchVersion);
+    virtual ISteamVideo *GetISteamVideo(HSteamUser hSteamuser, HSteamPipe hSteamPipe, const char *pchVersion);
+    virtual ISteamParentalSettings *GetISteamParentalSettings(HSteamUser hSteamuser, HSteamPipe hSteamPipe, const char *pchVersion);
+
+private:
+    template<typename T> T* get_placeholder() const { return (T*)&m_placeholder; };
+
+    MockUserStats* m_stats;
+    MockUtils* m_utils;
+    void* m_placeholder;
+};
\ No newline at end of file
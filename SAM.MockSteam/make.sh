@@ -0,0 +1,17 @@
+#!/bin/bash
+
+# Builds the mock Steam API in bin/mock, see MockSteam.h.
+# Run SAM Rewritten against it with:
+#   LD_LIBRARY_PATH=bin/mock ./bin/samrewritten
+
+SCRIPT=`realpath $0`
+SCRIPTPATH=`dirname $SCRIPT`
+
+mkdir -p $SCRIPTPATH/../bin/mock
+
+g++ -std=c++17 -g -O2 \
+-shared -fPIC -Wall \
+-DSTEAM_API_EXPORTS \
+$SCRIPTPATH/*.cpp \
+-Wl,-soname,libsteam_api.so \
+-o $SCRIPTPATH/../bin/mock/libsteam_api.so
\ No newline at end of file
@@ -0,0 +1,488 @@
+#include "MockSteam.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+
+/**
+ * A callback or call result waiting for its latency to elapse
+ */
+struct QueuedCallback_t {
+    std::chrono::steady_clock::time_point due;
+    int callback_id;
+    SteamAPICall_t call;    // k_uAPICallInvalid for a plain callback
+    std::vector<char> data;
+};
+
+typedef struct QueuedCallback_t QueuedCallback_t;
+
+/**
+ * Layout of the buffer given to SteamInternal_ContextInit,
+ * see SteamInternal_ModuleContext
+ */
+struct ContextInitData_t {
+    void (*init)(void* context);
+    uintp counter;
+    CSteamAPIContext context;
+};
+
+typedef struct ContextInitData_t ContextInitData_t;
+
+/**
+ * Named after the class of the real library, CCallbackBase lets it set
+ * which callback an object waits for.
+ */
+class CCallbackMgr {
+public:
+    static void set_registered(CCallbackBase* callback, int callback_id) {
+        callback->m_iCallback = callback_id;
+        callback->m_nCallbackFlags |= CCallbackBase::k_ECallbackFlagsRegistered;
+    };
+
+    static void set_unregistered(CCallbackBase* callback) {
+        callback->m_nCallbackFlags &= ~CCallbackBase::k_ECallbackFlagsRegistered;
+    };
+};
+
+static MockUserStats* s_stats = nullptr;
+static MockUtils* s_utils = nullptr;
+static MockClient* s_client = nullptr;
+
+// Bumped on every init and shutdown, so the modules fill their context again
+static uintp s_context_counter = 0;
+
+static std::vector<QueuedCallback_t> s_queue;
+static std::map<int, std::vector<CCallbackBase*>> s_callbacks;
+static std::map<SteamAPICall_t, CCallbackBase*> s_call_results;
+static SteamAPICall_t s_next_call = 1;
+
+static unsigned
+read_config_value(const char* name, unsigned default_value) {
+    const char* value = getenv(name);
+
+    if (value == nullptr || *value == '\0') {
+        return default_value;
+    }
+
+    return (unsigned)strtoul(value, nullptr, 10);
+}
+// => read_config_value
+
+static void
+queue_callback(int callback_id, SteamAPICall_t call, const void* data, size_t size) {
+    QueuedCallback_t queued;
+
+    queued.due = std::chrono::steady_clock::now() + std::chrono::milliseconds(mock_get_config().latency_ms);
+    queued.callback_id = callback_id;
+    queued.call = call;
+    queued.data.assign((const char*)data, (const char*)data + size);
+
+    // The latency is the same for all, so the queue stays sorted
+    s_queue.push_back(queued);
+}
+// => queue_callback
+
+const MockConfig_t&
+mock_get_config() {
+    static MockConfig_t config;
+    static bool is_read = false;
+
+    if (!is_read) {
+        config.achievements = read_config_value("MOCK_STEAM_ACHIEVEMENTS", 100);
+        config.unlocked_percent = read_config_value("MOCK_STEAM_UNLOCKED_PERCENT", 30);
+        config.icon_size = read_config_value("MOCK_STEAM_ICON_SIZE", 64);
+        config.latency_ms = read_config_value("MOCK_STEAM_LATENCY_MS", 0);
+        config.call_latency_us = read_config_value("MOCK_STEAM_CALL_LATENCY_US", 0);
+        config.fail_init = getenv("MOCK_STEAM_FAIL_INIT") != nullptr;
+        is_read = true;
+    }
+
+    return config;
+}
+// => mock_get_config
+
+uint32
+mock_get_app_id() {
+    const char* app_id = getenv("SteamAppId");
+    return app_id == nullptr ? 0 : (uint32)strtoul(app_id, nullptr, 10);
+}
+// => mock_get_app_id
+
+void
+mock_post_callback(int callback_id, const void* data, size_t size) {
+    queue_callback(callback_id, k_uAPICallInvalid, data, size);
+}
+// => mock_post_callback
+
+SteamAPICall_t
+mock_post_call_result(int callback_id, const void* data, size_t size) {
+    const SteamAPICall_t call = s_next_call++;
+
+    queue_callback(callback_id, call, data, size);
+    return call;
+}
+// => mock_post_call_result
+
+S_API bool S_CALLTYPE
+SteamAPI_Init() {
+    if (mock_get_config().fail_init) {
+        std::cerr << "[Mock Steam API] SteamAPI_Init fails, as asked by MOCK_STEAM_FAIL_INIT." << std::endl;
+        return false;
+    }
+
+    if (s_client == nullptr) {
+        s_stats = new MockUserStats();
+        s_utils = new MockUtils();
+        s_client = new MockClient(s_stats, s_utils);
+        s_context_counter++;
+    }
+
+    return true;
+}
+// => SteamAPI_Init
+
+S_API void S_CALLTYPE
+SteamAPI_Shutdown() {
+    if (s_client == nullptr) {
+        return;
+    }
+
+    delete s_client;
+    delete s_utils;
+    delete s_stats;
+    s_client = nullptr;
+    s_utils = nullptr;
+    s_stats = nullptr;
+    s_queue.clear();
+    s_context_counter++;
+}
+// => SteamAPI_Shutdown
+
+S_API bool S_CALLTYPE
+SteamAPI_IsSteamRunning() {
+    return s_client != nullptr;
+}
+// => SteamAPI_IsSteamRunning
+
+/**
+ * Runs what is due. What the callbacks queue waits for the next call.
+ */
+S_API void S_CALLTYPE
+SteamAPI_RunCallbacks() {
+    const auto now = std::chrono::steady_clock::now();
+    std::vector<QueuedCallback_t> due;
+    size_t count = 0;
+
+    while (count < s_queue.size() && s_queue[count].due <= now) {
+        count++;
+    }
+
+    due.assign(s_queue.begin(), s_queue.begin() + count);
+    s_queue.erase(s_queue.begin(), s_queue.begin() + count);
+
+    for (QueuedCallback_t& queued : due) {
+        if (queued.call != k_uAPICallInvalid) {
+            const auto call_result = s_call_results.find(queued.call);
+            if (call_result != s_call_results.end()) {
+                CCallbackBase* callback = call_result->second;
+                s_call_results.erase(call_result);
+                callback->Run(queued.data.data(), false, queued.call);
+            }
+            continue;
+        }
+
+        // A callback may unregister itself or an other one
+        const std::vector<CCallbackBase*> callbacks(s_callbacks[queued.callback_id]);
+        for (CCallbackBase* callback : callbacks) {
+            const std::vector<CCallbackBase*>& registered = s_callbacks[queued.callback_id];
+            if (std::find(registered.begin(), registered.end(), callback) != registered.end()) {
+                callback->Run(queued.data.data());
+            }
+        }
+    }
+}
+// => SteamAPI_RunCallbacks
+
+S_API void S_CALLTYPE
+SteamAPI_RegisterCallback(CCallbackBase *pCallback, int iCallback) {
+    CCallbackMgr::set_registered(pCallback, iCallback);
+    s_callbacks[iCallback].push_back(pCallback);
+}
+// => SteamAPI_RegisterCallback
+
+S_API void S_CALLTYPE
+SteamAPI_UnregisterCallback(CCallbackBase *pCallback) {
+    CCallbackMgr::set_unregistered(pCallback);
+
+    std::vector<CCallbackBase*>& callbacks = s_callbacks[pCallback->GetICallback()];
+    callbacks.erase(std::remove(callbacks.begin(), callbacks.end(), pCallback), callbacks.end());
+}
+// => SteamAPI_UnregisterCallback
+
+S_API void S_CALLTYPE
+SteamAPI_RegisterCallResult(CCallbackBase *pCallback, SteamAPICall_t hAPICall) {
+    s_call_results[hAPICall] = pCallback;
+}
+// => SteamAPI_RegisterCallResult
+
+S_API void S_CALLTYPE
+SteamAPI_UnregisterCallResult(CCallbackBase *pCallback, SteamAPICall_t hAPICall) {
+    const auto call_result = s_call_results.find(hAPICall);
+
+    if (call_result != s_call_results.end() && call_result->second == pCallback) {
+        s_call_results.erase(call_result);
+    }
+}
+// => SteamAPI_UnregisterCallResult
+
+S_API HSteamUser
+SteamAPI_GetHSteamUser() {
+    return s_client == nullptr ? 0 : 1;
+}
+// => SteamAPI_GetHSteamUser
+
+S_API HSteamPipe
+SteamAPI_GetHSteamPipe() {
+    return s_client == nullptr ? 0 : 1;
+}
+// => SteamAPI_GetHSteamPipe
+
+S_API void * S_CALLTYPE
+SteamInternal_ContextInit(void *pContextInitData) {
+    ContextInitData_t* data = (ContextInitData_t*)pContextInitData;
+
+    if (data->counter != s_context_counter) {
+        data->init(&data->context);
+        data->counter = s_context_counter;
+    }
+
+    return &data->context;
+}
+// => SteamInternal_ContextInit
+
+S_API void * S_CALLTYPE
+SteamInternal_CreateInterface(const char *ver) {
+    if (s_client == nullptr || strncmp(ver, "SteamClient", strlen("SteamClient")) != 0) {
+        return nullptr;
+    }
+
+    return s_client;
+}
+// => SteamInternal_CreateInterface
+
+HSteamPipe
+MockClient::CreateSteamPipe() {
+    return 1;
+}
+// => CreateSteamPipe
+
+bool
+MockClient::BReleaseSteamPipe(HSteamPipe hSteamPipe) {
+    return true;
+}
+// => BReleaseSteamPipe
+
+HSteamUser
+MockClient::ConnectToGlobalUser(HSteamPipe hSteamPipe) {
+    return 1;
+}
+// => ConnectToGlobalUser
+
+HSteamUser
+MockClient::CreateLocalUser(HSteamPipe *phSteamPipe, EAccountType eAccountType) {
+    return 0;
+}
+// => CreateLocalUser
+
+void
+MockClient::ReleaseUser(HSteamPipe hSteamPipe, HSteamUser hUser) {
+}
+// => ReleaseUser
+
+ISteamUser *
+MockClient::GetISteamUser(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion) {
+    return get_placeholder<ISteamUser>();
+}
+// => GetISteamUser
+
+ISteamGameServer *
+MockClient::GetISteamGameServer(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion) {
+    return nullptr;
+}
+// => GetISteamGameServer
+
+void
+MockClient::SetLocalIPBinding(uint32 unIP, uint16 usPort) {
+}
+// => SetLocalIPBinding
+
+ISteamFriends *
+MockClient::GetISteamFriends(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion) {
+    return get_placeholder<ISteamFriends>();
+}
+// => GetISteamFriends
+
+ISteamUtils *
+MockClient::GetISteamUtils(HSteamPipe hSteamPipe, const char *pchVersion) {
+    return m_utils;
+}
+// => GetISteamUtils
+
+ISteamMatchmaking *
+MockClient::GetISteamMatchmaking(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion) {
+    return get_placeholder<ISteamMatchmaking>();
+}
+// => GetISteamMatchmaking
+
+ISteamMatchmakingServers *
+MockClient::GetISteamMatchmakingServers(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion) {
+    return get_placeholder<ISteamMatchmakingServers>();
+}
+// => GetISteamMatchmakingServers
+
+void *
+MockClient::GetISteamGenericInterface(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion) {
+    return nullptr;
+}
+// => GetISteamGenericInterface
+
+ISteamUserStats *
+MockClient::GetISteamUserStats(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion) {
+    return m_stats;
+}
+// => GetISteamUserStats
+
+ISteamGameServerStats *
+MockClient::GetISteamGameServerStats(HSteamUser hSteamuser, HSteamPipe hSteamPipe, const char *pchVersion) {
+    return nullptr;
+}
+// => GetISteamGameServerStats
+
+ISteamApps *
+MockClient::GetISteamApps(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion) {
+    return get_placeholder<ISteamApps>();
+}
+// => GetISteamApps
+
+ISteamNetworking *
+MockClient::GetISteamNetworking(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion) {
+    return get_placeholder<ISteamNetworking>();
+}
+// => GetISteamNetworking
+
+ISteamRemoteStorage *
+MockClient::GetISteamRemoteStorage(HSteamUser hSteamuser, HSteamPipe hSteamPipe, const char *pchVersion) {
+    return get_placeholder<ISteamRemoteStorage>();
+}
+// => GetISteamRemoteStorage
+
+ISteamScreenshots *
+MockClient::GetISteamScreenshots(HSteamUser hSteamuser, HSteamPipe hSteamPipe, const char *pchVersion) {
+    return get_placeholder<ISteamScreenshots>();
+}
+// => GetISteamScreenshots
+
+void
+MockClient::RunFrame() {
+}
+// => RunFrame
+
+uint32
+MockClient::GetIPCCallCount() {
+    return 0;
+}
+// => GetIPCCallCount
+
+void
+MockClient::SetWarningMessageHook(SteamAPIWarningMessageHook_t pFunction) {
+}
+// => SetWarningMessageHook
+
+bool
+MockClient::BShutdownIfAllPipesClosed() {
+    return false;
+}
+// => BShutdownIfAllPipesClosed
+
+ISteamHTTP *
+MockClient::GetISteamHTTP(HSteamUser hSteamuser, HSteamPipe hSteamPipe, const char *pchVersion) {
+    return get_placeholder<ISteamHTTP>();
+}
+// => GetISteamHTTP
+
+void *
+MockClient::DEPRECATED_GetISteamUnifiedMessages(HSteamUser hSteamuser, HSteamPipe hSteamPipe, const char *pchVersion) {
+    return nullptr;
+}
+// => DEPRECATED_GetISteamUnifiedMessages
+
+ISteamController *
+MockClient::GetISteamController(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion) {
+    return get_placeholder<ISteamController>();
+}
+// => GetISteamController
+
+ISteamUGC *
+MockClient::GetISteamUGC(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion) {
+    return get_placeholder<ISteamUGC>();
+}
+// => GetISteamUGC
+
+ISteamAppList *
+MockClient::GetISteamAppList(HSteamUser hSteamUser, HSteamPipe hSteamPipe, const char *pchVersion) {
+    return get_placeholder<ISteamAppList>();
+}
+// => GetISteamAppList
+
+ISteamMusic *
+MockClient::GetISteamMusic(HSteamUser hSteamuser, HSteamPipe hSteamPipe, const char *pchVersion) {
+    return get_placeholder<ISteamMusic>();
+}
+// => GetISteamMusic
+
+ISteamMusicRemote *
+MockClient::GetISteamMusicRemote(HSteamUser hSteamuser, HSteamPipe hSteamPipe, const char *pchVersion) {
+    return get_placeholder<ISteamMusicRemote>();
+}
+// => GetISteamMusicRemote
+
+ISteamHTMLSurface *
+MockClient::GetISteamHTMLSurface(HSteamUser hSteamuser, HSteamPipe hSteamPipe, const char *pchVersion) {
+    return get_placeholder<ISteamHTMLSurface>();
+}
+// => GetISteamHTMLSurface
+
+void
+MockClient::DEPRECATED_Set_SteamAPI_CPostAPIResultInProcess(void (*)()) {
+}
+// => DEPRECATED_Set_SteamAPI_CPostAPIResultInProcess
+
+void
+MockClient::DEPRECATED_Remove_SteamAPI_CPostAPIResultInProcess(void (*)()) {
+}
+// => DEPRECATED_Remove_SteamAPI_CPostAPIResultInProcess
+
+void
+MockClient::Set_SteamAPI_CCheckCallbackRegisteredInProcess(SteamAPI_CheckCallbackRegistered_t func) {
+}
+// => Set_SteamAPI_CCheckCallbackRegisteredInProcess
+
+ISteamInventory *
+MockClient::GetISteamInventory(HSteamUser hSteamuser, HSteamPipe hSteamPipe, const char *pchVersion) {
+    return get_placeholder<ISteamInventory>();
+}
+// => GetISteamInventory
+
+ISteamVideo *
+MockClient::GetISteamVideo(HSteamUser hSteamuser, HSteamPipe hSteamPipe, const char *pchVersion) {
+    return get_placeholder<ISteamVideo>();
+}
+// => GetISteamVideo
+
+ISteamParentalSettings *
+MockClient::GetISteamParentalSettings(HSteamUser hSteamuser, HSteamPipe hSteamPipe, const char *pchVersion) {
+    return get_placeholder<ISteamParentalSettings>();
+}
+// => GetISteamParentalSettings
\ No newline at end of file
@@ -16,10 +16,14 @@ struct Achievement_t {
     char name[MAX_ACHIEVEMENT_NAME_LENGTH];
     char desc[MAX_ACHIEVEMENT_DESC_LENGTH];
     char id[MAX_ACHIEVEMENT_ID_LENGTH]; // I have no idea what the length limit of this is. Crossing fingers there's none above 256.
-    float global_achieved_rate;  
+    float global_achieved_rate; // In percents, negative if unknown
     int icon_handle; //0 : incorrect, error occurred, RTFM
 	bool achieved;
     bool hidden;
+    bool has_progress; // Some achievements follow a stat, the 3 next values are only set if so
+    float progress_min;
+    float progress_max;
+    float progress;
 };
 
 typedef struct Achievement_t Achievement_t;
\ No newline at end of file
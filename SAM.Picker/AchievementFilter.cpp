@@ -0,0 +1,183 @@
+#include "AchievementFilter.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+AchievementFilter::AchievementFilter()
+:
+m_achievements(nullptr),
+m_count(0),
+m_state_filter(FILTER_ALL),
+m_sort_order(SORT_DEFAULT)
+{
+
+}
+// => Constructor
+
+void
+AchievementFilter::set_achievements(const Achievement_t* achievements, unsigned count) {
+    m_achievements = achievements;
+    m_count = count;
+    m_visible.clear();
+
+    m_search_keys.resize(count);
+    for (unsigned i = 0; i < count; i++) {
+        update_search_key(i);
+    }
+
+    update_sort_keys();
+}
+// => set_achievements
+
+void
+AchievementFilter::update_achievements(const std::vector<unsigned>& changed) {
+    // A new name or description changes what the search finds,
+    // and the name sort uses the search keys
+    for (const unsigned index : changed) {
+        if (index < m_count) {
+            update_search_key(index);
+        }
+    }
+
+    update_sort_keys();
+}
+// => update_achievements
+
+void
+AchievementFilter::update_search_key(unsigned index) {
+    const Achievement_t& achievement = m_achievements[index];
+
+    m_search_keys[index] = to_lower(achievement.name) + "\n" + to_lower(achievement.desc) + "\n" + to_lower(achievement.id);
+}
+// => update_search_key
+
+void
+AchievementFilter::update_sort_keys() {
+    const Achievement_t* achievements = m_achievements;
+
+    m_by_name.resize(m_count);
+    m_by_rarity.resize(m_count);
+    for (unsigned i = 0; i < m_count; i++) {
+        m_by_name[i] = i;
+        m_by_rarity[i] = i;
+    }
+
+    // The search keys start with the lower case name
+    std::stable_sort(m_by_name.begin(), m_by_name.end(), [this](unsigned a, unsigned b) {
+        return m_search_keys[a].compare(0, m_search_keys[a].find('\n'), m_search_keys[b], 0, m_search_keys[b].find('\n')) < 0;
+    });
+
+    // Unknown rarities go last either way
+    std::stable_sort(m_by_rarity.begin(), m_by_rarity.end(), [achievements](unsigned a, unsigned b) {
+        const float rate_a = achievements[a].global_achieved_rate;
+        const float rate_b = achievements[b].global_achieved_rate;
+
+        if ((rate_a < 0) != (rate_b < 0)) {
+            return rate_b < 0;
+        }
+        return rate_a < rate_b;
+    });
+}
+// => update_sort_keys
+
+void
+AchievementFilter::set_search(const std::string& search) {
+    m_search = to_lower(search.c_str());
+}
+// => set_search
+
+void
+AchievementFilter::apply(const PendingModifications& pending) {
+    std::vector<unsigned> fuzzy_matches;
+    const unsigned known_rarities = std::count_if(m_by_rarity.begin(), m_by_rarity.end(), [this](unsigned i) { return m_achievements[i].global_achieved_rate >= 0; });
+
+    m_visible.clear();
+
+    for (unsigned position = 0; position < m_count; position++) {
+        unsigned index;
+
+        switch (m_sort_order) {
+            case SORT_NAME:
+                index = m_by_name[position];
+                break;
+            case SORT_RAREST:
+                index = m_by_rarity[position];
+                break;
+            case SORT_MOST_COMMON:
+                // Backwards through the known ones, then the unknown ones
+                index = (position < known_rarities) ? m_by_rarity[known_rarities - 1 - position] : m_by_rarity[position];
+                break;
+            default:
+                index = position;
+                break;
+        }
+
+        if (!matches_state(index, pending)) {
+            continue;
+        }
+
+        if (m_search.empty() || m_search_keys[index].find(m_search) != std::string::npos) {
+            m_visible.push_back(index);
+        }
+        else if (matches_fuzzy(index)) {
+            fuzzy_matches.push_back(index);
+        }
+    }
+
+    m_visible.insert(m_visible.end(), fuzzy_matches.begin(), fuzzy_matches.end());
+}
+// => apply
+
+bool
+AchievementFilter::matches_state(unsigned index, const PendingModifications& pending) const {
+    const Achievement_t& achievement = m_achievements[index];
+
+    switch (m_state_filter) {
+        case FILTER_LOCKED:
+            return !achievement.achieved;
+        case FILTER_UNLOCKED:
+            return achievement.achieved;
+        case FILTER_HIDDEN:
+            return achievement.hidden;
+        case FILTER_PENDING:
+            return pending.is_achievement_pending(index);
+        default:
+            return true;
+    }
+}
+// => matches_state
+
+/**
+ * True if every character of the search appears in the name, in order.
+ * Spaces in the search are ignored.
+ */
+bool
+AchievementFilter::matches_fuzzy(unsigned index) const {
+    const std::string& key = m_search_keys[index];
+    const size_t name_length = key.find('\n');
+    size_t position = 0;
+
+    for (const char c : m_search) {
+        if (c == ' ') {
+            continue;
+        }
+
+        position = key.find(c, position);
+        if (position == std::string::npos || position >= name_length) {
+            return false;
+        }
+        position++;
+    }
+
+    return true;
+}
+// => matches_fuzzy
+
+std::string
+AchievementFilter::to_lower(const char* text) {
+    std::string lower(text);
+
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    return lower;
+}
+// => to_lower
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include "Achievement.h"
+#include "PendingModifications.h"
+
+/**
+ * Searches, filters and sorts the achievements of the displayed app,
+ * without touching any widget: it only gives the indexes of the
+ * achievements to show, in order. The list then binds its rows to them.
+ *
+ * Sorting by name or rarity uses permutations computed once per list,
+ * so changing the order or the search is a single pass over the indexes.
+ */
+class AchievementFilter {
+public:
+    /**
+     * Which achievements to keep, apart from the search.
+     * Same order as the filter combo box of the main window.
+     */
+    enum StateFilter {
+        FILTER_ALL = 0,
+        FILTER_LOCKED = 1,
+        FILTER_UNLOCKED = 2,
+        FILTER_HIDDEN = 3,
+        FILTER_PENDING = 4
+    };
+
+    /**
+     * Same order as the sort combo box of the main window
+     */
+    enum SortOrder {
+        SORT_DEFAULT = 0,       // As Steam gives them
+        SORT_NAME = 1,
+        SORT_RAREST = 2,
+        SORT_MOST_COMMON = 3
+    };
+
+    AchievementFilter();
+
+    /**
+     * Uses a new list of achievements, and computes its search and sort keys.
+     * The achievements must live until another list is set.
+     */
+    void set_achievements(const Achievement_t* achievements, unsigned count);
+
+    /**
+     * Computes the search keys of the given achievements again, and the
+     * sort keys of all of them, after they changed in place
+     */
+    void update_achievements(const std::vector<unsigned>& changed);
+
+    void set_search(const std::string& search);
+    void set_state_filter(StateFilter filter) { m_state_filter = filter; };
+    void set_sort_order(SortOrder order) { m_sort_order = order; };
+
+    /**
+     * Computes the indexes of the achievements to show. The pending
+     * modifications are needed for FILTER_PENDING.
+     * Achievements whose name, description or id contain the search come
+     * first. Then come the ones whose name contains all the letters of the
+     * search, in the same order (a fuzzy match, "nghtmr" finds "Nightmare").
+     */
+    void apply(const PendingModifications& pending);
+
+    /**
+     * The result of the last apply
+     */
+    const std::vector<unsigned>& get_visible() const { return m_visible; };
+
+private:
+    void update_search_key(unsigned index);
+    void update_sort_keys();
+    bool matches_state(unsigned index, const PendingModifications& pending) const;
+    bool matches_fuzzy(unsigned index) const;
+    static std::string to_lower(const char* text);
+
+    const Achievement_t* m_achievements;
+    unsigned m_count;
+
+    // Lower case "name\ndesc\nid" of every achievement, for the search
+    std::vector<std::string> m_search_keys;
+    // Achievement indexes sorted by name, and from the rarest to the most common
+    std::vector<unsigned> m_by_name;
+    std::vector<unsigned> m_by_rarity;
+
+    std::string m_search;
+    StateFilter m_state_filter;
+    SortOrder m_sort_order;
+    std::vector<unsigned> m_visible;
+};
\ No newline at end of file
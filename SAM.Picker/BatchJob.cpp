@@ -0,0 +1,206 @@
+#include "BatchJob.h"
+
+/**
+ * Small helper, yajl wants unsigned chars and a length
+ */
+static void
+gen_string(yajl_gen gen, const std::string& str) {
+    yajl_gen_string(gen, (const unsigned char*)str.c_str(), str.size());
+}
+
+BatchJob::BatchJob(unsigned max_parallel)
+:
+m_manager(max_parallel)
+{
+
+}
+// => Constructor
+
+bool
+BatchJob::load(const std::string& job_file_path) {
+    std::ifstream input(job_file_path, std::ios::in);
+    std::string line;
+    unsigned line_number = 0;
+
+    if (!input) {
+        std::cerr << "Could not open the job file " << job_file_path << std::endl;
+        return false;
+    }
+
+    while (std::getline(input, line)) {
+        std::istringstream words(line);
+        std::string app_id, action, ach_id, garbage;
+        line_number++;
+
+        if (!(words >> app_id) || app_id[0] == '#') {
+            continue;
+        }
+
+        if (app_id.find_first_not_of("0123456789") != std::string::npos) {
+            std::cerr << job_file_path << ":" << line_number << ": invalid app id " << app_id << std::endl;
+            return false;
+        }
+
+        if (!(words >> action)) {
+            m_manager.add_app(app_id);
+            continue;
+        }
+
+        if (action == "stat") {
+            std::string stat_id, value_text;
+            char* end;
+
+            if (!(words >> stat_id) || !(words >> value_text) || (words >> garbage)) {
+                std::cerr << job_file_path << ":" << line_number << ": expected \"<app id> stat <stat> <value>\"" << std::endl;
+                return false;
+            }
+
+            const double value = strtod(value_text.c_str(), &end);
+            if (*end != '\0') {
+                std::cerr << job_file_path << ":" << line_number << ": invalid stat value " << value_text << std::endl;
+                return false;
+            }
+
+            m_manager.add_modification_stat(app_id, stat_id, value);
+            continue;
+        }
+
+        if ((action != "unlock" && action != "relock") || !(words >> ach_id) || (words >> garbage)) {
+            std::cerr << job_file_path << ":" << line_number << ": expected \"<app id> unlock|relock <achievement>\"" << std::endl;
+            return false;
+        }
+
+        m_manager.add_modification_ach(app_id, ach_id, action == "unlock");
+    }
+
+    return true;
+}
+// => load
+
+bool
+BatchJob::run() {
+    return m_manager.run();
+}
+// => run
+
+void
+BatchJob::write_report(std::ostream& out) const {
+    const unsigned char* buf;
+    size_t len;
+    yajl_gen gen = yajl_gen_alloc(NULL);
+
+    yajl_gen_config(gen, yajl_gen_beautify, 1);
+    yajl_gen_array_open(gen);
+
+    for (const AppAchievements_t& result : m_manager.get_results()) {
+        unsigned unlocked = 0;
+
+        yajl_gen_map_open(gen);
+        gen_string(gen, "app_id");
+        gen_string(gen, result.app_id);
+        gen_string(gen, "success");
+        yajl_gen_bool(gen, result.success);
+        gen_string(gen, "error");
+        gen_string(gen, result.error);
+
+        gen_string(gen, "achievements");
+        yajl_gen_array_open(gen);
+        for (const Achievement_t& ach : result.achievements) {
+            unlocked += ach.achieved ? 1 : 0;
+
+            yajl_gen_map_open(gen);
+            gen_string(gen, "id");
+            gen_string(gen, ach.id);
+            gen_string(gen, "name");
+            gen_string(gen, ach.name);
+            gen_string(gen, "achieved");
+            yajl_gen_bool(gen, ach.achieved);
+            yajl_gen_map_close(gen);
+        }
+        yajl_gen_array_close(gen);
+
+        gen_string(gen, "stats");
+        yajl_gen_array_open(gen);
+        for (const Stat_t& stat : result.stats) {
+            yajl_gen_map_open(gen);
+            gen_string(gen, "id");
+            gen_string(gen, stat.id);
+            gen_string(gen, "name");
+            gen_string(gen, stat.name);
+            gen_string(gen, "value");
+            if (stat.type == STAT_TYPE_INT) {
+                yajl_gen_integer(gen, (long long)stat.value);
+            } else {
+                yajl_gen_double(gen, stat.value);
+            }
+            yajl_gen_map_close(gen);
+        }
+        yajl_gen_array_close(gen);
+
+        gen_string(gen, "unlocked");
+        yajl_gen_integer(gen, unlocked);
+        gen_string(gen, "total");
+        yajl_gen_integer(gen, result.achievements.size());
+        yajl_gen_map_close(gen);
+    }
+
+    yajl_gen_array_close(gen);
+    yajl_gen_get_buf(gen, &buf, &len);
+    out.write((const char*)buf, len);
+    out.flush();
+    yajl_gen_free(gen);
+}
+// => write_report
+
+int
+BatchJob::main(int argc, char *argv[]) {
+    const std::string usage("Usage: samrewritten --batch <job file> [--parallel <n>] [--report <file>]");
+    std::string job_file_path;
+    std::string report_path;
+    unsigned max_parallel = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg(argv[i]);
+
+        if (arg == "--batch" && i + 1 < argc) {
+            job_file_path = argv[++i];
+        }
+        else if (arg == "--parallel" && i + 1 < argc) {
+            max_parallel = strtoul(argv[++i], NULL, 10);
+        }
+        else if (arg == "--report" && i + 1 < argc) {
+            report_path = argv[++i];
+        }
+        else {
+            std::cerr << usage << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (job_file_path.empty()) {
+        std::cerr << usage << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    BatchJob job(max_parallel);
+    if (!job.load(job_file_path)) {
+        return EXIT_FAILURE;
+    }
+
+    const bool success = job.run();
+
+    if (report_path.empty()) {
+        job.write_report(std::cout);
+    }
+    else {
+        std::ofstream report(report_path, std::ios::out | std::ios::trunc);
+        if (!report) {
+            std::cerr << "Could not write the report to " << report_path << std::endl;
+            return EXIT_FAILURE;
+        }
+        job.write_report(report);
+    }
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+// => main
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <yajl/yajl_gen.h>
+#include "GameEmulatorManager.h"
+
+/**
+ * Runs SAM without any GUI, from a job file. This is what
+ * "samrewritten --batch" does.
+ *
+ * The job file has one instruction per line, empty lines and lines
+ * starting with # are ignored:
+ *
+ *      <app id>                        Only read the achievements
+ *      <app id> unlock <achievement>   Unlock an achievement
+ *      <app id> relock <achievement>   Relock an achievement
+ *      <app id> stat <stat> <value>    Set a stat
+ *
+ * Use * as the achievement to unlock or relock them all.
+ *
+ * The report is a JSON array, with one object per app:
+ * { "app_id", "success", "error", "unlocked", "total", "achievements": [ { "id", "name", "achieved" } ],
+ *   "stats": [ { "id", "name", "value" } ] }
+ */
+class BatchJob {
+public:
+    /**
+     * max_parallel is the number of apps loaded at the same time,
+     * 0 means one per core.
+     */
+    BatchJob(unsigned max_parallel);
+
+    /**
+     * Reads a job file. Returns false and prints the faulty line
+     * if it isn't valid.
+     */
+    bool load(const std::string& job_file_path);
+
+    /**
+     * Runs every job. Returns true if all apps succeeded.
+     */
+    bool run();
+
+    /**
+     * Writes the machine-readable report of the last run
+     */
+    void write_report(std::ostream& out) const;
+
+    /**
+     * Entry point for the command line. Parses the arguments coming after
+     * --batch, runs the job and returns the exit code of the program.
+     */
+    static int main(int argc, char *argv[]);
+
+private:
+    GameEmulatorManager m_manager;
+};
\ No newline at end of file
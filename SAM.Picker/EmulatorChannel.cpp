@@ -0,0 +1,324 @@
+#include "EmulatorChannel.h"
+#include <iostream>
+#include <algorithm>
+#include <new>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+/**
+ * Where the data of each ring starts in the shared memory: the
+ * ChannelHeader_t comes first, on its own page
+ */
+#define RING_DATA_OFFSET 4096
+
+static_assert(sizeof(ChannelHeader_t) <= RING_DATA_OFFSET, "The channel header must fit in its page");
+
+/**
+ * Copies count bytes into a ring at the given position, wrapping around
+ */
+static void
+copy_to_ring(unsigned char* ring, size_t ring_size, uint64_t pos, const unsigned char* src, size_t count) {
+    const size_t start = pos % ring_size;
+    const size_t first = std::min(count, ring_size - start);
+
+    memcpy(ring + start, src, first);
+    memcpy(ring, src + first, count - first);
+}
+
+static void
+copy_from_ring(const unsigned char* ring, size_t ring_size, uint64_t pos, unsigned char* dst, size_t count) {
+    const size_t start = pos % ring_size;
+    const size_t first = std::min(count, ring_size - start);
+
+    memcpy(dst, ring + start, first);
+    memcpy(dst + first, ring, count - first);
+}
+
+EmulatorChannel::EmulatorChannel()
+:
+m_memory(MAP_FAILED),
+m_header(nullptr),
+m_in(nullptr),
+m_out(nullptr),
+m_parent_bell(-1),
+m_child_bell(-1),
+m_own_bell(-1),
+m_peer_bell(-1),
+m_lifeline(-1)
+{
+    m_sockets[0] = -1;
+    m_sockets[1] = -1;
+}
+// => Constructor
+
+EmulatorChannel::~EmulatorChannel() {
+    if (m_memory != MAP_FAILED) {
+        munmap(m_memory, RING_DATA_OFFSET + EMULATOR_COMMAND_RING_SIZE + EMULATOR_RESULT_RING_SIZE);
+    }
+
+    const int fds[4] = { m_parent_bell, m_child_bell, m_sockets[0], m_sockets[1] };
+    for (const int fd : fds) {
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+}
+// => Destructor
+
+/**
+ * The memory is anonymous and shared, so the child inherits it with fork,
+ * nothing has a name in /dev/shm.
+ */
+EmulatorChannel*
+EmulatorChannel::create() {
+    EmulatorChannel* channel = new EmulatorChannel();
+    const size_t size = RING_DATA_OFFSET + EMULATOR_COMMAND_RING_SIZE + EMULATOR_RESULT_RING_SIZE;
+
+    channel->m_memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    channel->m_parent_bell = eventfd(0, EFD_NONBLOCK);
+    channel->m_child_bell = eventfd(0, EFD_NONBLOCK);
+
+    if (channel->m_memory == MAP_FAILED
+        || channel->m_parent_bell == -1
+        || channel->m_child_bell == -1
+        || socketpair(AF_UNIX, SOCK_STREAM, 0, channel->m_sockets) == -1) {
+        std::cerr << "Could not create a channel to the Steam game, errno: " << errno << std::endl;
+        delete channel;
+        return nullptr;
+    }
+
+    unsigned char* memory = (unsigned char*)channel->m_memory;
+    channel->m_header = new (memory) ChannelHeader_t();
+    channel->m_command_data = memory + RING_DATA_OFFSET;
+    channel->m_result_data = memory + RING_DATA_OFFSET + EMULATOR_COMMAND_RING_SIZE;
+
+    return channel;
+}
+// => create
+
+void
+EmulatorChannel::use_as_parent() {
+    m_out = &m_header->commands;
+    m_out_data = m_command_data;
+    m_out_size = EMULATOR_COMMAND_RING_SIZE;
+    m_in = &m_header->results;
+    m_in_data = m_result_data;
+    m_in_size = EMULATOR_RESULT_RING_SIZE;
+    m_own_bell = m_parent_bell;
+    m_peer_bell = m_child_bell;
+
+    close(m_sockets[1]);
+    m_sockets[1] = -1;
+    m_lifeline = m_sockets[0];
+}
+// => use_as_parent
+
+void
+EmulatorChannel::use_as_child() {
+    m_out = &m_header->results;
+    m_out_data = m_result_data;
+    m_out_size = EMULATOR_RESULT_RING_SIZE;
+    m_in = &m_header->commands;
+    m_in_data = m_command_data;
+    m_in_size = EMULATOR_COMMAND_RING_SIZE;
+    m_own_bell = m_child_bell;
+    m_peer_bell = m_parent_bell;
+
+    close(m_sockets[0]);
+    m_sockets[0] = -1;
+    m_lifeline = m_sockets[1];
+}
+// => use_as_child
+
+/**
+ * The waiting flags and positions are stored and loaded with sequential
+ * consistency: a writer publishing its data then checking reader_waiting,
+ * and a reader setting reader_waiting then checking for data, can't both
+ * miss each other. Either the reader sees the data, or the writer rings.
+ */
+bool
+EmulatorChannel::write(const void* buf, size_t count) {
+    const unsigned char* ptr = (const unsigned char*)buf;
+
+    while (count > 0) {
+        const size_t chunk = write_some(ptr, count);
+
+        if (chunk == 0) {
+            if (can_sleep_for_room() && !wait()) {
+                m_out->writer_waiting.store(0);
+                return false;
+            }
+            m_out->writer_waiting.store(0, std::memory_order_relaxed);
+
+            // The doorbell may have been rung for incoming data too,
+            // whoever watches it must still hear about it
+            if (has_data()) {
+                ring(m_own_bell);
+            }
+            continue;
+        }
+
+        ptr += chunk;
+        count -= chunk;
+    }
+
+    return true;
+}
+// => write
+
+bool
+EmulatorChannel::read(void* buf, size_t count) {
+    unsigned char* ptr = (unsigned char*)buf;
+
+    while (count > 0) {
+        const size_t chunk = read_some(ptr, count);
+
+        if (chunk == 0) {
+            // What was written before hanging up can still be read
+            if (can_sleep() && !wait() && !has_data()) {
+                m_in->reader_waiting.store(0);
+                return false;
+            }
+            m_in->reader_waiting.store(0, std::memory_order_relaxed);
+            continue;
+        }
+
+        ptr += chunk;
+        count -= chunk;
+    }
+
+    return true;
+}
+// => read
+
+size_t
+EmulatorChannel::write_some(const void* buf, size_t count) {
+    const uint64_t write_pos = m_out->write_pos.load(std::memory_order_relaxed);
+    const size_t room = m_out_size - (write_pos - m_out->read_pos.load(std::memory_order_acquire));
+    const size_t chunk = std::min(count, room);
+
+    if (chunk == 0) {
+        return 0;
+    }
+
+    copy_to_ring(m_out_data, m_out_size, write_pos, (const unsigned char*)buf, chunk);
+    m_out->write_pos.store(write_pos + chunk);
+
+    // Only the first write after the reader fell asleep rings, it
+    // then reads everything there is before sleeping again
+    if (m_out->reader_waiting.exchange(0)) {
+        ring(m_peer_bell);
+    }
+
+    return chunk;
+}
+// => write_some
+
+size_t
+EmulatorChannel::read_some(void* buf, size_t count) {
+    const uint64_t read_pos = m_in->read_pos.load(std::memory_order_relaxed);
+    const size_t chunk = std::min(count, (size_t)(m_in->write_pos.load(std::memory_order_acquire) - read_pos));
+
+    if (chunk == 0) {
+        return 0;
+    }
+
+    copy_from_ring(m_in_data, m_in_size, read_pos, (unsigned char*)buf, chunk);
+    m_in->read_pos.store(read_pos + chunk);
+
+    if (m_in->writer_waiting.exchange(0)) {
+        ring(m_peer_bell);
+    }
+
+    return chunk;
+}
+// => read_some
+
+bool
+EmulatorChannel::has_data() const {
+    return m_in->write_pos.load(std::memory_order_acquire) != m_in->read_pos.load(std::memory_order_relaxed);
+}
+// => has_data
+
+size_t
+EmulatorChannel::get_available() const {
+    return m_in->write_pos.load(std::memory_order_acquire) - m_in->read_pos.load(std::memory_order_relaxed);
+}
+// => get_available
+
+bool
+EmulatorChannel::can_sleep() {
+    m_in->reader_waiting.store(1);
+    return m_in->write_pos.load() == m_in->read_pos.load(std::memory_order_relaxed);
+}
+// => can_sleep
+
+bool
+EmulatorChannel::can_sleep_for_room() {
+    m_out->writer_waiting.store(1);
+    return m_out->write_pos.load(std::memory_order_relaxed) - m_out->read_pos.load() == m_out_size;
+}
+// => can_sleep_for_room
+
+void
+EmulatorChannel::acknowledge() {
+    uint64_t rings;
+
+    m_in->reader_waiting.store(0, std::memory_order_relaxed);
+    // Non blocking, fails with EAGAIN if it didn't ring
+    while (::read(m_own_bell, &rings, sizeof(rings)) == -1 && errno == EINTR) {}
+}
+// => acknowledge
+
+/**
+ * Nothing is ever written on the socket pair, so the lifeline becoming
+ * readable means the other end got closed.
+ */
+bool
+EmulatorChannel::wait(int timeout_ms) {
+    struct pollfd poll_fds[2];
+    uint64_t rings;
+
+    poll_fds[0].fd = m_own_bell;
+    poll_fds[0].events = POLLIN;
+    poll_fds[0].revents = 0;
+    poll_fds[1].fd = m_lifeline;
+    poll_fds[1].events = POLLIN;
+    poll_fds[1].revents = 0;
+
+    if (poll(poll_fds, 2, timeout_ms) == -1) {
+        return errno == EINTR;
+    }
+
+    if (poll_fds[1].revents != 0) {
+        return false;
+    }
+
+    if (poll_fds[0].revents != 0) {
+        while (::read(m_own_bell, &rings, sizeof(rings)) == -1 && errno == EINTR) {}
+    }
+
+    return true;
+}
+// => wait
+
+void
+EmulatorChannel::get_fds(int* fds) const {
+    fds[0] = m_parent_bell;
+    fds[1] = m_child_bell;
+    fds[2] = m_lifeline;
+}
+// => get_fds
+
+void
+EmulatorChannel::ring(int bell) {
+    const uint64_t one = 1;
+
+    while (::write(bell, &one, sizeof(one)) == -1 && errno == EINTR) {}
+}
+// => ring
\ No newline at end of file
@@ -0,0 +1,186 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Size in bytes of the ring carrying the commands, from the parent to
+ * an emulator process. A command is a few hundred bytes.
+ */
+#define EMULATOR_COMMAND_RING_SIZE (256 * 1024)
+
+/**
+ * Size in bytes of the ring carrying the results, from an emulator
+ * process to the parent. Icons are the biggest, they go through in
+ * several rounds if they don't fit.
+ */
+#define EMULATOR_RESULT_RING_SIZE (1024 * 1024)
+
+/**
+ * The shared state of one ring. Each position is on its own cache line,
+ * so the reader and the writer don't fight over it.
+ * Positions only grow, the offset in the ring is position % size.
+ */
+struct RingHeader_t {
+    alignas(64) std::atomic<uint64_t> write_pos;
+    alignas(64) std::atomic<uint64_t> read_pos;
+    alignas(64) std::atomic<uint32_t> reader_waiting;   // The reader sleeps, or is about to
+    std::atomic<uint32_t> writer_waiting;               // The writer waits for room
+};
+
+typedef struct RingHeader_t RingHeader_t;
+
+/**
+ * The shared state that isn't part of a ring
+ */
+struct ChannelHeader_t {
+    RingHeader_t commands;
+    RingHeader_t results;
+    alignas(64) std::atomic<uint64_t> heartbeat;    // Counted up by the child as long as it runs
+};
+
+typedef struct ChannelHeader_t ChannelHeader_t;
+
+/**
+ * Connects the parent to one emulator process, replacing a pair of pipes.
+ *
+ * Each direction is a single producer, single consumer ring in memory
+ * shared by both processes, so sending and receiving are plain copies.
+ * Each process has an eventfd doorbell, which the other one only rings
+ * when it was told the process sleeps (reader_waiting, writer_waiting).
+ * A process busy reading or writing is never woken with a syscall.
+ * A socket pair is kept open between the two, for the sole purpose of
+ * telling when the other process is gone. A heartbeat counter tells if
+ * the child still runs, or is stuck.
+ *
+ * Create it before forking, then each process calls use_as_parent or
+ * use_as_child.
+ */
+class EmulatorChannel {
+public:
+    /**
+     * Maps the rings and creates the doorbells.
+     * Returns nullptr if the system refused.
+     */
+    static EmulatorChannel* create();
+    ~EmulatorChannel();
+
+    void use_as_parent();
+    void use_as_child();
+
+    /**
+     * Copies count bytes to the other process, waiting for room if the
+     * ring is full. Returns false if the other process is gone.
+     */
+    bool write(const void* buf, size_t count);
+
+    /**
+     * Copies count bytes from the other process, waiting for them if
+     * needed. Returns false if the other process is gone.
+     */
+    bool read(void* buf, size_t count);
+
+    /**
+     * Copies as much of count bytes as there is room for right away, and
+     * returns how many it copied. Never waits.
+     */
+    size_t write_some(const void* buf, size_t count);
+
+    /**
+     * Copies up to count bytes that are there to read right away, and
+     * returns how many it copied. Never waits.
+     */
+    size_t read_some(void* buf, size_t count);
+
+    /**
+     * True if there is something to read right away
+     */
+    bool has_data() const;
+
+    /**
+     * How many bytes there are to read right away
+     */
+    size_t get_available() const;
+
+    /**
+     * To be called before going to sleep on the doorbell, in a poll or a
+     * main loop: from now on, the other process rings it when it writes.
+     * Returns false if something came in meanwhile, and sleeping would
+     * miss it.
+     */
+    bool can_sleep();
+
+    /**
+     * To be called before going to sleep with something left to write:
+     * from now on, the other process rings the doorbell when it reads.
+     * Returns false if there is room already, and sleeping would wait
+     * for nothing.
+     */
+    bool can_sleep_for_room();
+
+    /**
+     * To be called once woken up by the doorbell: silences it, and tells
+     * the other process it doesn't need to ring anymore.
+     */
+    void acknowledge();
+
+    /**
+     * Sleeps until the doorbell rings, for at most timeout_ms (-1 for no
+     * limit). Returns false if the other process is gone.
+     */
+    bool wait(int timeout_ms = -1);
+
+    /**
+     * Child side. Tells the parent we are not stuck, costs no syscall.
+     */
+    void beat() { m_header->heartbeat.fetch_add(1, std::memory_order_relaxed); };
+
+    /**
+     * Parent side. Changes as long as the child beats.
+     */
+    uint64_t get_heartbeat() const { return m_header->heartbeat.load(std::memory_order_relaxed); };
+
+    /**
+     * Readable when the doorbell rings, for poll or the GTK main loop
+     */
+    int get_doorbell_fd() const { return m_own_bell; };
+
+    /**
+     * Hangs up when the other process is gone, for poll or the GTK main loop
+     */
+    int get_lifeline_fd() const { return m_lifeline; };
+
+    /**
+     * The file descriptors a freshly forked child must keep open,
+     * see close_inherited_fds
+     */
+    static const unsigned FD_COUNT = 3;
+    void get_fds(int* fds) const;
+
+    EmulatorChannel(EmulatorChannel const&)     = delete;
+    void operator=(EmulatorChannel const&)      = delete;
+
+private:
+    EmulatorChannel();
+    static void ring(int bell);
+
+    void* m_memory;
+    ChannelHeader_t* m_header;
+    unsigned char* m_command_data;
+    unsigned char* m_result_data;
+
+    // Set by use_as_parent and use_as_child
+    RingHeader_t* m_in;
+    RingHeader_t* m_out;
+    unsigned char* m_in_data;
+    unsigned char* m_out_data;
+    size_t m_in_size;
+    size_t m_out_size;
+
+    int m_parent_bell;
+    int m_child_bell;
+    int m_own_bell;
+    int m_peer_bell;
+    int m_sockets[2];
+    int m_lifeline;
+};
\ No newline at end of file
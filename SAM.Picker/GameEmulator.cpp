@@ -1,24 +1,37 @@
 #include "GameEmulator.h"
+#include "MySteam.h"
+#include "KeyValue.h"
+#include <glib-unix.h>
+#include <sys/stat.h>
+
+/**
+ * Set in the child once SteamAPI_Init succeeded, so a spare child
+ * doesn't try to shut down an API it never started.
+ */
+static bool s_steam_api_running = false;
 
 /****************************
  * SIGNAL CALLBACKS
  ****************************/
 
 /**
- * Used by the child process when the parent tells him to 
+ * Used by the child process when the parent tells him to
  * stop the steam app. The child process will die.
  */
-void 
+void
 handle_sigterm(int signum) {
-    SteamAPI_Shutdown();
+    if (s_steam_api_running) {
+        SteamAPI_Shutdown();
+    }
     exit(EXIT_SUCCESS);
 }
 
 /**
- * Used by the parent process to remove the zombie process
- * of the child, once it terminated
+ * Used by the parent process to remove the zombie processes
+ * of the children, once they terminated. The channel of the child is
+ * cleaned up by on_worker_hangup, which gets notified by the main loop.
  */
-void 
+void
 handle_sigchld(int signum) {
     pid_t pid;
     GameEmulator* emulator = GameEmulator::get_instance();
@@ -31,95 +44,87 @@ handle_sigchld(int signum) {
             return;
         else {
             std::cerr << "Steam game terminated." << std::endl;
-            emulator->m_son_pid = -1;
+            for (unsigned i = 0; i < EMULATOR_POOL_SIZE; i++) {
+                if (emulator->m_workers[i].pid == pid) {
+                    emulator->m_workers[i].pid = -1;
+                }
+            }
         }
     }
 }
 
+/****************************
+ * MAIN LOOP CALLBACKS
+ ****************************/
+
 /**
- * When the parent receives SIGUSR1, it will read the pipe,
- * and if everything goes well, it should fill the member 
- * achievements list, and the achievement count.
- * Once done, will update the view
- * 
- * TODO: Check for errors
+ * Called by the GTK main loop when a child rang the doorbell of its
+ * channel: it wrote results while we were not reading, or made room for
+ * the commands waiting in the outbox.
+ * Everything waiting in the ring is read before going back to sleep.
  */
-void handle_sigusr1_parent(int signum) {
+gboolean
+on_worker_result(gint fd, GIOCondition condition, gpointer user_data) {
     GameEmulator *inst = GameEmulator::get_instance();
-    Achievement_t achievement;
-
-    read(inst->m_pipe[0], &inst->m_achievement_count, sizeof(unsigned));
-
-    if (inst->m_achievement_list != nullptr) {
-        free(inst->m_achievement_list);
-        inst->m_achievement_list = nullptr;
-    }
+    const int index = GPOINTER_TO_INT(user_data);
+    EmulatorChannel* channel = inst->m_workers[index].channel;
 
-    inst->m_achievement_list = (Achievement_t*)malloc(inst->m_achievement_count * sizeof(Achievement_t));
-    
-    if (!inst->m_achievement_list) {
-        std::cerr << "ERROR: could not allocate memory." << std::endl;
-        exit(EXIT_FAILURE);
-    }
+    channel->acknowledge();
+    do {
+        inst->flush_commands(index);
 
-    //TODO see if I can read directly in the achievements list
-    //That would avoid the memcpy
-    for (unsigned i = 0; i < inst->m_achievement_count; i++) {
-        read(inst->m_pipe[0], &achievement, sizeof(Achievement_t));
-        memcpy(&(inst->m_achievement_list[i]), &achievement, sizeof(Achievement_t));
-    }
+        if (!inst->read_results(index)) {
+            // The child is talking nonsense
+            inst->m_workers[index].watch_id = 0;
+            inst->handle_worker_failure(index, "The Steam game sent something unexpected");
+            return G_SOURCE_REMOVE;
+        }
+    } while (!channel->can_sleep());
 
-    inst->update_view();
+    return G_SOURCE_CONTINUE;
 }
 
 /**
- * When the son process receives SIGUSR1, it will retrieve all achievements,
- * and send a SIGUSR1 signal to the parent when done, and start writing 
- * to the pipe.
+ * Called by the GTK main loop when a child died, and its end of the
+ * lifeline got closed. What it wrote before is read first.
  */
-void handle_sigusr1_child(int signum) {
-    std::cerr << "I'm the child, and I received SIGUSR1, which means I must retrieve achievements and tell them to my parent through a pipe." << std::endl;
+gboolean
+on_worker_hangup(gint fd, GIOCondition condition, gpointer user_data) {
     GameEmulator *inst = GameEmulator::get_instance();
-    inst->retrieve_achievements();
+    const int index = GPOINTER_TO_INT(user_data);
+
+    inst->read_results(index);
+
+    inst->m_workers[index].hangup_watch_id = 0;
+    inst->handle_worker_failure(index, "The Steam game crashed");
+    return G_SOURCE_REMOVE;
 }
 
 /**
- * We are the child and we will receive data/stats of achievements to unlock/relock
- * Data will have this shitty format:
- * - 1 char, a for "achievement", or s for "stat"
- * - 1 unsigned int, 0 => locked, 1 => unlocked, or the stat progression
- * - The length of MAX_ID_LENGTH to get the achievement ID
- * 
- * If someone wants to update this repo, maybe IPC is too low level for what I want
- * to achieve. This doesn't require super fast speed or anything, maybe see if 
- * TCP server is easier to use. Or at least one type of interfacing because this code
- * gets really ugly over time, bad practices become usual.
+ * Called every EMULATOR_HEARTBEAT_CHECK_SECONDS while a game is displayed
  */
-void handle_sigusr2_child(int signum) {
+gboolean
+on_heartbeat_check(gpointer user_data) {
     GameEmulator *inst = GameEmulator::get_instance();
-    ISteamUserStats *stats_api = SteamUserStats();
-    int* pipe = inst->m_pipe;
-    char type;
-    unsigned value;
-    char achievement_id[MAX_ACHIEVEMENT_ID_LENGTH];
-
-    read(pipe[0], &type, sizeof(char));
-    read(pipe[0], &value, sizeof(unsigned));
-    read(pipe[0], &achievement_id, MAX_ACHIEVEMENT_ID_LENGTH * sizeof(char));
 
-    if (type == 'a') {
-        // We want to edit an achievement
-        if (value == 0) {
-            // We want to relock an achievement
-            stats_api->ClearAchievement(achievement_id);
-        } else {
-            // We want to unlock an achievement
-            stats_api->SetAchievement(achievement_id);
-        }
+    inst->check_heartbeat();
 
-    } else {
-        // We want to edit a stat
+    if (inst->m_active_worker == -1) {
+        inst->m_heartbeat_timer_id = 0;
+        return G_SOURCE_REMOVE;
     }
+
+    return G_SOURCE_CONTINUE;
+}
+
+/**
+ * Called once in a while after a game was put in the background,
+ * to kill the ones nobody came back to.
+ */
+gboolean
+on_idle_grace_expired(gpointer user_data) {
+    GameEmulator::get_instance()->prune_idle_workers();
+    return G_SOURCE_REMOVE;
 }
 
 
@@ -127,13 +132,33 @@ void handle_sigusr2_child(int signum) {
  * CLASS METHODS DEFINITION
  ********************************/
 
-GameEmulator::GameEmulator() : 
+GameEmulator::GameEmulator() :
 m_CallbackUserStatsReceived( this, &GameEmulator::OnUserStatsReceived ),
+m_CallbackAchievementIconFetched( this, &GameEmulator::OnAchievementIconFetched ),
 m_achievement_list( nullptr ),
-m_son_pid( -1 ),
-m_have_stats_been_requested( false )
+m_stats_request_answers( 0 ),
+m_refreshes_waiting( 0 ),
+m_user_stats_answers_due( 0 ),
+m_achievement_count( 0 ),
+m_stat_list( nullptr ),
+m_stat_count( 0 ),
+m_active_worker( -1 ),
+m_heartbeat_timer_id( 0 ),
+m_last_heartbeat( 0 ),
+m_last_heartbeat_change( 0 ),
+m_channel( nullptr ),
+m_have_user_stats( false ),
+m_have_global_percentages_been_requested( false ),
+m_have_icons_been_requested( false )
 {
-
+    for (unsigned i = 0; i < EMULATOR_POOL_SIZE; i++) {
+        m_workers[i].pid = -1;
+        m_workers[i].channel = nullptr;
+        m_workers[i].watch_id = 0;
+        m_workers[i].hangup_watch_id = 0;
+        m_workers[i].app_id[0] = '\0';
+        m_workers[i].last_used = 0;
+    }
 }
 // => Constructor
 
@@ -147,50 +172,56 @@ GameEmulator::get_instance() {
 bool
 GameEmulator::init_app(const std::string& app_id) {
 
-    if(m_son_pid > 0) {
+    if(m_active_worker != -1) {
         std::cerr << "Warning: trying to initialize a Steam App while one is already running." << std::endl;
         return false;
     }
 
-    // Create the pipe
-    // We never close it because they are bidirectionnal (I know it's ugly)
-    if( pipe(m_pipe) == -1 ) {
-        std::cerr << "Could not create a pipe. Exitting." << std::endl;
-        std::cerr << "errno: " << errno << std::endl;
-        exit(EXIT_FAILURE);
+    if(app_id.size() >= MAX_APP_ID_LENGTH) {
+        std::cerr << "Warning: app id " << app_id << " is too long." << std::endl;
+        return false;
     }
 
-    pid_t pid;
-    if((pid = fork()) == 0) {
-        //Son's process
-        setenv("SteamAppId", app_id.c_str(), 1);
-        if( !SteamAPI_Init() ) {
-            std::cerr << "An error occurred launching the steam API. Aborting." << std::endl;
-            exit(EXIT_FAILURE);
-        }
+    prune_idle_workers();
 
-        signal(SIGTERM, handle_sigterm);
-        signal(SIGUSR1, handle_sigusr1_child); // Communicate game stats to parent
-        signal(SIGUSR2, handle_sigusr2_child); // Read from parents stats to modify
+    // Another app, its commands and crashes don't matter anymore
+    m_in_flight.clear();
+    m_restart_times.clear();
 
-        retrieve_achievements();
-        for(;;) {
-            SteamAPI_RunCallbacks();
-            sleep(1);
-        }
-    }
-    else if (pid == -1) {
-        std::cerr << "An error occurred while forking. Exitting." << std::endl;
-        exit(EXIT_FAILURE);
+    int index = find_worker(app_id);
+    if (index != -1) {
+        // This game was recently opened, and is still alive in the background
+        m_active_worker = index;
+        send_command(index, 'r', 0, nullptr);
     }
     else {
-        //Main process
-        signal(SIGCHLD, handle_sigchld);
-        signal(SIGUSR1, handle_sigusr1_parent);
-        m_son_pid = pid;
+        index = find_spare_worker();
+        if (index == -1) {
+            index = spawn_worker();
+        }
+
+        if (index == -1) {
+            std::cerr << "Could not start a process for the Steam game." << std::endl;
+            return false;
+        }
+
+        strncpy(m_workers[index].app_id, app_id.c_str(), MAX_APP_ID_LENGTH);
+        m_active_worker = index;
+        send_command(index, 'i', 0, app_id.c_str());
+    }
+
+    // Achievement ids are only unique within an app
+    IconCache::get_instance()->forget_app();
+
+    m_last_heartbeat = m_workers[index].channel->get_heartbeat();
+    m_last_heartbeat_change = time(NULL);
+    if (m_heartbeat_timer_id == 0) {
+        m_heartbeat_timer_id = g_timeout_add_seconds(EMULATOR_HEARTBEAT_CHECK_SECONDS, on_heartbeat_check, NULL);
     }
 
-    //Only a successful parent will reach this
+    // Get a spare child ready for the next game
+    warm_up();
+
     return true;
 }
 // => init_app
@@ -198,18 +229,27 @@ GameEmulator::init_app(const std::string& app_id) {
 
 bool
 GameEmulator::kill_running_app() {
-    if(m_son_pid > 0) {
-        kill(m_son_pid, SIGTERM);
+    if(m_active_worker != -1) {
+        m_workers[m_active_worker].last_used = time(NULL);
+        m_active_worker = -1;
+        m_in_flight.clear();
+
         free(m_achievement_list);
+        free(m_stat_list);
         m_achievement_list = nullptr;
+        m_stat_list = nullptr;
+        m_achievement_count = 0;
+        m_stat_count = 0;
+        IconCache::get_instance()->forget_app();
 
-        // We will set the pid back to -1 when son's death is confirmed
+        // The child keeps running for a while, in case the user comes back
+        g_timeout_add_seconds(EMULATOR_IDLE_GRACE_SECONDS + 1, on_idle_grace_expired, NULL);
         return true;
     }
     else {
         if (g_main_gui != NULL)
             std::cerr << "Warning: trying to kill the Steam Game while it's not running." << std::endl;
-        
+
         return true;
     }
 
@@ -219,169 +259,1525 @@ GameEmulator::kill_running_app() {
 
 
 void
-GameEmulator::retrieve_achievements() {
-    if (m_achievement_list != nullptr) {
-        std::cerr << "WARNING: Achievement list given may already have been initialized" << std::endl;
+GameEmulator::kill_all_workers() {
+    for (unsigned i = 0; i < EMULATOR_POOL_SIZE; i++) {
+        stop_worker(i);
     }
 
-    if (!m_have_stats_been_requested) {
-        m_have_stats_been_requested = true;
-        ISteamUserStats *stats_api = SteamUserStats();
-        stats_api->RequestCurrentStats();
+    m_active_worker = -1;
+    m_in_flight.clear();
+    free(m_achievement_list);
+    free(m_stat_list);
+    m_achievement_list = nullptr;
+    m_stat_list = nullptr;
+    m_achievement_count = 0;
+    m_stat_count = 0;
+}
+// => kill_all_workers
+
+
+void
+GameEmulator::warm_up() {
+    if (find_spare_worker() == -1) {
+        spawn_worker();
     }
 }
-// => retrieve_achievements
+// => warm_up
+
+
+/**
+ * Forks a new spare child, and returns its index in m_workers.
+ * If the pool is full, the least recently used background game is killed
+ * to make room. Returns -1 if no room could be made.
+ */
+int
+GameEmulator::spawn_worker() {
+    int index = -1;
+    int oldest_idle = -1;
+
+    for (unsigned i = 0; i < EMULATOR_POOL_SIZE; i++) {
+        if (m_workers[i].channel == nullptr) {
+            index = i;
+            break;
+        }
+
+        if ((int)i != m_active_worker && m_workers[i].app_id[0] != '\0') {
+            if (oldest_idle == -1 || m_workers[i].last_used < m_workers[oldest_idle].last_used) {
+                oldest_idle = i;
+            }
+        }
+    }
+
+    if (index == -1) {
+        if (oldest_idle == -1) {
+            return -1;
+        }
+
+        stop_worker(oldest_idle);
+        index = oldest_idle;
+    }
+
+    EmulatorChannel* channel;
+    const pid_t pid = fork_worker(&channel);
+
+    if (pid == -1) {
+        return -1;
+    }
+
+    m_workers[index].pid = pid;
+    m_workers[index].channel = channel;
+    m_workers[index].app_id[0] = '\0';
+    m_workers[index].last_used = time(NULL);
+    // The child only rings once we said we sleep
+    channel->can_sleep();
+    m_workers[index].watch_id = g_unix_fd_add(channel->get_doorbell_fd(), G_IO_IN, on_worker_result, GINT_TO_POINTER(index));
+    m_workers[index].hangup_watch_id = g_unix_fd_add(channel->get_lifeline_fd(), (GIOCondition)(G_IO_IN | G_IO_HUP | G_IO_ERR), on_worker_hangup, GINT_TO_POINTER(index));
+
+    return index;
+}
+// => spawn_worker
+
+
+/**
+ * Creates the channel and forks. The child never returns from here: it
+ * becomes a spare, waiting for its app id on the channel.
+ */
+pid_t
+GameEmulator::fork_worker(EmulatorChannel** channel) {
+    *channel = EmulatorChannel::create();
+    if (*channel == nullptr) {
+        return -1;
+    }
+
+    signal(SIGCHLD, handle_sigchld);
+    // A child may die at any time, writing to it must not kill us
+    signal(SIGPIPE, SIG_IGN);
+
+    pid_t pid;
+    if((pid = create_process()) == 0) {
+        //Son's process
+        int keep[EmulatorChannel::FD_COUNT];
+
+        (*channel)->use_as_child();
+        (*channel)->get_fds(keep);
+
+        // Don't keep our brothers' lifelines open, or they'd never hang up
+        close_inherited_fds(keep, EmulatorChannel::FD_COUNT);
+
+        // stdout may be a report in batch mode, the Steam API is chatty
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+
+        signal(SIGCHLD, SIG_DFL);
+        signal(SIGPIPE, SIG_DFL);
+        signal(SIGTERM, handle_sigterm);
+
+        run_worker(*channel);
+        exit(EXIT_SUCCESS);
+    }
+    else if (pid == -1) {
+        // The callers carry on without this child
+        std::cerr << "An error occurred while forking, errno: " << errno << std::endl;
+        delete *channel;
+        *channel = nullptr;
+        return -1;
+    }
+
+    //Main process
+    (*channel)->use_as_parent();
+    return pid;
+}
+// => fork_worker
+
+
+int
+GameEmulator::find_worker(const std::string& app_id) const {
+    for (unsigned i = 0; i < EMULATOR_POOL_SIZE; i++) {
+        if (m_workers[i].channel != nullptr && m_workers[i].pid > 0 && app_id == m_workers[i].app_id) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+// => find_worker
+
+
+int
+GameEmulator::find_spare_worker() const {
+    for (unsigned i = 0; i < EMULATOR_POOL_SIZE; i++) {
+        if (m_workers[i].channel != nullptr && m_workers[i].pid > 0 && m_workers[i].app_id[0] == '\0') {
+            return i;
+        }
+    }
+
+    return -1;
+}
+// => find_spare_worker
 
 
+/**
+ * Kills a child if it's still alive, and frees its slot.
+ * Does nothing on a free slot.
+ */
 void
-GameEmulator::update_view() {
-    for(unsigned i = 0; i < m_achievement_count; i++) {
-        g_main_gui->add_to_achievement_list(m_achievement_list[i]);
+GameEmulator::stop_worker(int index) {
+    EmulatorWorker_t& worker = m_workers[index];
+
+    if (worker.channel == nullptr) {
+        return;
     }
 
-    g_main_gui->confirm_stats_list();
+    if (worker.pid > 0) {
+        kill(worker.pid, SIGTERM);
+    }
+
+    if (worker.watch_id != 0) {
+        g_source_remove(worker.watch_id);
+    }
+
+    if (worker.hangup_watch_id != 0) {
+        g_source_remove(worker.hangup_watch_id);
+    }
+
+    delete worker.channel;
+
+    if (index == m_active_worker) {
+        m_active_worker = -1;
+    }
+
+    // The pid is reset here too: if the slot gets reused before SIGCHLD
+    // arrives, handle_sigchld must not mistake the new child for the old one
+    worker.pid = -1;
+    worker.channel = nullptr;
+    worker.watch_id = 0;
+    worker.hangup_watch_id = 0;
+    worker.app_id[0] = '\0';
+    std::vector<unsigned char>().swap(worker.outbox);
+    std::vector<unsigned char>().swap(worker.inbox);
 }
-// => update_view
+// => stop_worker
+
+
+void
+GameEmulator::prune_idle_workers() {
+    const time_t now = time(NULL);
+
+    for (unsigned i = 0; i < EMULATOR_POOL_SIZE; i++) {
+        if ((int)i == m_active_worker || m_workers[i].channel == nullptr || m_workers[i].app_id[0] == '\0') {
+            continue;
+        }
+
+        if (now - m_workers[i].last_used >= EMULATOR_IDLE_GRACE_SECONDS) {
+            stop_worker(i);
+        }
+    }
+}
+// => prune_idle_workers
+
+
+bool
+GameEmulator::send_command(int index, const char type, const double value, const char* id) {
+    EmulatorCommand_t command;
+
+    if (index < 0 || m_workers[index].channel == nullptr) {
+        std::cerr << "Could not send a command to the Steam game, it's not running." << std::endl;
+        return false;
+    }
+
+    fill_command(&command, type, value, id);
+
+    // Icons are asked for again anyway once the achievements come in
+    if (index == m_active_worker && type != 'g') {
+        record_in_flight(&command, 1);
+    }
+
+    queue_commands(index, &command, 1);
+    return true;
+}
+// => send_command
+
 
 /**
- * This one might need a little more documentation on the technical side.
- * This method must only be called on the parent process. It will send 
- * SIGUSR1 to the son, if a son there is. The son, upon receiving the signal,
- * will retrieve the stats and achievements from steam, and once it is done,
- * it will send a SIGUSR1 to the parent back. The parent will then save the
- * new data, and update the view accordingly.
+ * Parent side. Sends commands to a child without ever waiting: what the
+ * ring has no room for stays in the outbox of the worker, and is sent by
+ * on_worker_result once the child has read enough.
  */
 void
-GameEmulator::update_data_and_view() {
-    // Must be run by the parent
-    if(m_son_pid > 0) {
-        g_main_gui->reset_achievements_list();
-        g_main_gui->confirm_stats_list();
+GameEmulator::queue_commands(int index, const EmulatorCommand_t* commands, size_t count) {
+    const unsigned char* data = (const unsigned char*)commands;
 
-        kill(m_son_pid, SIGUSR1);
-    } else {
-        std::cerr << "Could not update data & view, no child found." << std::endl;
+    // Behind the ones already waiting, commands are handled in order
+    m_workers[index].outbox.insert(m_workers[index].outbox.end(), data, data + count * sizeof(EmulatorCommand_t));
+    flush_commands(index);
+}
+// => queue_commands
+
+
+void
+GameEmulator::flush_commands(int index) {
+    flush_outbox(m_workers[index].channel, m_workers[index].outbox);
+}
+// => flush_commands
+
+
+void
+GameEmulator::flush_outbox(EmulatorChannel* channel, std::vector<unsigned char>& outbox) {
+    size_t sent = 0;
+
+    do {
+        sent += channel->write_some(outbox.data() + sent, outbox.size() - sent);
+    } while (sent < outbox.size() && !channel->can_sleep_for_room());
+
+    outbox.erase(outbox.begin(), outbox.begin() + sent);
+}
+// => flush_outbox
+
+
+void
+GameEmulator::queue_command(std::vector<unsigned char>& outbox, const char type, const double value, const char* id) {
+    EmulatorCommand_t command;
+
+    fill_command(&command, type, value, id);
+    outbox.insert(outbox.end(), (const unsigned char*)&command, (const unsigned char*)(&command + 1));
+}
+// => queue_command
+
+
+void
+GameEmulator::fill_command(EmulatorCommand_t* command, const char type, const double value, const char* id) {
+    memset(command, 0, sizeof(EmulatorCommand_t));
+    command->type = type;
+    command->value = value;
+    if (id != nullptr) {
+        strncpy(command->id, id, MAX_ACHIEVEMENT_ID_LENGTH - 1);
     }
 }
-// => update_data_and_view
+// => fill_command
+
 
 /**
- * Alright I didn't touch this whole mess in a while, so here is a recap of what I
- * think happens here. The parent process requested the son process to unlock an 
- * achievement. So this code will be executed in the parent process, so here is 
- * what we have to do:
- * - Send a message to the son, associated with an achievement ID
- * - Make a signal handler for the son to unlock the achievement
- * - Rewrite the project from scratch
+ * All the modifications are queued at once, followed by a commit, so
+ * the child can apply them in one go and call StoreStats only once.
  */
-bool 
-GameEmulator::unlock_achievement(const char* ach_api_name) const {
-    // We assume the son process is already running
-    static const unsigned unlock_state = 1;
+void
+GameEmulator::queue_modifications(std::vector<unsigned char>& outbox, const std::map<std::string, bool>& achievements, const std::map<std::string, double>& stats) {
+    outbox.reserve(outbox.size() + (achievements.size() + stats.size() + 1) * sizeof(EmulatorCommand_t));
 
-    // Send it a signal
-    kill(m_son_pid, SIGUSR2);
+    for (auto const& [ach_id, new_value] : achievements) {
+        queue_command(outbox, 'a', new_value ? 1 : 0, ach_id.c_str());
+    }
 
-    // Write "a1" (for achievement unlock) then the achievement id
-    write(m_pipe[1], "a", sizeof(char));
-    write(m_pipe[1], &unlock_state, sizeof(unsigned));
-    write(m_pipe[1], ach_api_name, MAX_ACHIEVEMENT_ID_LENGTH * sizeof(char));
+    for (auto const& [stat_id, new_value] : stats) {
+        queue_command(outbox, 's', new_value, stat_id.c_str());
+    }
 
-    return false; // Yeah error handling? Maybe later (TODO)
+    queue_command(outbox, 'c', 0, nullptr);
 }
-// => unlock_achievement
+// => queue_modifications
+
+
+bool
+GameEmulator::commit_modifications(const PendingModifications& pending) {
+    if (m_active_worker == -1) {
+        std::cerr << "Could not send the modifications to the Steam game, it's not running." << std::endl;
+        return false;
+    }
+
+    const unsigned ach_count = std::min(pending.get_achievement_count(), m_achievement_count);
+    std::vector<EmulatorCommand_t> commands(pending.get_pending_achievement_count() + pending.get_stat_deltas().size() + 1);
+    size_t i = 0;
+
+    // Slots are indexes in the lists the edits were made on
+    for (unsigned slot = pending.next_pending_achievement(0); slot < ach_count; slot = pending.next_pending_achievement(slot + 1)) {
+        fill_command(&commands[i++], 'a', pending.get_achievement_target(slot) ? 1 : 0, m_achievement_list[slot].id);
+    }
+
+    for (const StatDelta_t& delta : pending.get_stat_deltas()) {
+        if (delta.slot < m_stat_count) {
+            fill_command(&commands[i++], 's', delta.value, m_stat_list[delta.slot].id);
+        }
+    }
+
+    fill_command(&commands[i++], 'c', 0, nullptr);
+
+    record_in_flight(commands.data(), i);
+    queue_commands(m_active_worker, commands.data(), i);
+    return true;
+}
+// => commit_modifications
+
+
+/**
+ * Takes what the child at the given index wrote, and handles every result
+ * that is all there. The rest stays in the inbox of the worker until the
+ * doorbell rings again, so a big result never holds the main loop up.
+ * Returns false if the child sent nonsense.
+ */
+bool
+GameEmulator::read_results(int index) {
+    std::vector<unsigned char>& inbox = m_workers[index].inbox;
+    size_t start = 0;
+    size_t size;
+
+    receive(m_workers[index].channel, inbox);
+
+    while (start < inbox.size()) {
+        if (!get_result_size(inbox.data() + start, inbox.size() - start, &size)) {
+            return false;
+        }
+
+        if (size == 0) {
+            break;
+        }
 
-bool 
-GameEmulator::relock_achievement(const char* ach_api_name) const {
-        // We assume the son process is already running
-    static const unsigned unlock_state = 0;
+        switch (inbox[start]) {
+            case 'a':
+                handle_user_stats(index, inbox.data() + start);
+                break;
+            case 'i':
+                handle_icons(index, inbox.data() + start);
+                break;
+            case 'f':
+                // No achievements are coming, the load or refresh is over
+                if (index == m_active_worker) {
+                    acknowledge_in_flight();
+                }
+                handle_error(index, inbox.data() + start);
+                break;
+            default:
+                handle_error(index, inbox.data() + start);
+                break;
+        }
+
+        start += size;
+    }
 
-    // Send it a signal
-    kill(m_son_pid, SIGUSR2);
+    inbox.erase(inbox.begin(), inbox.begin() + start);
 
-    // Write "a1" (for achievement unlock) then the achievement id
-    write(m_pipe[1], "a", sizeof(char));
-    write(m_pipe[1], &unlock_state, sizeof(unsigned));
-    write(m_pipe[1], ach_api_name, MAX_ACHIEVEMENT_ID_LENGTH * sizeof(char));
+    // Icons can take a few MB, that's not to be kept around
+    if (inbox.empty() && inbox.capacity() > EMULATOR_RESULT_RING_SIZE) {
+        std::vector<unsigned char>().swap(inbox);
+    }
 
-    return false; // Yeah error handling? Maybe later (TODO)
+    return true;
 }
-// => relock_achievement
+// => read_results
 
-/*****************************************
- * STEAM API CALLBACKS BELOW
- ****************************************/
 
 /**
- * Retrieves all achievemnts data, then pipes the data to the 
- * parent process.
+ * An 'a' result from the child at the given index, see send_user_stats.
+ * Results of the games in the background are dropped.
  */
 void
-GameEmulator::OnUserStatsReceived(UserStatsReceived_t *callback) {
-    // Check if we received the values for the good app
-    if(std::string(getenv("SteamAppId")) == std::to_string(callback->m_nGameID)) {
-        if ( k_EResultOK == callback->m_eResult ) {
+GameEmulator::handle_user_stats(int index, const unsigned char* result) {
+    Achievement_t* achievements;
+    Stat_t* stats;
+    unsigned achievement_count;
+    unsigned stat_count;
 
-            ISteamUserStats *stats_api = SteamUserStats();
-            
-            // ==============================
-            // RETRIEVE IDS
-            // ==============================
-            const unsigned num_ach = stats_api->GetNumAchievements();
+    if (index != m_active_worker) {
+        return;
+    }
 
-            if (m_achievement_list != nullptr) {
-                free(m_achievement_list);
-                m_achievement_list = nullptr;
-            } 
+    parse_user_stats(result, &achievements, &achievement_count, &stats, &stat_count);
+    acknowledge_in_flight();
 
-            m_achievement_list = (Achievement_t*)malloc(num_ach * sizeof(Achievement_t));
+    // The stat rows point to the old list, so they go first
+    g_main_gui->reset_stat_list();
+    free(m_stat_list);
+    m_stat_list = stats;
+    m_stat_count = stat_count;
 
-            for (unsigned i = 0; i < num_ach ; i++) {
-                // TODO: strncpy is slow, because it fills the remaining space with NULLs
-                // This is last stage optimisation but, could have used strcpy, or sprintf,
-                // making sure strings are NULL terminated
-                // see "man strncpy" for a possible implementation
-                strncpy(
-                    m_achievement_list[i].id, 
-                    stats_api->GetAchievementName(i), 
-                    MAX_ACHIEVEMENT_ID_LENGTH);
-                
-                strncpy(
-                    m_achievement_list[i].name, 
-                    stats_api->GetAchievementDisplayAttribute(m_achievement_list[i].id, "name"),
-                    MAX_ACHIEVEMENT_NAME_LENGTH);
+    // Usually a refresh after storing: only a few achievements changed,
+    // only their rows are updated, and the list stays where it was
+    std::vector<unsigned> changed;
+    if (merge_achievements(m_achievement_list, m_achievement_count, achievements, achievement_count, changed)) {
+        free(achievements);
+        PendingModifications* pending = g_steam->get_pending_modifications();
+        pending->refresh(m_achievement_list, m_stat_list, m_stat_count);
 
-                strncpy(
-                    m_achievement_list[i].desc,
-                    stats_api->GetAchievementDisplayAttribute(m_achievement_list[i].id, "desc"),
-                    MAX_ACHIEVEMENT_DESC_LENGTH);
+        // Stat edits not stored yet stay in sight, they will be stored
+        for (unsigned i = 0; i < m_stat_count; i++) {
+            double value;
 
-                // TODO
-                // https://partner.steamgames.com/doc/api/ISteamUserStats#RequestGlobalAchievementPercentages
-                //stats_api->GetAchievementAchievedPercent(m_achievement_list[i].id, &(m_achievement_list[i].global_achieved_rate));
-                m_achievement_list[i].global_achieved_rate = 0;
-                stats_api->GetAchievement(m_achievement_list[i].id, &(m_achievement_list[i].achieved));
-                m_achievement_list[i].hidden = (bool)strcmp(stats_api->GetAchievementDisplayAttribute( m_achievement_list[i].id, "hidden" ), "0");
-                m_achievement_list[i].icon_handle = stats_api->GetAchievementIcon( m_achievement_list[i].id );
+            if (!pending->get_stat(i, &value)) {
+                value = m_stat_list[i].value;
             }
+            g_main_gui->add_to_stat_list(m_stat_list[i], value);
+        }
+        g_main_gui->refresh_achievements(changed);
+        g_main_gui->confirm_stats_list();
 
-            //Tell parent that he must read
-            kill(getppid(), SIGUSR1);
-            
+        send_command(index, 'g', 0, nullptr);
+        return;
+    }
 
-            //Start writing
-            write(m_pipe[1], &num_ach, sizeof(unsigned));
+    // The achievement rows are rebound to the new list by update_view
+    Achievement_t* old_achievements = m_achievement_list;
+    m_achievement_list = achievements;
+    m_achievement_count = achievement_count;
 
-            // We could send all the memory bloc at once, but the pipe buffer 
-            // might not be big enough on some systems, so let's just loop
-            for(unsigned i = 0; i < num_ach; i++) {
-                write(m_pipe[1], &(m_achievement_list[i]), sizeof(Achievement_t));
-            }
+    // Another app, or its achievements changed: the slots mean nothing anymore
+    g_steam->get_pending_modifications()->reset(m_achievement_list, m_achievement_count, m_stat_count);
+    update_view();
+    free(old_achievements);
 
-            m_have_stats_been_requested = false;
-        } else {
-            std::cerr << "Received stats for the game, but an erorr occurrred." << std::endl;
-        }
+    // The rows are there, they can get their icons
+    send_command(index, 'g', 1, nullptr);
+}
+// => handle_user_stats
+
+
+/**
+ * Keeps the commands sent to the displayed game until their result comes
+ * back, so they can be sent again to a new child if this one crashes
+ */
+void
+GameEmulator::record_in_flight(const EmulatorCommand_t* commands, size_t count) {
+    m_in_flight.insert(m_in_flight.end(), commands, commands + count);
+}
+// => record_in_flight
+
+
+/**
+ * An 'a' or 'f' result came back: it answers the oldest 'i' or 'r', so everything
+ * up to it is done, the commit before a refresh included.
+ */
+void
+GameEmulator::acknowledge_in_flight() {
+    const auto answered = std::find_if(m_in_flight.begin(), m_in_flight.end(),
+        [](const EmulatorCommand_t& command) { return command.type == 'i' || command.type == 'r'; });
+
+    if (answered != m_in_flight.end()) {
+        m_in_flight.erase(m_in_flight.begin(), answered + 1);
+    }
+}
+// => acknowledge_in_flight
+
+
+/**
+ * A child died, hung or talked nonsense. Games in the background are just
+ * forgotten, the displayed one is restarted if it didn't crash too often.
+ */
+void
+GameEmulator::handle_worker_failure(int index, const std::string& reason) {
+    if (index != m_active_worker) {
+        stop_worker(index);
+        return;
+    }
+
+    const std::string app_id(m_workers[index].app_id);
+    const bool was_storing = std::any_of(m_in_flight.begin(), m_in_flight.end(),
+        [](const EmulatorCommand_t& command) { return command.type == 'c'; });
+
+    std::cerr << reason << " (app " << app_id << ")." << std::endl;
+    stop_worker(index);
+
+    if (!restart_active_app(app_id)) {
+        m_in_flight.clear();
+        report_error(reason + " too many times, or could not be restarted. Go back to the games list and try again.");
+        return;
+    }
+
+    if (was_storing) {
+        report_error(reason + ". It was restarted, and the modifications being stored were sent again.");
+    } else {
+        report_error(reason + ". It was restarted.");
+    }
+}
+// => handle_worker_failure
+
+
+/**
+ * Starts the app again in a new child, and replays the commands that
+ * were in flight, the start first. Returns false if the app crashed too
+ * often lately, or no child could be started.
+ */
+bool
+GameEmulator::restart_active_app(const std::string& app_id) {
+    const time_t now = time(NULL);
+    EmulatorCommand_t start;
+
+    m_restart_times.erase(
+        std::remove_if(m_restart_times.begin(), m_restart_times.end(), [&](time_t t) { return now - t >= EMULATOR_RESTART_WINDOW_SECONDS; }),
+        m_restart_times.end());
+
+    if (m_restart_times.size() >= EMULATOR_MAX_RESTARTS) {
+        return false;
+    }
+    m_restart_times.push_back(now);
+
+    int index = find_spare_worker();
+    if (index == -1) {
+        index = spawn_worker();
+    }
+
+    if (index == -1) {
+        return false;
+    }
+
+    strncpy(m_workers[index].app_id, app_id.c_str(), MAX_APP_ID_LENGTH);
+    m_active_worker = index;
+    m_last_heartbeat = m_workers[index].channel->get_heartbeat();
+    m_last_heartbeat_change = now;
+
+    // The start of the dead child will never be answered, the new child
+    // answers its own first, it waits in line like the rest
+    m_in_flight.erase(
+        std::remove_if(m_in_flight.begin(), m_in_flight.end(), [](const EmulatorCommand_t& command) { return command.type == 'i'; }),
+        m_in_flight.end());
+    fill_command(&start, 'i', 0, app_id.c_str());
+    m_in_flight.insert(m_in_flight.begin(), start);
+
+    queue_commands(index, m_in_flight.data(), m_in_flight.size());
+    warm_up();
+    return true;
+}
+// => restart_active_app
+
+
+void
+GameEmulator::check_heartbeat() {
+    if (m_active_worker == -1) {
+        return;
+    }
+
+    const EmulatorWorker_t& worker = m_workers[m_active_worker];
+    const uint64_t heartbeat = worker.channel->get_heartbeat();
+    const time_t now = time(NULL);
+
+    if (heartbeat != m_last_heartbeat) {
+        m_last_heartbeat = heartbeat;
+        m_last_heartbeat_change = now;
+        return;
+    }
+
+    if (now - m_last_heartbeat_change >= EMULATOR_HEARTBEAT_TIMEOUT_SECONDS) {
+        // SIGTERM would run SteamAPI_Shutdown, which may be what is stuck
+        if (worker.pid > 0) {
+            kill(worker.pid, SIGKILL);
+        }
+        handle_worker_failure(m_active_worker, "The Steam game stopped responding");
+    }
+}
+// => check_heartbeat
+
+
+void
+GameEmulator::report_error(const std::string& message) const {
+    if (g_main_gui != NULL) {
+        g_main_gui->show_error(message);
+    }
+}
+// => report_error
+
+
+/**
+ * Copies what changed from fresh into current, and lists the indexes of
+ * the achievements that changed. Returns false without touching anything
+ * if the two lists don't hold the same achievements in the same order,
+ * because it's another app or the first load.
+ */
+bool
+GameEmulator::merge_achievements(Achievement_t* current, unsigned current_count, const Achievement_t* fresh, unsigned fresh_count, std::vector<unsigned>& changed) {
+    if (current == nullptr || current_count != fresh_count) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < current_count; i++) {
+        if (strcmp(current[i].id, fresh[i].id) != 0) {
+            return false;
+        }
+    }
+
+    // Compared field by field, the padding of the structures is garbage
+    for (unsigned i = 0; i < current_count; i++) {
+        if (current[i].achieved != fresh[i].achieved
+            || current[i].hidden != fresh[i].hidden
+            || current[i].global_achieved_rate != fresh[i].global_achieved_rate
+            || current[i].has_progress != fresh[i].has_progress
+            || (fresh[i].has_progress && (current[i].progress != fresh[i].progress
+                                          || current[i].progress_min != fresh[i].progress_min
+                                          || current[i].progress_max != fresh[i].progress_max))
+            || strcmp(current[i].name, fresh[i].name) != 0
+            || strcmp(current[i].desc, fresh[i].desc) != 0) {
+            current[i] = fresh[i];
+            changed.push_back(i);
+        }
+    }
+
+    return true;
+}
+// => merge_achievements
+
+
+/**
+ * An 'i' result: the icon count, the icons, and all their pixels in one
+ * block, which the textures then use without copying.
+ */
+void
+GameEmulator::handle_icons(int index, const unsigned char* result) {
+    unsigned count;
+    size_t pixels_size = 0;
+
+    if (index != m_active_worker) {
+        return;
+    }
+
+    memcpy(&count, result + sizeof(char), sizeof(unsigned));
+    result += sizeof(char) + sizeof(unsigned);
+
+    std::vector<AchievementIcon_t> icons(count);
+    memcpy(icons.data(), result, count * sizeof(AchievementIcon_t));
+    result += count * sizeof(AchievementIcon_t);
+
+    for (const AchievementIcon_t& icon : icons) {
+        pixels_size += (size_t)icon.width * icon.height * 4;
+    }
+
+    unsigned char* pixels = (unsigned char*)malloc(pixels_size);
+    if (pixels_size > 0 && !pixels) {
+        std::cerr << "ERROR: could not allocate memory." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    memcpy(pixels, result, pixels_size);
+    IconCache::get_instance()->add_textures(icons.data(), count, pixels);
+    g_main_gui->refresh_achievement_icons();
+}
+// => handle_icons
+
+
+/**
+ * An 'e' or 'f' result, shown if it comes from the displayed game
+ */
+void
+GameEmulator::handle_error(int index, const unsigned char* result) {
+    char text[EMULATOR_ERROR_LENGTH];
+
+    memcpy(text, result + sizeof(char), EMULATOR_ERROR_LENGTH);
+    text[EMULATOR_ERROR_LENGTH - 1] = '\0';
+
+    std::cerr << "The Steam game (app " << m_workers[index].app_id << ") says: " << text << std::endl;
+    if (index == m_active_worker) {
+        report_error(text);
+    }
+}
+// => handle_error
+
+
+/**
+ * Error results coming before the achievements are only logged
+ */
+int
+GameEmulator::receive_user_stats(EmulatorChannel* channel, std::vector<unsigned char>& inbox, Achievement_t** achievements, unsigned* achievement_count, Stat_t** stats, unsigned* stat_count) {
+    size_t size;
+
+    *achievements = nullptr;
+    *stats = nullptr;
+
+    receive(channel, inbox);
+
+    while (!inbox.empty()) {
+        if (!get_result_size(inbox.data(), inbox.size(), &size)) {
+            return -1;
+        }
+
+        if (size == 0) {
+            return 0;
+        }
+
+        if (inbox[0] == 'a') {
+            parse_user_stats(inbox.data(), achievements, achievement_count, stats, stat_count);
+            inbox.erase(inbox.begin(), inbox.begin() + size);
+            return 1;
+        }
+
+        if (inbox[0] != 'e' && inbox[0] != 'f') {
+            std::cerr << "Received an unexpected result type from the Steam game: " << inbox[0] << std::endl;
+            return -1;
+        }
+
+        inbox[size - 1] = '\0';
+        std::cerr << "The Steam game says: " << (const char*)&inbox[1] << std::endl;
+        if (inbox[0] == 'f') {
+            return -1;
+        }
+        inbox.erase(inbox.begin(), inbox.begin() + size);
+    }
+
+    return 0;
+}
+// => receive_user_stats
+
+
+/**
+ * Moves everything there is to read on a channel to the end of inbox
+ */
+void
+GameEmulator::receive(EmulatorChannel* channel, std::vector<unsigned char>& inbox) {
+    size_t available;
+
+    while ((available = channel->get_available()) > 0) {
+        const size_t end = inbox.size();
+
+        inbox.resize(end + available);
+        inbox.resize(end + channel->read_some(inbox.data() + end, available));
+    }
+}
+// => receive
+
+
+/**
+ * Tells how long the result at the start of data is, in *result_size,
+ * or 0 if it's not all there yet. Returns false if it makes no sense.
+ */
+bool
+GameEmulator::get_result_size(const unsigned char* data, size_t size, size_t* result_size) {
+    const size_t header_size = sizeof(char) + sizeof(unsigned);
+    size_t needed;
+    unsigned count;
+
+    *result_size = 0;
+
+    if (size == 0) {
+        return true;
+    }
+
+    if (data[0] == 'e' || data[0] == 'f') {
+        needed = sizeof(char) + EMULATOR_ERROR_LENGTH;
+    }
+    else if (data[0] == 'a') {
+        // The achievements, then the stat count and the stats
+        if (size < header_size) {
+            return true;
+        }
+
+        memcpy(&count, data + sizeof(char), sizeof(unsigned));
+        needed = header_size + (size_t)count * sizeof(Achievement_t) + sizeof(unsigned);
+        if (size < needed) {
+            return true;
+        }
+
+        memcpy(&count, data + needed - sizeof(unsigned), sizeof(unsigned));
+        needed += (size_t)count * sizeof(Stat_t);
+    }
+    else if (data[0] == 'i') {
+        // The icons, then the pixels of all of them
+        if (size < header_size) {
+            return true;
+        }
+
+        memcpy(&count, data + sizeof(char), sizeof(unsigned));
+        needed = header_size + (size_t)count * sizeof(AchievementIcon_t);
+        if (size < needed) {
+            return true;
+        }
+
+        for (unsigned i = 0; i < count; i++) {
+            AchievementIcon_t icon;
+
+            memcpy(&icon, data + header_size + i * sizeof(AchievementIcon_t), sizeof(AchievementIcon_t));
+            needed += (size_t)icon.width * icon.height * 4;
+        }
+    }
+    else {
+        std::cerr << "Received an unknown result type from the Steam game: " << data[0] << std::endl;
+        return false;
+    }
+
+    if (size >= needed) {
+        *result_size = needed;
+    }
+
+    return true;
+}
+// => get_result_size
+
+
+/**
+ * Copies the lists out of a whole 'a' result. They are allocated with
+ * malloc, the caller must free them.
+ */
+void
+GameEmulator::parse_user_stats(const unsigned char* result, Achievement_t** achievements, unsigned* achievement_count, Stat_t** stats, unsigned* stat_count) {
+    result += sizeof(char);
+    memcpy(achievement_count, result, sizeof(unsigned));
+    result += sizeof(unsigned);
+
+    *achievements = (Achievement_t*)malloc(*achievement_count * sizeof(Achievement_t));
+    if (*achievement_count > 0 && !*achievements) {
+        std::cerr << "ERROR: could not allocate memory." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    memcpy(*achievements, result, *achievement_count * sizeof(Achievement_t));
+    result += *achievement_count * sizeof(Achievement_t);
+    memcpy(stat_count, result, sizeof(unsigned));
+    result += sizeof(unsigned);
+
+    *stats = (Stat_t*)malloc(*stat_count * sizeof(Stat_t));
+    if (*stat_count > 0 && !*stats) {
+        std::cerr << "ERROR: could not allocate memory." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    memcpy(*stats, result, *stat_count * sizeof(Stat_t));
+}
+// => parse_user_stats
+
+
+/**
+ * Main function of a child. The child starts as a spare, waits to be
+ * given an app id, then behaves like the Steam game until the parent
+ * kills it or goes away.
+ */
+void
+GameEmulator::run_worker(EmulatorChannel* channel) {
+    EmulatorCommand_t command;
+
+    m_channel = channel;
+
+    // If the parent goes away before choosing a game, just leave
+    if (!m_channel->read(&command, sizeof(EmulatorCommand_t))) {
+        exit(EXIT_SUCCESS);
+    }
+
+    if (command.type != 'i') {
+        std::cerr << "A spare Steam game was given a command before an app id. Aborting." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    m_channel->beat();
+    setenv("SteamAppId", command.id, 1);
+    if( !SteamAPI_Init() ) {
+        std::cerr << "An error occurred launching the steam API. Aborting." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    s_steam_api_running = true;
+
+    load_stats_schema(command.id);
+    IconCache::get_instance()->load_index(command.id);
+    if (load_global_percentages(command.id)) {
+        // Fresh enough, no need to ask Steam
+        m_have_global_percentages_been_requested = true;
+    }
+    retrieve_achievements();
+
+    for(;;) {
+        m_channel->beat();
+        m_channel->acknowledge();
+
+        // Handle every pending command before running the callbacks,
+        // a commit usually comes with a lot of them
+        while (m_channel->has_data()) {
+            if (!handle_command()) {
+                // The parent is gone
+                SteamAPI_Shutdown();
+                exit(EXIT_SUCCESS);
+            }
+        }
+
+        SteamAPI_RunCallbacks();
+
+        // Icons Steam finished downloading come in a burst of callbacks
+        IconCache::get_instance()->flush_index();
+
+        // The parent only rings the doorbell once we said we sleep
+        if (m_channel->can_sleep() && !m_channel->wait(100)) {
+            SteamAPI_Shutdown();
+            exit(EXIT_SUCCESS);
+        }
+    }
+}
+// => run_worker
+
+
+/**
+ * We are the child and we will receive a command from the parent
+ * Returns false if the parent is gone.
+ */
+bool
+GameEmulator::handle_command() {
+    ISteamUserStats *stats_api = SteamUserStats();
+    EmulatorCommand_t command;
+
+    if (!m_channel->read(&command, sizeof(EmulatorCommand_t))) {
+        return false;
+    }
+
+    if (command.type == 'r') {
+        retrieve_achievements();
+    }
+    else if (command.type == 'a') {
+        // We want to edit an achievement
+        if (command.value == 0) {
+            // We want to relock an achievement
+            if (!stats_api->ClearAchievement(command.id)) {
+                send_error(std::string("Steam refused to relock the achievement ") + command.id + ".");
+            }
+        } else {
+            // We want to unlock an achievement
+            if (!stats_api->SetAchievement(command.id)) {
+                send_error(std::string("Steam refused to unlock the achievement ") + command.id + ".");
+            }
+        }
+    }
+    else if (command.type == 's') {
+        // We want to edit a stat, the schema tells us which type to use
+        Stat_t* stat = std::find_if(m_stat_list, m_stat_list + m_stat_count, [&](const Stat_t& s) { return strcmp(s.id, command.id) == 0; });
+
+        if (stat == m_stat_list + m_stat_count) {
+            std::cerr << "Unknown stat " << command.id << ", not setting it." << std::endl;
+        }
+        else if (stat->type == STAT_TYPE_INT ? !stats_api->SetStat(command.id, (int32)command.value)
+                                             : !stats_api->SetStat(command.id, (float)command.value)) {
+            send_error(std::string("Steam refused to set the stat ") + command.id + ".");
+        }
+    }
+    else if (command.type == 'g') {
+        m_have_icons_been_requested = true;
+        send_icons(command.value != 0);
+    }
+    else if (command.type == 'c') {
+        // Send everything that was edited to Steam at once
+        if (!stats_api->StoreStats()) {
+            std::cerr << "StoreStats failed, the modifications may be lost." << std::endl;
+            send_error("Steam could not store the modifications, they may be lost.");
+        }
+    }
+    else {
+        std::cerr << "Received an unknown command from the parent: " << command.type << std::endl;
+    }
+
+    return true;
+}
+// => handle_command
+
+
+/**
+ * The first time, the global achievement percentages are requested along
+ * with the stats, so both round trips to Steam happen at the same time.
+ * The result is sent to the parent once both arrived, see send_user_stats.
+ * Every 'i' and 'r' gets an answer of its own. One coming while a request
+ * is on its way waits for the next one: Steam may answer the first with
+ * the stats as they were before the commands that came in between.
+ */
+void
+GameEmulator::retrieve_achievements() {
+    ISteamUserStats *stats_api = SteamUserStats();
+
+    if (m_stats_request_answers > 0) {
+        m_refreshes_waiting++;
+    } else {
+        request_current_stats(1);
+    }
+
+    if (!m_have_global_percentages_been_requested) {
+        m_have_global_percentages_been_requested = true;
+        m_global_percentages_call.Set(stats_api->RequestGlobalAchievementPercentages(), this, &GameEmulator::OnGlobalAchievementPercentagesReceived);
+    }
+}
+// => retrieve_achievements
+
+
+/**
+ * Asks Steam for the stats, for the given number of 'i' and 'r' commands
+ */
+void
+GameEmulator::request_current_stats(unsigned answers) {
+    if (SteamUserStats()->RequestCurrentStats()) {
+        m_stats_request_answers = answers;
+        return;
+    }
+
+    // No callback will come, the parent waits for the answers anyway
+    std::cerr << "RequestCurrentStats failed." << std::endl;
+    for (unsigned i = 0; i < answers; i++) {
+        send_error("Steam refused to give the achievements of this game. Go back to the games list and try again.", 'f');
+    }
+}
+// => request_current_stats
+
+
+/**
+ * Reads the global percentages saved by a previous visit, from
+ * <cache folder>/<app id>/global_percentages, one "<id> <percent>" per line.
+ * Returns false if there is no such file, or it is too old to be used.
+ */
+bool
+GameEmulator::load_global_percentages(const std::string& app_id) {
+    const std::string path(std::string(g_cache_folder) + "/" + app_id + "/global_percentages");
+    struct stat file_info;
+    std::string ach_id;
+    float percent;
+
+    if (stat(path.c_str(), &file_info) != 0 || time(NULL) - file_info.st_mtime > GLOBAL_PERCENTAGES_CACHE_SECONDS) {
+        return false;
+    }
+
+    std::ifstream input(path, std::ios::in);
+    m_global_percentages.clear();
+    while (input >> ach_id >> percent) {
+        m_global_percentages[ach_id] = percent;
+    }
+
+    return !m_global_percentages.empty();
+}
+// => load_global_percentages
+
+
+void
+GameEmulator::save_global_percentages(const std::string& app_id) const {
+    const std::string local_folder(std::string(g_cache_folder) + "/" + app_id);
+    const std::string path(local_folder + "/global_percentages");
+
+    if ((mkdir(g_cache_folder, S_IRWXU | S_IRWXG | S_IROTH) != 0 && errno != EEXIST)
+        || (mkdir(local_folder.c_str(), S_IRWXU | S_IRWXG | S_IROTH) != 0 && errno != EEXIST)) {
+        std::cerr << "Unable to create the cache folder (" << local_folder << ", errno " << errno << ")." << std::endl;
+        return;
+    }
+
+    // Written aside then renamed, so a game loading at the same time
+    // never reads half a file
+    const std::string tmp_path(path + "." + std::to_string(getpid()));
+    std::ofstream output(tmp_path, std::ios::out | std::ios::trunc);
+    for (auto const& [ach_id, percent] : m_global_percentages) {
+        output << ach_id << " " << percent << "\n";
+    }
+    output.close();
+
+    if (!output || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Could not save the global achievement percentages to " << path << std::endl;
+        unlink(tmp_path.c_str());
+    }
+}
+// => save_global_percentages
+
+
+/**
+ * Pipes the achievements and stats to the parent, see parse_user_stats,
+ * once per command they answer.
+ * Waits for the global percentages if they are still on their way.
+ */
+void
+GameEmulator::send_user_stats() {
+    if (!m_have_user_stats || m_global_percentages_call.IsActive()) {
+        return;
+    }
+
+    for (unsigned i = 0; i < m_achievement_count; i++) {
+        const auto percent = m_global_percentages.find(m_achievement_list[i].id);
+        m_achievement_list[i].global_achieved_rate = (percent == m_global_percentages.end()) ? -1 : percent->second;
+    }
+
+    // Send everything at once, the parent reads until it got it all
+    for (; m_user_stats_answers_due > 0; m_user_stats_answers_due--) {
+        m_channel->write("a", sizeof(char));
+        m_channel->write(&m_achievement_count, sizeof(unsigned));
+        m_channel->write(m_achievement_list, m_achievement_count * sizeof(Achievement_t));
+        m_channel->write(&m_stat_count, sizeof(unsigned));
+        m_channel->write(m_stat_list, m_stat_count * sizeof(Stat_t));
+    }
+}
+// => send_user_stats
+
+
+/**
+ * Sends an 'e' result, or an 'f' one if type says so, see handle_error
+ */
+void
+GameEmulator::send_error(const std::string& message, char type) const {
+    char text[EMULATOR_ERROR_LENGTH];
+
+    memset(text, 0, EMULATOR_ERROR_LENGTH);
+    strncpy(text, message.c_str(), EMULATOR_ERROR_LENGTH - 1);
+
+    m_channel->write(&type, sizeof(char));
+    m_channel->write(text, EMULATOR_ERROR_LENGTH);
+}
+// => send_error
+
+
+/**
+ * Sends the icons of the achievements in their current state, in one result:
+ * all of them, or only the ones that changed since they were last sent.
+ * Icons Steam doesn't have yet are sent by OnAchievementIconFetched.
+ */
+void
+GameEmulator::send_icons(bool all) {
+    ISteamUserStats *stats_api = SteamUserStats();
+    std::vector<AchievementIcon_t> icons;
+    std::vector<const std::vector<unsigned char>*> pixels;
+
+    for (unsigned i = 0; i < m_achievement_count; i++) {
+        const Achievement_t& ach = m_achievement_list[i];
+        AchievementIcon_t icon;
+        const std::vector<unsigned char>* icon_pixels;
+
+        if (IconCache::get_instance()->lookup(ach.id, ach.achieved, icon, &icon_pixels)
+            || fetch_icon(ach.id, ach.achieved, stats_api->GetAchievementIcon(ach.id), icon, &icon_pixels)) {
+            std::string& sent_hash = m_sent_icons[ach.id];
+
+            if (all || sent_hash != icon.hash) {
+                sent_hash = icon.hash;
+                icons.push_back(icon);
+                pixels.push_back(icon_pixels);
+            }
+        }
+    }
+
+    // The whole index is rewritten, once for all the icons fetched
+    IconCache::get_instance()->flush_index();
+    write_icons(icons, pixels);
+}
+// => send_icons
+
+
+/**
+ * Copies an icon out of Steam, and saves it in the cache.
+ * Returns false if Steam doesn't have it (yet).
+ */
+bool
+GameEmulator::fetch_icon(const char* ach_id, bool achieved, int icon_handle, AchievementIcon_t& icon, const std::vector<unsigned char>** pixels) {
+    ISteamUtils *utils_api = SteamUtils();
+    std::vector<unsigned char> rgba;
+    uint32 width, height;
+
+    if (icon_handle == 0 || !utils_api->GetImageSize(icon_handle, &width, &height)) {
+        return false;
+    }
+
+    rgba.resize((size_t)width * height * 4);
+    if (!utils_api->GetImageRGBA(icon_handle, rgba.data(), rgba.size())) {
+        return false;
+    }
+
+    IconCache::get_instance()->store(ach_id, achieved, rgba, width, height, icon);
+    return IconCache::get_instance()->lookup(ach_id, achieved, icon, pixels);
+}
+// => fetch_icon
+
+
+void
+GameEmulator::write_icons(const std::vector<AchievementIcon_t>& icons, const std::vector<const std::vector<unsigned char>*>& pixels) const {
+    const unsigned count = icons.size();
+
+    if (count == 0) {
+        return;
+    }
+
+    m_channel->write("i", sizeof(char));
+    m_channel->write(&count, sizeof(unsigned));
+    m_channel->write(icons.data(), count * sizeof(AchievementIcon_t));
+    for (const std::vector<unsigned char>* icon_pixels : pixels) {
+        m_channel->write(icon_pixels->data(), icon_pixels->size());
+    }
+}
+// => write_icons
+
+
+/**
+ * The Steam API can't list the stats of a game, so we read them from the
+ * schema Steam keeps in its cache, like SAM on Windows does. Integer and
+ * float stats are kept in m_stat_list, their values are filled in
+ * OnUserStatsReceived. The stats an achievement's progress follows are
+ * kept in m_achievement_progress.
+ */
+void
+GameEmulator::load_stats_schema(const std::string& app_id) {
+    const std::string path(MySteam::get_steam_install_path() + "/appcache/stats/UserGameStatsSchema_" + app_id + ".bin");
+    std::vector<Stat_t> stats;
+    KeyValue schema;
+
+    free(m_stat_list);
+    m_stat_list = nullptr;
+    m_stat_count = 0;
+    m_achievement_progress.clear();
+
+    if (!schema.load_binary(path)) {
+        std::cerr << "Could not read the stats schema " << path << ", no stats will be shown." << std::endl;
+        return;
+    }
+
+    for (const KeyValue& stat : schema["stats"].get_children()) {
+        const KeyValue& type_int = stat["type_int"];
+        const int type = type_int.is_valid() ? type_int.as_integer(0) : stat["type"].as_integer(0);
+        const std::string id(stat["name"].as_string(""));
+        const KeyValue& display_name = stat["display"]["name"];
+        std::string name;
+        Stat_t data;
+
+        // Achievements come in groups of 32, one per bit
+        for (const KeyValue& bit : stat["bits"].get_children()) {
+            const KeyValue& progress = bit["progress"];
+
+            if (progress["value"]["operation"].as_string("") == "statvalue") {
+                AchievementProgress_t& ach_progress = m_achievement_progress[bit["name"].as_string("")];
+                ach_progress.stat_id = progress["value"]["operand1"].as_string("");
+                ach_progress.min_value = progress["min_val"].as_float(0);
+                ach_progress.max_value = progress["max_val"].as_float(0);
+            }
+        }
+
+        if ((type != STAT_TYPE_INT && type != STAT_TYPE_FLOAT) || id.empty()) {
+            continue;
+        }
+
+        // The display name is either a string, or localized strings
+        if (display_name["english"].is_valid()) {
+            name = display_name["english"].as_string(id);
+        }
+        else if (!display_name.get_children().empty()) {
+            name = display_name.get_children()[0].as_string(id);
+        }
+        else {
+            name = display_name.as_string(id);
+        }
+
+        memset(&data, 0, sizeof(Stat_t));
+        strncpy(data.id, id.c_str(), MAX_STAT_ID_LENGTH - 1);
+        strncpy(data.name, name.c_str(), MAX_STAT_NAME_LENGTH - 1);
+        data.type = type;
+        if (type == STAT_TYPE_INT) {
+            data.value = stat["default"].as_integer(0);
+            data.min_value = stat["min"].as_integer(INT32_MIN);
+            data.max_value = stat["max"].as_integer(INT32_MAX);
+        }
+        else {
+            data.value = stat["default"].as_float(0);
+            data.min_value = stat["min"].as_float(-FLT_MAX);
+            data.max_value = stat["max"].as_float(FLT_MAX);
+        }
+        data.increment_only = stat["incrementonly"].as_boolean(false);
+        data.is_protected = (stat["permission"].as_integer(0) & 2) != 0;
+
+        stats.push_back(data);
+    }
+
+    m_stat_list = (Stat_t*)malloc(stats.size() * sizeof(Stat_t));
+    if (stats.size() > 0 && !m_stat_list) {
+        std::cerr << "ERROR: could not allocate memory." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::copy(stats.begin(), stats.end(), m_stat_list);
+    m_stat_count = stats.size();
+}
+// => load_stats_schema
+
+
+void
+GameEmulator::update_view() {
+    g_main_gui->set_achievements(m_achievement_list, m_achievement_count);
+
+    for(unsigned i = 0; i < m_stat_count; i++) {
+        g_main_gui->add_to_stat_list(m_stat_list[i], m_stat_list[i].value);
+    }
+
+    g_main_gui->confirm_stats_list();
+}
+// => update_view
+
+/**
+ * This one might need a little more documentation on the technical side.
+ * This method must only be called on the parent process. It will send
+ * a refresh command to the son, if a son there is. The son, upon receiving it,
+ * will retrieve the stats and achievements from steam, and once it is done,
+ * it will write them on its channel. The main loop will then wake us up,
+ * we will save the new data, and update the view accordingly.
+ */
+void
+GameEmulator::update_data_and_view() {
+    // Must be run by the parent
+    if(m_active_worker != -1) {
+        // The rows stay until the new data comes in, then they are rebound
+        send_command(m_active_worker, 'r', 0, nullptr);
+    } else {
+        std::cerr << "Could not update data & view, no child found." << std::endl;
+    }
+}
+// => update_data_and_view
+
+/**
+ * The parent process requested the son process to unlock an
+ * achievement. So this code will be executed in the parent process,
+ * it sends the command to the son, who will do the actual unlocking.
+ */
+bool
+GameEmulator::unlock_achievement(const char* ach_api_name) {
+    return send_command(m_active_worker, 'a', 1, ach_api_name);
+}
+// => unlock_achievement
+
+bool
+GameEmulator::relock_achievement(const char* ach_api_name) {
+    return send_command(m_active_worker, 'a', 0, ach_api_name);
+}
+// => relock_achievement
+
+/*****************************************
+ * STEAM API CALLBACKS BELOW
+ ****************************************/
+
+/**
+ * Retrieves all achievemnts data, then pipes the data to the
+ * parent process. Stats Steam sends on its own are ignored: every result
+ * answers an 'i' or 'r' of the parent, see acknowledge_in_flight.
+ */
+void
+GameEmulator::OnUserStatsReceived(UserStatsReceived_t *callback) {
+    // Check if we received the values for the good app, and asked for them
+    if(m_stats_request_answers > 0 && std::string(getenv("SteamAppId")) == std::to_string(callback->m_nGameID)) {
+        const unsigned answers = m_stats_request_answers;
+
+        m_stats_request_answers = 0;
+        if ( k_EResultOK == callback->m_eResult ) {
+
+            ISteamUserStats *stats_api = SteamUserStats();
+
+            // ==============================
+            // RETRIEVE IDS
+            // ==============================
+            const unsigned num_ach = stats_api->GetNumAchievements();
+
+            if (m_achievement_list != nullptr) {
+                free(m_achievement_list);
+                m_achievement_list = nullptr;
+            }
+
+            m_achievement_list = (Achievement_t*)malloc(num_ach * sizeof(Achievement_t));
+
+            for (unsigned i = 0; i < num_ach ; i++) {
+                // TODO: strncpy is slow, because it fills the remaining space with NULLs
+                // This is last stage optimisation but, could have used strcpy, or sprintf,
+                // making sure strings are NULL terminated
+                // see "man strncpy" for a possible implementation
+                // The last byte stays a NULL, the parent reads them as C strings
+                strncpy(
+                    m_achievement_list[i].id,
+                    stats_api->GetAchievementName(i),
+                    MAX_ACHIEVEMENT_ID_LENGTH - 1);
+                m_achievement_list[i].id[MAX_ACHIEVEMENT_ID_LENGTH - 1] = '\0';
+
+                strncpy(
+                    m_achievement_list[i].name,
+                    stats_api->GetAchievementDisplayAttribute(m_achievement_list[i].id, "name"),
+                    MAX_ACHIEVEMENT_NAME_LENGTH - 1);
+                m_achievement_list[i].name[MAX_ACHIEVEMENT_NAME_LENGTH - 1] = '\0';
+
+                strncpy(
+                    m_achievement_list[i].desc,
+                    stats_api->GetAchievementDisplayAttribute(m_achievement_list[i].id, "desc"),
+                    MAX_ACHIEVEMENT_DESC_LENGTH - 1);
+                m_achievement_list[i].desc[MAX_ACHIEVEMENT_DESC_LENGTH - 1] = '\0';
+
+                // Filled in send_user_stats, they may not be there yet
+                m_achievement_list[i].global_achieved_rate = -1;
+                stats_api->GetAchievement(m_achievement_list[i].id, &(m_achievement_list[i].achieved));
+                m_achievement_list[i].hidden = (bool)strcmp(stats_api->GetAchievementDisplayAttribute( m_achievement_list[i].id, "hidden" ), "0");
+                m_achievement_list[i].icon_handle = stats_api->GetAchievementIcon( m_achievement_list[i].id );
+            }
+
+            // ==============================
+            // RETRIEVE STATS
+            // ==============================
+            for (unsigned i = 0; i < m_stat_count; i++) {
+                int32 int_value;
+                float float_value;
+
+                if (m_stat_list[i].type == STAT_TYPE_INT && stats_api->GetStat(m_stat_list[i].id, &int_value)) {
+                    m_stat_list[i].value = int_value;
+                }
+                else if (m_stat_list[i].type == STAT_TYPE_FLOAT && stats_api->GetStat(m_stat_list[i].id, &float_value)) {
+                    m_stat_list[i].value = float_value;
+                }
+            }
+
+            // ==============================
+            // RETRIEVE PROGRESS
+            // ==============================
+            for (unsigned i = 0; i < num_ach; i++) {
+                const auto progress = m_achievement_progress.find(m_achievement_list[i].id);
+                const Stat_t* stat = nullptr;
+
+                if (progress != m_achievement_progress.end()) {
+                    stat = std::find_if(m_stat_list, m_stat_list + m_stat_count, [&](const Stat_t& s) { return progress->second.stat_id == s.id; });
+                }
+
+                m_achievement_list[i].has_progress = (stat != nullptr && stat != m_stat_list + m_stat_count && progress->second.max_value > progress->second.min_value);
+                if (m_achievement_list[i].has_progress) {
+                    m_achievement_list[i].progress_min = progress->second.min_value;
+                    m_achievement_list[i].progress_max = progress->second.max_value;
+                    m_achievement_list[i].progress = std::min(std::max((float)stat->value, progress->second.min_value), progress->second.max_value);
+                }
+            }
+
+            m_achievement_count = num_ach;
+            m_have_user_stats = true;
+            m_user_stats_answers_due += answers;
+            send_user_stats();
+        } else {
+            // The parent waits for an answer to its 'i' and 'r'
+            std::cerr << "Received stats for the game, but an error occurred: " << callback->m_eResult << std::endl;
+            for (unsigned i = 0; i < answers; i++) {
+                send_error("Steam could not give the achievements of this game (error " + std::to_string(callback->m_eResult)
+                           + "). Go back to the games list and try again.", 'f');
+            }
+        }
+
+        if (m_refreshes_waiting > 0) {
+            request_current_stats(m_refreshes_waiting);
+            m_refreshes_waiting = 0;
+        }
+    }
+}
+// => OnUserStatsReceived
+
+/**
+ * Walks the achievements from the most to the least achieved, saves
+ * their percentages for the next visits, and sends the achievements
+ * if they were only waiting for this.
+ * If the request failed, the achievements are sent with unknown rarity.
+ */
+void
+GameEmulator::OnGlobalAchievementPercentagesReceived(GlobalAchievementPercentagesReady_t *callback, bool io_failure) {
+    ISteamUserStats *stats_api = SteamUserStats();
+    char ach_id[MAX_ACHIEVEMENT_ID_LENGTH];
+    float percent;
+    bool achieved;
+
+    if (io_failure || callback->m_eResult != k_EResultOK) {
+        std::cerr << "Could not retrieve the global achievement percentages." << std::endl;
+    }
+    else {
+        m_global_percentages.clear();
+
+        int iterator = stats_api->GetMostAchievedAchievementInfo(ach_id, MAX_ACHIEVEMENT_ID_LENGTH, &percent, &achieved);
+        while (iterator != -1) {
+            m_global_percentages[ach_id] = percent;
+            iterator = stats_api->GetNextMostAchievedAchievementInfo(iterator, ach_id, MAX_ACHIEVEMENT_ID_LENGTH, &percent, &achieved);
+        }
+
+        save_global_percentages(getenv("SteamAppId"));
+    }
+
+    send_user_stats();
+}
+// => OnGlobalAchievementPercentagesReceived
+
+void
+GameEmulator::OnAchievementIconFetched(UserAchievementIconFetched_t *callback) {
+    AchievementIcon_t icon;
+    const std::vector<unsigned char>* pixels;
+
+    if (!m_have_icons_been_requested || std::string(getenv("SteamAppId")) != std::to_string(callback->m_nGameID.ToUint64())) {
+        return;
+    }
+
+    if (fetch_icon(callback->m_rgchAchievementName, callback->m_bAchieved, callback->m_nIconHandle, icon, &pixels)) {
+        m_sent_icons[icon.ach_id] = icon.hash;
+        write_icons({ icon }, { pixels });
     }
 }
-// => OnUserStatsReceived
\ No newline at end of file
+// => OnAchievementIconFetched
\ No newline at end of file
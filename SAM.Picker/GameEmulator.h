@@ -1,25 +1,143 @@
 #pragma once
 #include <string>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <cfloat>
 #include <csignal>
+#include <ctime>
 #include <iostream>
 #include <unistd.h>
-#include <sys/types.h> 
+#include <sys/types.h>
 #include <sys/wait.h>
 #include "globals.h"
 #include "Achievement.h"
+#include "Stat.h"
+#include "IconCache.h"
+#include "PendingModifications.h"
+#include "EmulatorChannel.h"
 #include "MainPickerWindow.h"
 #include "../steam/steam_api.h"
 
+#define MAX_APP_ID_LENGTH 32
+
+/**
+ * Length of the message of an 'e' or 'f' result, null terminated
+ */
+#define EMULATOR_ERROR_LENGTH 256
+
+/**
+ * Maximum amount of emulator processes alive at the same time: the one
+ * being displayed, the warmed spare one, and the recently used ones.
+ */
+#define EMULATOR_POOL_SIZE 4
+
+/**
+ * How long (in seconds) a recently used game stays alive in the background
+ * after the user went back to the game list. Coming back to it within this
+ * delay is instant, because SteamAPI_Init doesn't have to run again.
+ */
+#define EMULATOR_IDLE_GRACE_SECONDS 120
+
+/**
+ * How long (in seconds) the global achievement percentages of a game,
+ * saved in the cache folder, are trusted before asking Steam again.
+ * They barely move from one day to the next.
+ */
+#define GLOBAL_PERCENTAGES_CACHE_SECONDS (60 * 60 * 24)
+
+/**
+ * How often (in seconds) the parent checks that the displayed game still
+ * beats, and how long it may stay silent before it is deemed stuck.
+ * Loading icons can keep a child busy for a few seconds.
+ */
+#define EMULATOR_HEARTBEAT_CHECK_SECONDS 2
+#define EMULATOR_HEARTBEAT_TIMEOUT_SECONDS 15
+
+/**
+ * A displayed game that crashes is restarted, unless it already crashed
+ * EMULATOR_MAX_RESTARTS times in the last EMULATOR_RESTART_WINDOW_SECONDS
+ */
+#define EMULATOR_MAX_RESTARTS 3
+#define EMULATOR_RESTART_WINDOW_SECONDS 60
+
+/**
+ * One forked emulator process, as seen by the parent.
+ * A worker with an empty app_id is a spare: it has been forked in advance
+ * and waits for an app id before calling SteamAPI_Init.
+ */
+struct EmulatorWorker_t {
+    pid_t pid;                  // -1 once the process is dead
+    EmulatorChannel* channel;   // nullptr if the slot is free
+    unsigned watch_id;          // GLib source watching the doorbell of the channel
+    unsigned hangup_watch_id;   // GLib source watching the lifeline of the channel
+    char app_id[MAX_APP_ID_LENGTH];
+    time_t last_used;
+    std::vector<unsigned char> outbox;  // Commands the ring had no room for yet
+    std::vector<unsigned char> inbox;   // Results not all there yet
+};
+
+typedef struct EmulatorWorker_t EmulatorWorker_t;
+
+/**
+ * Commands sent from the parent to a child. They have a fixed length.
+ * Types:
+ * - 'i' to bind a spare child to the app id given in id (Init)
+ * - 'r' to refetch all the achievements (Refresh)
+ * - 'a' to edit an achievement, value being 0 => relock, 1 => unlock
+ * - 's' to edit a stat, value being the new stat value
+ * - 'c' to send the edited achievements and stats to Steam (Commit)
+ * - 'g' to send the achievement icons, and the ones Steam fetches later (Get icons),
+ *   value being 1 => all of them, 0 => only the ones that changed since the last 'g'
+ *
+ * Results sent back by a child start with their type:
+ * - 'a' for the achievements and stats, see handle_user_stats
+ * - 'i' for achievement icons, see handle_icons
+ * - 'e' for an error to show to the user, followed by EMULATOR_ERROR_LENGTH
+ *   chars, see send_error
+ * - 'f' when Steam could not give the achievements and stats, in place of
+ *   an 'a', laid out like 'e'
+ */
+struct EmulatorCommand_t {
+    char type;
+    double value;
+    char id[MAX_ACHIEVEMENT_ID_LENGTH];
+};
+
+typedef struct EmulatorCommand_t EmulatorCommand_t;
+
+/**
+ * Some achievements are unlocked once a stat reaches a value, the schema
+ * tells which one. The child uses it to show the progress.
+ */
+struct AchievementProgress_t {
+    std::string stat_id;
+    float min_value;
+    float max_value;
+};
+
 /**
  * This class will play the part of being the emulated app
  * It is responsible for retrieving all stats and achievements
  * for a give steam app id.
- * 
- * Technically, it calls fork, and the child process will have 
+ *
+ * Technically, it calls fork, and the child process will have
  * the role of a steam app, that will retrieve all the data
  * and pipe it to the parent process.
- * It uses SIGUSR1, so don't be surprised if you get callbacks
- * triggered if you use this signal somewhere else.
+ *
+ * Children are kept in a small pool: a spare child is forked ahead of
+ * time, and the children of recently visited games are kept alive for
+ * EMULATOR_IDLE_GRACE_SECONDS, so switching between games is fast.
+ * Each child has its own EmulatorChannel. Commands go down one ring of
+ * shared memory, and results come back on the other, whose doorbell the
+ * GTK main loop watches. The parent never waits on a child: commands the
+ * ring has no room for wait in the outbox of the worker, and a result is
+ * only handled once it is all there.
+ *
+ * The child of the displayed game is supervised: if it dies, or its
+ * heartbeat stops, a new one is started for the same app, and the
+ * commands whose result didn't come back yet are sent to it again.
+ * Those are edits and refreshes, doing them twice is harmless.
  */
 
 class GameEmulator {
@@ -36,37 +154,115 @@ public:
     bool init_app(const std::string& app_id);
 
     /**
-     * Will stop the currently running Steam app, launched with
-     * init_app
+     * Will stop displaying the currently running Steam app, launched with
+     * init_app. The process is kept alive in the background for a while,
+     * in case the user comes back to it.
      */
     bool kill_running_app();
 
     /**
-     * Will update the main view, adding all achievements to the 
+     * True if an app was started with init_app, and not killed since
+     */
+    bool is_app_running() const { return m_active_worker != -1; };
+
+    /**
+     * Kills every emulator process, running, idle or spare.
+     * Use this when the program is about to exit.
+     */
+    void kill_all_workers();
+
+    /**
+     * Forks a spare emulator process if there is none, so the next
+     * init_app doesn't have to wait for the fork.
+     */
+    void warm_up();
+
+    /**
+     * Forks a new emulator process, and gives back the channel to talk to
+     * it, to be deleted once done with it. The new process is a spare:
+     * send it an 'i' command with an app id to start the Steam app.
+     * Returns the pid of the child, -1 if it could not be started.
+     */
+    pid_t fork_worker(EmulatorChannel** channel);
+
+    /**
+     * Adds a command for an emulator process at the end of outbox, see
+     * flush_outbox to send it.
+     * See EmulatorCommand_t above for the available commands.
+     */
+    static void queue_command(std::vector<unsigned char>& outbox, const char type, const double value, const char* id);
+
+    /**
+     * Adds all the given modifications for an emulator process at the end
+     * of outbox, followed by a commit command.
+     * The process will then call StoreStats once for all of them.
+     */
+    static void queue_modifications(std::vector<unsigned char>& outbox, const std::map<std::string, bool>& achievements, const std::map<std::string, double>& stats);
+
+    /**
+     * Sends what outbox holds to an emulator process, as far as its ring has
+     * room, and keeps the rest. Never waits: if some is left, the process
+     * rings the doorbell of the channel once it has read.
+     */
+    static void flush_outbox(EmulatorChannel* channel, std::vector<unsigned char>& outbox);
+
+    /**
+     * Takes the achievements and stats sent by an emulator process, without
+     * waiting: what the process sent so far is kept in inbox, to be given
+     * again on the next call. The lists are allocated with malloc and must
+     * be freed by the caller.
+     * Returns 1 once the achievements and stats are all there, 0 if they
+     * are still on their way, -1 if Steam could not give them or the data
+     * doesn't make sense.
+     */
+    static int receive_user_stats(EmulatorChannel* channel, std::vector<unsigned char>& inbox, Achievement_t** achievements, unsigned* achievement_count, Stat_t** stats, unsigned* stat_count);
+
+    /**
+     * Will update the main view, adding all achievements to the
      * list of achievements
      */
     void update_view();
 
     /**
      * Will refetch data from the steam API.
-     * Will update the main view, adding all achievements to the 
+     * Will update the main view, adding all achievements to the
      * list of achievements
      */
     void update_data_and_view();
 
     /**
      * Will unlock the achivement given it's API name.
-     * Will return the value of SetAchievement.
+     * Returns false if the command could not be sent. SetAchievement runs
+     * in the child, which sends back an error result if it fails.
      * https://partner.steamgames.com/doc/api/ISteamUserStats#SetAchievement
      */
-    bool unlock_achievement(const char* ach_api_name) const;
+    bool unlock_achievement(const char* ach_api_name);
+
+    /**
+     * Sends all the pending modifications to the running app, and asks it
+     * to store them on Steam. Call update_data_and_view afterwards to see
+     * the result.
+     */
+    bool commit_modifications(const PendingModifications& pending);
+
+    /**
+     * The stats of the displayed app, their index is their slot in
+     * PendingModifications
+     */
+    const Stat_t* get_stat_list() const { return m_stat_list; };
+
+    /**
+     * The number of achievements of the displayed app, 0 until they came
+     */
+    unsigned get_achievement_count() const { return m_achievement_count; };
 
     /**
      * Will relock the achivement given it's API name.
-     * Will return the value of ClearAchievement.
+     * Returns false if the command could not be sent. ClearAchievement runs
+     * in the child, which sends back an error result if it fails.
      * https://partner.steamgames.com/doc/api/ISteamUserStats#ClearAchievement
      */
-    bool relock_achievement(const char* ach_api_name) const;
+    bool relock_achievement(const char* ach_api_name);
 
     /**
      * Steam API callback to handle the received stats and achievements
@@ -74,7 +270,18 @@ public:
     STEAM_CALLBACK( GameEmulator, OnUserStatsReceived, UserStatsReceived_t, m_CallbackUserStatsReceived );
 
     /**
-     * Prevent using the default constructor because we use the 
+     * Steam API call result for RequestGlobalAchievementPercentages
+     */
+    void OnGlobalAchievementPercentagesReceived(GlobalAchievementPercentagesReady_t *callback, bool io_failure);
+
+    /**
+     * Steam API callback, called when an achievement icon that wasn't
+     * ready in GetAchievementIcon finished downloading
+     */
+    STEAM_CALLBACK( GameEmulator, OnAchievementIconFetched, UserAchievementIconFetched_t, m_CallbackAchievementIconFetched );
+
+    /**
+     * Prevent using the default constructor because we use the
      * singleton pattern
      */
     GameEmulator(GameEmulator const&)            = delete;
@@ -82,17 +289,84 @@ public:
 
 private:
     void retrieve_achievements();
+    void request_current_stats(unsigned answers);
+
+    /**
+     * Parent side: pool management
+     */
+    int spawn_worker();
+    int find_worker(const std::string& app_id) const;
+    int find_spare_worker() const;
+    void stop_worker(int index);
+    void prune_idle_workers();
+    bool send_command(int index, const char type, const double value, const char* id);
+    void queue_commands(int index, const EmulatorCommand_t* commands, size_t count);
+    void flush_commands(int index);
+    static void fill_command(EmulatorCommand_t* command, const char type, const double value, const char* id);
+    bool read_results(int index);
+    void handle_user_stats(int index, const unsigned char* result);
+    void handle_icons(int index, const unsigned char* result);
+    void handle_error(int index, const unsigned char* result);
+    static void receive(EmulatorChannel* channel, std::vector<unsigned char>& inbox);
+    static bool get_result_size(const unsigned char* data, size_t size, size_t* result_size);
+    static void parse_user_stats(const unsigned char* result, Achievement_t** achievements, unsigned* achievement_count, Stat_t** stats, unsigned* stat_count);
+    void record_in_flight(const EmulatorCommand_t* commands, size_t count);
+    void acknowledge_in_flight();
+    void handle_worker_failure(int index, const std::string& reason);
+    bool restart_active_app(const std::string& app_id);
+    void check_heartbeat();
+    void report_error(const std::string& message) const;
+    static bool merge_achievements(Achievement_t* current, unsigned current_count, const Achievement_t* fresh, unsigned fresh_count, std::vector<unsigned>& changed);
+
+    /**
+     * Child side: main loop and command handling
+     */
+    void run_worker(EmulatorChannel* channel);
+    void load_stats_schema(const std::string& app_id);
+    bool load_global_percentages(const std::string& app_id);
+    void save_global_percentages(const std::string& app_id) const;
+    bool handle_command();
+    void send_user_stats();
+    void send_error(const std::string& message, char type = 'e') const;
+    void send_icons(bool all);
+    bool fetch_icon(const char* ach_id, bool achieved, int icon_handle, AchievementIcon_t& icon, const std::vector<unsigned char>** pixels);
+    void write_icons(const std::vector<AchievementIcon_t>& icons, const std::vector<const std::vector<unsigned char>*>& pixels) const;
 
     Achievement_t *m_achievement_list;
-    pid_t m_son_pid;
-    bool m_have_stats_been_requested;
-    int m_pipe[2];
+    unsigned m_stats_request_answers;   // 'i' and 'r' the stats request on its way answers, 0 if none is
+    unsigned m_refreshes_waiting;       // 'r' received meanwhile, answered by the next request
+    unsigned m_user_stats_answers_due;  // 'a' results waiting for the global percentages
     unsigned m_achievement_count;
+    Stat_t *m_stat_list;
+    unsigned m_stat_count;
+
+    EmulatorWorker_t m_workers[EMULATOR_POOL_SIZE];
+    int m_active_worker;
+
+    // Supervision of the displayed game, see handle_worker_failure.
+    // 'i' and 'r' in m_in_flight each wait for an 'a' or 'f' result.
+    std::vector<EmulatorCommand_t> m_in_flight;
+    std::vector<time_t> m_restart_times;
+    unsigned m_heartbeat_timer_id;
+    uint64_t m_last_heartbeat;
+    time_t m_last_heartbeat_change;
+
+    // Only meaningful in the child process
+    EmulatorChannel* m_channel;
+    bool m_have_user_stats;
+    bool m_have_global_percentages_been_requested;
+    bool m_have_icons_been_requested;
+    std::map<std::string, float> m_global_percentages;
+    std::map<std::string, AchievementProgress_t> m_achievement_progress;
+    std::map<std::string, std::string> m_sent_icons;
+    CCallResult<GameEmulator, GlobalAchievementPercentagesReady_t> m_global_percentages_call;
 
     friend void handle_sigchld(int);
-    friend void handle_sigusr1_parent(int);
-    friend void handle_sigusr1_child(int);
-    friend void handle_sigusr2_child(int);
+    friend void handle_sigterm(int);
+    friend gboolean on_worker_result(gint, GIOCondition, gpointer);
+    friend gboolean on_worker_hangup(gint, GIOCondition, gpointer);
+    friend gboolean on_idle_grace_expired(gpointer);
+    friend gboolean on_heartbeat_check(gpointer);
 
     GameEmulator();
     ~GameEmulator() {};
@@ -0,0 +1,297 @@
+#include "GameEmulatorManager.h"
+#include <thread>
+#include <algorithm>
+
+GameEmulatorManager::GameEmulatorManager(unsigned max_parallel)
+:
+m_max_parallel(max_parallel),
+m_next_app(0)
+{
+    if (m_max_parallel == 0) {
+        m_max_parallel = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+// => Constructor
+
+GameEmulatorManager::~GameEmulatorManager() {
+    for (RunningApp_t& app : m_running) {
+        finish_app(app, "Interrupted");
+    }
+}
+// => Destructor
+
+void
+GameEmulatorManager::add_app(const std::string& app_id) {
+    for (const AppAchievements_t& result : m_results) {
+        if (result.app_id == app_id) {
+            return;
+        }
+    }
+
+    AppAchievements_t result;
+    result.app_id = app_id;
+    result.success = false;
+    m_results.push_back(result);
+    m_attempts.push_back(0);
+}
+// => add_app
+
+void
+GameEmulatorManager::add_modification_ach(const std::string& app_id, const std::string& ach_id, const bool& new_value) {
+    add_app(app_id);
+    m_pending_ach_modifications[app_id][ach_id] = new_value;
+}
+// => add_modification_ach
+
+void
+GameEmulatorManager::add_modification_stat(const std::string& app_id, const std::string& stat_id, const double& new_value) {
+    add_app(app_id);
+    m_pending_stat_modifications[app_id][stat_id] = new_value;
+}
+// => add_modification_stat
+
+/**
+ * The main loop. Keeps max_parallel apps running, and waits for any of
+ * them to send something with poll, on the doorbell and the lifeline of
+ * their channel.
+ */
+bool
+GameEmulatorManager::run() {
+    std::vector<struct pollfd> poll_fds;
+    bool all_succeeded = true;
+
+    while (m_next_app < m_results.size() || !m_running.empty() || !m_retry_queue.empty()) {
+        // Apps that crashed go first, they already waited
+        while (m_running.size() < m_max_parallel && !m_retry_queue.empty()) {
+            start_app(m_retry_queue.front());
+            m_retry_queue.erase(m_retry_queue.begin());
+        }
+
+        while (m_running.size() < m_max_parallel && m_next_app < m_results.size()) {
+            start_app(m_next_app++);
+        }
+
+        // Forget about the apps that are done
+        m_running.erase(
+            std::remove_if(m_running.begin(), m_running.end(), [](const RunningApp_t& app) { return app.pid == -1; }),
+            m_running.end());
+
+        if (m_running.empty()) {
+            continue;
+        }
+
+        // Results may have come in since we last looked, without ringing
+        bool ready = false;
+        poll_fds.clear();
+        for (RunningApp_t& app : m_running) {
+            struct pollfd pfd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            pfd.fd = app.channel->get_doorbell_fd();
+            poll_fds.push_back(pfd);
+            pfd.fd = app.channel->get_lifeline_fd();
+            poll_fds.push_back(pfd);
+
+            ready = !app.channel->can_sleep() || ready;
+        }
+
+        if (poll(poll_fds.data(), poll_fds.size(), ready ? 0 : get_poll_timeout()) == -1 && errno != EINTR) {
+            std::cerr << "poll failed, errno: " << errno << std::endl;
+            return false;
+        }
+
+        const time_t now = time(NULL);
+        for (size_t i = 0; i < m_running.size(); i++) {
+            RunningApp_t& app = m_running[i];
+            const bool hung_up = poll_fds[2 * i + 1].revents != 0;
+
+            // The doorbell also rings when the child made room for more
+            GameEmulator::flush_outbox(app.channel, app.outbox);
+
+            if (poll_fds[2 * i].revents != 0 || hung_up || app.channel->has_data()) {
+                app.channel->acknowledge();
+                read_app_result(app, hung_up);
+            }
+
+            // Sending half of the achievements doesn't buy more time
+            if (app.pid != -1 && now >= app.deadline) {
+                retry_app(app, "Timed out waiting for the achievements");
+            }
+        }
+    }
+
+    for (const AppAchievements_t& result : m_results) {
+        all_succeeded = all_succeeded && result.success;
+    }
+
+    return all_succeeded;
+}
+// => run
+
+void
+GameEmulatorManager::start_app(size_t result_index) {
+    RunningApp_t app;
+    const std::string& app_id = m_results[result_index].app_id;
+
+    app.result_index = result_index;
+    m_attempts[result_index]++;
+    app.committing = false;
+    app.deadline = time(NULL) + EMULATOR_MANAGER_TIMEOUT_SECONDS;
+    app.pid = GameEmulator::get_instance()->fork_worker(&app.channel);
+
+    if (app.pid == -1) {
+        m_results[result_index].error = "Could not start a process for the Steam game";
+        return;
+    }
+
+    GameEmulator::queue_command(app.outbox, 'i', 0, app_id.c_str());
+    GameEmulator::flush_outbox(app.channel, app.outbox);
+    m_running.push_back(app);
+}
+// => start_app
+
+/**
+ * Takes what an app sent, never waiting for the rest. Once its achievements
+ * and stats are all there, if there are modifications to do, sends them and
+ * asks for the data again, else we are done with it.
+ * hung_up tells that the process is gone, nothing more will come.
+ */
+void
+GameEmulatorManager::read_app_result(RunningApp_t& app, bool hung_up) {
+    AppAchievements_t& result = m_results[app.result_index];
+    const std::map<std::string, bool>& modifications = m_pending_ach_modifications[result.app_id];
+    const std::map<std::string, double>& stat_modifications = m_pending_stat_modifications[result.app_id];
+    std::map<std::string, bool> ach_changes;
+    std::map<std::string, double> stat_changes;
+    Achievement_t* list;
+    Stat_t* stats;
+    unsigned count;
+    unsigned stat_count;
+
+    const int received = GameEmulator::receive_user_stats(app.channel, app.inbox, &list, &count, &stats, &stat_count);
+
+    if (received == -1) {
+        retry_app(app, "The Steam game could not send its achievements");
+        return;
+    }
+
+    if (received == 0) {
+        if (hung_up) {
+            retry_app(app, "The Steam game stopped before sending its achievements");
+        }
+        return;
+    }
+
+    if (!app.committing && (!modifications.empty() || !stat_modifications.empty())) {
+        const auto wildcard = modifications.find(ALL_ACHIEVEMENTS);
+
+        for (auto const& [ach_id, new_value] : modifications) {
+            const bool known = std::any_of(list, list + count, [&](const Achievement_t& ach) { return ach_id == ach.id; });
+
+            if (!known && ach_id != ALL_ACHIEVEMENTS) {
+                std::cerr << "WARNING: app " << result.app_id << " has no achievement " << ach_id << std::endl;
+            }
+        }
+
+        // Only send what actually changes something
+        for (unsigned i = 0; i < count; i++) {
+            auto modification = modifications.find(list[i].id);
+            if (modification == modifications.end()) {
+                modification = wildcard;
+            }
+
+            if (modification != modifications.end() && modification->second != list[i].achieved) {
+                ach_changes[list[i].id] = modification->second;
+            }
+        }
+
+        for (auto const& [stat_id, new_value] : stat_modifications) {
+            const Stat_t* stat = std::find_if(stats, stats + stat_count, [&](const Stat_t& s) { return stat_id == s.id; });
+
+            if (stat == stats + stat_count) {
+                std::cerr << "WARNING: app " << result.app_id << " has no stat " << stat_id << std::endl;
+            }
+            else if (stat->is_protected) {
+                std::cerr << "WARNING: stat " << stat_id << " of app " << result.app_id << " is protected, skipping it" << std::endl;
+            }
+            else if (stat->value != new_value) {
+                stat_changes[stat_id] = new_value;
+            }
+        }
+
+        if (!ach_changes.empty() || !stat_changes.empty()) {
+            // Sent as the child reads them, the deadline runs meanwhile
+            GameEmulator::queue_modifications(app.outbox, ach_changes, stat_changes);
+            GameEmulator::queue_command(app.outbox, 'r', 0, nullptr);
+            GameEmulator::flush_outbox(app.channel, app.outbox);
+
+            app.committing = true;
+            app.deadline = time(NULL) + EMULATOR_MANAGER_TIMEOUT_SECONDS;
+            free(list);
+            free(stats);
+            return;
+        }
+    }
+
+    result.achievements.assign(list, list + count);
+    result.stats.assign(stats, stats + stat_count);
+    result.success = true;
+    free(list);
+    free(stats);
+    finish_app(app, "");
+}
+// => read_app_result
+
+void
+GameEmulatorManager::finish_app(RunningApp_t& app, const std::string& error) {
+    if (app.pid == -1) {
+        return;
+    }
+
+    if (!error.empty()) {
+        m_results[app.result_index].error = error;
+        std::cerr << "App " << m_results[app.result_index].app_id << ": " << error << std::endl;
+    }
+
+    kill(app.pid, SIGTERM);
+    delete app.channel;
+    app.channel = nullptr;
+    app.pid = -1;
+}
+// => finish_app
+
+/**
+ * Stops an app that crashed or hung, and queues it to be started again if
+ * it has attempts left. It starts from scratch: if the modifications were
+ * already sent, they are sent again, which changes nothing.
+ */
+void
+GameEmulatorManager::retry_app(RunningApp_t& app, const std::string& error) {
+    const size_t result_index = app.result_index;
+
+    if (m_attempts[result_index] >= EMULATOR_MANAGER_MAX_ATTEMPTS) {
+        finish_app(app, error);
+        return;
+    }
+
+    std::cerr << "App " << m_results[result_index].app_id << ": " << error << ", starting it again." << std::endl;
+    finish_app(app, "");
+    m_retry_queue.push_back(result_index);
+}
+// => retry_app
+
+/**
+ * Returns how long poll may sleep before the closest deadline, in ms
+ */
+int
+GameEmulatorManager::get_poll_timeout() const {
+    const time_t now = time(NULL);
+    time_t closest = now + EMULATOR_MANAGER_TIMEOUT_SECONDS;
+
+    for (const RunningApp_t& app : m_running) {
+        closest = std::min(closest, app.deadline);
+    }
+
+    return closest > now ? (closest - now) * 1000 : 0;
+}
+// => get_poll_timeout
\ No newline at end of file
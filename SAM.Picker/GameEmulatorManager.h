@@ -0,0 +1,121 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <ctime>
+#include <poll.h>
+#include "Achievement.h"
+#include "Stat.h"
+#include "GameEmulator.h"
+
+/**
+ * How long an app has to send its achievements before we give up on it
+ */
+#define EMULATOR_MANAGER_TIMEOUT_SECONDS 60
+
+/**
+ * How many times an app is started before giving up on it, when its
+ * emulator process crashes or hangs
+ */
+#define EMULATOR_MANAGER_MAX_ATTEMPTS 3
+
+/**
+ * Achievement id meaning "every achievement of the app" in modifications
+ */
+#define ALL_ACHIEVEMENTS "*"
+
+/**
+ * What we got back from one of the apps loaded by the GameEmulatorManager.
+ * If success is false, error tells what went wrong.
+ */
+struct AppAchievements_t {
+    std::string app_id;
+    bool success;
+    std::string error;
+    std::vector<Achievement_t> achievements;
+    std::vector<Stat_t> stats;
+};
+
+/**
+ * Loads the achievements of many apps at once. Every app gets its own
+ * emulator process (see GameEmulator::fork_worker), and up to max_parallel
+ * of them run at the same time.
+ *
+ * Unlike GameEmulator, which works along with the GTK main loop, run() blocks
+ * until every app is done. Modifications added for an app are sent to it as
+ * soon as its achievements are loaded, and the achievements are read again
+ * afterwards, so the results reflect the new state.
+ * An app whose process crashes, or doesn't send its achievements within
+ * EMULATOR_MANAGER_TIMEOUT_SECONDS, is started again, up to
+ * EMULATOR_MANAGER_MAX_ATTEMPTS times, the others keep running meanwhile.
+ */
+class GameEmulatorManager {
+public:
+    /**
+     * max_parallel is the number of apps running at the same time.
+     * 0 means one per core.
+     */
+    GameEmulatorManager(unsigned max_parallel = 0);
+    ~GameEmulatorManager();
+
+    /**
+     * Queues an app to be loaded by run()
+     */
+    void add_app(const std::string& app_id);
+
+    /**
+     * Adds an achievement to unlock (new_value true) or relock for the given
+     * app. The app is queued if it wasn't already. Use ALL_ACHIEVEMENTS as
+     * ach_id to modify them all, achievements given by id still win over it.
+     */
+    void add_modification_ach(const std::string& app_id, const std::string& ach_id, const bool& new_value);
+
+    /**
+     * Adds a stat to set to new_value for the given app.
+     * The app is queued if it wasn't already.
+     */
+    void add_modification_stat(const std::string& app_id, const std::string& stat_id, const double& new_value);
+
+    /**
+     * Runs every queued app, max_parallel at a time, until they are all done.
+     * Returns true if every app succeeded.
+     */
+    bool run();
+
+    /**
+     * The results of run(), in the order the apps were added
+     */
+    const std::vector<AppAchievements_t>& get_results() const { return m_results; };
+
+    GameEmulatorManager(GameEmulatorManager const&)     = delete;
+    void operator=(GameEmulatorManager const&)          = delete;
+
+private:
+    /**
+     * An app currently being handled by an emulator process
+     */
+    struct RunningApp_t {
+        size_t result_index;
+        pid_t pid;
+        EmulatorChannel* channel;
+        time_t deadline;
+        bool committing; // Modifications sent, waiting for the refreshed achievements
+        std::vector<unsigned char> inbox; // What came of the achievements so far
+        std::vector<unsigned char> outbox; // Commands the ring had no room for yet
+    };
+
+    void start_app(size_t result_index);
+    void read_app_result(RunningApp_t& app, bool hung_up);
+    void finish_app(RunningApp_t& app, const std::string& error);
+    void retry_app(RunningApp_t& app, const std::string& error);
+    int get_poll_timeout() const;
+
+    unsigned m_max_parallel;
+    size_t m_next_app;
+    std::vector<AppAchievements_t> m_results;
+    std::vector<RunningApp_t> m_running;
+    std::vector<unsigned> m_attempts;       // Per result index
+    std::vector<size_t> m_retry_queue;      // Result indexes to start again
+    std::map<std::string, std::map<std::string, bool>> m_pending_ach_modifications;
+    std::map<std::string, std::map<std::string, double>> m_pending_stat_modifications;
+};
\ No newline at end of file
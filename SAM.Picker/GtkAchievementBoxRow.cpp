@@ -1,111 +1,199 @@
 #include "GtkAchievementBoxRow.h"
+#include <algorithm>
 #include "MySteam.h"
 #include "globals.h"
+#include "IconCache.h"
+
+/**
+ * The label of the lock button, given if the achievement is achieved,
+ * and if the button is pressed
+ */
+static const char*
+get_lock_button_label(bool achieved, bool active) {
+    if (active) {
+        return achieved ? "Unlocked" : "To unlock";
+    }
+
+    return achieved ? "To relock" : "Locked";
+}
 
 extern "C"
 {
     void 
-    on_achievement_button_toggle(GtkToggleButton* but, gpointer achievement) {
+    on_achievement_button_toggle(GtkToggleButton* but, gpointer row) {
+        GtkAchievementBoxRow* achievement_row = (GtkAchievementBoxRow *)row;
         const bool active = gtk_toggle_button_get_active(but);
-        const bool achieved = (*(Achievement_t *)achievement).achieved;
-        const std::string ach_id = std::string((*(Achievement_t *)achievement).id);
-
-        if(active && achieved) {
-            gtk_button_set_label(GTK_BUTTON(but), "Unlocked");
-            g_steam->remove_modification_ach(ach_id);
-        }
-        else if (active && !achieved) {
-            gtk_button_set_label(GTK_BUTTON(but), "To unlock");
-            g_steam->add_modification_ach(ach_id, true);
-        }
-        else if (!active && achieved) {
-            gtk_button_set_label(GTK_BUTTON(but), "To relock");
-            g_steam->add_modification_ach(ach_id, false);
-        }
-        else if (!active && !achieved) {
-            gtk_button_set_label(GTK_BUTTON(but), "Locked");
-            g_steam->remove_modification_ach(ach_id);
-        }
+
+        gtk_button_set_label(GTK_BUTTON(but), get_lock_button_label(achievement_row->get_data()->achieved, active));
+
+        // Toggling back cancels the edit
+        g_steam->get_pending_modifications()->set_achievement(achievement_row->get_slot(), active);
+    }
+
+    void
+    on_achievement_info_clicked(GtkButton* but, gpointer row) {
+        g_main_gui->show_achievement_details(GTK_WIDGET(but), *((GtkAchievementBoxRow *)row)->get_data());
     }
 }
 
-GtkAchievementBoxRow::GtkAchievementBoxRow(const Achievement_t& data) 
+GtkAchievementBoxRow::GtkAchievementBoxRow() 
 :
-m_data(data)
+m_data(nullptr),
+m_slot(0),
+m_level_bar(nullptr)
 {
-    // TODO achievement icons
-    // TODO Rewrite. Ugly AF for unknown reasons
-    char ach_title_text[MAX_ACHIEVEMENT_NAME_LENGTH + 7];
-    char ach_player_percent_text[50];
-    char ach_locked_text[9];
-    gboolean pressed;
-    if ( data.achieved ) {
-        sprintf(ach_locked_text, "%s", "Unlocked");
-        pressed = TRUE;
-    } else {
-        sprintf(ach_locked_text, "%s", "Locked");
-        pressed = FALSE;
-    }
-    sprintf(ach_title_text, "<b>%s</b>", data.name);
-    sprintf(ach_player_percent_text, "Achieved by %.1f%% of the players", data.global_achieved_rate);
-    
-
-    //TODO create and set new level bar only if ach has progress bar
     m_main_box = gtk_list_box_row_new();
-    
+    m_icon = gtk_image_new_from_icon_name("gtk-missing-image", GTK_ICON_SIZE_DIALOG);
+    m_title_desc_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
+    m_title_label = gtk_label_new("");
+    m_desc_label = gtk_label_new("");
+    m_more_info_button = gtk_button_new_from_icon_name("gtk-about", GTK_ICON_SIZE_BUTTON);
+    m_lock_unlock_button = gtk_toggle_button_new_with_label("");
+
     GtkWidget *layout = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
-    GtkWidget *ach_pic = gtk_image_new_from_icon_name("gtk-missing-image", GTK_ICON_SIZE_DIALOG);
-    GtkWidget *title_desc_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
-    GtkWidget *title_label = gtk_label_new("");
-    GtkWidget *desc_label = gtk_label_new(data.desc);
-    GtkWidget *more_info_button = gtk_menu_button_new();
-    GtkWidget *more_info_image = gtk_image_new_from_icon_name("gtk-about", GTK_ICON_SIZE_BUTTON);
-    GtkWidget *lock_unlock_button = gtk_toggle_button_new_with_label(ach_locked_text);
-    GtkWidget *popover_menu = gtk_popover_new( more_info_button );
-    GtkWidget *popover_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 3);
-    GtkWidget *more_info_label = gtk_label_new("");
-    GtkWidget *percentage_players_label = gtk_label_new(ach_player_percent_text);
-    GtkWidget *sep_one = gtk_separator_menu_item_new();
-    GtkWidget *sep_two = gtk_separator_menu_item_new();
-    GtkWidget *progression_label = gtk_label_new("Achievement progress");
-    GtkWidget *ach_level_bar = gtk_level_bar_new(); //gtk_level_bar_new_for_interval (gdouble min_value, gdouble max_value);
-    GtkWidget *ach_progress_label_value = gtk_label_new("TODO / TODO");
-
-    gtk_label_set_markup(GTK_LABEL(title_label), ach_title_text);
-    gtk_label_set_markup(GTK_LABEL(more_info_label), "<b>Additional information</b>");
-    gtk_widget_set_size_request(m_main_box, -1, 80);
-    gtk_menu_button_set_popover(GTK_MENU_BUTTON(more_info_button), GTK_WIDGET(popover_menu));
-    gtk_widget_set_valign(GTK_WIDGET(more_info_button), GTK_ALIGN_CENTER);
-    gtk_widget_set_margin_end(GTK_WIDGET(more_info_button), 10);
-    gtk_widget_set_size_request(GTK_WIDGET(lock_unlock_button), 150, -1);
-    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(lock_unlock_button), pressed);
-    gtk_container_set_border_width(GTK_CONTAINER(popover_box), 5);
+
+    // The height must not depend on the text nor the icon, see measure_height
+    gtk_widget_set_size_request(m_main_box, -1, ACHIEVEMENT_ROW_HEIGHT);
+    gtk_widget_set_size_request(m_icon, ACHIEVEMENT_ICON_SIZE, ACHIEVEMENT_ICON_SIZE);
+    gtk_label_set_ellipsize(GTK_LABEL(m_title_label), PANGO_ELLIPSIZE_END);
+    gtk_label_set_ellipsize(GTK_LABEL(m_desc_label), PANGO_ELLIPSIZE_END);
+    gtk_widget_set_valign(GTK_WIDGET(m_more_info_button), GTK_ALIGN_CENTER);
+    gtk_widget_set_margin_end(GTK_WIDGET(m_more_info_button), 10);
+    gtk_widget_set_size_request(GTK_WIDGET(m_lock_unlock_button), 150, -1);
     gtk_style_context_add_class(
-        gtk_widget_get_style_context( GTK_WIDGET(more_info_button) ),
+        gtk_widget_get_style_context( GTK_WIDGET(m_more_info_button) ),
         "circular"
     );
 
-    gtk_container_add(GTK_CONTAINER(more_info_button), GTK_WIDGET(more_info_image));
-    gtk_box_pack_start(GTK_BOX(title_desc_box), GTK_WIDGET(title_label), FALSE, TRUE, 0);
-    gtk_box_pack_start(GTK_BOX(title_desc_box), GTK_WIDGET(desc_label), TRUE, TRUE, 0);
-    gtk_box_pack_start(GTK_BOX(layout), GTK_WIDGET(ach_pic), FALSE, TRUE, 0);
-    gtk_box_pack_start(GTK_BOX(layout), GTK_WIDGET(title_desc_box), TRUE, TRUE, 0);
-    gtk_box_pack_start(GTK_BOX(layout), GTK_WIDGET(more_info_button), FALSE, TRUE, 0);
-    gtk_box_pack_start(GTK_BOX(layout), GTK_WIDGET(lock_unlock_button), FALSE, TRUE, 0);
-    gtk_box_pack_start(GTK_BOX(popover_box), GTK_WIDGET(more_info_label), FALSE, TRUE, 0);
-    gtk_box_pack_start(GTK_BOX(popover_box), GTK_WIDGET(sep_one), FALSE, TRUE, 0);
-    gtk_box_pack_start(GTK_BOX(popover_box), GTK_WIDGET(percentage_players_label), FALSE, TRUE, 0);
-    gtk_box_pack_start(GTK_BOX(popover_box), GTK_WIDGET(sep_two), FALSE, TRUE, 0);
-    gtk_box_pack_start(GTK_BOX(popover_box), GTK_WIDGET(progression_label), FALSE, TRUE, 0);
-    gtk_box_pack_start(GTK_BOX(popover_box), GTK_WIDGET(ach_level_bar), FALSE, TRUE, 0);
-    gtk_box_pack_start(GTK_BOX(popover_box), GTK_WIDGET(ach_progress_label_value), FALSE, TRUE, 0);
-
-    gtk_container_add(GTK_CONTAINER(popover_menu), GTK_WIDGET(popover_box));
-    gtk_widget_show_all(popover_box);
+    gtk_box_pack_start(GTK_BOX(m_title_desc_box), GTK_WIDGET(m_title_label), FALSE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(m_title_desc_box), GTK_WIDGET(m_desc_label), TRUE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(layout), GTK_WIDGET(m_icon), FALSE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(layout), GTK_WIDGET(m_title_desc_box), TRUE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(layout), GTK_WIDGET(m_more_info_button), FALSE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(layout), GTK_WIDGET(m_lock_unlock_button), FALSE, TRUE, 0);
     gtk_container_add(GTK_CONTAINER(m_main_box), GTK_WIDGET(layout));
+    gtk_widget_show_all(layout);
+
+    m_lock_unlock_handler_id = g_signal_connect(m_lock_unlock_button, "toggled", (GCallback)on_achievement_button_toggle, (gpointer)this);
+    g_signal_connect(m_more_info_button, "clicked", (GCallback)on_achievement_info_clicked, (gpointer)this);
+}
+
+void
+GtkAchievementBoxRow::bind(const Achievement_t* data, unsigned slot) {
+    char ach_title_text[MAX_ACHIEVEMENT_NAME_LENGTH + 7];
+
+    m_data = data;
+    m_slot = slot;
+
+    sprintf(ach_title_text, "<b>%s</b>", data->name);
+    gtk_label_set_markup(GTK_LABEL(m_title_label), ach_title_text);
+    gtk_label_set_text(GTK_LABEL(m_desc_label), data->desc);
+
+    // Most achievements have no progress, don't pay for a level bar then
+    if ( data->has_progress ) {
+        create_level_bar();
+    }
+
+    if ( m_level_bar != nullptr ) {
+        gtk_widget_set_visible(m_level_bar, data->has_progress);
+    }
+
+    if ( data->has_progress ) {
+        gtk_level_bar_set_min_value(GTK_LEVEL_BAR(m_level_bar), data->progress_min);
+        gtk_level_bar_set_max_value(GTK_LEVEL_BAR(m_level_bar), data->progress_max);
+        gtk_level_bar_set_value(GTK_LEVEL_BAR(m_level_bar), data->progress);
+    }
+
+    gtk_image_set_from_icon_name(GTK_IMAGE(m_icon), "gtk-missing-image", GTK_ICON_SIZE_DIALOG);
+    refresh_icon();
+    refresh_lock_button();
+    gtk_widget_show(m_main_box);
+}
+// => bind
+
+void
+GtkAchievementBoxRow::create_level_bar() {
+    if ( m_level_bar != nullptr ) {
+        return;
+    }
+
+    m_level_bar = gtk_level_bar_new();
+    gtk_widget_set_margin_start(m_level_bar, 20);
+    gtk_widget_set_margin_end(m_level_bar, 20);
+    gtk_box_pack_start(GTK_BOX(m_title_desc_box), GTK_WIDGET(m_level_bar), FALSE, TRUE, 0);
+}
+// => create_level_bar
+
+int
+GtkAchievementBoxRow::measure_height() {
+    int natural = 0;
+
+    create_level_bar();
+
+    // Hidden widgets measure 0, show the row as tall as it gets
+    const bool bar_visible = gtk_widget_get_visible(m_level_bar);
+    const bool row_visible = gtk_widget_get_visible(m_main_box);
+    gtk_widget_show(m_level_bar);
+    gtk_widget_show(m_main_box);
+    gtk_widget_set_size_request(m_main_box, -1, -1);
+
+    gtk_widget_get_preferred_height(m_main_box, nullptr, &natural);
+
+    gtk_widget_set_size_request(m_main_box, -1, ACHIEVEMENT_ROW_HEIGHT);
+    gtk_widget_set_visible(m_level_bar, bar_visible);
+    gtk_widget_set_visible(m_main_box, row_visible);
+
+    return std::max(natural, ACHIEVEMENT_ROW_HEIGHT);
+}
+// => measure_height
+
+void
+GtkAchievementBoxRow::set_height(int height) {
+    gtk_widget_set_size_request(m_main_box, -1, height);
+}
+// => set_height
+
+void
+GtkAchievementBoxRow::unbind() {
+    m_data = nullptr;
+    gtk_widget_hide(m_main_box);
+}
+// => unbind
+
+void
+GtkAchievementBoxRow::refresh_lock_button() {
+    const bool active = g_steam->get_pending_modifications()->get_achievement_target(m_slot);
+
+    g_signal_handler_block(m_lock_unlock_button, m_lock_unlock_handler_id);
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(m_lock_unlock_button), active);
+    gtk_button_set_label(GTK_BUTTON(m_lock_unlock_button), get_lock_button_label(m_data->achieved, active));
+    g_signal_handler_unblock(m_lock_unlock_button, m_lock_unlock_handler_id);
+}
+// => refresh_lock_button
+
+void
+GtkAchievementBoxRow::refresh_icon() {
+    if (m_data == nullptr) {
+        return;
+    }
+
+    GdkPixbuf *texture = IconCache::get_instance()->get_texture(m_data->id);
+
+    if (texture == nullptr || texture == gtk_image_get_pixbuf(GTK_IMAGE(m_icon))) {
+        return;
+    }
+
+    if (gdk_pixbuf_get_width(texture) <= ACHIEVEMENT_ICON_SIZE && gdk_pixbuf_get_height(texture) <= ACHIEVEMENT_ICON_SIZE) {
+        gtk_image_set_from_pixbuf(GTK_IMAGE(m_icon), texture);
+        return;
+    }
 
-    g_signal_connect(lock_unlock_button, "toggled", (GCallback)on_achievement_button_toggle,  (gpointer)&data);
+    // Rare, the scaled copy isn't cached and is redone on every bind
+    GdkPixbuf *scaled = gdk_pixbuf_scale_simple(texture, ACHIEVEMENT_ICON_SIZE, ACHIEVEMENT_ICON_SIZE, GDK_INTERP_BILINEAR);
+    gtk_image_set_from_pixbuf(GTK_IMAGE(m_icon), scaled);
+    g_object_unref(scaled);
 }
+// => refresh_icon
 
 GtkAchievementBoxRow::~GtkAchievementBoxRow() {
     //std::cerr << "Deleting a row" << std::endl;
@@ -4,15 +4,91 @@
 #include <gtk/gtk.h>
 #include "Achievement.h"
 
+/**
+ * The least height of a row of the achievement list. The real one depends
+ * on the theme, see GtkAchievementBoxRow::measure_height.
+ */
+#define ACHIEVEMENT_ROW_HEIGHT 80
+
+/**
+ * Steam achievement icons are 64 pixels wide, bigger ones are scaled down
+ * so they can't make their row grow
+ */
+#define ACHIEVEMENT_ICON_SIZE 64
+
+/**
+ * One row of the achievement list. Rows are recycled: the list only has
+ * enough of them to fill the screen, and binds them to other achievements
+ * as the user scrolls (see MainPickerWindow::bind_achievement_rows).
+ * The details popover is shared by all of them, and the level bar is only
+ * created once a row shows an achievement with progress.
+ */
 class GtkAchievementBoxRow {
 public:
-    GtkAchievementBoxRow(const Achievement_t& data);
+    GtkAchievementBoxRow();
     ~GtkAchievementBoxRow();
 
     GtkWidget* get_main_widget() { return m_main_box; };
 
+    /**
+     * Shows the given achievement in this row. The achievement must live
+     * until the row is bound to another one, or unbound.
+     * slot is its index in the list of the app, see PendingModifications.
+     */
+    void bind(const Achievement_t* data, unsigned slot);
+
+    /**
+     * Hides the row, it doesn't show anything anymore
+     */
+    void unbind();
+
+    /**
+     * The achievement shown, nullptr if none
+     */
+    const Achievement_t* get_data() const { return m_data; };
+    unsigned get_slot() const { return m_slot; };
+
+    /**
+     * Shows the icon the IconCache has for this achievement, if any
+     */
+    void refresh_icon();
+
+    /**
+     * Updates the lock button from the achievement and the pending
+     * modifications, without it counting as a click
+     */
+    void refresh_lock_button();
+
+    /**
+     * The tallest this row can be: one line of title, one of description,
+     * a level bar and the icon. Every row is as high as that, so the list
+     * knows which achievements are on screen from the scroll position.
+     * The row must be in the list, for the theme to apply.
+     */
+    int measure_height();
+
+    /**
+     * Makes the row exactly height pixels high, height being at least
+     * what measure_height returned
+     */
+    void set_height(int height);
+
 private:
-    Achievement_t m_data;
+    /**
+     * Adds the level bar, hidden, if the row has none yet
+     */
+    void create_level_bar();
+
+    const Achievement_t* m_data;
+    unsigned m_slot;
 
     GtkWidget *m_main_box;
+    GtkWidget *m_icon;
+    GtkWidget *m_title_desc_box;
+    GtkWidget *m_title_label;
+    GtkWidget *m_desc_label;
+    GtkWidget *m_level_bar;
+    GtkWidget *m_more_info_button;
+    GtkWidget *m_lock_unlock_button;
+    gulong m_lock_unlock_handler_id;
 };
\ No newline at end of file
@@ -0,0 +1,314 @@
+#include "IconCache.h"
+#include "../common/functions.h"
+#include "../common/lodepng.h"
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+
+/**
+ * A block of pixels received from a child, shared by the textures
+ * created from it. Freed with the last of them.
+ */
+struct PixelBlock_t {
+    unsigned char* data;
+    unsigned refs;
+};
+
+/**
+ * Makes lodepng allocate from an arena for as long as it lives. To be
+ * declared before the lodepng::State, so the state is freed inside.
+ */
+class ArenaScope {
+public:
+    ArenaScope(LodePNGArena* arena, size_t capacity) {
+        lodepng_arena_reset(arena, capacity);
+        m_previous = lodepng_arena_use(arena);
+    }
+
+    ~ArenaScope() {
+        lodepng_arena_use(m_previous);
+    }
+
+private:
+    LodePNGArena* m_previous;
+};
+
+static void
+release_pixel_block(guchar* pixels, gpointer user_data) {
+    PixelBlock_t* block = (PixelBlock_t*)user_data;
+
+    if (--block->refs == 0) {
+        free(block->data);
+        delete block;
+    }
+}
+
+/**
+ * Lazy singleton pattern
+ */
+IconCache*
+IconCache::get_instance() {
+    static IconCache me;
+    return &me;
+}
+// => get_instance
+
+void
+IconCache::load_index(const std::string& app_id) {
+    const std::string path(std::string(g_cache_folder) + "/" + app_id + "/icons");
+    std::ifstream input(path, std::ios::in);
+    std::string key, hash;
+
+    m_app_id = app_id;
+    m_index.clear();
+    m_index_dirty = false;
+    m_pixels.clear();
+    m_sizes.clear();
+
+    while (input >> key >> hash) {
+        m_index[key] = hash;
+    }
+}
+// => load_index
+
+bool
+IconCache::lookup(const std::string& ach_id, bool achieved, AchievementIcon_t& icon, const std::vector<unsigned char>** pixels) {
+    const auto hash = m_index.find(get_index_key(ach_id, achieved));
+
+    if (hash == m_index.end()) {
+        return false;
+    }
+
+    // Already decoded for an other achievement or a previous refresh
+    if (m_pixels.find(hash->second) == m_pixels.end()) {
+        const std::string path(std::string(g_cache_folder) + "/icons/" + hash->second + ".png");
+        std::vector<unsigned char> decoded;
+        unsigned width, height, error;
+
+        // The file buffer is reused from an icon to the next
+        if (lodepng::load_file(m_file, path) != 0) {
+            // Deleted, Steam will give it again
+            m_index.erase(hash);
+            m_index_dirty = true;
+            return false;
+        }
+
+        LodePNGColorMode rgba;
+        lodepng_color_mode_init(&rgba);
+        const size_t memory_size = lodepng_decode_memory_size(m_file.data(), m_file.size(), &rgba);
+
+        if (memory_size == 0) {
+            error = 1;
+        } else {
+            // All the decoding buffers are taken from the arena, emptied
+            // for each icon, so a whole app is decoded without the heap
+            ArenaScope arena(&m_arena, memory_size);
+            lodepng::State state;
+
+            // Written by us, only a truncated file is to be expected
+            // and the decoder notices those without the checksums
+            state.decoder.ignore_crc = 1;
+            state.decoder.zlibsettings.ignore_adler32 = 1;
+
+            // The pixels are decoded straight in the vector kept for the
+            // icon, rows end to end as they are sent to the parent
+            lodepng_inspect(&width, &height, &state, m_file.data(), m_file.size());
+            decoded.resize((size_t)width * height * 4);
+            error = lodepng_decode_into(decoded.data(), (size_t)width * 4, width, height, 0, &state, m_file.data(), m_file.size());
+        }
+
+        if (error != 0) {
+            // Damaged, Steam will give it again
+            m_index.erase(hash);
+            m_index_dirty = true;
+            return false;
+        }
+
+        m_pixels[hash->second].swap(decoded);
+        m_sizes[hash->second] = std::make_pair(width, height);
+    }
+
+    memset(&icon, 0, sizeof(AchievementIcon_t));
+    strncpy(icon.ach_id, ach_id.c_str(), MAX_ACHIEVEMENT_ID_LENGTH - 1);
+    strncpy(icon.hash, hash->second.c_str(), ICON_HASH_LENGTH - 1);
+    icon.width = m_sizes[hash->second].first;
+    icon.height = m_sizes[hash->second].second;
+    *pixels = &m_pixels[hash->second];
+    return true;
+}
+// => lookup
+
+void
+IconCache::store(const std::string& ach_id, bool achieved, const std::vector<unsigned char>& pixels, unsigned width, unsigned height, AchievementIcon_t& icon) {
+    const std::string hash(hash_pixels(pixels, width, height));
+    const std::string folder(std::string(g_cache_folder) + "/icons");
+    const std::string path(folder + "/" + hash + ".png");
+
+    memset(&icon, 0, sizeof(AchievementIcon_t));
+    strncpy(icon.ach_id, ach_id.c_str(), MAX_ACHIEVEMENT_ID_LENGTH - 1);
+    strncpy(icon.hash, hash.c_str(), ICON_HASH_LENGTH - 1);
+    icon.width = width;
+    icon.height = height;
+
+    m_pixels[hash] = pixels;
+    m_sizes[hash] = std::make_pair(width, height);
+    m_index[get_index_key(ach_id, achieved)] = hash;
+    m_index_dirty = true;
+
+    // Same pixels, same file. Many games reuse their icons.
+    if (file_exists(path)) {
+        return;
+    }
+
+    if ((mkdir(g_cache_folder, S_IRWXU | S_IRWXG | S_IROTH) != 0 && errno != EEXIST)
+        || (mkdir(folder.c_str(), S_IRWXU | S_IRWXG | S_IROTH) != 0 && errno != EEXIST)) {
+        std::cerr << "Unable to create the cache folder (" << folder << ", errno " << errno << ")." << std::endl;
+        return;
+    }
+
+    // Thousands of them get written during a library scan, level 2
+    // compresses icons about as well as the default in 2/3 of the time
+    std::vector<unsigned char> png;
+    unsigned error;
+    {
+        // Room for the filtered scanlines, the LZ77 output and the
+        // hash tables, what doesn't fit goes to the heap anyway
+        ArenaScope arena(&m_arena, (size_t)width * height * 8 + 262144);
+        lodepng::State state;
+        lodepng_encoder_settings_set_level(&state.encoder, 2);
+        error = lodepng::encode(png, pixels, width, height, state);
+    }
+
+    // Written aside then renamed, an other game may be reading it
+    const std::string tmp_path(path + "." + std::to_string(getpid()));
+    if (error != 0
+        || lodepng::save_file(png, tmp_path) != 0
+        || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Could not save the achievement icon " << path << std::endl;
+        unlink(tmp_path.c_str());
+    }
+}
+// => store
+
+void
+IconCache::flush_index() {
+    if (m_index_dirty) {
+        save_index();
+        m_index_dirty = false;
+    }
+}
+// => flush_index
+
+void
+IconCache::save_index() const {
+    const std::string local_folder(std::string(g_cache_folder) + "/" + m_app_id);
+    const std::string path(local_folder + "/icons");
+
+    if ((mkdir(g_cache_folder, S_IRWXU | S_IRWXG | S_IROTH) != 0 && errno != EEXIST)
+        || (mkdir(local_folder.c_str(), S_IRWXU | S_IRWXG | S_IROTH) != 0 && errno != EEXIST)) {
+        std::cerr << "Unable to create the cache folder (" << local_folder << ", errno " << errno << ")." << std::endl;
+        return;
+    }
+
+    const std::string tmp_path(path + "." + std::to_string(getpid()));
+    std::ofstream output(tmp_path, std::ios::out | std::ios::trunc);
+    for (auto const& [key, hash] : m_index) {
+        output << key << " " << hash << "\n";
+    }
+    output.close();
+
+    if (!output || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Could not save the achievement icons index to " << path << std::endl;
+        unlink(tmp_path.c_str());
+    }
+}
+// => save_index
+
+void
+IconCache::add_textures(const AchievementIcon_t* icons, unsigned count, unsigned char* pixels) {
+    PixelBlock_t* block = new PixelBlock_t;
+    size_t offset = 0;
+
+    block->data = pixels;
+    block->refs = 1; // Held by us until the end of the loop
+
+    for (unsigned i = 0; i < count; i++) {
+        const std::string hash(icons[i].hash);
+
+        m_achievement_textures[icons[i].ach_id] = hash;
+
+        if (m_textures.find(hash) == m_textures.end()) {
+            // No copy, the texture uses the block directly
+            block->refs++;
+            m_textures[hash] = gdk_pixbuf_new_from_data(
+                pixels + offset,
+                GDK_COLORSPACE_RGB,
+                TRUE,
+                8,
+                icons[i].width,
+                icons[i].height,
+                icons[i].width * 4,
+                release_pixel_block,
+                block);
+        }
+
+        offset += (size_t)icons[i].width * icons[i].height * 4;
+    }
+
+    release_pixel_block(pixels, block);
+}
+// => add_textures
+
+GdkPixbuf*
+IconCache::get_texture(const std::string& ach_id) const {
+    const auto hash = m_achievement_textures.find(ach_id);
+
+    if (hash == m_achievement_textures.end()) {
+        return nullptr;
+    }
+
+    return m_textures.at(hash->second);
+}
+// => get_texture
+
+void
+IconCache::forget_app() {
+    m_achievement_textures.clear();
+
+    // The last texture of a block frees it, see release_pixel_block
+    for (auto const& [hash, texture] : m_textures) {
+        g_object_unref(texture);
+    }
+    m_textures.clear();
+}
+// => forget_app
+
+/**
+ * 64 bits FNV-1a of the size and the pixels. Only used to name files,
+ * it doesn't need to resist anything.
+ */
+std::string
+IconCache::hash_pixels(const std::vector<unsigned char>& pixels, unsigned width, unsigned height) {
+    uint64_t hash = 14695981039346656037ULL;
+    char hash_text[ICON_HASH_LENGTH];
+
+    const unsigned size[2] = { width, height };
+    const unsigned char* size_bytes = (const unsigned char*)size;
+    for (size_t i = 0; i < sizeof(size); i++) {
+        hash = (hash ^ size_bytes[i]) * 1099511628211ULL;
+    }
+
+    for (const unsigned char byte : pixels) {
+        hash = (hash ^ byte) * 1099511628211ULL;
+    }
+
+    snprintf(hash_text, ICON_HASH_LENGTH, "%016llx", (unsigned long long)hash);
+    return hash_text;
+}
+// => hash_pixels
+
+std::string
+IconCache::get_index_key(const std::string& ach_id, bool achieved) {
+    return ach_id + (achieved ? ":1" : ":0");
+}
+// => get_index_key
\ No newline at end of file
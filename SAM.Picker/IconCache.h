@@ -0,0 +1,119 @@
+#pragma once
+#include <string>
+#include <map>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <gtk/gtk.h>
+#include "Achievement.h"
+#include "globals.h"
+#include "../common/lodepng.h"
+
+/**
+ * Icons are identified by the hash of their pixels, as an hex string
+ */
+#define ICON_HASH_LENGTH 17
+
+/**
+ * Describes one icon piped from a child to the parent. An 'i' result is
+ * the icon count, every AchievementIcon_t, then all the RGBA pixels one
+ * icon after the other, in a single block.
+ */
+struct AchievementIcon_t {
+    char ach_id[MAX_ACHIEVEMENT_ID_LENGTH];
+    char hash[ICON_HASH_LENGTH];
+    unsigned width;
+    unsigned height;
+};
+
+typedef struct AchievementIcon_t AchievementIcon_t;
+
+/**
+ * Keeps the achievement icons around, so they are only asked to Steam once.
+ *
+ * The child side is a content-addressed cache on the disk: the pixels go
+ * to <cache folder>/icons/<hash>.png, and <cache folder>/<app id>/icons
+ * tells which hash every achievement uses, locked and unlocked.
+ *
+ * The parent side keeps one GdkPixbuf per hash, shared by all the rows
+ * showing that icon.
+ */
+class IconCache {
+public:
+    /**
+     * Singleton method to get the unique instance
+     */
+    static IconCache* get_instance();
+
+    /**
+     * Child side. Reads the index of the given app, telling which icon
+     * each achievement uses. The pixels kept for another app are dropped.
+     */
+    void load_index(const std::string& app_id);
+
+    /**
+     * Child side. Gives the pixels of the icon of an achievement from the
+     * disk or memory, if it has been stored before.
+     * Returns false if Steam needs to be asked.
+     */
+    bool lookup(const std::string& ach_id, bool achieved, AchievementIcon_t& icon, const std::vector<unsigned char>** pixels);
+
+    /**
+     * Child side. Stores the pixels of an achievement icon on the disk,
+     * and fills icon with its hash and size.
+     */
+    void store(const std::string& ach_id, bool achieved, const std::vector<unsigned char>& pixels, unsigned width, unsigned height, AchievementIcon_t& icon);
+
+    /**
+     * Child side. Saves the index of the app if icons were stored or
+     * forgotten since it was last saved. Call it once a batch of icons
+     * is done, not after each one.
+     */
+    void flush_index();
+
+    /**
+     * Parent side. Takes ownership of a block of pixels received from a
+     * child, allocated with malloc, and makes a texture of each icon that
+     * wasn't already known. The textures point into the block, which is
+     * freed once none of them uses it anymore.
+     */
+    void add_textures(const AchievementIcon_t* icons, unsigned count, unsigned char* pixels);
+
+    /**
+     * Parent side. Gives the texture of the given achievement of the
+     * app being displayed, or nullptr if it didn't arrive yet.
+     */
+    GdkPixbuf* get_texture(const std::string& ach_id) const;
+
+    /**
+     * Parent side. Forgets which icons the achievements of the displayed app
+     * use, and releases the textures, call it when switching to another app.
+     * Rows still showing an icon keep their own reference to it.
+     */
+    void forget_app();
+
+    IconCache(IconCache const&)                 = delete;
+    void operator=(IconCache const&)            = delete;
+
+private:
+    IconCache() : m_index_dirty(false) { lodepng_arena_init(&m_arena); };
+    ~IconCache() { lodepng_arena_cleanup(&m_arena); };
+
+    static std::string hash_pixels(const std::vector<unsigned char>& pixels, unsigned width, unsigned height);
+    static std::string get_index_key(const std::string& ach_id, bool achieved);
+    void save_index() const;
+
+    // Child side
+    std::string m_app_id;
+    std::map<std::string, std::string> m_index;
+    bool m_index_dirty;
+    std::map<std::string, std::vector<unsigned char>> m_pixels;
+    std::map<std::string, std::pair<unsigned, unsigned>> m_sizes;
+    std::vector<unsigned char> m_file;
+    LodePNGArena m_arena;
+
+    // Parent side
+    std::map<std::string, GdkPixbuf*> m_textures;
+    std::map<std::string, std::string> m_achievement_textures;
+};
\ No newline at end of file
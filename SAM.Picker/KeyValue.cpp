@@ -0,0 +1,208 @@
+#include "KeyValue.h"
+#include <cstring>
+#include <cstdlib>
+#include <strings.h>
+
+/**
+ * Returned by operator[] when the key doesn't exist
+ */
+static const KeyValue s_invalid_key_value;
+
+KeyValue::KeyValue()
+:
+m_type(TYPE_INVALID),
+m_integer(0),
+m_float(0)
+{
+
+}
+// => Constructor
+
+bool
+KeyValue::load_binary(const std::string& path) {
+    std::ifstream input(path, std::ios::in | std::ios::binary);
+
+    if (!input) {
+        return false;
+    }
+
+    // The file is one subsection, the root, usually named after the app id
+    m_children.clear();
+    m_type = TYPE_SUBSECTION;
+    m_name = "";
+    if (!read_children(input) || m_children.size() != 1) {
+        m_type = TYPE_INVALID;
+        return false;
+    }
+
+    KeyValue root = m_children[0];
+    *this = root;
+    return true;
+}
+// => load_binary
+
+/**
+ * Reads KeyValues until the end marker of the current subsection
+ */
+bool
+KeyValue::read_children(std::ifstream& input) {
+    int type;
+
+    while ((type = input.get()) != EOF) {
+        if (type == TYPE_END || type == TYPE_ALTERNATE_END) {
+            return true;
+        }
+
+        KeyValue child;
+        child.m_type = (Type)type;
+        if (!read_string(input, child.m_name)) {
+            return false;
+        }
+
+        switch (type) {
+            case TYPE_SUBSECTION:
+                if (!child.read_children(input)) {
+                    return false;
+                }
+                break;
+
+            case TYPE_STRING:
+                if (!read_string(input, child.m_string)) {
+                    return false;
+                }
+                break;
+
+            case TYPE_INT32:
+            case TYPE_POINTER:
+            case TYPE_COLOR: {
+                int32_t value;
+                input.read((char*)&value, sizeof(int32_t));
+                child.m_integer = value;
+                break;
+            }
+
+            case TYPE_FLOAT32: {
+                float value;
+                input.read((char*)&value, sizeof(float));
+                child.m_float = value;
+                break;
+            }
+
+            case TYPE_UINT64:
+            case TYPE_INT64: {
+                int64_t value;
+                input.read((char*)&value, sizeof(int64_t));
+                child.m_integer = value;
+                break;
+            }
+
+            default:
+                // Wide strings are not used in the stats files, and we can't
+                // know their length anyway
+                return false;
+        }
+
+        if (!input) {
+            return false;
+        }
+
+        m_children.push_back(child);
+    }
+
+    // Only the root is allowed to end without a marker
+    return m_name.empty();
+}
+// => read_children
+
+bool
+KeyValue::read_string(std::ifstream& input, std::string& out) {
+    return (bool)std::getline(input, out, '\0');
+}
+// => read_string
+
+const KeyValue&
+KeyValue::operator[](const std::string& key) const {
+    for (const KeyValue& child : m_children) {
+        if (strcasecmp(child.m_name.c_str(), key.c_str()) == 0) {
+            return child;
+        }
+    }
+
+    return s_invalid_key_value;
+}
+// => operator[]
+
+std::string
+KeyValue::as_string(const std::string& default_value) const {
+    switch (m_type) {
+        case TYPE_STRING:
+            return m_string;
+        case TYPE_INT32:
+        case TYPE_POINTER:
+        case TYPE_COLOR:
+        case TYPE_UINT64:
+        case TYPE_INT64:
+            return std::to_string(m_integer);
+        case TYPE_FLOAT32:
+            return std::to_string(m_float);
+        default:
+            return default_value;
+    }
+}
+// => as_string
+
+int64_t
+KeyValue::as_integer(int64_t default_value) const {
+    char* end;
+
+    switch (m_type) {
+        case TYPE_STRING: {
+            const long long value = strtoll(m_string.c_str(), &end, 10);
+            return (end != m_string.c_str() && *end == '\0') ? value : default_value;
+        }
+        case TYPE_INT32:
+        case TYPE_POINTER:
+        case TYPE_COLOR:
+        case TYPE_UINT64:
+        case TYPE_INT64:
+            return m_integer;
+        case TYPE_FLOAT32:
+            return (int64_t)m_float;
+        default:
+            return default_value;
+    }
+}
+// => as_integer
+
+double
+KeyValue::as_float(double default_value) const {
+    char* end;
+
+    switch (m_type) {
+        case TYPE_STRING: {
+            const double value = strtod(m_string.c_str(), &end);
+            return (end != m_string.c_str() && *end == '\0') ? value : default_value;
+        }
+        case TYPE_INT32:
+        case TYPE_POINTER:
+        case TYPE_COLOR:
+        case TYPE_UINT64:
+        case TYPE_INT64:
+            return (double)m_integer;
+        case TYPE_FLOAT32:
+            return m_float;
+        default:
+            return default_value;
+    }
+}
+// => as_float
+
+bool
+KeyValue::as_boolean(bool default_value) const {
+    if (!is_valid() || m_type == TYPE_SUBSECTION) {
+        return default_value;
+    }
+
+    return as_integer(default_value ? 1 : 0) != 0;
+}
+// => as_boolean
\ No newline at end of file
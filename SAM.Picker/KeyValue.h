@@ -0,0 +1,72 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+
+/**
+ * Minimal reader for Valve's binary KeyValues format, which Steam uses
+ * for the files in appcache/stats/. For example,
+ * UserGameStatsSchema_<appid>.bin describes every stat and achievement of
+ * an app, which the Steam API has no way to enumerate.
+ *
+ * A KeyValue is either a value (string, int, float...) or a subsection
+ * holding other KeyValues.
+ */
+class KeyValue {
+public:
+    enum Type {
+        TYPE_SUBSECTION = 0,
+        TYPE_STRING = 1,
+        TYPE_INT32 = 2,
+        TYPE_FLOAT32 = 3,
+        TYPE_POINTER = 4,
+        TYPE_WIDESTRING = 5,
+        TYPE_COLOR = 6,
+        TYPE_UINT64 = 7,
+        TYPE_END = 8,
+        TYPE_INT64 = 10,
+        TYPE_ALTERNATE_END = 11,
+        TYPE_INVALID = 255
+    };
+
+    KeyValue();
+
+    /**
+     * Parses a binary KeyValues file. Returns false if it could not be
+     * opened or is malformed.
+     */
+    bool load_binary(const std::string& path);
+
+    /**
+     * Returns the child with the given name (case insensitive), or an invalid
+     * KeyValue if there is none, so lookups can be chained safely:
+     * kv["stats"]["1"]["name"]
+     */
+    const KeyValue& operator[](const std::string& key) const;
+
+    bool is_valid() const { return m_type != TYPE_INVALID; };
+
+    /**
+     * Value getters. Strings holding numbers are converted, and the
+     * default is returned if the value can't be represented.
+     */
+    std::string as_string(const std::string& default_value) const;
+    int64_t as_integer(int64_t default_value) const;
+    double as_float(double default_value) const;
+    bool as_boolean(bool default_value) const;
+
+    std::string get_name() const { return m_name; };
+    const std::vector<KeyValue>& get_children() const { return m_children; };
+
+private:
+    bool read_children(std::ifstream& input);
+    static bool read_string(std::ifstream& input, std::string& out);
+
+    std::string m_name;
+    Type m_type;
+    std::string m_string;
+    int64_t m_integer;
+    double m_float;
+    std::vector<KeyValue> m_children;
+};
\ No newline at end of file
@@ -1,15 +1,87 @@
 #include "MainPickerWindow.h"
+#include "../common/lodepng.h"
+#include <cstring>
+
+/**
+ * Called when the achievement list is scrolled or resized,
+ * to show the achievements now on screen.
+ */
+void
+on_achievement_list_scrolled(GtkAdjustment* adjustment, gpointer user_data) {
+    ((MainPickerWindow*)user_data)->bind_achievement_rows();
+}
+
+/**
+ * Loads an image straight at the given size, the full size one never
+ * exists. PNGs are box filtered by lodepng while they are decoded, the
+ * other formats (Steam sends JPEGs) are reduced by their GdkPixbuf loader.
+ * Returns nullptr and sets error if it can't be read.
+ */
+static GdkPixbuf*
+load_thumbnail(const std::string& path, int width, int height, GError** error) {
+    std::vector<unsigned char> file;
+    GdkPixbuf* pixbuf = nullptr;
+
+    if (lodepng::load_file(file, path) != 0) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_NOENT, "Could not read %s", path.c_str());
+        return nullptr;
+    }
+
+    // Without a pixbuf to decode into, the loader below reads PNGs too
+    if (file.size() >= 8 && memcmp(file.data(), "\x89PNG\r\n\x1a\n", 8) == 0
+        && (pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, TRUE, 8, width, height)) != nullptr) {
+        lodepng::State state;
+        unsigned lodepng_error;
+
+        lodepng_error = lodepng_decode_scaled(gdk_pixbuf_get_pixels(pixbuf), gdk_pixbuf_get_rowstride(pixbuf),
+                                              width, height, 0, &state, file.data(), file.size());
+        if (lodepng_error != 0) {
+            g_set_error(error, GDK_PIXBUF_ERROR, GDK_PIXBUF_ERROR_CORRUPT_IMAGE, "%s", lodepng_error_text(lodepng_error));
+            g_object_unref(pixbuf);
+            return nullptr;
+        }
+        return pixbuf;
+    }
+
+    // libjpeg decodes at 1/2, 1/4 or 1/8 of the size when asked for less
+    GdkPixbufLoader* loader = gdk_pixbuf_loader_new();
+    gdk_pixbuf_loader_set_size(loader, width, height);
+    const bool written = gdk_pixbuf_loader_write(loader, file.data(), file.size(), error);
+    // Closed even after a failed write, a second error is then ignored
+    if (gdk_pixbuf_loader_close(loader, written ? error : nullptr) && written) {
+        pixbuf = gdk_pixbuf_loader_get_pixbuf(loader);
+        if (pixbuf != nullptr) {
+            g_object_ref(pixbuf);
+        }
+    }
+    g_object_unref(loader);
+    return pixbuf;
+}
 
 MainPickerWindow::MainPickerWindow() 
 : 
 m_main_window(nullptr),
 m_back_button(nullptr),
+m_store_button(nullptr),
+m_stat_values_button(nullptr),
+m_bulk_button(nullptr),
+m_search_entry(nullptr),
+m_achievement_options_box(nullptr),
+m_error_bar(nullptr),
+m_error_label(nullptr),
 m_game_list(nullptr),
 m_stats_list(nullptr),
+m_stat_values_list(nullptr),
 m_builder(nullptr),
 m_main_stack(nullptr),
 m_game_list_view(nullptr),
-m_stats_list_view(nullptr)
+m_stats_list_view(nullptr),
+m_stat_values_view(nullptr),
+m_stats_list_adjustment(nullptr),
+m_achievements(nullptr),
+m_achievement_count(0),
+m_first_bound_achievement(0),
+m_achievement_row_height(0)
 {
     GError *error = NULL;
     m_builder = gtk_builder_new();
@@ -25,12 +97,20 @@ m_stats_list_view(nullptr)
     // Load the required widgets through the builder
     m_game_list = GTK_LIST_BOX(gtk_builder_get_object(m_builder, "game_list"));
     m_stats_list = GTK_LIST_BOX(gtk_builder_get_object(m_builder, "stats_list"));
+    m_stat_values_list = GTK_LIST_BOX(gtk_builder_get_object(m_builder, "stat_values_list"));
     m_main_window = GTK_WIDGET(gtk_builder_get_object(m_builder, "main_window"));
     m_main_stack = GTK_STACK(gtk_builder_get_object(m_builder, "main_stack"));
     m_game_list_view = GTK_SCROLLED_WINDOW(gtk_builder_get_object(m_builder, "game_list_view"));
     m_stats_list_view = GTK_SCROLLED_WINDOW(gtk_builder_get_object(m_builder, "stats_list_view"));
+    m_stat_values_view = GTK_SCROLLED_WINDOW(gtk_builder_get_object(m_builder, "stat_values_view"));
     m_back_button = GTK_BUTTON(gtk_builder_get_object(m_builder, "back_button"));
     m_store_button = GTK_BUTTON(gtk_builder_get_object(m_builder, "store_button"));
+    m_stat_values_button = GTK_TOGGLE_BUTTON(gtk_builder_get_object(m_builder, "stat_values_button"));
+    m_bulk_button = GTK_WIDGET(gtk_builder_get_object(m_builder, "bulk_button"));
+    m_search_entry = GTK_ENTRY(gtk_builder_get_object(m_builder, "search_entry"));
+    m_achievement_options_box = GTK_WIDGET(gtk_builder_get_object(m_builder, "achievement_options_box"));
+    m_error_bar = GTK_WIDGET(gtk_builder_get_object(m_builder, "error_bar"));
+    m_error_label = GTK_LABEL(gtk_builder_get_object(m_builder, "error_label"));
     GtkWidget* game_placeholder = GTK_WIDGET(gtk_builder_get_object(m_builder, "game_placeholder"));
     GtkWidget* stats_placeholder = GTK_WIDGET(gtk_builder_get_object(m_builder, "stats_placeholder"));
 
@@ -42,9 +122,80 @@ m_stats_list_view(nullptr)
     gtk_list_box_set_placeholder(m_game_list, game_placeholder);
     gtk_list_box_set_placeholder(m_stats_list, stats_placeholder);
     gtk_widget_show(game_placeholder);
+
+    create_achievement_details_popover();
+
+    // The achievement rows follow the scrolling, see bind_achievement_rows
+    m_stats_list_adjustment = gtk_scrolled_window_get_vadjustment(m_stats_list_view);
+    g_signal_connect(m_stats_list_adjustment, "value-changed", (GCallback)on_achievement_list_scrolled, this);
+    g_signal_connect(m_stats_list_adjustment, "changed", (GCallback)on_achievement_list_scrolled, this);
 }
 // => Constructor
 
+/**
+ * One popover for all the achievements, see show_achievement_details
+ */
+void
+MainPickerWindow::create_achievement_details_popover() {
+    GtkWidget *popover_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 3);
+    GtkWidget *more_info_label = gtk_label_new("");
+    GtkWidget *sep_one = gtk_separator_menu_item_new();
+    GtkWidget *sep_two = gtk_separator_menu_item_new();
+    GtkWidget *progression_label = gtk_label_new("Achievement progress");
+
+    m_achievement_popover = gtk_popover_new( GTK_WIDGET(m_stats_list) );
+    m_achievement_popover_title = gtk_label_new("");
+    m_achievement_popover_percent = gtk_label_new("");
+    m_achievement_popover_progress_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 3);
+    m_achievement_popover_level_bar = gtk_level_bar_new();
+    m_achievement_popover_progress = gtk_label_new("");
+
+    gtk_label_set_markup(GTK_LABEL(more_info_label), "<b>Additional information</b>");
+    gtk_container_set_border_width(GTK_CONTAINER(popover_box), 5);
+
+    gtk_box_pack_start(GTK_BOX(popover_box), GTK_WIDGET(more_info_label), FALSE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(popover_box), GTK_WIDGET(m_achievement_popover_title), FALSE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(popover_box), GTK_WIDGET(sep_one), FALSE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(popover_box), GTK_WIDGET(m_achievement_popover_percent), FALSE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(m_achievement_popover_progress_box), GTK_WIDGET(sep_two), FALSE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(m_achievement_popover_progress_box), GTK_WIDGET(progression_label), FALSE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(m_achievement_popover_progress_box), GTK_WIDGET(m_achievement_popover_level_bar), FALSE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(m_achievement_popover_progress_box), GTK_WIDGET(m_achievement_popover_progress), FALSE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(popover_box), GTK_WIDGET(m_achievement_popover_progress_box), FALSE, TRUE, 0);
+
+    gtk_container_add(GTK_CONTAINER(m_achievement_popover), GTK_WIDGET(popover_box));
+    gtk_widget_show_all(popover_box);
+}
+// => create_achievement_details_popover
+
+void
+MainPickerWindow::show_achievement_details(GtkWidget* relative_to, const Achievement_t& achievement) {
+    char ach_player_percent_text[50];
+    char ach_progress_text[50];
+
+    if ( achievement.global_achieved_rate < 0 ) {
+        sprintf(ach_player_percent_text, "%s", "Unknown rarity");
+    } else {
+        sprintf(ach_player_percent_text, "Achieved by %.1f%% of the players", achievement.global_achieved_rate);
+    }
+
+    gtk_label_set_text(GTK_LABEL(m_achievement_popover_title), achievement.id);
+    gtk_label_set_text(GTK_LABEL(m_achievement_popover_percent), ach_player_percent_text);
+
+    gtk_widget_set_visible(m_achievement_popover_progress_box, achievement.has_progress);
+    if ( achievement.has_progress ) {
+        sprintf(ach_progress_text, "%g / %g", achievement.progress, achievement.progress_max);
+        gtk_level_bar_set_min_value(GTK_LEVEL_BAR(m_achievement_popover_level_bar), achievement.progress_min);
+        gtk_level_bar_set_max_value(GTK_LEVEL_BAR(m_achievement_popover_level_bar), achievement.progress_max);
+        gtk_level_bar_set_value(GTK_LEVEL_BAR(m_achievement_popover_level_bar), achievement.progress);
+        gtk_label_set_text(GTK_LABEL(m_achievement_popover_progress), ach_progress_text);
+    }
+
+    gtk_popover_set_relative_to(GTK_POPOVER(m_achievement_popover), relative_to);
+    gtk_popover_popup(GTK_POPOVER(m_achievement_popover));
+}
+// => show_achievement_details
+
 
 
 /**
@@ -64,18 +215,41 @@ MainPickerWindow::reset_game_list() {
 }
 // => reset_game_list
 
+/**
+ * The rows are kept for the next game, only hidden
+ */
 void 
 MainPickerWindow::reset_achievements_list() {
+    // The popover may be pointing at a row about to show something else
+    gtk_popover_popdown(GTK_POPOVER(m_achievement_popover));
+
+    m_achievements = nullptr;
+    m_achievement_count = 0;
+    m_first_bound_achievement = 0;
+    m_achievement_filter.set_achievements(nullptr, 0);
+
     for ( GtkAchievementBoxRow* row : m_achievement_list_rows )
     {
-        delete row;
-        row = nullptr;
+        row->unbind();
     }
 
-    m_achievement_list_rows.clear(); // Just to be sure
+    gtk_widget_set_margin_top(GTK_WIDGET(m_stats_list), 0);
+    gtk_widget_set_margin_bottom(GTK_WIDGET(m_stats_list), 0);
+    gtk_adjustment_set_value(m_stats_list_adjustment, 0);
 }
 // => reset_achievements_list
 
+void
+MainPickerWindow::reset_stat_list() {
+    for ( GtkWidget* row : m_stat_list_rows )
+    {
+        gtk_widget_destroy( row );
+    }
+
+    m_stat_list_rows.clear();
+}
+// => reset_stat_list
+
 
 /**
  * Add a game to the list. Ignores warnings for the obsolete GtkArrow.
@@ -119,20 +293,221 @@ MainPickerWindow::add_to_game_list(const Game_t& app) {
 // => add_to_game_list
 
 void
-MainPickerWindow::add_to_achievement_list(const Achievement_t& achievement) {
-    GtkAchievementBoxRow *row = new GtkAchievementBoxRow(achievement);
-    m_achievement_list_rows.push_back(row);
+MainPickerWindow::set_achievements(const Achievement_t* achievements, unsigned count) {
+    m_achievements = achievements;
+    m_achievement_count = count;
+    m_achievement_filter.set_achievements(achievements, count);
+    m_achievement_filter.apply(*g_steam->get_pending_modifications());
+    bind_achievement_rows();
+}
+// => set_achievements
+
+void
+MainPickerWindow::refresh_achievements(const std::vector<unsigned>& changed) {
+    // Some may not pass the filter anymore, or have moved
+    if (!changed.empty()) {
+        m_achievement_filter.update_achievements(changed);
+    }
+    m_achievement_filter.apply(*g_steam->get_pending_modifications());
+    bind_achievement_rows();
+
+    for (GtkAchievementBoxRow* row : m_achievement_list_rows) {
+        if (row->get_data() == nullptr) {
+            continue;
+        }
+
+        if (std::binary_search(changed.begin(), changed.end(), row->get_slot())) {
+            row->bind(row->get_data(), row->get_slot());
+        } else {
+            // The modifications were stored, the buttons may be stale
+            row->refresh_lock_button();
+        }
+    }
+}
+// => refresh_achievements
 
-    gtk_list_box_insert(m_stats_list, GTK_WIDGET( row->get_main_widget() ), -1);
+void
+MainPickerWindow::refresh_pending_achievements() {
+    // Nothing changed in the achievements themselves
+    refresh_achievements(std::vector<unsigned>());
 }
-// => add_to_achievement_list
+// => refresh_pending_achievements
+
+void
+MainPickerWindow::unlock_shown_achievements() {
+    g_steam->get_pending_modifications()->set_achievements(m_achievement_filter.get_visible(), true);
+    refresh_pending_achievements();
+}
+// => unlock_shown_achievements
+
+/**
+ * Measured once, on the first row, as the theme can't change meanwhile.
+ * Every row is then forced to that height: were one taller, the margins
+ * would be off and the list would drift while scrolling.
+ */
+unsigned
+MainPickerWindow::get_achievement_row_height() {
+    if (m_achievement_row_height == 0) {
+        if (m_achievement_list_rows.empty()) {
+            GtkAchievementBoxRow *row = new GtkAchievementBoxRow();
+            m_achievement_list_rows.push_back(row);
+            gtk_list_box_insert(m_stats_list, GTK_WIDGET( row->get_main_widget() ), -1);
+        }
+
+        m_achievement_row_height = m_achievement_list_rows[0]->measure_height();
+
+        for (GtkAchievementBoxRow *row : m_achievement_list_rows) {
+            row->set_height(m_achievement_row_height);
+        }
+    }
+
+    return m_achievement_row_height;
+}
+// => get_achievement_row_height
+
+/**
+ * Only the achievements on screen have a row. The list box is pushed down
+ * by a top margin as high as the rows above would be, and a bottom margin
+ * stands for the rows below, so the scrollbar behaves as if they all were
+ * there. Rows are created as needed to fill the screen, and rebound to
+ * other achievements when scrolling.
+ */
+void
+MainPickerWindow::bind_achievement_rows() {
+    const double page_size = gtk_adjustment_get_page_size(m_stats_list_adjustment);
+    const double scroll = gtk_adjustment_get_value(m_stats_list_adjustment);
+    const unsigned row_height = get_achievement_row_height();
+    // Before the first allocation the page size is 0, a window is about 10 rows high
+    const unsigned rows_on_screen = (page_size > 0) ? page_size / row_height + 2 : 10;
+    const std::vector<unsigned>& visible = m_achievement_filter.get_visible();
+    const unsigned visible_count = visible.size();
+    const unsigned row_count = std::min(rows_on_screen, visible_count);
+    const unsigned first = std::min((unsigned)(scroll / row_height), visible_count - row_count);
+
+    while (m_achievement_list_rows.size() < row_count) {
+        GtkAchievementBoxRow *row = new GtkAchievementBoxRow();
+        row->set_height(row_height);
+        m_achievement_list_rows.push_back(row);
+        gtk_list_box_insert(m_stats_list, GTK_WIDGET( row->get_main_widget() ), -1);
+    }
+
+    if (first != m_first_bound_achievement) {
+        gtk_popover_popdown(GTK_POPOVER(m_achievement_popover));
+        m_first_bound_achievement = first;
+    }
+
+    for (unsigned i = 0; i < m_achievement_list_rows.size(); i++) {
+        if (i < row_count) {
+            // Most scroll events move less than a row
+            const unsigned slot = visible[first + i];
+            if (m_achievement_list_rows[i]->get_data() != &m_achievements[slot]) {
+                m_achievement_list_rows[i]->bind(&m_achievements[slot], slot);
+            }
+        } else {
+            m_achievement_list_rows[i]->unbind();
+        }
+    }
+
+    gtk_widget_set_margin_top(GTK_WIDGET(m_stats_list), first * row_height);
+    gtk_widget_set_margin_bottom(GTK_WIDGET(m_stats_list), (visible_count - first - row_count) * row_height);
+}
+// => bind_achievement_rows
+
+/**
+ * Filters and sorts the achievements again, and goes back to the top
+ * of the list. No widget is created, the rows are only rebound.
+ */
+void
+MainPickerWindow::apply_achievement_filter() {
+    m_achievement_filter.apply(*g_steam->get_pending_modifications());
+    gtk_adjustment_set_value(m_stats_list_adjustment, 0);
+    bind_achievement_rows();
+}
+// => apply_achievement_filter
+
+void
+MainPickerWindow::filter_achievements(const char* filter_text) {
+    m_achievement_filter.set_search(filter_text);
+    apply_achievement_filter();
+}
+// => filter_achievements
+
+void
+MainPickerWindow::set_achievement_state_filter(AchievementFilter::StateFilter filter) {
+    m_achievement_filter.set_state_filter(filter);
+    apply_achievement_filter();
+}
+// => set_achievement_state_filter
+
+void
+MainPickerWindow::set_achievement_sort_order(AchievementFilter::SortOrder order) {
+    m_achievement_filter.set_sort_order(order);
+    apply_achievement_filter();
+}
+// => set_achievement_sort_order
+
+/**
+ * Stats are simple enough to not need their own class: a name, and a spin
+ * button holding the value. Protected stats are shown but can't be edited,
+ * Steam would refuse them anyway.
+ */
+void
+MainPickerWindow::add_to_stat_list(const Stat_t& stat, double value) {
+    char stat_title_text[MAX_STAT_NAME_LENGTH + 7];
+    const bool is_int = (stat.type == STAT_TYPE_INT);
+    // Increment-only stats can't go below their current value
+    const double min_value = stat.increment_only ? std::max(stat.value, stat.min_value) : stat.min_value;
+
+    GtkWidget *wrapper = gtk_list_box_row_new();
+    GtkWidget *layout = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
+    GtkWidget *title_label = gtk_label_new("");
+    GtkWidget *value_button = gtk_spin_button_new_with_range(min_value, stat.max_value, is_int ? 1 : 0.1);
+
+    sprintf(stat_title_text, "<b>%s</b>", stat.name);
+    gtk_label_set_markup(GTK_LABEL(title_label), stat_title_text);
+    gtk_label_set_xalign(GTK_LABEL(title_label), 0);
+    gtk_widget_set_tooltip_text(title_label, stat.id);
+    gtk_widget_set_size_request(wrapper, -1, 50);
+    gtk_widget_set_margin_start(layout, 10);
+    gtk_widget_set_margin_end(layout, 10);
+    gtk_widget_set_valign(value_button, GTK_ALIGN_CENTER);
+    gtk_widget_set_size_request(value_button, 150, -1);
+    gtk_spin_button_set_digits(GTK_SPIN_BUTTON(value_button), is_int ? 0 : 3);
+    gtk_spin_button_set_value(GTK_SPIN_BUTTON(value_button), value);
+
+    if (stat.is_protected) {
+        gtk_widget_set_sensitive(value_button, FALSE);
+        gtk_widget_set_tooltip_text(value_button, "This stat is protected, only the game can change it.");
+    }
+
+    gtk_box_pack_start(GTK_BOX(layout), GTK_WIDGET(title_label), TRUE, TRUE, 0);
+    gtk_box_pack_start(GTK_BOX(layout), GTK_WIDGET(value_button), FALSE, TRUE, 0);
+    gtk_container_add(GTK_CONTAINER(wrapper), GTK_WIDGET(layout));
+    gtk_list_box_insert(m_stat_values_list, GTK_WIDGET(wrapper), -1);
+
+    // Connected last, so setting the initial value doesn't count as an edit
+    g_signal_connect(value_button, "value-changed", (GCallback)on_stat_value_changed, (gpointer)&stat);
+
+    m_stat_list_rows.push_back(wrapper);
+}
+// => add_to_stat_list
 
 void
 MainPickerWindow::confirm_stats_list() {
     gtk_widget_show_all( GTK_WIDGET(m_stats_list) );
+    gtk_widget_show_all( GTK_WIDGET(m_stat_values_list) );
 }
 // => confirm_stats_list
 
+void
+MainPickerWindow::refresh_achievement_icons() {
+    for ( GtkAchievementBoxRow* row : m_achievement_list_rows )
+    {
+        row->refresh_icon();
+    }
+}
+// => refresh_achievement_icons
+
 /**
  * Draws all the games that have not been shown yet
  */
@@ -176,17 +551,16 @@ MainPickerWindow::refresh_app_icon(const unsigned long app_id) {
     
     g_list_free(children);
 
-    pixbuf = gdk_pixbuf_new_from_file(path.c_str(), &error);
-    if (error != NULL) {
+    pixbuf = load_thumbnail(path, 146, 68, &error);
+    if (pixbuf == nullptr) {
         std::cerr << "Error while loading an app's logo: " << std::endl;
         std::cerr << "AppId: " << app_id << std::endl;
-        std::cerr << "Message: "  << error->message << std::endl;
+        std::cerr << "Message: "  << (error != nullptr ? error->message : "unknown") << std::endl;
+        g_clear_error(&error);
     }
     else {
-        //Quick and jerky, quality isn't key here
-        // Is the excess of memory freed though?
-        pixbuf = gdk_pixbuf_scale_simple(pixbuf, 146, 68, GDK_INTERP_NEAREST);
         gtk_image_set_from_pixbuf(img, pixbuf);
+        g_object_unref(pixbuf);
     }
 
 }
@@ -243,6 +617,12 @@ void
 MainPickerWindow::switch_to_stats_page() {
     gtk_widget_set_visible(GTK_WIDGET(m_back_button), TRUE);
     gtk_widget_set_visible(GTK_WIDGET(m_store_button), TRUE);
+    gtk_widget_set_visible(GTK_WIDGET(m_stat_values_button), TRUE);
+    gtk_toggle_button_set_active(m_stat_values_button, FALSE);
+    gtk_widget_set_visible(m_bulk_button, TRUE);
+    gtk_widget_set_visible(m_achievement_options_box, TRUE);
+    gtk_entry_set_text(m_search_entry, "");
+    gtk_entry_set_placeholder_text(m_search_entry, "Name, description or id...");
     gtk_stack_set_visible_child(GTK_STACK(m_main_stack), GTK_WIDGET(m_stats_list_view));
 }
 // => switch_to_stats_page
@@ -252,14 +632,39 @@ void
 MainPickerWindow::switch_to_games_page() {
     gtk_widget_set_visible(GTK_WIDGET(m_back_button), FALSE);
     gtk_widget_set_visible(GTK_WIDGET(m_store_button), FALSE);
+    gtk_widget_set_visible(GTK_WIDGET(m_stat_values_button), FALSE);
+    gtk_widget_set_visible(m_bulk_button, FALSE);
+    gtk_widget_set_visible(m_achievement_options_box, FALSE);
+    gtk_entry_set_text(m_search_entry, "");
+    gtk_entry_set_placeholder_text(m_search_entry, "Name of the game...");
     gtk_stack_set_visible_child(GTK_STACK(m_main_stack), GTK_WIDGET(m_game_list_view));
+    hide_error();
 
-    //TODO Clear achievments list
-    //TODO MAKE THIS WORK
-    for(GtkAchievementBoxRow* i : m_achievement_list_rows) {
-        gtk_widget_destroy( GTK_WIDGET(i->get_main_widget()) );
-        delete i;
+    reset_achievements_list();
+    reset_stat_list();
+}
+// => switch_to_games_page
+
+void
+MainPickerWindow::show_error(const std::string& message) {
+    gtk_label_set_text(m_error_label, message.c_str());
+    gtk_widget_show(m_error_bar);
+}
+// => show_error
+
+void
+MainPickerWindow::hide_error() {
+    gtk_widget_hide(m_error_bar);
+}
+// => hide_error
+
+void
+MainPickerWindow::switch_to_stat_values(bool show_stats) {
+    if (show_stats) {
+        gtk_stack_set_visible_child(GTK_STACK(m_main_stack), GTK_WIDGET(m_stat_values_view));
+    }
+    else {
+        gtk_stack_set_visible_child(GTK_STACK(m_main_stack), GTK_WIDGET(m_stats_list_view));
     }
-    m_achievement_list_rows.clear();
 }
-// => switch_to_games_page
\ No newline at end of file
+// => switch_to_stat_values
\ No newline at end of file
@@ -8,8 +8,10 @@
 #include "globals.h"
 #include "Game.h"
 #include "Achievement.h"
+#include "Stat.h"
 #include "gtk_callbacks.h"
 #include "GtkAchievementBoxRow.h"
+#include "AchievementFilter.h"
 
 /**
  * The main GUI class to display both the games ans the achievements to the user
@@ -33,10 +35,15 @@ public:
 
     /**
      * Empty the achievements list, leaving only the placeholder widget,
-     * which means the loading widget.
+     * which means the loading widget. The rows are kept for later.
      */
     void reset_achievements_list();
 
+    /**
+     * Empty the stat list.
+     */
+    void reset_stat_list();
+
     /**
      * Adds a game to the game list. The new item will be added and saved,
      * but not drawn.
@@ -44,10 +51,46 @@ public:
     void add_to_game_list(const Game_t& app);
 
     /**
-     * Adds an achievement to the achievement list. The new item will be added 
-     * and saved, but not drawn.
+     * Shows the given achievements in the achievement list. Only the ones on
+     * screen get a row, and the rows already there are reused, so the list
+     * can be set again after a refresh without rebuilding anything.
+     * The achievements must live until the list is set again or reset.
+     */
+    void set_achievements(const Achievement_t* achievements, unsigned count);
+
+    /**
+     * The achievements at the given indexes (sorted) changed in place,
+     * updates their rows if they are on screen. The other rows are left
+     * as they are, apart from their lock button following the pending
+     * modifications.
+     */
+    void refresh_achievements(const std::vector<unsigned>& changed);
+
+    /**
+     * Many pending modifications changed at once: filters the list again
+     * and updates the lock button of every row on screen, without any of
+     * them counting as a click.
+     */
+    void refresh_pending_achievements();
+
+    /**
+     * Marks every achievement that passes the search and filters to be
+     * unlocked
+     */
+    void unlock_shown_achievements();
+
+    /**
+     * Shows the details popover of an achievement, pointing at the given
+     * widget of its row. There is only one popover for all the rows.
+     */
+    void show_achievement_details(GtkWidget* relative_to, const Achievement_t& achievement);
+
+    /**
+     * Adds a stat to the stat list, with a spin button to edit its value,
+     * showing value: the one of the stat, or its pending edit.
+     * The new item will be added and saved, but not drawn.
      */
-    void add_to_achievement_list(const Achievement_t& achievement);
+    void add_to_stat_list(const Stat_t& stat, double value);
 
     /**
      * Shows all widget that has been added to the list, removes all
@@ -61,6 +104,12 @@ public:
      */
     void confirm_stats_list();
 
+    /**
+     * Achievement icons arrive after the rows, this method gives each row
+     * its icon once the IconCache has it.
+     */
+    void refresh_achievement_icons();
+
     /**
      * When a game is added to the list, the "missing icon" is used by default
      * Once the correct icon has been retrieved, this method will be called
@@ -74,6 +123,22 @@ public:
      */
     void filter_games(const char* filter_text);
 
+    /**
+     * Only shows the achievements whose name, description or id contain
+     * filter_text, or whose name roughly matches it. See AchievementFilter.
+     */
+    void filter_achievements(const char* filter_text);
+
+    /**
+     * Only shows the locked, unlocked, hidden or pending achievements
+     */
+    void set_achievement_state_filter(AchievementFilter::StateFilter filter);
+
+    /**
+     * Orders the achievements by name or rarity
+     */
+    void set_achievement_sort_order(AchievementFilter::SortOrder order);
+
     /**
      * Give it a pointer to a row from the main game list, returns the associated
      * appid. Returns 0 on error;
@@ -90,21 +155,61 @@ public:
      */
     void switch_to_games_page();
 
+    /**
+     * Shows a message above the lists, until the user closes it or goes
+     * back to the games list
+     */
+    void show_error(const std::string& message);
+    void hide_error();
+
+    /**
+     * While a game is open, shows either its stats (show_stats true)
+     * or its achievements.
+     */
+    void switch_to_stat_values(bool show_stats);
+
     /**
      * Getter for the main window
      */
     GtkWidget* get_main_window() { return m_main_window; };
 
 private:
+    void create_achievement_details_popover();
+    void bind_achievement_rows();
+    unsigned get_achievement_row_height();
+    void apply_achievement_filter();
+    friend void on_achievement_list_scrolled(GtkAdjustment*, gpointer);
+
     GtkWidget *m_main_window;
     GtkButton *m_back_button;
     GtkButton *m_store_button;
+    GtkToggleButton *m_stat_values_button;
+    GtkWidget *m_bulk_button;
+    GtkEntry *m_search_entry;
+    GtkWidget *m_achievement_options_box;
+    GtkWidget *m_error_bar;
+    GtkLabel *m_error_label;
     GtkListBox *m_game_list;
     GtkListBox *m_stats_list;
+    GtkListBox *m_stat_values_list;
     GtkBuilder *m_builder;
     GtkStack *m_main_stack;
     GtkScrolledWindow *m_game_list_view;
     GtkScrolledWindow *m_stats_list_view;
+    GtkScrolledWindow *m_stat_values_view;
     std::map<unsigned long, GtkWidget*> m_game_list_rows;
     std::vector<GtkAchievementBoxRow*> m_achievement_list_rows;
+    GtkAdjustment *m_stats_list_adjustment;
+    const Achievement_t* m_achievements;
+    unsigned m_achievement_count;
+    unsigned m_first_bound_achievement;
+    unsigned m_achievement_row_height;
+    AchievementFilter m_achievement_filter;
+    GtkWidget *m_achievement_popover;
+    GtkWidget *m_achievement_popover_title;
+    GtkWidget *m_achievement_popover_percent;
+    GtkWidget *m_achievement_popover_progress_box;
+    GtkWidget *m_achievement_popover_level_bar;
+    GtkWidget *m_achievement_popover_progress;
+    std::vector<GtkWidget*> m_stat_list_rows;
 };
\ No newline at end of file
@@ -25,17 +25,16 @@ bool
 MySteam::launch_game(std::string appID) {
     // Print an error if a game is already launched, maybe allow multiple games at the same time in the future?
     GameEmulator* emulator = GameEmulator::get_instance();
-    
-    //TODO if
-    emulator->init_app(appID);
 
-    return false;
+    return emulator->init_app(appID);
 }
 // => launch_game
 
 
 /**
  * If a fake game is running, stops it and returns true, else false.
+ * The emulator may keep the process in the background for a while,
+ * so launching the same game again soon after is fast.
  */
 bool 
 MySteam::quit_game() {
@@ -45,6 +44,13 @@ MySteam::quit_game() {
 // => quit_game
 
 
+bool
+MySteam::is_game_running() const {
+    return GameEmulator::get_instance()->is_app_running();
+}
+// => is_game_running
+
+
 /**
  * This does NOT retrieves all owned games.
  * It does retrieve all owned games WITH STATS or ACHIEVEMENTS
@@ -174,27 +180,4 @@ MySteam::refresh_icons() {
         appDAO->download_app_icon(i.app_id);
     }
 }
-// => refresh_icons
-
-/**
- * Adds an achievement to the list of achievements to unlock/lock
- */
-void 
-MySteam::add_modification_ach(const std::string& ach_id, const bool& new_value) {
-    std::cout << ach_id << ": " << (new_value ? "to unlock" : "to relock") << std::endl;
-    m_pending_ach_modifications.insert( std::pair<std::string, bool>(ach_id, new_value) );
-}
-// => add_modification_ach
-
-/**
- * Removes an achievement to the list of achievements to unlock/lock
- */
-void 
-MySteam::remove_modification_ach(const std::string& ach_id) {
-    if ( m_pending_ach_modifications.find(ach_id) == m_pending_ach_modifications.end() ) {
-        std::cerr << "WARNING: Could not cancel: modification was not pending";
-    } else {
-        m_pending_ach_modifications.erase(ach_id);
-    }
-}
-// => remove_modification_ach
\ No newline at end of file
+// => refresh_icons
\ No newline at end of file
@@ -10,6 +10,7 @@
 #include "Game.h"
 #include "SteamAppDAO.h"
 #include "GameEmulator.h"
+#include "PendingModifications.h"
 #include "../common/functions.h"
 
 /**
@@ -41,14 +42,10 @@ public:
     static std::string get_steam_install_path();
 
     /**
-     * Simple getter for m_pending_ach_modifications
+     * The modifications to be done on the launched app.
+     * Commit them with GameEmulator::commit_modifications.
      */
-    std::map<std::string, bool> get_pending_ach_modifications() const { return m_pending_ach_modifications; };
-
-    /**
-     * Simple getter for m_pending_stat_modifications
-     */
-    std::map<std::string, double> get_pending_stat_modifications() const { return m_pending_stat_modifications; };
+    PendingModifications* get_pending_modifications() { return &m_pending_modifications; };
 
     /**
      * Starts a process that will emulate a steam game with the 
@@ -63,6 +60,11 @@ public:
      */
     bool quit_game();
 
+    /**
+     * True between launch_game and quit_game
+     */
+    bool is_game_running() const;
+
     /**
      * Mostly used for debug purposes, prints all apps owned
      * (with stats or achievements) in the console.
@@ -88,30 +90,11 @@ public:
      */
     std::vector<Game_t> get_all_games_with_stats() { return m_all_subscribed_apps; };
 
-    /**
-     * Adds a modification to be done on the launched app.
-     * Commit the change with commit_modifications.
-     */
-    void add_modification_ach(const std::string& ach_id, const bool& new_value);
-
-    /**
-     * Adds a modification to be done on the launched app.
-     * Commit the change with commit_modifications.
-     */
-    void remove_modification_ach(const std::string& ach_id);
-
-    /**
-     * Adds a modification to be done on the launched app.
-     * Commit the change with commit_modifications.
-     */
-    //void add_modification_stat(const std::string& stat_id, const double& new_value); // TODO: IMPLEMENT
-
     MySteam(MySteam const&)                 = delete;
     void operator=(MySteam const&)          = delete;
 private:
     MySteam();
 
     std::vector<Game_t> m_all_subscribed_apps;
-    std::map<std::string, bool> m_pending_ach_modifications;
-    std::map<std::string, double> m_pending_stat_modifications;
+    PendingModifications m_pending_modifications;
 };
\ No newline at end of file
@@ -0,0 +1,227 @@
+#include "PendingModifications.h"
+#include <algorithm>
+
+PendingModifications::PendingModifications()
+:
+m_achievement_count(0),
+m_stat_count(0)
+{
+}
+// => Constructor
+
+void
+PendingModifications::reset(const Achievement_t* achievements, unsigned achievement_count, unsigned stat_count) {
+    const unsigned words = (achievement_count + 63) / 64;
+
+    m_achievement_count = achievement_count;
+    m_achieved.assign(words, 0);
+    m_pending.assign(words, 0);
+
+    for (unsigned i = 0; i < achievement_count; i++) {
+        if (achievements[i].achieved) {
+            m_achieved[i / 64] |= (uint64_t)1 << (i % 64);
+        }
+    }
+
+    m_target = m_achieved;
+
+    // Reserved once, so editing stats never allocates
+    m_stat_count = stat_count;
+    m_stat_deltas.clear();
+    m_stat_deltas.reserve(stat_count);
+}
+// => reset
+
+void
+PendingModifications::refresh(const Achievement_t* achievements, const Stat_t* stats, unsigned stat_count) {
+    for (unsigned w = 0; w < m_achieved.size(); w++) {
+        uint64_t achieved = 0;
+        const unsigned end = std::min(m_achievement_count, (w + 1) * 64);
+
+        for (unsigned i = w * 64; i < end; i++) {
+            if (achievements[i].achieved) {
+                achieved |= (uint64_t)1 << (i % 64);
+            }
+        }
+
+        // Untouched achievements follow Steam, edited ones keep their target
+        m_target[w] = (m_target[w] & m_pending[w]) | (achieved & ~m_pending[w]);
+        m_pending[w] = m_target[w] ^ achieved;
+        m_achieved[w] = achieved;
+    }
+
+    if (stat_count != m_stat_count) {
+        m_stat_count = stat_count;
+        m_stat_deltas.clear();
+        m_stat_deltas.reserve(stat_count);
+        return;
+    }
+
+    m_stat_deltas.erase(
+        std::remove_if(m_stat_deltas.begin(), m_stat_deltas.end(), [&](const StatDelta_t& delta) {
+            const Stat_t& stat = stats[delta.slot];
+            return delta.value == stat.value || (stat.increment_only && delta.value < stat.value);
+        }),
+        m_stat_deltas.end());
+}
+// => refresh
+
+void
+PendingModifications::clear() {
+    std::fill(m_pending.begin(), m_pending.end(), 0);
+    m_target = m_achieved;
+    m_stat_deltas.clear();
+}
+// => clear
+
+void
+PendingModifications::set_achievement(unsigned slot, bool achieved) {
+    const uint64_t bit = (uint64_t)1 << (slot % 64);
+    const unsigned w = slot / 64;
+
+    if (slot >= m_achievement_count) {
+        return;
+    }
+
+    m_target[w] = achieved ? (m_target[w] | bit) : (m_target[w] & ~bit);
+    m_pending[w] = m_target[w] ^ m_achieved[w];
+}
+// => set_achievement
+
+void
+PendingModifications::set_all_achievements(bool achieved) {
+    for (unsigned w = 0; w < m_target.size(); w++) {
+        m_target[w] = achieved ? ~(uint64_t)0 : 0;
+    }
+
+    if (!m_target.empty()) {
+        m_target.back() &= last_word_mask();
+    }
+
+    for (unsigned w = 0; w < m_target.size(); w++) {
+        m_pending[w] = m_target[w] ^ m_achieved[w];
+    }
+}
+// => set_all_achievements
+
+void
+PendingModifications::set_achievements(const std::vector<unsigned>& slots, bool achieved) {
+    for (const unsigned slot : slots) {
+        if (slot < m_achievement_count) {
+            const uint64_t bit = (uint64_t)1 << (slot % 64);
+            m_target[slot / 64] = achieved ? (m_target[slot / 64] | bit) : (m_target[slot / 64] & ~bit);
+        }
+    }
+
+    // The pending bits are only computed once for the whole list
+    for (unsigned w = 0; w < m_target.size(); w++) {
+        m_pending[w] = m_target[w] ^ m_achieved[w];
+    }
+}
+// => set_achievements
+
+void
+PendingModifications::invert_achievements() {
+    for (unsigned w = 0; w < m_target.size(); w++) {
+        m_target[w] = ~m_target[w];
+    }
+
+    if (!m_target.empty()) {
+        m_target.back() &= last_word_mask();
+    }
+
+    for (unsigned w = 0; w < m_target.size(); w++) {
+        m_pending[w] = m_target[w] ^ m_achieved[w];
+    }
+}
+// => invert_achievements
+
+unsigned
+PendingModifications::next_pending_achievement(unsigned slot) const {
+    if (slot >= m_achievement_count) {
+        return m_achievement_count;
+    }
+
+    unsigned w = slot / 64;
+    // Ignore the bits before slot in its word
+    uint64_t word = m_pending[w] & (~(uint64_t)0 << (slot % 64));
+
+    while (word == 0) {
+        if (++w == m_pending.size()) {
+            return m_achievement_count;
+        }
+        word = m_pending[w];
+    }
+
+    return w * 64 + __builtin_ctzll(word);
+}
+// => next_pending_achievement
+
+unsigned
+PendingModifications::get_pending_achievement_count() const {
+    unsigned count = 0;
+
+    for (const uint64_t word : m_pending) {
+        count += __builtin_popcountll(word);
+    }
+
+    return count;
+}
+// => get_pending_achievement_count
+
+std::vector<StatDelta_t>::iterator
+PendingModifications::find_stat(unsigned slot) {
+    return std::lower_bound(m_stat_deltas.begin(), m_stat_deltas.end(), slot,
+        [](const StatDelta_t& delta, unsigned s) { return delta.slot < s; });
+}
+// => find_stat
+
+void
+PendingModifications::set_stat(unsigned slot, double value) {
+    const auto delta = find_stat(slot);
+
+    if (slot >= m_stat_count) {
+        return;
+    }
+
+    if (delta != m_stat_deltas.end() && delta->slot == slot) {
+        delta->value = value;
+    } else {
+        m_stat_deltas.insert(delta, { slot, value });
+    }
+}
+// => set_stat
+
+void
+PendingModifications::cancel_stat(unsigned slot) {
+    const auto delta = find_stat(slot);
+
+    if (delta != m_stat_deltas.end() && delta->slot == slot) {
+        m_stat_deltas.erase(delta);
+    }
+}
+// => cancel_stat
+
+bool
+PendingModifications::get_stat(unsigned slot, double* value) const {
+    const auto delta = std::lower_bound(m_stat_deltas.begin(), m_stat_deltas.end(), slot,
+        [](const StatDelta_t& d, unsigned s) { return d.slot < s; });
+
+    if (delta == m_stat_deltas.end() || delta->slot != slot) {
+        return false;
+    }
+
+    *value = delta->value;
+    return true;
+}
+// => get_stat
+
+/**
+ * The bits of the last word that stand for an achievement
+ */
+uint64_t
+PendingModifications::last_word_mask() const {
+    const unsigned used = m_achievement_count % 64;
+    return (used == 0) ? ~(uint64_t)0 : (((uint64_t)1 << used) - 1);
+}
+// => last_word_mask
\ No newline at end of file
@@ -0,0 +1,127 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Achievement.h"
+#include "Stat.h"
+
+/**
+ * A stat edit, by its index in the stat list of the app
+ */
+struct StatDelta_t {
+    unsigned slot;
+    double value;
+};
+
+typedef struct StatDelta_t StatDelta_t;
+
+/**
+ * The edits the user made on the displayed app and did not store yet.
+ *
+ * Achievements are known by their index in the list of the app, their slot,
+ * and kept in bitsets of 64 achievements per word: which ones the user
+ * changed, and the state they should end in. Toggling one is a bit flip,
+ * and unlocking, relocking or inverting them all is done a word at a time,
+ * without allocating anything.
+ *
+ * The target bit always equals the achieved bit of achievements that are
+ * not pending, so pending == target ^ achieved.
+ *
+ * Stat edits are few, they are kept sorted by slot in a vector.
+ */
+class PendingModifications {
+public:
+    PendingModifications();
+
+    /**
+     * Forgets every edit, and uses a new list of achievements.
+     * Only their achieved state is read, they don't need to live on.
+     */
+    void reset(const Achievement_t* achievements, unsigned achievement_count, unsigned stat_count);
+
+    /**
+     * The same achievements came back from Steam, maybe with other states.
+     * Edits that already happened are dropped, the others are kept. So are
+     * stat edits, unless the stat got that value, or it can only go up and
+     * went past it.
+     */
+    void refresh(const Achievement_t* achievements, const Stat_t* stats, unsigned stat_count);
+
+    /**
+     * Forgets every edit, once they are stored
+     */
+    void clear();
+
+    /**
+     * The achievement at slot should end achieved or not. Setting it back
+     * to its current state cancels the edit.
+     */
+    void set_achievement(unsigned slot, bool achieved);
+
+    /**
+     * All the achievements should end achieved, or all locked
+     */
+    void set_all_achievements(bool achieved);
+
+    /**
+     * The achievements at the given slots should end achieved or not
+     */
+    void set_achievements(const std::vector<unsigned>& slots, bool achieved);
+
+    /**
+     * Every achievement should end in the opposite state of the one shown
+     */
+    void invert_achievements();
+
+    bool is_achievement_pending(unsigned slot) const { return get_bit(m_pending, slot); };
+
+    /**
+     * The state the achievement will be in once stored, the one to show
+     */
+    bool get_achievement_target(unsigned slot) const { return get_bit(m_target, slot); };
+
+    /**
+     * The first pending achievement from slot on, or the achievement count
+     * if there is none. To go through them all:
+     * for (i = next_pending_achievement(0); i < count; i = next_pending_achievement(i + 1))
+     */
+    unsigned next_pending_achievement(unsigned slot) const;
+
+    unsigned get_pending_achievement_count() const;
+    unsigned get_achievement_count() const { return m_achievement_count; };
+
+    /**
+     * The stat at slot should be set to value. If it was already edited,
+     * the new value replaces the old one.
+     */
+    void set_stat(unsigned slot, double value);
+
+    /**
+     * Cancels the edit of a stat, if any
+     */
+    void cancel_stat(unsigned slot);
+
+    /**
+     * Gives the edited value of a stat. Returns false if it is not edited.
+     */
+    bool get_stat(unsigned slot, double* value) const;
+
+    /**
+     * The stat edits, sorted by slot
+     */
+    const std::vector<StatDelta_t>& get_stat_deltas() const { return m_stat_deltas; };
+
+    bool empty() const { return m_stat_deltas.empty() && get_pending_achievement_count() == 0; };
+
+private:
+    static bool get_bit(const std::vector<uint64_t>& bits, unsigned slot) { return (bits[slot / 64] >> (slot % 64)) & 1; };
+    std::vector<StatDelta_t>::iterator find_stat(unsigned slot);
+    uint64_t last_word_mask() const;
+
+    std::vector<uint64_t> m_achieved;
+    std::vector<uint64_t> m_pending;
+    std::vector<uint64_t> m_target;
+    unsigned m_achievement_count;
+
+    std::vector<StatDelta_t> m_stat_deltas;
+    unsigned m_stat_count;
+};
\ No newline at end of file
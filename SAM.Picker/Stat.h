@@ -0,0 +1,32 @@
+#pragma once
+
+#define MAX_STAT_ID_LENGTH 256
+#define MAX_STAT_NAME_LENGTH 100
+
+/**
+ * Stat types, as found in UserGameStatsSchema_<appid>.bin.
+ * Average rates and achievement bits are not editable stats,
+ * so they are not listed.
+ */
+#define STAT_TYPE_INT 1
+#define STAT_TYPE_FLOAT 2
+
+/**
+ * Stat structure.
+ * Same as Achievement_t, it uses basic C types and has a fixed length,
+ * so it can be piped between processes as is.
+ * Integer stats are stored in a double too, which represents
+ * every int32 exactly.
+ */
+struct Stat_t {
+    char id[MAX_STAT_ID_LENGTH];
+    char name[MAX_STAT_NAME_LENGTH];
+    int type;               // STAT_TYPE_INT or STAT_TYPE_FLOAT
+    double value;
+    double min_value;
+    double max_value;
+    bool increment_only;    // The value can only go up
+    bool is_protected;      // Only the game server may set it, Steam will refuse
+};
+
+typedef struct Stat_t Stat_t;
\ No newline at end of file
@@ -14,45 +14,28 @@ extern "C"
         g_main_gui = NULL;
 
         g_steam->quit_game();
+        GameEmulator::get_instance()->kill_all_workers();
     }
     // => on_close_button_clicked
 
     void
     on_store_button_clicked() {
         std::cerr << "Saving stats and achievements." << std::endl;
-        const std::map<std::string, bool> pending_achs = g_steam->get_pending_ach_modifications();
-        const std::map<std::string, double> pending_stats = g_steam->get_pending_stat_modifications();
+        PendingModifications* pending = g_steam->get_pending_modifications();
         GameEmulator* emulator = GameEmulator::get_instance();
-        char tmp_id[MAX_ACHIEVEMENT_ID_LENGTH];
 
-        // TODO: JUST DO IT
         /**
-         * foreach(pending_achs as &val) {
-         * if(val.second == true)
-         *  gameEmulator->unlock(val.first)
-         * } else {
-         *  gameEmulator->relock(val.first)
-         * }
-         * }
+         * Everything is sent in one go, the son sets each achievement and
+         * stat, then stores them all with a single StoreStats.
+         * TODO: Check for failures. But storing is done async because
+         * the son process has to deal with it.
          */
-        
-        /**
-         * TODO: Check for failures. But unlocking is done async because
-         * the son process has to deal with it. 
-         */
-        for (auto const& [key, val] : pending_achs) {
-            if(val) {
-                std::cout << "Unlocking " << key << std::endl;
-                strncpy(tmp_id, key.c_str(), MAX_ACHIEVEMENT_ID_LENGTH); // TODO REMOVE ME IT WAS FOR TESTING JUST USE C_STR INLINE
-                emulator->unlock_achievement( tmp_id );
-                g_steam->remove_modification_ach(key);
-            } else {
-                std::cout << "Relocking " << key << std::endl;
-                emulator->relock_achievement( key.c_str() );
-                g_steam->remove_modification_ach(key);                
-            }
+        if (!emulator->commit_modifications(*pending)) {
+            std::cerr << "Could not send the modifications to the game." << std::endl;
+            return;
         }
 
+        pending->clear();
         emulator->update_data_and_view(); // This is async
     }
     // => on_store_button_clicked
@@ -83,10 +66,11 @@ extern "C"
     on_search_changed(GtkWidget* search_widget) {
         const char* filter_text = gtk_entry_get_text( GTK_ENTRY(search_widget) );
 
-        //if !g_steam->isgamerunning
-        g_main_gui->filter_games(filter_text);
-        //else 
-        //g_main_gui->filter_stats(filter_text)
+        if (g_steam->is_game_running()) {
+            g_main_gui->filter_achievements(filter_text);
+        } else {
+            g_main_gui->filter_games(filter_text);
+        }
     }
     // => on_search_changed
 
@@ -112,4 +96,70 @@ extern "C"
         g_main_gui->switch_to_games_page();
     }
     // => on_back_button_clicked
+
+    void
+    on_stat_values_button_toggled(GtkToggleButton* button) {
+        g_main_gui->switch_to_stat_values( gtk_toggle_button_get_active(button) );
+    }
+    // => on_stat_values_button_toggled
+
+    void
+    on_stat_value_changed(GtkSpinButton* button, gpointer stat) {
+        const Stat_t* original = (const Stat_t*)stat;
+        const unsigned slot = original - GameEmulator::get_instance()->get_stat_list();
+        const double new_value = gtk_spin_button_get_value(button);
+
+        // Going back to the original value cancels the edit
+        if (new_value == original->value) {
+            g_steam->get_pending_modifications()->cancel_stat(slot);
+        } else {
+            g_steam->get_pending_modifications()->set_stat(slot, new_value);
+        }
+    }
+    // => on_stat_value_changed
+
+    void
+    on_achievement_filter_changed(GtkComboBox* combo) {
+        g_main_gui->set_achievement_state_filter( (AchievementFilter::StateFilter)gtk_combo_box_get_active(combo) );
+    }
+    // => on_achievement_filter_changed
+
+    void
+    on_achievement_sort_changed(GtkComboBox* combo) {
+        g_main_gui->set_achievement_sort_order( (AchievementFilter::SortOrder)gtk_combo_box_get_active(combo) );
+    }
+    // => on_achievement_sort_changed
+
+    void
+    on_unlock_all_clicked() {
+        g_steam->get_pending_modifications()->set_all_achievements(true);
+        g_main_gui->refresh_pending_achievements();
+    }
+    // => on_unlock_all_clicked
+
+    void
+    on_relock_all_clicked() {
+        g_steam->get_pending_modifications()->set_all_achievements(false);
+        g_main_gui->refresh_pending_achievements();
+    }
+    // => on_relock_all_clicked
+
+    void
+    on_invert_all_clicked() {
+        g_steam->get_pending_modifications()->invert_achievements();
+        g_main_gui->refresh_pending_achievements();
+    }
+    // => on_invert_all_clicked
+
+    void
+    on_unlock_shown_clicked() {
+        g_main_gui->unlock_shown_achievements();
+    }
+    // => on_unlock_shown_clicked
+
+    void
+    on_error_bar_response(GtkInfoBar* bar, gint response_id) {
+        g_main_gui->hide_error();
+    }
+    // => on_error_bar_response
 }
\ No newline at end of file
@@ -50,4 +50,54 @@ extern "C"
 
     void
     on_store_button_clicked();
+
+    /**
+     * When the user switches between the achievements and the stats
+     * of the open game
+     */
+    void
+    on_stat_values_button_toggled(GtkToggleButton* button);
+
+    /**
+     * When a stat's value is edited, stat points to its Stat_t
+     */
+    void
+    on_stat_value_changed(GtkSpinButton* button, gpointer stat);
+
+    /**
+     * When the user chooses which achievements to show
+     */
+    void
+    on_achievement_filter_changed(GtkComboBox* combo);
+
+    /**
+     * When the user chooses the order of the achievements
+     */
+    void
+    on_achievement_sort_changed(GtkComboBox* combo);
+
+    /**
+     * Bulk modifications, from the menu of the achievement list.
+     * The lock buttons on screen are updated at once afterwards.
+     */
+    void
+    on_unlock_all_clicked();
+
+    void
+    on_relock_all_clicked();
+
+    void
+    on_invert_all_clicked();
+
+    /**
+     * Unlocks what passes the search and filters
+     */
+    void
+    on_unlock_shown_clicked();
+
+    /**
+     * When the user closes the error bar
+     */
+    void
+    on_error_bar_response(GtkInfoBar* bar, gint response_id);
 }
\ No newline at end of file
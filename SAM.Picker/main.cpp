@@ -7,6 +7,7 @@
 #include <gmodule.h>
 #include "MySteam.h"
 #include "MainPickerWindow.h"
+#include "BatchJob.h"
 #include "globals.h"
 
 /**************************************
@@ -30,12 +31,23 @@ main(int argc, char *argv[])
         exit(EXIT_FAILURE);
     }
     
+    g_cache_folder = concat( getenv("HOME"), "/.SamRewritten" );
+
+    // Headless mode, no GUI at all
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--batch") {
+            return BatchJob::main(argc, argv);
+        }
+    }
+
     gtk_init(&argc, &argv);
     
-    g_cache_folder = concat( getenv("HOME"), "/.SamRewritten" );
     g_steam = MySteam::get_instance();
     g_main_gui = new MainPickerWindow();
 
+    // Fork a spare Steam game process now, so opening the first game is faster
+    GameEmulator::get_instance()->warm_up();
+
     gtk_widget_show( g_main_gui->get_main_window() );
     gtk_main();
 
@@ -4,5 +4,5 @@ SCRIPT=`realpath $0`
 SCRIPTPATH=`dirname $SCRIPT`
 
 export LD_LIBRARY_PATH=$SCRIPTPATH
-echo "Library path is" $LD_LIBRARY_PATH
-$SCRIPTPATH/samrewritten
+echo "Library path is" $LD_LIBRARY_PATH >&2
+$SCRIPTPATH/samrewritten "$@"
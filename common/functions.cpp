@@ -1,4 +1,6 @@
 #include "functions.h"
+#include <dirent.h>
+#include <vector>
 
 pid_t create_process()
 {
@@ -34,4 +36,30 @@ bool strstri(const std::string & strHaystack, const std::string & strNeedle)
     [](char ch1, char ch2) { return std::toupper(ch1) == std::toupper(ch2); }
   );
   return (it != strHaystack.end() );
+}
+
+void close_inherited_fds(const int* keep, size_t keep_count)
+{
+    std::vector<int> to_close;
+    DIR* dirp = opendir("/proc/self/fd");
+    struct dirent* dp;
+    int fd;
+
+    if (dirp == NULL) {
+        return;
+    }
+
+    // Don't close while iterating, the directory itself has an fd
+    while ((dp = readdir(dirp)) != NULL) {
+        fd = atoi(dp->d_name);
+        if (fd > STDERR_FILENO && fd != dirfd(dirp)
+            && std::find(keep, keep + keep_count, fd) == keep + keep_count) {
+            to_close.push_back(fd);
+        }
+    }
+    closedir(dirp);
+
+    for (int i : to_close) {
+        close(i);
+    }
 }
\ No newline at end of file
@@ -27,4 +27,11 @@ char* concat(const char *s1, const char *s2);
 /**
  * Insensitive "string in string"
  */
-bool strstri(const std::string & strHaystack, const std::string & strNeedle);
\ No newline at end of file
+bool strstri(const std::string & strHaystack, const std::string & strNeedle);
+
+/**
+ * Closes every file descriptor above stderr, except the ones given in keep.
+ * Meant to be called in a freshly forked child, so it doesn't hold on to
+ * the pipes and sockets of its parent.
+ */
+void close_inherited_fds(const int* keep, size_t keep_count);
\ No newline at end of file
@@ -33,6 +33,17 @@ Rename this file to lodepng.cpp to use it for C++, or to lodepng.c to use it for
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#if defined(LODEPNG_COMPILE_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LODEPNG_SIMD_X86
+#include <immintrin.h>
+#endif /*LODEPNG_COMPILE_SIMD*/
+
+#if defined(LODEPNG_COMPILE_THREADS) && defined(LODEPNG_COMPILE_ENCODER) && (defined(__unix__) || defined(__APPLE__))
+#define LODEPNG_PTHREADS
+#include <pthread.h>
+#endif /*LODEPNG_COMPILE_THREADS*/
 
 #if defined(_MSC_VER) && (_MSC_VER >= 1310) /*Visual Studio: A few warning types are not desired here.*/
 #pragma warning( disable : 4244 ) /*implicit conversions: not warned by gcc -Wall -Wextra and requires too much casts*/
@@ -60,19 +71,116 @@ lodepng source code. Don't forget to remove "static" if you copypaste them
 from here.*/
 
 #ifdef LODEPNG_COMPILE_ALLOCATORS
+#if defined(__GNUC__)
+#define LODEPNG_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define LODEPNG_THREAD_LOCAL __declspec(thread)
+#else
+#define LODEPNG_THREAD_LOCAL
+#endif
+
+/*the arena the allocators below take from on this thread, see lodepng_arena_use*/
+static LODEPNG_THREAD_LOCAL LodePNGArena* lodepng_current_arena = 0;
+
+/*each allocation in an arena is preceded by its size, in a header that keeps the data 16-byte aligned*/
+#define ARENA_HEADER 16
+#define ARENA_ROUND(size) (((size) + 15) & ~(size_t)15)
+#define ARENA_NO_LAST ((size_t)(-1))
+
+static unsigned lodepng_arena_owns(const LodePNGArena* arena, const void* ptr)
+{
+  return arena && (const unsigned char*)ptr >= arena->data && (const unsigned char*)ptr < arena->data + arena->capacity;
+}
+
 static void* lodepng_malloc(size_t size)
 {
+  LodePNGArena* arena = lodepng_current_arena;
+  if(arena && size <= arena->capacity && ARENA_HEADER + ARENA_ROUND(size) <= arena->capacity - arena->used)
+  {
+    unsigned char* block = arena->data + arena->used;
+    *(size_t*)block = size;
+    arena->last = arena->used + ARENA_HEADER;
+    arena->used = arena->last + ARENA_ROUND(size);
+    return block + ARENA_HEADER;
+  }
   return malloc(size);
 }
 
+void lodepng_free(void* ptr)
+{
+  LodePNGArena* arena = lodepng_current_arena;
+  if(!lodepng_arena_owns(arena, ptr))
+  {
+    free(ptr);
+  }
+  else if((unsigned char*)ptr == arena->data + arena->last)
+  {
+    /*the last allocation gives its memory back, the others wait for lodepng_arena_reset*/
+    arena->used = arena->last - ARENA_HEADER;
+    arena->last = ARENA_NO_LAST;
+  }
+}
+
 static void* lodepng_realloc(void* ptr, size_t new_size)
 {
-  return realloc(ptr, new_size);
+  LodePNGArena* arena = lodepng_current_arena;
+  size_t old_size;
+  void* moved;
+  if(!lodepng_arena_owns(arena, ptr)) return ptr || !arena ? realloc(ptr, new_size) : lodepng_malloc(new_size);
+
+  old_size = *(size_t*)((unsigned char*)ptr - ARENA_HEADER);
+  if((unsigned char*)ptr == arena->data + arena->last
+     && new_size <= arena->capacity && ARENA_ROUND(new_size) <= arena->capacity - arena->last)
+  {
+    /*the last allocation grows or shrinks in place, that is how the vectors of lodepng grow*/
+    *(size_t*)((unsigned char*)ptr - ARENA_HEADER) = new_size;
+    arena->used = arena->last + ARENA_ROUND(new_size);
+    return ptr;
+  }
+
+  moved = lodepng_malloc(new_size);
+  if(moved)
+  {
+    memcpy(moved, ptr, old_size < new_size ? old_size : new_size);
+    lodepng_free(ptr);
+  }
+  return moved;
+}
+
+void lodepng_arena_init(LodePNGArena* arena)
+{
+  arena->data = 0;
+  arena->capacity = arena->used = 0;
+  arena->last = ARENA_NO_LAST;
+}
+
+void lodepng_arena_cleanup(LodePNGArena* arena)
+{
+  free(arena->data);
+  lodepng_arena_init(arena);
 }
 
-static void lodepng_free(void* ptr)
+unsigned lodepng_arena_reset(LodePNGArena* arena, size_t capacity)
 {
-  free(ptr);
+  arena->used = 0;
+  arena->last = ARENA_NO_LAST;
+  if(capacity > arena->capacity)
+  {
+    /*nothing to keep, so no realloc and its copy*/
+    capacity = ARENA_ROUND(capacity);
+    free(arena->data);
+    arena->data = (unsigned char*)malloc(capacity);
+    arena->capacity = arena->data ? capacity : 0;
+    if(!arena->data) return 83; /*alloc fail*/
+  }
+  return 0;
+}
+
+LodePNGArena* lodepng_arena_use(LodePNGArena* arena)
+{
+  LodePNGArena* previous = lodepng_current_arena;
+  lodepng_current_arena = arena;
+  return previous;
 }
 #else /*LODEPNG_COMPILE_ALLOCATORS*/
 void* lodepng_malloc(size_t size);
@@ -86,6 +194,99 @@ void lodepng_free(void* ptr);
 /* ////////////////////////////////////////////////////////////////////////// */
 /* ////////////////////////////////////////////////////////////////////////// */
 
+#ifdef LODEPNG_SIMD_X86
+#define LODEPNG_CPU_SSE2 1u
+#define LODEPNG_CPU_SSSE3 2u
+#define LODEPNG_CPU_AVX2 4u
+#define LODEPNG_CPU_PCLMUL 8u
+
+/*
+The instruction sets the running CPU has, among the ones used here. Detected on
+the first call: threads racing there all store the same value.
+*/
+static unsigned lodepng_cpu_features(void)
+{
+  static int features = -1;
+  if(features < 0)
+  {
+    unsigned detected = 0;
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("sse2")) detected |= LODEPNG_CPU_SSE2;
+    if(__builtin_cpu_supports("ssse3")) detected |= LODEPNG_CPU_SSSE3;
+    if(__builtin_cpu_supports("avx2")) detected |= LODEPNG_CPU_AVX2;
+    if(__builtin_cpu_supports("pclmul")) detected |= LODEPNG_CPU_PCLMUL;
+    features = (int)detected;
+  }
+  return (unsigned)features;
+}
+#endif /*LODEPNG_SIMD_X86*/
+
+#ifdef LODEPNG_PTHREADS
+/*a batch of independent tasks, see lodepng_parallel_for*/
+typedef struct LodePNGTasks
+{
+  void (*task)(void* context, size_t index);
+  void* context;
+  size_t count;
+  size_t next; /*the next task not started yet*/
+  pthread_mutex_t mutex;
+} LodePNGTasks;
+
+static void* lodepng_tasks_run(void* arg)
+{
+  LodePNGTasks* tasks = (LodePNGTasks*)arg;
+  for(;;)
+  {
+    size_t index;
+    pthread_mutex_lock(&tasks->mutex);
+    index = tasks->next;
+    if(index < tasks->count) ++tasks->next;
+    pthread_mutex_unlock(&tasks->mutex);
+    if(index >= tasks->count) return 0;
+    tasks->task(tasks->context, index);
+  }
+}
+
+/*
+Calls task(context, i) for every i below count, on up to numthreads threads
+counting the calling one, each thread taking the next task not started yet.
+Returns once all are done. If no thread can be started, the calling thread
+does them all.
+*/
+static void lodepng_parallel_for(void (*task)(void*, size_t), void* context, size_t count, unsigned numthreads)
+{
+  LodePNGTasks tasks;
+  pthread_t* threads = 0;
+  unsigned started = 0;
+  size_t i;
+
+  tasks.task = task;
+  tasks.context = context;
+  tasks.count = count;
+  tasks.next = 0;
+
+  if(pthread_mutex_init(&tasks.mutex, 0) != 0)
+  {
+    for(i = 0; i != count; ++i) task(context, i);
+    return;
+  }
+
+  if(numthreads > count) numthreads = (unsigned)count;
+  if(numthreads > 1) threads = (pthread_t*)lodepng_malloc((numthreads - 1) * sizeof(pthread_t));
+  if(threads)
+  {
+    while(started != numthreads - 1 && pthread_create(&threads[started], 0, lodepng_tasks_run, &tasks) == 0)
+    {
+      ++started;
+    }
+  }
+  lodepng_tasks_run(&tasks);
+  for(i = 0; i != started; ++i) pthread_join(threads[i], 0);
+  lodepng_free(threads);
+  pthread_mutex_destroy(&tasks.mutex);
+}
+#endif /*LODEPNG_PTHREADS*/
+
 /*
 Often in case of an error a value is assigned to a variable and then it breaks
 out of a loop (to go to the cleanup phase of a function). This macro does that.
@@ -322,6 +523,17 @@ unsigned lodepng_read32bitInt(const unsigned char* buffer)
   return (unsigned)((buffer[0] << 24) | (buffer[1] << 16) | (buffer[2] << 8) | buffer[3]);
 }
 
+#ifdef LODEPNG_COMPILE_ZLIB
+/*compilers turn this into a single unaligned load on little endian machines*/
+static unsigned long long lodepng_read64bitInt_le(const unsigned char* buffer)
+{
+  return (unsigned long long)buffer[0] | ((unsigned long long)buffer[1] << 8)
+       | ((unsigned long long)buffer[2] << 16) | ((unsigned long long)buffer[3] << 24)
+       | ((unsigned long long)buffer[4] << 32) | ((unsigned long long)buffer[5] << 40)
+       | ((unsigned long long)buffer[6] << 48) | ((unsigned long long)buffer[7] << 56);
+}
+#endif /*LODEPNG_COMPILE_ZLIB*/
+
 #if defined(LODEPNG_COMPILE_PNG) || defined(LODEPNG_COMPILE_ENCODER)
 /*buffer must have at least 4 allocated bytes available*/
 static void lodepng_set32bitInt(unsigned char* buffer, unsigned value)
@@ -416,6 +628,14 @@ unsigned lodepng_save_file(const unsigned char* buffer, size_t buffersize, const
 /* ////////////////////////////////////////////////////////////////////////// */
 
 #ifdef LODEPNG_COMPILE_ZLIB
+/*the deflate codes are stored MSB first in tree1d, but read and written LSB first in the stream*/
+static unsigned reverseBits(unsigned bits, unsigned num)
+{
+  unsigned i, result = 0;
+  for(i = 0; i < num; i++) result |= ((bits >> (num - i - 1u)) & 1u) << i;
+  return result;
+}
+
 #ifdef LODEPNG_COMPILE_ENCODER
 /*TODO: this ignores potential out of memory errors*/
 #define addBitToStream(/*size_t**/ bitpointer, /*ucvector**/ bitstream, /*unsigned char*/ bit)\
@@ -427,40 +647,110 @@ unsigned lodepng_save_file(const unsigned char* buffer, size_t buffersize, const
   ++(*bitpointer);\
 }
 
+/*fills the last byte with as many bits as fit at once, then goes on with the next byte*/
 static void addBitsToStream(size_t* bitpointer, ucvector* bitstream, unsigned value, size_t nbits)
 {
-  size_t i;
-  for(i = 0; i != nbits; ++i) addBitToStream(bitpointer, bitstream, (unsigned char)((value >> i) & 1));
+  while(nbits > 0)
+  {
+    unsigned used = (unsigned)((*bitpointer) & 7);
+    unsigned amount = 8 - used;
+    if(amount > nbits) amount = (unsigned)nbits;
+    if(used == 0) ucvector_push_back(bitstream, (unsigned char)0);
+    bitstream->data[bitstream->size - 1] |= (unsigned char)((value & ((1u << amount) - 1u)) << used);
+    value >>= amount;
+    nbits -= amount;
+    (*bitpointer) += amount;
+  }
 }
 
 static void addBitsToStreamReversed(size_t* bitpointer, ucvector* bitstream, unsigned value, size_t nbits)
 {
-  size_t i;
-  for(i = 0; i != nbits; ++i) addBitToStream(bitpointer, bitstream, (unsigned char)((value >> (nbits - 1 - i)) & 1));
+  addBitsToStream(bitpointer, bitstream, reverseBits(value, (unsigned)nbits), nbits);
 }
 #endif /*LODEPNG_COMPILE_ENCODER*/
 
 #ifdef LODEPNG_COMPILE_DECODER
 
-#define READBIT(bitpointer, bitstream) ((bitstream[bitpointer >> 3] >> (bitpointer & 0x7)) & (unsigned char)1)
+/*
+Reads the bits of a deflate stream, LSB first. buffer holds the next bits of the
+stream and is refilled with a whole 64-bit little endian word at a time, so a
+field is read with a shift and a mask. Past the end of data, buffer gets zeros:
+instead of checking before every read, the callers refill once per symbol or
+header and then check LodePNGBitReader_pastEnd once.
+*/
+typedef struct LodePNGBitReader
+{
+  const unsigned char* data;
+  size_t size; /*size of data in bytes*/
+  size_t pos; /*next byte of data to go in buffer, goes past size by the zero bytes made up*/
+  unsigned long long buffer; /*the next bits of the stream, the first one in the LSB*/
+  unsigned bits; /*number of bits in buffer*/
+} LodePNGBitReader;
 
-static unsigned char readBitFromStream(size_t* bitpointer, const unsigned char* bitstream)
+static void LodePNGBitReader_init(LodePNGBitReader* reader, const unsigned char* data, size_t size, size_t pos)
 {
-  unsigned char result = (unsigned char)(READBIT(*bitpointer, bitstream));
-  ++(*bitpointer);
-  return result;
+  reader->data = data;
+  reader->size = size;
+  reader->pos = pos;
+  reader->buffer = 0;
+  reader->bits = 0;
 }
 
-static unsigned readBitsFromStream(size_t* bitpointer, const unsigned char* bitstream, size_t nbits)
+/*makes buffer hold at least 56 bits, enough for a length or distance code and its extra bits*/
+static void LodePNGBitReader_refill(LodePNGBitReader* reader)
 {
-  unsigned result = 0, i;
-  for(i = 0; i != nbits; ++i)
+  if(reader->pos + 8 <= reader->size)
   {
-    result += ((unsigned)READBIT(*bitpointer, bitstream)) << i;
-    ++(*bitpointer);
+    /*
+    Only the bytes that fit whole are consumed. The bits of the next one that got
+    in anyway are the same as the ones it will bring next time, so OR-ing is fine.
+    */
+    reader->buffer |= lodepng_read64bitInt_le(&reader->data[reader->pos]) << reader->bits;
+    reader->pos += (63u - reader->bits) >> 3;
+    reader->bits |= 56u;
+  }
+  else
+  {
+    while(reader->bits < 56u)
+    {
+      if(reader->pos < reader->size) reader->buffer |= (unsigned long long)reader->data[reader->pos] << reader->bits;
+      ++reader->pos;
+      reader->bits += 8u;
+    }
   }
+}
+
+/*the next nbits bits, without consuming them. nbits < 32 and not more than the bits in buffer*/
+static unsigned LodePNGBitReader_peek(const LodePNGBitReader* reader, unsigned nbits)
+{
+  return (unsigned)reader->buffer & ((1u << nbits) - 1u);
+}
+
+static void LodePNGBitReader_skip(LodePNGBitReader* reader, unsigned nbits)
+{
+  reader->buffer >>= nbits;
+  reader->bits -= nbits;
+}
+
+static unsigned LodePNGBitReader_read(LodePNGBitReader* reader, unsigned nbits)
+{
+  unsigned result = LodePNGBitReader_peek(reader, nbits);
+  LodePNGBitReader_skip(reader, nbits);
   return result;
 }
+
+/*whether bits made up past the end of data were consumed. Cheap unless near the end*/
+static int LodePNGBitReader_pastEnd(const LodePNGBitReader* reader)
+{
+  return reader->pos > reader->size && reader->pos * 8 - reader->bits > reader->size * 8;
+}
+
+/*skips to the next byte boundary, and gives the position of that byte in data*/
+static size_t LodePNGBitReader_alignToByte(LodePNGBitReader* reader)
+{
+  LodePNGBitReader_skip(reader, reader->bits & 7u);
+  return reader->pos - reader->bits / 8u;
+}
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 /* ////////////////////////////////////////////////////////////////////////// */
@@ -508,11 +798,13 @@ Huffman tree struct, containing multiple representations of the tree
 */
 typedef struct HuffmanTree
 {
-  unsigned* tree2d;
   unsigned* tree1d;
   unsigned* lengths; /*the lengths of the codes of the 1d-tree*/
   unsigned maxbitlen; /*maximum number of bits a single code can get*/
   unsigned numcodes; /*number of symbols in the alphabet = number of codes*/
+  /*decoder lookup tables, indexed by the next FIRSTBITS bits of input, see HuffmanTree_makeTable*/
+  unsigned char* table_len; /*length of the symbol, or of the longest code behind a sub-table*/
+  unsigned short* table_value; /*the symbol, or the position of the sub-table*/
 } HuffmanTree;
 
 /*function used for debug purposes to draw the tree in ascii art with C++*/
@@ -530,77 +822,18 @@ static void HuffmanTree_draw(HuffmanTree* tree)
 
 static void HuffmanTree_init(HuffmanTree* tree)
 {
-  tree->tree2d = 0;
   tree->tree1d = 0;
   tree->lengths = 0;
+  tree->table_len = 0;
+  tree->table_value = 0;
 }
 
 static void HuffmanTree_cleanup(HuffmanTree* tree)
 {
-  lodepng_free(tree->tree2d);
   lodepng_free(tree->tree1d);
   lodepng_free(tree->lengths);
-}
-
-/*the tree representation used by the decoder. return value is error*/
-static unsigned HuffmanTree_make2DTree(HuffmanTree* tree)
-{
-  unsigned nodefilled = 0; /*up to which node it is filled*/
-  unsigned treepos = 0; /*position in the tree (1 of the numcodes columns)*/
-  unsigned n, i;
-
-  tree->tree2d = (unsigned*)lodepng_malloc(tree->numcodes * 2 * sizeof(unsigned));
-  if(!tree->tree2d) return 83; /*alloc fail*/
-
-  /*
-  convert tree1d[] to tree2d[][]. In the 2D array, a value of 32767 means
-  uninited, a value >= numcodes is an address to another bit, a value < numcodes
-  is a code. The 2 rows are the 2 possible bit values (0 or 1), there are as
-  many columns as codes - 1.
-  A good huffman tree has N * 2 - 1 nodes, of which N - 1 are internal nodes.
-  Here, the internal nodes are stored (what their 0 and 1 option point to).
-  There is only memory for such good tree currently, if there are more nodes
-  (due to too long length codes), error 55 will happen
-  */
-  for(n = 0; n < tree->numcodes * 2; ++n)
-  {
-    tree->tree2d[n] = 32767; /*32767 here means the tree2d isn't filled there yet*/
-  }
-
-  for(n = 0; n < tree->numcodes; ++n) /*the codes*/
-  {
-    for(i = 0; i != tree->lengths[n]; ++i) /*the bits for this code*/
-    {
-      unsigned char bit = (unsigned char)((tree->tree1d[n] >> (tree->lengths[n] - i - 1)) & 1);
-      /*oversubscribed, see comment in lodepng_error_text*/
-      if(treepos > 2147483647 || treepos + 2 > tree->numcodes) return 55;
-      if(tree->tree2d[2 * treepos + bit] == 32767) /*not yet filled in*/
-      {
-        if(i + 1 == tree->lengths[n]) /*last bit*/
-        {
-          tree->tree2d[2 * treepos + bit] = n; /*put the current code in it*/
-          treepos = 0;
-        }
-        else
-        {
-          /*put address of the next step in here, first that address has to be found of course
-          (it's just nodefilled + 1)...*/
-          ++nodefilled;
-          /*addresses encoded with numcodes added to it*/
-          tree->tree2d[2 * treepos + bit] = nodefilled + tree->numcodes;
-          treepos = nodefilled;
-        }
-      }
-      else treepos = tree->tree2d[2 * treepos + bit] - tree->numcodes;
-    }
-  }
-
-  for(n = 0; n < tree->numcodes * 2; ++n)
-  {
-    if(tree->tree2d[n] == 32767) tree->tree2d[n] = 0; /*remove possible remaining 32767's*/
-  }
-
-  return 0;
+  lodepng_free(tree->table_len);
+  lodepng_free(tree->table_value);
 }
 
 /*
@@ -644,9 +877,167 @@ static unsigned HuffmanTree_makeFromLengths2(HuffmanTree* tree)
   uivector_cleanup(&blcount);
   uivector_cleanup(&nextcode);
 
-  if(!error) return HuffmanTree_make2DTree(tree);
-  else return error;
+  return error;
+}
+
+#ifdef LODEPNG_COMPILE_DECODER
+
+/*
+Number of bits of input looked up at once when decoding a symbol. Longer codes
+(up to 15 bits) continue in a sub-table of the entry of their first FIRSTBITS
+bits. 9 bits keeps the tables of the litlen tree in L1 cache while nearly all
+symbols of real images are found in the first lookup.
+*/
+#define FIRSTBITS 9u
+
+/*table_len value of an entry not filled in yet, no code is that long*/
+#define UNFILLEDLEN 16u
+
+/*table_value of the entries no code leads to, in a tree with less than 2 codes*/
+#define INVALIDSYMBOL 65535u
+
+/*
+Makes the lookup tables of the decoder from tree1d and lengths. return value is error.
+Entry i of the first 2^FIRSTBITS entries is the symbol whose code starts with
+the FIRSTBITS bits i (read from the stream, so reversed), along with the length
+of that code. If codes longer than FIRSTBITS start with i, the entry instead
+gives the length of the longest of them and where their sub-table starts, which
+is indexed by the bits following the first FIRSTBITS ones.
+*/
+static unsigned HuffmanTree_makeTable(HuffmanTree* tree)
+{
+  static const unsigned headsize = 1u << FIRSTBITS;
+  static const unsigned mask = (1u << FIRSTBITS) - 1u;
+  size_t i, numpresent, pointer, size; /*total table size*/
+  unsigned* maxlens = (unsigned*)lodepng_malloc(headsize * sizeof(unsigned));
+  if(!maxlens) return 83; /*alloc fail*/
+
+  /*compute maxlens: max total bit length of symbols sharing prefix in the first table*/
+  for(i = 0; i < headsize; ++i) maxlens[i] = 0;
+  for(i = 0; i < tree->numcodes; i++)
+  {
+    unsigned symbol = tree->tree1d[i];
+    unsigned l = tree->lengths[i];
+    unsigned index;
+    if(l <= FIRSTBITS) continue; /*symbols that fit in first table don't increase secondary table size*/
+    /*get the FIRSTBITS MSBs, the MSBs of the symbol are encoded first. See later comment about the reversing*/
+    index = reverseBits(symbol >> (l - FIRSTBITS), FIRSTBITS);
+    if(l > maxlens[index]) maxlens[index] = l;
+  }
+  /*compute total table size: size of first table plus all secondary tables for symbols longer than FIRSTBITS*/
+  size = headsize;
+  for(i = 0; i < headsize; ++i)
+  {
+    unsigned l = maxlens[i];
+    if(l > FIRSTBITS) size += (1u << (l - FIRSTBITS));
+  }
+  tree->table_len = (unsigned char*)lodepng_malloc(size * sizeof(*tree->table_len));
+  tree->table_value = (unsigned short*)lodepng_malloc(size * sizeof(*tree->table_value));
+  if(!tree->table_len || !tree->table_value)
+  {
+    lodepng_free(maxlens);
+    return 83; /*alloc fail, the tables are freed by HuffmanTree_cleanup*/
+  }
+  for(i = 0; i < size; ++i) tree->table_len[i] = UNFILLEDLEN;
+
+  /*fill in the first table for long symbols: max prefix size and pointer to secondary tables*/
+  pointer = headsize;
+  for(i = 0; i < headsize; ++i)
+  {
+    unsigned l = maxlens[i];
+    if(l <= FIRSTBITS) continue;
+    tree->table_len[i] = l;
+    tree->table_value[i] = (unsigned short)pointer;
+    pointer += (1u << (l - FIRSTBITS));
+  }
+  lodepng_free(maxlens);
+
+  /*fill in the first table for short symbols, or secondary table for long symbols*/
+  numpresent = 0;
+  for(i = 0; i < tree->numcodes; ++i)
+  {
+    unsigned l = tree->lengths[i];
+    unsigned symbol, reverse;
+    if(l == 0) continue;
+    symbol = tree->tree1d[i];
+    /*reverse bits, because the huffman bits are given in MSB first order but the bit reader reads LSB first*/
+    reverse = reverseBits(symbol, l);
+    numpresent++;
+
+    if(l <= FIRSTBITS)
+    {
+      /*short symbol, fully in first table, replicated num times if l < FIRSTBITS*/
+      unsigned num = 1u << (FIRSTBITS - l);
+      unsigned j;
+      for(j = 0; j < num; ++j)
+      {
+        /*bit reader will read the l bits of symbol first, the remaining FIRSTBITS - l bits go to the MSB's*/
+        unsigned index = reverse | (j << l);
+        if(tree->table_len[index] != UNFILLEDLEN) return 55; /*invalid tree: long symbol shares prefix with short symbol*/
+        tree->table_len[index] = l;
+        tree->table_value[index] = (unsigned short)i;
+      }
+    }
+    else
+    {
+      /*long symbol, shares prefix with other long symbols in first lookup table, needs second lookup*/
+      /*the FIRSTBITS MSBs of the symbol are the first table index*/
+      unsigned index = reverse & mask;
+      unsigned maxlen = tree->table_len[index];
+      /*log2 of secondary table length, should be >= l - FIRSTBITS*/
+      unsigned tablelen = maxlen - FIRSTBITS;
+      unsigned start = tree->table_value[index]; /*starting index in secondary table*/
+      unsigned num = 1u << (tablelen - (l - FIRSTBITS)); /*amount of entries of this symbol in secondary table*/
+      unsigned j;
+      if(maxlen < l) return 55; /*invalid tree: long symbol shares prefix with short symbol*/
+      for(j = 0; j < num; ++j)
+      {
+        unsigned reverse2 = reverse >> FIRSTBITS; /*l - FIRSTBITS bits*/
+        unsigned index2 = start + (reverse2 | (j << (l - FIRSTBITS)));
+        tree->table_len[index2] = l;
+        tree->table_value[index2] = (unsigned short)i;
+      }
+    }
+  }
+
+  if(numpresent < 2)
+  {
+    /*
+    In case of exactly 1 symbol, in theory the huffman symbol needs 0 bits,
+    but deflate uses 1 bit instead. In case of 0 symbols, no symbols can
+    appear at all, but such huffman tree could still exist (e.g. if distance
+    codes are never used). In both cases, not all symbols of the table will be
+    filled in. Fill them in with an invalid symbol value so returning them from
+    huffmanDecodeSymbol will cause error.
+    */
+    for(i = 0; i < size; ++i)
+    {
+      if(tree->table_len[i] == UNFILLEDLEN)
+      {
+        /*As length, use a value smaller than FIRSTBITS for the head table, and a value larger than FIRSTBITS for the
+        secondary table, so huffmanDecodeSymbol takes the same path as for a real symbol before failing.*/
+        tree->table_len[i] = (i < headsize) ? 1 : (FIRSTBITS + 1);
+        tree->table_value[i] = INVALIDSYMBOL;
+      }
+    }
+  }
+  else
+  {
+    /*
+    A good huffman tree has N * 2 - 1 nodes, of which N - 1 are internal nodes.
+    If that is not the case, the table will not have been fully used, and this
+    is an error (not all bit combinations can be decoded), indicated by error 55
+    like an oversubscribed tree. zlib refuses such trees too.
+    */
+    for(i = 0; i < size; ++i)
+    {
+      if(tree->table_len[i] == UNFILLEDLEN) return 55;
+    }
+  }
+
+  return 0;
 }
+#endif /*LODEPNG_COMPILE_DECODER*/
 
 /*
 given the code lengths (as stored in the PNG file), generate the tree as defined
@@ -662,7 +1053,13 @@ static unsigned HuffmanTree_makeFromLengths(HuffmanTree* tree, const unsigned* b
   for(i = 0; i != numcodes; ++i) tree->lengths[i] = bitlen[i];
   tree->numcodes = (unsigned)numcodes; /*number of symbols*/
   tree->maxbitlen = maxbitlen;
+#ifdef LODEPNG_COMPILE_DECODER
+  /*only the decoder reads codes from lengths, the encoder makes its trees from frequencies*/
+  CERROR_TRY_RETURN(HuffmanTree_makeFromLengths2(tree));
+  return HuffmanTree_makeTable(tree);
+#else /*LODEPNG_COMPILE_DECODER*/
   return HuffmanTree_makeFromLengths2(tree);
+#endif /*LODEPNG_COMPILE_DECODER*/
 }
 
 #ifdef LODEPNG_COMPILE_ENCODER
@@ -786,6 +1183,75 @@ static void boundaryPM(BPMLists* lists, BPMNode* leaves, size_t numpresent, int
   }
 }
 
+/*
+Huffman code lengths without length limit, for leaves sorted by weight, with the
+in-place algorithm of "In-Place Calculation of Minimum-Redundancy Codes", Alistair
+Moffat and Jyrki Katajainen, 1995. Sets the lengths of the leaves in lengths and
+returns the longest. numpresent must be at least 2.
+*/
+static unsigned huffman_code_lengths_unlimited(unsigned* lengths, const BPMNode* leaves, size_t numpresent)
+{
+  /*first the weights, then the parents of the internal nodes, then the depths*/
+  unsigned* a = (unsigned*)lodepng_malloc(numpresent * sizeof(unsigned));
+  size_t root, leaf, next, avbl, used, i;
+  unsigned depth, maxlength;
+  if(!a) return 16; /*too long for any deflate tree, the caller falls back to package-merge*/
+  for(i = 0; i != numpresent; ++i) a[i] = (unsigned)leaves[i].weight;
+
+  /*combine the two lightest leaves or internal nodes, left to right*/
+  a[0] += a[1];
+  root = 0;
+  leaf = 2;
+  for(next = 1; next < numpresent - 1; ++next)
+  {
+    if(leaf >= numpresent || a[root] < a[leaf])
+    {
+      a[next] = a[root];
+      a[root++] = (unsigned)next;
+    }
+    else a[next] = a[leaf++];
+
+    if(leaf >= numpresent || (root < next && a[root] < a[leaf]))
+    {
+      a[next] += a[root];
+      a[root++] = (unsigned)next;
+    }
+    else a[next] += a[leaf++];
+  }
+
+  /*depths of the internal nodes, right to left*/
+  a[numpresent - 2] = 0;
+  for(next = numpresent - 2; next-- > 0;) a[next] = a[a[next]] + 1;
+
+  /*depths of the leaves*/
+  avbl = 1;
+  used = 0;
+  depth = 0;
+  root = numpresent - 1; /*one past the next internal node, counting down*/
+  next = numpresent;
+  while(avbl > 0)
+  {
+    while(root > 0 && a[root - 1] == depth)
+    {
+      ++used;
+      --root;
+    }
+    while(avbl > used)
+    {
+      a[--next] = depth;
+      --avbl;
+    }
+    avbl = 2 * used;
+    ++depth;
+    used = 0;
+  }
+
+  maxlength = a[0];
+  for(i = 0; i != numpresent; ++i) lengths[leaves[i].index] = a[i];
+  lodepng_free(a);
+  return maxlength;
+}
+
 unsigned lodepng_huffman_code_lengths(unsigned* lengths, const unsigned* frequencies,
                                       size_t numcodes, unsigned maxbitlen)
 {
@@ -833,6 +1299,15 @@ unsigned lodepng_huffman_code_lengths(unsigned* lengths, const unsigned* frequen
 
     bpmnode_sort(leaves, numpresent);
 
+    /*unlimited Huffman lengths are just as optimal and much faster to get, the
+    package-merge below is only needed when the longest of them is too long*/
+    if(huffman_code_lengths_unlimited(lengths, leaves, numpresent) <= maxbitlen)
+    {
+      lodepng_free(leaves);
+      return 0;
+    }
+    for(i = 0; i != numcodes; ++i) lengths[i] = 0;
+
     lists.listsize = maxbitlen;
     lists.memsize = 2 * maxbitlen * (maxbitlen + 1);
     lists.nextfree = 0;
@@ -941,27 +1416,27 @@ static unsigned generateFixedDistanceTree(HuffmanTree* tree)
 #ifdef LODEPNG_COMPILE_DECODER
 
 /*
-returns the code, or (unsigned)(-1) if error happened
-inbitlength is the length of the complete buffer, in bits (so its byte length times 8)
+returns the code, or (unsigned)(-1) if error happened. The bit reader must have
+been refilled, and may have gone past the end of the input afterwards.
 */
-static unsigned huffmanDecodeSymbol(const unsigned char* in, size_t* bp,
-                                    const HuffmanTree* codetree, size_t inbitlength)
+static unsigned huffmanDecodeSymbol(LodePNGBitReader* reader, const HuffmanTree* codetree)
 {
-  unsigned treepos = 0, ct;
-  for(;;)
+  /*
+  one table lookup for nearly all symbols, two for the codes longer than FIRSTBITS.
+  This replaced a walk of the tree one bit at a time, the biggest bottleneck while decoding
+  */
+  unsigned code = LodePNGBitReader_peek(reader, FIRSTBITS);
+  unsigned l = codetree->table_len[code];
+  unsigned value = codetree->table_value[code];
+  if(l > FIRSTBITS)
   {
-    if(*bp >= inbitlength) return (unsigned)(-1); /*error: end of input memory reached without endcode*/
-    /*
-    decode the symbol from the tree. The "readBitFromStream" code is inlined in
-    the expression below because this is the biggest bottleneck while decoding
-    */
-    ct = codetree->tree2d[(treepos << 1) + READBIT(*bp, in)];
-    ++(*bp);
-    if(ct < codetree->numcodes) return ct; /*the symbol is decoded, return it*/
-    else treepos = ct - codetree->numcodes; /*symbol not yet decoded, instead move tree position*/
-
-    if(treepos >= codetree->numcodes) return (unsigned)(-1); /*error: it appeared outside the codetree*/
+    unsigned index2 = value + (LodePNGBitReader_peek(reader, l) >> FIRSTBITS);
+    l = codetree->table_len[index2];
+    value = codetree->table_value[index2];
   }
+  LodePNGBitReader_skip(reader, l);
+  if(value == INVALIDSYMBOL) return (unsigned)(-1); /*error: a code no symbol has*/
+  return value;
 }
 #endif /*LODEPNG_COMPILE_DECODER*/
 
@@ -980,13 +1455,11 @@ static void getTreeInflateFixed(HuffmanTree* tree_ll, HuffmanTree* tree_d)
 }
 
 /*get the tree of a deflated block with dynamic tree, the tree itself is also Huffman compressed with a known tree*/
-static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
-                                      const unsigned char* in, size_t* bp, size_t inlength)
+static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d, LodePNGBitReader* reader)
 {
   /*make sure that length values that aren't filled in will be 0, or a wrong tree will be generated*/
   unsigned error = 0;
   unsigned n, HLIT, HDIST, HCLEN, i;
-  size_t inbitlength = inlength * 8;
 
   /*see comments in deflateDynamic for explanation of the context and these variables, it is analogous*/
   unsigned* bitlen_ll = 0; /*lit,len code lengths*/
@@ -995,16 +1468,15 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
   unsigned* bitlen_cl = 0;
   HuffmanTree tree_cl; /*the code tree for code length codes (the huffman tree for compressed huffman trees)*/
 
-  if((*bp) + 14 > (inlength << 3)) return 49; /*error: the bit pointer is or will go past the memory*/
-
+  LodePNGBitReader_refill(reader);
   /*number of literal/length codes + 257. Unlike the spec, the value 257 is added to it here already*/
-  HLIT =  readBitsFromStream(bp, in, 5) + 257;
+  HLIT =  LodePNGBitReader_read(reader, 5) + 257;
   /*number of distance codes. Unlike the spec, the value 1 is added to it here already*/
-  HDIST = readBitsFromStream(bp, in, 5) + 1;
+  HDIST = LodePNGBitReader_read(reader, 5) + 1;
   /*number of code length codes. Unlike the spec, the value 4 is added to it here already*/
-  HCLEN = readBitsFromStream(bp, in, 4) + 4;
+  HCLEN = LodePNGBitReader_read(reader, 4) + 4;
 
-  if((*bp) + HCLEN * 3 > (inlength << 3)) return 50; /*error: the bit pointer is or will go past the memory*/
+  if(LodePNGBitReader_pastEnd(reader)) return 49; /*error: the bit pointer is or will go past the memory*/
 
   HuffmanTree_init(&tree_cl);
 
@@ -1017,9 +1489,14 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
 
     for(i = 0; i != NUM_CODE_LENGTH_CODES; ++i)
     {
-      if(i < HCLEN) bitlen_cl[CLCL_ORDER[i]] = readBitsFromStream(bp, in, 3);
+      if(i < HCLEN)
+      {
+        LodePNGBitReader_refill(reader); /*the 19 codes need more bits than a refill gives*/
+        bitlen_cl[CLCL_ORDER[i]] = LodePNGBitReader_read(reader, 3);
+      }
       else bitlen_cl[CLCL_ORDER[i]] = 0; /*if not, it must stay 0*/
     }
+    if(LodePNGBitReader_pastEnd(reader)) ERROR_BREAK(50); /*error: the bit pointer is or will go past the memory*/
 
     error = HuffmanTree_makeFromLengths(&tree_cl, bitlen_cl, NUM_CODE_LENGTH_CODES, 7);
     if(error) break;
@@ -1035,7 +1512,9 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
     i = 0;
     while(i < HLIT + HDIST)
     {
-      unsigned code = huffmanDecodeSymbol(in, bp, &tree_cl, inbitlength);
+      unsigned code;
+      LodePNGBitReader_refill(reader); /*at most 7 bits of code and 7 extra bits*/
+      code = huffmanDecodeSymbol(reader, &tree_cl);
       if(code <= 15) /*a length code*/
       {
         if(i < HLIT) bitlen_ll[i] = code;
@@ -1049,8 +1528,7 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
 
         if(i == 0) ERROR_BREAK(54); /*can't repeat previous if i is 0*/
 
-        if((*bp + 2) > inbitlength) ERROR_BREAK(50); /*error, bit pointer jumps past memory*/
-        replength += readBitsFromStream(bp, in, 2);
+        replength += LodePNGBitReader_read(reader, 2);
 
         if(i < HLIT + 1) value = bitlen_ll[i - 1];
         else value = bitlen_d[i - HLIT - 1];
@@ -1066,8 +1544,7 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
       else if(code == 17) /*repeat "0" 3-10 times*/
       {
         unsigned replength = 3; /*read in the bits that indicate repeat length*/
-        if((*bp + 3) > inbitlength) ERROR_BREAK(50); /*error, bit pointer jumps past memory*/
-        replength += readBitsFromStream(bp, in, 3);
+        replength += LodePNGBitReader_read(reader, 3);
 
         /*repeat this value in the next lengths*/
         for(n = 0; n < replength; ++n)
@@ -1082,8 +1559,7 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
       else if(code == 18) /*repeat "0" 11-138 times*/
       {
         unsigned replength = 11; /*read in the bits that indicate repeat length*/
-        if((*bp + 7) > inbitlength) ERROR_BREAK(50); /*error, bit pointer jumps past memory*/
-        replength += readBitsFromStream(bp, in, 7);
+        replength += LodePNGBitReader_read(reader, 7);
 
         /*repeat this value in the next lengths*/
         for(n = 0; n < replength; ++n)
@@ -1101,11 +1577,12 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
         {
           /*return error code 10 or 11 depending on the situation that happened in huffmanDecodeSymbol
           (10=no endcode, 11=wrong jump outside of tree)*/
-          error = (*bp) > inbitlength ? 10 : 11;
+          error = LodePNGBitReader_pastEnd(reader) ? 10 : 11;
         }
         else error = 16; /*unexisting code, this can never happen*/
         break;
       }
+      if(LodePNGBitReader_pastEnd(reader)) ERROR_BREAK(50); /*error, bit pointer jumps past memory*/
     }
     if(error) break;
 
@@ -1128,28 +1605,33 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
 }
 
 /*inflate a block with dynamic of fixed Huffman tree*/
-static unsigned inflateHuffmanBlock(ucvector* out, const unsigned char* in, size_t* bp,
-                                    size_t* pos, size_t inlength, unsigned btype)
+static unsigned inflateHuffmanBlock(ucvector* out, LodePNGBitReader* reader, size_t* pos, unsigned btype)
 {
   unsigned error = 0;
   HuffmanTree tree_ll; /*the huffman tree for literal and length codes*/
   HuffmanTree tree_d; /*the huffman tree for distance codes*/
-  size_t inbitlength = inlength * 8;
 
   HuffmanTree_init(&tree_ll);
   HuffmanTree_init(&tree_d);
 
   if(btype == 1) getTreeInflateFixed(&tree_ll, &tree_d);
-  else if(btype == 2) error = getTreeInflateDynamic(&tree_ll, &tree_d, in, bp, inlength);
+  else if(btype == 2) error = getTreeInflateDynamic(&tree_ll, &tree_d, reader);
 
   while(!error) /*decode all symbols until end reached, breaks at end code*/
   {
+    unsigned code_ll;
+    /*
+    Room for the longest match, so the output is checked once per symbol. And enough
+    bits for a whole length and distance: 15 + 5 + 15 + 13 bits at most.
+    */
+    if(!ucvector_reserve(out, (*pos) + 258)) ERROR_BREAK(83 /*alloc fail*/);
+    LodePNGBitReader_refill(reader);
+
     /*code_ll is literal, length or end code*/
-    unsigned code_ll = huffmanDecodeSymbol(in, bp, &tree_ll, inbitlength);
+    code_ll = huffmanDecodeSymbol(reader, &tree_ll);
     if(code_ll <= 255) /*literal symbol*/
     {
-      /*ucvector_push_back would do the same, but for some reason the two lines below run 10% faster*/
-      if(!ucvector_resize(out, (*pos) + 1)) ERROR_BREAK(83 /*alloc fail*/);
+      if(LodePNGBitReader_pastEnd(reader)) ERROR_BREAK(10); /*error: end of input memory reached without endcode*/
       out->data[*pos] = (unsigned char)code_ll;
       ++(*pos);
     }
@@ -1164,18 +1646,17 @@ static unsigned inflateHuffmanBlock(ucvector* out, const unsigned char* in, size
 
       /*part 2: get extra bits and add the value of that to length*/
       numextrabits_l = LENGTHEXTRA[code_ll - FIRST_LENGTH_CODE_INDEX];
-      if((*bp + numextrabits_l) > inbitlength) ERROR_BREAK(51); /*error, bit pointer will jump past memory*/
-      length += readBitsFromStream(bp, in, numextrabits_l);
+      length += LodePNGBitReader_read(reader, numextrabits_l);
 
       /*part 3: get distance code*/
-      code_d = huffmanDecodeSymbol(in, bp, &tree_d, inbitlength);
+      code_d = huffmanDecodeSymbol(reader, &tree_d);
       if(code_d > 29)
       {
         if(code_d == (unsigned)(-1)) /*huffmanDecodeSymbol returns (unsigned)(-1) in case of error*/
         {
           /*return error code 10 or 11 depending on the situation that happened in huffmanDecodeSymbol
           (10=no endcode, 11=wrong jump outside of tree)*/
-          error = (*bp) > inlength * 8 ? 10 : 11;
+          error = LodePNGBitReader_pastEnd(reader) ? 10 : 11;
         }
         else error = 18; /*error: invalid distance code (30-31 are never used)*/
         break;
@@ -1184,15 +1665,14 @@ static unsigned inflateHuffmanBlock(ucvector* out, const unsigned char* in, size
 
       /*part 4: get extra bits from distance*/
       numextrabits_d = DISTANCEEXTRA[code_d];
-      if((*bp + numextrabits_d) > inbitlength) ERROR_BREAK(51); /*error, bit pointer will jump past memory*/
-      distance += readBitsFromStream(bp, in, numextrabits_d);
+      distance += LodePNGBitReader_read(reader, numextrabits_d);
+      if(LodePNGBitReader_pastEnd(reader)) ERROR_BREAK(51); /*error, bit pointer will jump past memory*/
 
       /*part 5: fill in all the out[n] values based on the length and dist*/
       start = (*pos);
       if(distance > start) ERROR_BREAK(52); /*too long backward distance*/
       backward = start - distance;
 
-      if(!ucvector_resize(out, (*pos) + length)) ERROR_BREAK(83 /*alloc fail*/);
       if (distance < length) {
         for(forward = 0; forward < length; ++forward)
         {
@@ -1205,34 +1685,38 @@ static unsigned inflateHuffmanBlock(ucvector* out, const unsigned char* in, size
     }
     else if(code_ll == 256)
     {
+      if(LodePNGBitReader_pastEnd(reader)) ERROR_BREAK(10); /*error: the end code was made of bits past the input*/
       break; /*end code, break the loop*/
     }
     else /*if(code == (unsigned)(-1))*/ /*huffmanDecodeSymbol returns (unsigned)(-1) in case of error*/
     {
       /*return error code 10 or 11 depending on the situation that happened in huffmanDecodeSymbol
       (10=no endcode, 11=wrong jump outside of tree)*/
-      error = ((*bp) > inlength * 8) ? 10 : 11;
+      error = LodePNGBitReader_pastEnd(reader) ? 10 : 11;
       break;
     }
   }
 
+  out->size = *pos;
+
   HuffmanTree_cleanup(&tree_ll);
   HuffmanTree_cleanup(&tree_d);
 
   return error;
 }
 
-static unsigned inflateNoCompression(ucvector* out, const unsigned char* in, size_t* bp, size_t* pos, size_t inlength)
+static unsigned inflateNoCompression(ucvector* out, LodePNGBitReader* reader, size_t* pos)
 {
   size_t p;
-  unsigned LEN, NLEN, n, error = 0;
+  unsigned LEN, NLEN, error = 0;
+  const unsigned char* in = reader->data;
+  size_t inlength = reader->size;
 
   /*go to first boundary of byte*/
-  while(((*bp) & 0x7) != 0) ++(*bp);
-  p = (*bp) / 8; /*byte position*/
+  p = LodePNGBitReader_alignToByte(reader); /*byte position*/
 
-  /*read LEN (2 bytes) and NLEN (2 bytes)*/
-  if(p + 4 >= inlength) return 52; /*error, bit pointer will jump past memory*/
+  /*read LEN (2 bytes) and NLEN (2 bytes). An empty block may end the input*/
+  if(p + 4 > inlength) return 52; /*error, bit pointer will jump past memory*/
   LEN = in[p] + 256u * in[p + 1]; p += 2;
   NLEN = in[p] + 256u * in[p + 1]; p += 2;
 
@@ -1243,9 +1727,12 @@ static unsigned inflateNoCompression(ucvector* out, const unsigned char* in, siz
 
   /*read the literal data: LEN bytes are now stored in the out buffer*/
   if(p + LEN > inlength) return 23; /*error: reading outside of in buffer*/
-  for(n = 0; n < LEN; ++n) out->data[(*pos)++] = in[p++];
+  if(LEN) memcpy(out->data + *pos, in + p, LEN);
+  *pos += LEN;
+  p += LEN;
 
-  (*bp) = p * 8;
+  /*the bits already in the buffer are before p, start over from there*/
+  LodePNGBitReader_init(reader, in, inlength, p);
 
   return error;
 }
@@ -1254,25 +1741,26 @@ static unsigned lodepng_inflatev(ucvector* out,
                                  const unsigned char* in, size_t insize,
                                  const LodePNGDecompressSettings* settings)
 {
-  /*bit pointer in the "in" data, current byte is bp >> 3, current bit is bp & 0x7 (from lsb to msb of the byte)*/
-  size_t bp = 0;
+  LodePNGBitReader reader;
   unsigned BFINAL = 0;
   size_t pos = 0; /*byte position in the out buffer*/
   unsigned error = 0;
 
   (void)settings;
 
+  LodePNGBitReader_init(&reader, in, insize, 0);
+
   while(!BFINAL)
   {
     unsigned BTYPE;
-    if(bp + 2 >= insize * 8) return 52; /*error, bit pointer will jump past memory*/
-    BFINAL = readBitFromStream(&bp, in);
-    BTYPE = 1u * readBitFromStream(&bp, in);
-    BTYPE += 2u * readBitFromStream(&bp, in);
+    LodePNGBitReader_refill(&reader);
+    BFINAL = LodePNGBitReader_read(&reader, 1);
+    BTYPE = LodePNGBitReader_read(&reader, 2);
+    if(LodePNGBitReader_pastEnd(&reader)) return 52; /*error, bit pointer will jump past memory*/
 
     if(BTYPE == 3) return 20; /*error: invalid BTYPE*/
-    else if(BTYPE == 0) error = inflateNoCompression(out, in, &bp, &pos, insize); /*no compression*/
-    else error = inflateHuffmanBlock(out, in, &bp, &pos, insize, BTYPE); /*compression, BTYPE 01 or 10*/
+    else if(BTYPE == 0) error = inflateNoCompression(out, &reader, &pos); /*no compression*/
+    else error = inflateHuffmanBlock(out, &reader, &pos, BTYPE); /*compression, BTYPE 01 or 10*/
 
     if(error) return error;
   }
@@ -1293,17 +1781,20 @@ unsigned lodepng_inflate(unsigned char** out, size_t* outsize,
   return error;
 }
 
-static unsigned inflate(unsigned char** out, size_t* outsize,
-                        const unsigned char* in, size_t insize,
-                        const LodePNGDecompressSettings* settings)
+/*the memory already reserved in out is kept, so a right guess of the size spares all reallocations*/
+static unsigned inflatev(ucvector* out,
+                         const unsigned char* in, size_t insize,
+                         const LodePNGDecompressSettings* settings)
 {
   if(settings->custom_inflate)
   {
-    return settings->custom_inflate(out, outsize, in, insize, settings);
+    unsigned error = settings->custom_inflate(&out->data, &out->size, in, insize, settings);
+    out->allocsize = out->size;
+    return error;
   }
   else
   {
-    return lodepng_inflate(out, outsize, in, insize, settings);
+    return lodepng_inflatev(out, in, insize, settings);
   }
 }
 
@@ -1378,10 +1869,23 @@ typedef struct Hash
   unsigned short* zeros; /*length of zeros streak, used as a second hash chain*/
 } Hash;
 
-static unsigned hash_init(Hash* hash, unsigned windowsize)
+/*with fastlz77, only head is used, the other arrays are left NULL*/
+static unsigned hash_init(Hash* hash, unsigned windowsize, unsigned fastlz77)
 {
   unsigned i;
   hash->head = (int*)lodepng_malloc(sizeof(int) * HASH_NUM_VALUES);
+  if(fastlz77)
+  {
+    hash->val = 0;
+    hash->chain = 0;
+    hash->zeros = 0;
+    hash->headz = 0;
+    hash->chainz = 0;
+    if(!hash->head) return 83; /*alloc fail*/
+    for(i = 0; i != HASH_NUM_VALUES; ++i) hash->head[i] = -1;
+    return 0;
+  }
+
   hash->val = (int*)lodepng_malloc(sizeof(int) * windowsize);
   hash->chain = (unsigned short*)lodepng_malloc(sizeof(unsigned short) * windowsize);
 
@@ -1648,6 +2152,77 @@ static unsigned encodeLZ77(uivector* out, Hash* hash,
   return error;
 }
 
+/*
+LZ77 for the fast levels: greedy, one candidate per hash and no chain to walk.
+Only the positions where a literal or a match starts go in the table, the ones
+inside a match are skipped. Candidates are checked against the data, so an
+entry older than the window just fails to match.
+*/
+static unsigned encodeLZ77Fast(uivector* out, Hash* hash,
+                               const unsigned char* in, size_t inpos, size_t insize, unsigned windowsize,
+                               unsigned minmatch)
+{
+  size_t pos = inpos;
+  unsigned error = 0;
+
+  if(windowsize == 0 || windowsize > 32768) return 60; /*error: windowsize smaller/larger than allowed*/
+  if((windowsize & (windowsize - 1)) != 0) return 90; /*error: must be power of two*/
+  /*a literal is one value, a match of 3 bytes or more is 4, so this is enough for all*/
+  if(!uivector_reserve(out, (out->size + (insize - inpos) / 3 * 4 + 4) * sizeof(unsigned))) return 83; /*alloc fail*/
+
+  while(pos < insize)
+  {
+    unsigned length = 0, offset = 0;
+
+    /*the last 7 bytes are left as literals, the hash and compare read 8 at a time*/
+    if(pos + 8 <= insize)
+    {
+      unsigned long long word = lodepng_read64bitInt_le(&in[pos]);
+      unsigned hashval = ((unsigned)word * 2654435761u) >> 16; /*the first 4 bytes*/
+      size_t wpos = pos & (windowsize - 1);
+      int candidate = hash->head[hashval];
+      hash->head[hashval] = (int)wpos;
+
+      if(candidate != -1)
+      {
+        offset = (unsigned)((wpos - (size_t)candidate) & (windowsize - 1));
+        if(offset != 0 && offset <= pos)
+        {
+          const unsigned char* foreptr = &in[pos];
+          const unsigned char* backptr = foreptr - offset;
+          const unsigned char* lastptr = &in[insize < pos + MAX_SUPPORTED_DEFLATE_LENGTH ?
+                                             insize : pos + MAX_SUPPORTED_DEFLATE_LENGTH];
+          while(foreptr + 8 <= lastptr && lodepng_read64bitInt_le(foreptr) == lodepng_read64bitInt_le(backptr))
+          {
+            foreptr += 8;
+            backptr += 8;
+          }
+          while(foreptr != lastptr && *backptr == *foreptr)
+          {
+            ++backptr;
+            ++foreptr;
+          }
+          length = (unsigned)(foreptr - &in[pos]);
+        }
+      }
+    }
+
+    /*same rules as encodeLZ77 for short matches*/
+    if(length < 3 || length < minmatch || (length == 3 && offset > 4096))
+    {
+      out->data[out->size++] = in[pos];
+      ++pos;
+    }
+    else
+    {
+      addLengthDistance(out, length, offset);
+      pos += length;
+    }
+  }
+
+  return error;
+}
+
 /* /////////////////////////////////////////////////////////////////////////// */
 
 static unsigned deflateNoCompression(ucvector* out, const unsigned char* data, size_t datasize)
@@ -1691,15 +2266,35 @@ static unsigned deflateNoCompression(ucvector* out, const unsigned char* data, s
 write the lz77-encoded data, which has lit, len and dist codes, to compressed stream using huffman trees.
 tree_ll: the tree for lit and len codes.
 tree_d: the tree for distance codes.
+This is most of the bits of a block, so they are gathered in a 64-bit buffer and
+appended a byte at a time, with the codes reversed once beforehand.
 */
-static void writeLZ77data(size_t* bp, ucvector* out, const uivector* lz77_encoded,
-                          const HuffmanTree* tree_ll, const HuffmanTree* tree_d)
+static unsigned writeLZ77data(size_t* bp, ucvector* out, const uivector* lz77_encoded,
+                              const HuffmanTree* tree_ll, const HuffmanTree* tree_d)
 {
-  size_t i = 0;
+  unsigned codes_ll[288], codes_d[32];
+  unsigned long long buffer = 0;
+  unsigned bits = (unsigned)((*bp) & 7); /*the bits of the last byte already used are taken back*/
+  size_t bitstart = (*bp) - bits, start, i = 0;
+
+  for(i = 0; i != tree_ll->numcodes; ++i) codes_ll[i] = reverseBits(tree_ll->tree1d[i], tree_ll->lengths[i]);
+  for(i = 0; i != tree_d->numcodes; ++i) codes_d[i] = reverseBits(tree_d->tree1d[i], tree_d->lengths[i]);
+
+  /*a literal takes at most 2 bytes, a length and distance 6 bytes for its 4 values*/
+  if(!ucvector_reserve(out, out->size + lz77_encoded->size * 2 + 1)) return 83; /*alloc fail*/
+
+  if(bits)
+  {
+    buffer = out->data[out->size - 1];
+    --out->size;
+  }
+  start = out->size;
+
   for(i = 0; i != lz77_encoded->size; ++i)
   {
     unsigned val = lz77_encoded->data[i];
-    addHuffmanSymbol(bp, out, HuffmanTree_getCode(tree_ll, val), HuffmanTree_getLength(tree_ll, val));
+    buffer |= (unsigned long long)codes_ll[val] << bits;
+    bits += tree_ll->lengths[val];
     if(val > 256) /*for a length code, 3 more things have to be added*/
     {
       unsigned length_index = val - FIRST_LENGTH_CODE_INDEX;
@@ -1712,12 +2307,25 @@ static void writeLZ77data(size_t* bp, ucvector* out, const uivector* lz77_encode
       unsigned n_distance_extra_bits = DISTANCEEXTRA[distance_index];
       unsigned distance_extra_bits = lz77_encoded->data[++i];
 
-      addBitsToStream(bp, out, length_extra_bits, n_length_extra_bits);
-      addHuffmanSymbol(bp, out, HuffmanTree_getCode(tree_d, distance_code),
-                       HuffmanTree_getLength(tree_d, distance_code));
-      addBitsToStream(bp, out, distance_extra_bits, n_distance_extra_bits);
+      /*at most 7 + 15 + 5 + 15 + 13 bits in the buffer*/
+      buffer |= (unsigned long long)length_extra_bits << bits;
+      bits += n_length_extra_bits;
+      buffer |= (unsigned long long)codes_d[distance_code] << bits;
+      bits += tree_d->lengths[distance_code];
+      buffer |= (unsigned long long)distance_extra_bits << bits;
+      bits += n_distance_extra_bits;
+    }
+    while(bits >= 8)
+    {
+      out->data[out->size++] = (unsigned char)buffer;
+      buffer >>= 8;
+      bits -= 8;
     }
   }
+
+  (*bp) = bitstart + (out->size - start) * 8 + bits;
+  if(bits) out->data[out->size++] = (unsigned char)buffer;
+  return 0;
 }
 
 /*Deflate for a block of type "dynamic", that is, with freely, optimally, created huffman trees*/
@@ -1782,8 +2390,16 @@ static unsigned deflateDynamic(ucvector* out, size_t* bp, Hash* hash,
   {
     if(settings->use_lz77)
     {
-      error = encodeLZ77(&lz77_encoded, hash, data, datapos, dataend, settings->windowsize,
-                         settings->minmatch, settings->nicematch, settings->lazymatching);
+      if(settings->fastlz77)
+      {
+        error = encodeLZ77Fast(&lz77_encoded, hash, data, datapos, dataend, settings->windowsize,
+                               settings->minmatch);
+      }
+      else
+      {
+        error = encodeLZ77(&lz77_encoded, hash, data, datapos, dataend, settings->windowsize,
+                           settings->minmatch, settings->nicematch, settings->lazymatching);
+      }
       if(error) break;
     }
     else
@@ -1941,7 +2557,8 @@ static unsigned deflateDynamic(ucvector* out, size_t* bp, Hash* hash,
     }
 
     /*write the compressed data symbols*/
-    writeLZ77data(bp, out, &lz77_encoded, &tree_ll, &tree_d);
+    error = writeLZ77data(bp, out, &lz77_encoded, &tree_ll, &tree_d);
+    if(error) break;
     /*error: the length of the end code 256 must be larger than 0*/
     if(HuffmanTree_getLength(&tree_ll, 256) == 0) ERROR_BREAK(64);
 
@@ -1992,9 +2609,17 @@ static unsigned deflateFixed(ucvector* out, size_t* bp, Hash* hash,
   {
     uivector lz77_encoded;
     uivector_init(&lz77_encoded);
-    error = encodeLZ77(&lz77_encoded, hash, data, datapos, dataend, settings->windowsize,
-                       settings->minmatch, settings->nicematch, settings->lazymatching);
-    if(!error) writeLZ77data(bp, out, &lz77_encoded, &tree_ll, &tree_d);
+    if(settings->fastlz77)
+    {
+      error = encodeLZ77Fast(&lz77_encoded, hash, data, datapos, dataend, settings->windowsize,
+                             settings->minmatch);
+    }
+    else
+    {
+      error = encodeLZ77(&lz77_encoded, hash, data, datapos, dataend, settings->windowsize,
+                         settings->minmatch, settings->nicematch, settings->lazymatching);
+    }
+    if(!error) error = writeLZ77data(bp, out, &lz77_encoded, &tree_ll, &tree_d);
     uivector_cleanup(&lz77_encoded);
   }
   else /*no LZ77, but still will be Huffman compressed*/
@@ -2014,17 +2639,20 @@ static unsigned deflateFixed(ucvector* out, size_t* bp, Hash* hash,
   return error;
 }
 
-static unsigned lodepng_deflatev(ucvector* out, const unsigned char* in, size_t insize,
-                                 const LodePNGCompressSettings* settings)
+/*
+Deflates in[start..end) as blocks of its own, the last one final if final is
+set. Otherwise an empty stored block follows, a sync flush: the output ends on
+a byte boundary and the deflate stream can go on with anything.
+*/
+static unsigned deflateRange(ucvector* out, const unsigned char* in, size_t start, size_t end,
+                             const LodePNGCompressSettings* settings, unsigned final)
 {
   unsigned error = 0;
-  size_t i, blocksize, numdeflateblocks;
+  size_t i, blocksize, numdeflateblocks, insize = end - start;
   size_t bp = 0; /*the bit pointer*/
   Hash hash;
 
-  if(settings->btype > 2) return 61;
-  else if(settings->btype == 0) return deflateNoCompression(out, in, insize);
-  else if(settings->btype == 1) blocksize = insize;
+  if(settings->btype == 1) blocksize = insize;
   else /*if(settings->btype == 2)*/
   {
     /*on PNGs, deflate blocks of 65-262k seem to give most dense encoding*/
@@ -2036,25 +2664,108 @@ static unsigned lodepng_deflatev(ucvector* out, const unsigned char* in, size_t
   numdeflateblocks = (insize + blocksize - 1) / blocksize;
   if(numdeflateblocks == 0) numdeflateblocks = 1;
 
-  error = hash_init(&hash, settings->windowsize);
+  error = hash_init(&hash, settings->windowsize, settings->fastlz77);
   if(error) return error;
 
   for(i = 0; i != numdeflateblocks && !error; ++i)
   {
-    unsigned final = (i == numdeflateblocks - 1);
-    size_t start = i * blocksize;
-    size_t end = start + blocksize;
-    if(end > insize) end = insize;
+    unsigned lastblock = (i == numdeflateblocks - 1);
+    size_t blockstart = start + i * blocksize;
+    size_t blockend = blockstart + blocksize;
+    if(blockend > end) blockend = end;
 
-    if(settings->btype == 1) error = deflateFixed(out, &bp, &hash, in, start, end, settings, final);
-    else if(settings->btype == 2) error = deflateDynamic(out, &bp, &hash, in, start, end, settings, final);
+    if(settings->btype == 1) error = deflateFixed(out, &bp, &hash, in, blockstart, blockend, settings, final && lastblock);
+    else error = deflateDynamic(out, &bp, &hash, in, blockstart, blockend, settings, final && lastblock);
   }
 
   hash_cleanup(&hash);
 
+  if(!error && !final)
+  {
+    addBitsToStream(&bp, out, 0, 3); /*BFINAL 0, BTYPE 00, then LEN 0 and NLEN 65535 from the next byte*/
+    if(!ucvector_push_back(out, 0) || !ucvector_push_back(out, 0)
+    || !ucvector_push_back(out, 255) || !ucvector_push_back(out, 255)) error = 83; /*alloc fail*/
+  }
+
   return error;
 }
 
+#ifdef LODEPNG_PTHREADS
+/*the parts of the input deflated on their own by lodepng_deflatev, each on a thread*/
+typedef struct DeflateSegments
+{
+  const unsigned char* in;
+  size_t insize;
+  size_t segmentsize;
+  const LodePNGCompressSettings* settings;
+  ucvector* outs; /*the output of each segment*/
+  unsigned* errors;
+} DeflateSegments;
+
+static void deflateSegment(void* context, size_t index)
+{
+  DeflateSegments* segments = (DeflateSegments*)context;
+  size_t start = index * segments->segmentsize;
+  size_t end = start + segments->segmentsize;
+  if(end > segments->insize) end = segments->insize;
+  segments->errors[index] = deflateRange(&segments->outs[index], segments->in, start, end,
+                                         segments->settings, end == segments->insize);
+}
+
+/*each segment is at least this big, smaller ones lose too much compression for the time won*/
+#define DEFLATE_MIN_SEGMENT_SIZE 262144
+#endif /*LODEPNG_PTHREADS*/
+
+static unsigned lodepng_deflatev(ucvector* out, const unsigned char* in, size_t insize,
+                                 const LodePNGCompressSettings* settings)
+{
+  if(settings->btype > 2) return 61;
+  else if(settings->btype == 0) return deflateNoCompression(out, in, insize);
+
+#ifdef LODEPNG_PTHREADS
+  /*
+  With several threads, the input is cut in one segment per thread, deflated
+  separately and joined with sync flushes. A segment can't refer to the data of
+  the previous one, that is what costs a bit of compression.
+  */
+  if(settings->numthreads > 1 && insize >= 2 * DEFLATE_MIN_SEGMENT_SIZE)
+  {
+    DeflateSegments segments;
+    size_t numsegments = insize / DEFLATE_MIN_SEGMENT_SIZE, i;
+    unsigned error = 0;
+    if(numsegments > settings->numthreads) numsegments = settings->numthreads;
+
+    segments.in = in;
+    segments.insize = insize;
+    segments.segmentsize = (insize + numsegments - 1) / numsegments;
+    segments.settings = settings;
+    segments.outs = (ucvector*)lodepng_malloc(numsegments * sizeof(ucvector));
+    segments.errors = (unsigned*)lodepng_malloc(numsegments * sizeof(unsigned));
+    if(!segments.outs || !segments.errors) error = 83; /*alloc fail*/
+
+    if(!error)
+    {
+      for(i = 0; i != numsegments; ++i) ucvector_init_buffer(&segments.outs[i], 0, 0);
+      lodepng_parallel_for(deflateSegment, &segments, numsegments, settings->numthreads);
+      for(i = 0; i != numsegments; ++i)
+      {
+        size_t j;
+        if(!error) error = segments.errors[i];
+        if(!error && !ucvector_reserve(out, out->size + segments.outs[i].size)) error = 83; /*alloc fail*/
+        for(j = 0; !error && j != segments.outs[i].size; ++j) out->data[out->size++] = segments.outs[i].data[j];
+        lodepng_free(segments.outs[i].data);
+      }
+    }
+
+    lodepng_free(segments.outs);
+    lodepng_free(segments.errors);
+    return error;
+  }
+#endif /*LODEPNG_PTHREADS*/
+
+  return deflateRange(out, in, 0, insize, settings, 1);
+}
+
 unsigned lodepng_deflate(unsigned char** out, size_t* outsize,
                          const unsigned char* in, size_t insize,
                          const LodePNGCompressSettings* settings)
@@ -2088,10 +2799,106 @@ static unsigned deflate(unsigned char** out, size_t* outsize,
 /* / Adler32                                                                  */
 /* ////////////////////////////////////////////////////////////////////////// */
 
+#ifdef LODEPNG_SIMD_X86
+/*
+Adler-32 of 16 (SSSE3) or 32 (AVX2) bytes per step, the way zlib-ng does it:
+s1 gets the sum of the bytes, s2 the bytes weighted by their distance to the
+end of the step plus the step size times s1 at its start. The lanes are
+summed and the sums reduced every ADLER32_SIMD_MAX bytes. Only does a multiple
+of the step size, returns the number of bytes done.
+*/
+#define ADLER32_SIMD_MAX 5536 /*largest multiple of 32 below 5552, where s2 could overflow*/
+
+__attribute__((target("ssse3")))
+static unsigned update_adler32_ssse3(unsigned* adler, const unsigned char* data, unsigned len)
+{
+  unsigned s1 = *adler & 0xffff;
+  unsigned s2 = (*adler >> 16) & 0xffff;
+  unsigned done = len & ~15u;
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i ones = _mm_set1_epi16(1);
+  const __m128i weights = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+  len = done;
+  while(len > 0)
+  {
+    unsigned amount = len > ADLER32_SIMD_MAX ? ADLER32_SIMD_MAX : len;
+    __m128i vs1 = _mm_cvtsi32_si128((int)s1);
+    __m128i vs2 = _mm_cvtsi32_si128((int)s2);
+    __m128i vs1_sum = zero; /*sum of s1 at the start of every step*/
+    len -= amount;
+    for(; amount > 0; amount -= 16, data += 16)
+    {
+      __m128i bytes = _mm_loadu_si128((const __m128i*)data);
+      vs1_sum = _mm_add_epi32(vs1_sum, vs1);
+      vs1 = _mm_add_epi32(vs1, _mm_sad_epu8(bytes, zero));
+      vs2 = _mm_add_epi32(vs2, _mm_madd_epi16(_mm_maddubs_epi16(bytes, weights), ones));
+    }
+    vs2 = _mm_add_epi32(vs2, _mm_slli_epi32(vs1_sum, 4));
+    vs1 = _mm_add_epi32(vs1, _mm_shuffle_epi32(vs1, _MM_SHUFFLE(1, 0, 3, 2)));
+    vs2 = _mm_add_epi32(vs2, _mm_shuffle_epi32(vs2, _MM_SHUFFLE(1, 0, 3, 2)));
+    vs2 = _mm_add_epi32(vs2, _mm_shuffle_epi32(vs2, _MM_SHUFFLE(2, 3, 0, 1)));
+    s1 = (unsigned)_mm_cvtsi128_si32(vs1) % 65521;
+    s2 = (unsigned)_mm_cvtsi128_si32(vs2) % 65521;
+  }
+  *adler = (s2 << 16) | s1;
+  return done;
+}
+
+__attribute__((target("avx2")))
+static unsigned update_adler32_avx2(unsigned* adler, const unsigned char* data, unsigned len)
+{
+  unsigned s1 = *adler & 0xffff;
+  unsigned s2 = (*adler >> 16) & 0xffff;
+  unsigned done = len & ~31u;
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i ones = _mm256_set1_epi16(1);
+  const __m256i weights = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,
+                                           16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+  len = done;
+  while(len > 0)
+  {
+    unsigned amount = len > ADLER32_SIMD_MAX ? ADLER32_SIMD_MAX : len;
+    __m256i vs1 = _mm256_setr_epi32((int)s1, 0, 0, 0, 0, 0, 0, 0);
+    __m256i vs2 = _mm256_setr_epi32((int)s2, 0, 0, 0, 0, 0, 0, 0);
+    __m256i vs1_sum = zero;
+    __m128i h1, h2;
+    len -= amount;
+    for(; amount > 0; amount -= 32, data += 32)
+    {
+      __m256i bytes = _mm256_loadu_si256((const __m256i*)data);
+      vs1_sum = _mm256_add_epi32(vs1_sum, vs1);
+      vs1 = _mm256_add_epi32(vs1, _mm256_sad_epu8(bytes, zero));
+      vs2 = _mm256_add_epi32(vs2, _mm256_madd_epi16(_mm256_maddubs_epi16(bytes, weights), ones));
+    }
+    vs2 = _mm256_add_epi32(vs2, _mm256_slli_epi32(vs1_sum, 5));
+    h1 = _mm_add_epi32(_mm256_castsi256_si128(vs1), _mm256_extracti128_si256(vs1, 1));
+    h2 = _mm_add_epi32(_mm256_castsi256_si128(vs2), _mm256_extracti128_si256(vs2, 1));
+    h1 = _mm_add_epi32(h1, _mm_shuffle_epi32(h1, _MM_SHUFFLE(1, 0, 3, 2)));
+    h2 = _mm_add_epi32(h2, _mm_shuffle_epi32(h2, _MM_SHUFFLE(1, 0, 3, 2)));
+    h2 = _mm_add_epi32(h2, _mm_shuffle_epi32(h2, _MM_SHUFFLE(2, 3, 0, 1)));
+    s1 = (unsigned)_mm_cvtsi128_si32(h1) % 65521;
+    s2 = (unsigned)_mm_cvtsi128_si32(h2) % 65521;
+  }
+  *adler = (s2 << 16) | s1;
+  return done;
+}
+#endif /*LODEPNG_SIMD_X86*/
+
 static unsigned update_adler32(unsigned adler, const unsigned char* data, unsigned len)
 {
-   unsigned s1 = adler & 0xffff;
-   unsigned s2 = (adler >> 16) & 0xffff;
+  unsigned s1, s2;
+
+#ifdef LODEPNG_SIMD_X86
+  unsigned features = lodepng_cpu_features();
+  unsigned done = 0;
+  if(features & LODEPNG_CPU_AVX2) done = update_adler32_avx2(&adler, data, len);
+  else if(features & LODEPNG_CPU_SSSE3) done = update_adler32_ssse3(&adler, data, len);
+  data += done;
+  len -= done;
+#endif /*LODEPNG_SIMD_X86*/
+
+  s1 = adler & 0xffff;
+  s2 = (adler >> 16) & 0xffff;
 
   while(len > 0)
   {
@@ -2123,8 +2930,8 @@ static unsigned adler32(const unsigned char* data, unsigned len)
 
 #ifdef LODEPNG_COMPILE_DECODER
 
-unsigned lodepng_zlib_decompress(unsigned char** out, size_t* outsize, const unsigned char* in,
-                                 size_t insize, const LodePNGDecompressSettings* settings)
+static unsigned lodepng_zlib_decompressv(ucvector* out, const unsigned char* in,
+                                         size_t insize, const LodePNGDecompressSettings* settings)
 {
   unsigned error = 0;
   unsigned CM, CINFO, FDICT;
@@ -2155,32 +2962,59 @@ unsigned lodepng_zlib_decompress(unsigned char** out, size_t* outsize, const uns
     return 26;
   }
 
-  error = inflate(out, outsize, in + 2, insize - 2, settings);
+  error = inflatev(out, in + 2, insize - 2, settings);
   if(error) return error;
 
   if(!settings->ignore_adler32)
   {
     unsigned ADLER32 = lodepng_read32bitInt(&in[insize - 4]);
-    unsigned checksum = adler32(*out, (unsigned)(*outsize));
+    unsigned checksum = adler32(out->data, (unsigned)(out->size));
     if(checksum != ADLER32) return 58; /*error, adler checksum not correct, data must be corrupted*/
   }
 
   return 0; /*no error*/
 }
 
-static unsigned zlib_decompress(unsigned char** out, size_t* outsize, const unsigned char* in,
-                                size_t insize, const LodePNGDecompressSettings* settings)
+unsigned lodepng_zlib_decompress(unsigned char** out, size_t* outsize, const unsigned char* in,
+                                 size_t insize, const LodePNGDecompressSettings* settings)
+{
+  unsigned error;
+  ucvector v;
+  ucvector_init_buffer(&v, *out, *outsize);
+  error = lodepng_zlib_decompressv(&v, in, insize, settings);
+  *out = v.data;
+  *outsize = v.size;
+  return error;
+}
+
+/*decompresses into out, keeping the memory already reserved in it*/
+static unsigned zlib_decompressv(ucvector* out, const unsigned char* in,
+                                 size_t insize, const LodePNGDecompressSettings* settings)
 {
   if(settings->custom_zlib)
   {
-    return settings->custom_zlib(out, outsize, in, insize, settings);
+    unsigned error = settings->custom_zlib(&out->data, &out->size, in, insize, settings);
+    out->allocsize = out->size;
+    return error;
   }
   else
   {
-    return lodepng_zlib_decompress(out, outsize, in, insize, settings);
+    return lodepng_zlib_decompressv(out, in, insize, settings);
   }
 }
 
+static unsigned zlib_decompress(unsigned char** out, size_t* outsize, const unsigned char* in,
+                                size_t insize, const LodePNGDecompressSettings* settings)
+{
+  unsigned error;
+  ucvector v;
+  ucvector_init_buffer(&v, *out, *outsize);
+  error = zlib_decompressv(&v, in, insize, settings);
+  *out = v.data;
+  *outsize = v.size;
+  return error;
+}
+
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 #ifdef LODEPNG_COMPILE_ENCODER
@@ -2251,6 +3085,14 @@ static unsigned zlib_decompress(unsigned char** out, size_t* outsize, const unsi
   if(!settings->custom_zlib) return 87; /*no custom zlib function provided */
   return settings->custom_zlib(out, outsize, in, insize, settings);
 }
+
+static unsigned zlib_decompressv(ucvector* out, const unsigned char* in,
+                                 size_t insize, const LodePNGDecompressSettings* settings)
+{
+  unsigned error = zlib_decompress(&out->data, &out->size, in, insize, settings);
+  out->allocsize = out->size;
+  return error;
+}
 #endif /*LODEPNG_COMPILE_DECODER*/
 #ifdef LODEPNG_COMPILE_ENCODER
 static unsigned zlib_compress(unsigned char** out, size_t* outsize, const unsigned char* in,
@@ -2279,13 +3121,37 @@ void lodepng_compress_settings_init(LodePNGCompressSettings* settings)
   settings->minmatch = 3;
   settings->nicematch = 128;
   settings->lazymatching = 1;
+  settings->fastlz77 = 0;
+  settings->numthreads = 1;
 
   settings->custom_zlib = 0;
   settings->custom_deflate = 0;
   settings->custom_context = 0;
 }
 
-const LodePNGCompressSettings lodepng_default_compress_settings = {2, 1, DEFAULT_WINDOWSIZE, 3, 128, 1, 0, 0, 0};
+const LodePNGCompressSettings lodepng_default_compress_settings = {2, 1, DEFAULT_WINDOWSIZE, 3, 128, 1, 0, 1, 0, 0, 0};
+
+void lodepng_compress_settings_set_level(LodePNGCompressSettings* settings, unsigned level)
+{
+  /*windowsize, nicematch, lazymatching and fastlz77 of each level. Level 6 is the default.
+  fastlz77 ignores the others but the window, which barely matters to it: 1 and 2 are the same.*/
+  static const unsigned LEVELS[10][4] = {
+    {0, 0, 0, 0}, /*stored, see below*/
+    {32768, 258, 0, 1}, {32768, 258, 0, 1},
+    {1024, 16, 0, 0}, {2048, 64, 0, 0}, {2048, 64, 1, 0}, {DEFAULT_WINDOWSIZE, 128, 1, 0},
+    {8192, 128, 1, 0}, {16384, 258, 1, 0}, {32768, 258, 1, 0}
+  };
+  if(level > 9) level = 9;
+
+  settings->btype = level == 0 ? 0 : 2;
+  settings->use_lz77 = 1;
+  settings->minmatch = 3;
+  if(level == 0) return;
+  settings->windowsize = LEVELS[level][0];
+  settings->nicematch = LEVELS[level][1];
+  settings->lazymatching = LEVELS[level][2];
+  settings->fastlz77 = LEVELS[level][3];
+}
 
 
 #endif /*LODEPNG_COMPILE_ENCODER*/
@@ -2319,50 +3185,391 @@ const LodePNGDecompressSettings lodepng_default_decompress_settings = {0, 0, 0,
 
 
 #ifndef LODEPNG_NO_COMPILE_CRC
-/* CRC polynomial: 0xedb88320 */
-static unsigned lodepng_crc32_table[256] = {
-           0u, 1996959894u, 3993919788u, 2567524794u,  124634137u, 1886057615u, 3915621685u, 2657392035u,
-   249268274u, 2044508324u, 3772115230u, 2547177864u,  162941995u, 2125561021u, 3887607047u, 2428444049u,
-   498536548u, 1789927666u, 4089016648u, 2227061214u,  450548861u, 1843258603u, 4107580753u, 2211677639u,
-   325883990u, 1684777152u, 4251122042u, 2321926636u,  335633487u, 1661365465u, 4195302755u, 2366115317u,
-   997073096u, 1281953886u, 3579855332u, 2724688242u, 1006888145u, 1258607687u, 3524101629u, 2768942443u,
-   901097722u, 1119000684u, 3686517206u, 2898065728u,  853044451u, 1172266101u, 3705015759u, 2882616665u,
-   651767980u, 1373503546u, 3369554304u, 3218104598u,  565507253u, 1454621731u, 3485111705u, 3099436303u,
-   671266974u, 1594198024u, 3322730930u, 2970347812u,  795835527u, 1483230225u, 3244367275u, 3060149565u,
-  1994146192u,   31158534u, 2563907772u, 4023717930u, 1907459465u,  112637215u, 2680153253u, 3904427059u,
-  2013776290u,  251722036u, 2517215374u, 3775830040u, 2137656763u,  141376813u, 2439277719u, 3865271297u,
-  1802195444u,  476864866u, 2238001368u, 4066508878u, 1812370925u,  453092731u, 2181625025u, 4111451223u,
-  1706088902u,  314042704u, 2344532202u, 4240017532u, 1658658271u,  366619977u, 2362670323u, 4224994405u,
-  1303535960u,  984961486u, 2747007092u, 3569037538u, 1256170817u, 1037604311u, 2765210733u, 3554079995u,
-  1131014506u,  879679996u, 2909243462u, 3663771856u, 1141124467u,  855842277u, 2852801631u, 3708648649u,
-  1342533948u,  654459306u, 3188396048u, 3373015174u, 1466479909u,  544179635u, 3110523913u, 3462522015u,
-  1591671054u,  702138776u, 2966460450u, 3352799412u, 1504918807u,  783551873u, 3082640443u, 3233442989u,
-  3988292384u, 2596254646u,   62317068u, 1957810842u, 3939845945u, 2647816111u,   81470997u, 1943803523u,
-  3814918930u, 2489596804u,  225274430u, 2053790376u, 3826175755u, 2466906013u,  167816743u, 2097651377u,
-  4027552580u, 2265490386u,  503444072u, 1762050814u, 4150417245u, 2154129355u,  426522225u, 1852507879u,
-  4275313526u, 2312317920u,  282753626u, 1742555852u, 4189708143u, 2394877945u,  397917763u, 1622183637u,
-  3604390888u, 2714866558u,  953729732u, 1340076626u, 3518719985u, 2797360999u, 1068828381u, 1219638859u,
-  3624741850u, 2936675148u,  906185462u, 1090812512u, 3747672003u, 2825379669u,  829329135u, 1181335161u,
-  3412177804u, 3160834842u,  628085408u, 1382605366u, 3423369109u, 3138078467u,  570562233u, 1426400815u,
-  3317316542u, 2998733608u,  733239954u, 1555261956u, 3268935591u, 3050360625u,  752459403u, 1541320221u,
-  2607071920u, 3965973030u, 1969922972u,   40735498u, 2617837225u, 3943577151u, 1913087877u,   83908371u,
-  2512341634u, 3803740692u, 2075208622u,  213261112u, 2463272603u, 3855990285u, 2094854071u,  198958881u,
-  2262029012u, 4057260610u, 1759359992u,  534414190u, 2176718541u, 4139329115u, 1873836001u,  414664567u,
-  2282248934u, 4279200368u, 1711684554u,  285281116u, 2405801727u, 4167216745u, 1634467795u,  376229701u,
-  2685067896u, 3608007406u, 1308918612u,  956543938u, 2808555105u, 3495958263u, 1231636301u, 1047427035u,
-  2932959818u, 3654703836u, 1088359270u,  936918000u, 2847714899u, 3736837829u, 1202900863u,  817233897u,
-  3183342108u, 3401237130u, 1404277552u,  615818150u, 3134207493u, 3453421203u, 1423857449u,  601450431u,
-  3009837614u, 3294710456u, 1567103746u,  711928724u, 3020668471u, 3272380065u, 1510334235u,  755167117u
+/*
+CRC polynomial: 0xedb88320. lodepng_crc32_table[0] is the usual byte at a time
+table, lodepng_crc32_table[k][n] is the CRC of byte n followed by k zero bytes,
+for slicing by 8 bytes.
+*/
+static const unsigned lodepng_crc32_table[8][256] = {
+  {
+             0u, 1996959894u, 3993919788u, 2567524794u,  124634137u, 1886057615u, 3915621685u, 2657392035u,
+     249268274u, 2044508324u, 3772115230u, 2547177864u,  162941995u, 2125561021u, 3887607047u, 2428444049u,
+     498536548u, 1789927666u, 4089016648u, 2227061214u,  450548861u, 1843258603u, 4107580753u, 2211677639u,
+     325883990u, 1684777152u, 4251122042u, 2321926636u,  335633487u, 1661365465u, 4195302755u, 2366115317u,
+     997073096u, 1281953886u, 3579855332u, 2724688242u, 1006888145u, 1258607687u, 3524101629u, 2768942443u,
+     901097722u, 1119000684u, 3686517206u, 2898065728u,  853044451u, 1172266101u, 3705015759u, 2882616665u,
+     651767980u, 1373503546u, 3369554304u, 3218104598u,  565507253u, 1454621731u, 3485111705u, 3099436303u,
+     671266974u, 1594198024u, 3322730930u, 2970347812u,  795835527u, 1483230225u, 3244367275u, 3060149565u,
+    1994146192u,   31158534u, 2563907772u, 4023717930u, 1907459465u,  112637215u, 2680153253u, 3904427059u,
+    2013776290u,  251722036u, 2517215374u, 3775830040u, 2137656763u,  141376813u, 2439277719u, 3865271297u,
+    1802195444u,  476864866u, 2238001368u, 4066508878u, 1812370925u,  453092731u, 2181625025u, 4111451223u,
+    1706088902u,  314042704u, 2344532202u, 4240017532u, 1658658271u,  366619977u, 2362670323u, 4224994405u,
+    1303535960u,  984961486u, 2747007092u, 3569037538u, 1256170817u, 1037604311u, 2765210733u, 3554079995u,
+    1131014506u,  879679996u, 2909243462u, 3663771856u, 1141124467u,  855842277u, 2852801631u, 3708648649u,
+    1342533948u,  654459306u, 3188396048u, 3373015174u, 1466479909u,  544179635u, 3110523913u, 3462522015u,
+    1591671054u,  702138776u, 2966460450u, 3352799412u, 1504918807u,  783551873u, 3082640443u, 3233442989u,
+    3988292384u, 2596254646u,   62317068u, 1957810842u, 3939845945u, 2647816111u,   81470997u, 1943803523u,
+    3814918930u, 2489596804u,  225274430u, 2053790376u, 3826175755u, 2466906013u,  167816743u, 2097651377u,
+    4027552580u, 2265490386u,  503444072u, 1762050814u, 4150417245u, 2154129355u,  426522225u, 1852507879u,
+    4275313526u, 2312317920u,  282753626u, 1742555852u, 4189708143u, 2394877945u,  397917763u, 1622183637u,
+    3604390888u, 2714866558u,  953729732u, 1340076626u, 3518719985u, 2797360999u, 1068828381u, 1219638859u,
+    3624741850u, 2936675148u,  906185462u, 1090812512u, 3747672003u, 2825379669u,  829329135u, 1181335161u,
+    3412177804u, 3160834842u,  628085408u, 1382605366u, 3423369109u, 3138078467u,  570562233u, 1426400815u,
+    3317316542u, 2998733608u,  733239954u, 1555261956u, 3268935591u, 3050360625u,  752459403u, 1541320221u,
+    2607071920u, 3965973030u, 1969922972u,   40735498u, 2617837225u, 3943577151u, 1913087877u,   83908371u,
+    2512341634u, 3803740692u, 2075208622u,  213261112u, 2463272603u, 3855990285u, 2094854071u,  198958881u,
+    2262029012u, 4057260610u, 1759359992u,  534414190u, 2176718541u, 4139329115u, 1873836001u,  414664567u,
+    2282248934u, 4279200368u, 1711684554u,  285281116u, 2405801727u, 4167216745u, 1634467795u,  376229701u,
+    2685067896u, 3608007406u, 1308918612u,  956543938u, 2808555105u, 3495958263u, 1231636301u, 1047427035u,
+    2932959818u, 3654703836u, 1088359270u,  936918000u, 2847714899u, 3736837829u, 1202900863u,  817233897u,
+    3183342108u, 3401237130u, 1404277552u,  615818150u, 3134207493u, 3453421203u, 1423857449u,  601450431u,
+    3009837614u, 3294710456u, 1567103746u,  711928724u, 3020668471u, 3272380065u, 1510334235u,  755167117u
+  },
+  {
+             0u,  421212481u,  842424962u,  724390851u, 1684849924u, 2105013317u, 1448781702u, 1329698503u,
+    3369699848u, 3519200073u, 4210026634u, 3824474571u, 2897563404u, 3048111693u, 2659397006u, 2274893007u,
+    1254232657u, 1406739216u, 2029285587u, 1643069842u,  783210325u,  934667796u,  479770071u,   92505238u,
+    2182846553u, 2600511768u, 2955803355u, 2838940570u, 3866582365u, 4285295644u, 3561045983u, 3445231262u,
+    2508465314u, 2359236067u, 2813478432u, 3198777185u, 4058571174u, 3908292839u, 3286139684u, 3670389349u,
+    1566420650u, 1145479147u, 1869335592u, 1987116393u,  959540142u,  539646703u,  185010476u,  303839341u,
+    3745920755u, 3327985586u, 3983561841u, 4100678960u, 3140154359u, 2721170102u, 2300350837u, 2416418868u,
+     396344571u,  243568058u,  631889529u, 1018359608u, 1945336319u, 1793607870u, 1103436669u, 1490954812u,
+    4034481925u, 3915546180u, 3259968903u, 3679722694u, 2484439553u, 2366552896u, 2787371139u, 3208174018u,
+     950060301u,  565965900u,  177645455u,  328046286u, 1556873225u, 1171730760u, 1861902987u, 2011255754u,
+    3132841300u, 2745199637u, 2290958294u, 2442530455u, 3738671184u, 3352078609u, 3974232786u, 4126854035u,
+    1919080284u, 1803150877u, 1079293406u, 1498383519u,  370020952u,  253043481u,  607678682u, 1025720731u,
+    1711106983u, 2095471334u, 1472923941u, 1322268772u,   26324643u,  411738082u,  866634785u,  717028704u,
+    2904875439u, 3024081134u, 2668790573u, 2248782444u, 3376948395u, 3495106026u, 4219356713u, 3798300520u,
+     792689142u,  908347575u,  487136116u,   68299317u, 1263779058u, 1380486579u, 2036719216u, 1618931505u,
+    3890672638u, 4278043327u, 3587215740u, 3435896893u, 2206873338u, 2593195963u, 2981909624u, 2829542713u,
+     998479947u,  580430090u,  162921161u,  279890824u, 1609522511u, 1190423566u, 1842954189u, 1958874764u,
+    4082766403u, 3930137346u, 3245109441u, 3631694208u, 2536953671u, 2385372678u, 2768287173u, 3155920004u,
+    1900120602u, 1750776667u, 1131931800u, 1517083097u,  355290910u,  204897887u,  656092572u, 1040194781u,
+    3113746450u, 2692952403u, 2343461520u, 2461357009u, 3723805974u, 3304059991u, 4022511508u, 4141455061u,
+    2919742697u, 3072101800u, 2620513899u, 2234183466u, 3396041197u, 3547351212u, 4166851439u, 3779471918u,
+    1725839073u, 2143618976u, 1424512099u, 1307796770u,   45282277u,  464110244u,  813994343u,  698327078u,
+    3838160568u, 4259225593u, 3606301754u, 3488152955u, 2158586812u, 2578602749u, 2996767038u, 2877569151u,
+     740041904u,  889656817u,  506086962u,  120682355u, 1215357364u, 1366020341u, 2051441462u, 1667084919u,
+    3422213966u, 3538019855u, 4190942668u, 3772220557u, 2945847882u, 3062702859u, 2644537544u, 2226864521u,
+      52649286u,  439905287u,  823476164u,  672009861u, 1733269570u, 2119477507u, 1434057408u, 1281543041u,
+    2167981343u, 2552493150u, 3004082077u, 2853541596u, 3847487515u, 4233048410u, 3613549209u, 3464057816u,
+    1239502615u, 1358593622u, 2077699477u, 1657543892u,  764250643u,  882293586u,  532408465u,  111204816u,
+    1585378284u, 1197851309u, 1816695150u, 1968414767u,  974272232u,  587794345u,  136598634u,  289367339u,
+    2527558116u, 2411481253u, 2760973158u, 3179948583u, 4073438432u, 3956313505u, 3237863010u, 3655790371u,
+     347922877u,  229101820u,  646611775u, 1066513022u, 1892689081u, 1774917112u, 1122387515u, 1543337850u,
+    3697634229u, 3313392372u, 3998419255u, 4148705398u, 3087642289u, 2702352368u, 2319436851u, 2468674930u
+  },
+  {
+             0u,   29518391u,   59036782u,   38190681u,  118073564u,  114017003u,   76381362u,   89069189u,
+     236147128u,  265370511u,  228034006u,  206958561u,  152762724u,  148411219u,  178138378u,  190596925u,
+     472294256u,  501532999u,  530741022u,  509615401u,  456068012u,  451764635u,  413917122u,  426358261u,
+     305525448u,  334993663u,  296822438u,  275991697u,  356276756u,  352202787u,  381193850u,  393929805u,
+     944588512u,  965684439u, 1003065998u,  973863097u, 1061482044u, 1049003019u, 1019230802u, 1023561829u,
+     912136024u,  933002607u,  903529270u,  874031361u,  827834244u,  815125939u,  852716522u,  856752605u,
+     611050896u,  631869351u,  669987326u,  640506825u,  593644876u,  580921211u,  551983394u,  556069653u,
+     712553512u,  733666847u,  704405574u,  675154545u,  762387700u,  749958851u,  787859610u,  792175277u,
+    1889177024u, 1901651959u, 1931368878u, 1927033753u, 2006131996u, 1985040171u, 1947726194u, 1976933189u,
+    2122964088u, 2135668303u, 2098006038u, 2093965857u, 2038461604u, 2017599123u, 2047123658u, 2076625661u,
+    1824272048u, 1836991623u, 1866005214u, 1861914857u, 1807058540u, 1786244187u, 1748062722u, 1777547317u,
+    1655668488u, 1668093247u, 1630251878u, 1625932113u, 1705433044u, 1684323811u, 1713505210u, 1742760333u,
+    1222101792u, 1226154263u, 1263738702u, 1251046777u, 1339974652u, 1310460363u, 1281013650u, 1301863845u,
+    1187289752u, 1191637167u, 1161842422u, 1149379777u, 1103966788u, 1074747507u, 1112139306u, 1133218845u,
+    1425107024u, 1429406311u, 1467333694u, 1454888457u, 1408811148u, 1379576507u, 1350309090u, 1371438805u,
+    1524775400u, 1528845279u, 1499917702u, 1487177649u, 1575719220u, 1546255107u, 1584350554u, 1605185389u,
+    3778354048u, 3774312887u, 3803303918u, 3816007129u, 3862737756u, 3892238699u, 3854067506u, 3833203973u,
+    4012263992u, 4007927823u, 3970080342u, 3982554209u, 3895452388u, 3924658387u, 3953866378u, 3932773565u,
+    4245928176u, 4241609415u, 4271336606u, 4283762345u, 4196012076u, 4225268251u, 4187931714u, 4166823541u,
+    4076923208u, 4072833919u, 4035198246u, 4047918865u, 4094247316u, 4123732899u, 4153251322u, 4132437965u,
+    3648544096u, 3636082519u, 3673983246u, 3678331705u, 3732010428u, 3753090955u, 3723829714u, 3694611429u,
+    3614117080u, 3601426159u, 3572488374u, 3576541825u, 3496125444u, 3516976691u, 3555094634u, 3525581405u,
+    3311336976u, 3298595879u, 3336186494u, 3340255305u, 3260503756u, 3281337595u, 3251864226u, 3222399125u,
+    3410866088u, 3398419871u, 3368647622u, 3372945905u, 3427010420u, 3448139075u, 3485520666u, 3456284973u,
+    2444203584u, 2423127159u, 2452308526u, 2481530905u, 2527477404u, 2539934891u, 2502093554u, 2497740997u,
+    2679949304u, 2659102159u, 2620920726u, 2650438049u, 2562027300u, 2574714131u, 2603727690u, 2599670141u,
+    2374579504u, 2353749767u, 2383274334u, 2412743529u, 2323684844u, 2336421851u, 2298759554u, 2294686645u,
+    2207933576u, 2186809023u, 2149495014u, 2178734801u, 2224278612u, 2236720739u, 2266437690u, 2262135309u,
+    2850214048u, 2820717207u, 2858812622u, 2879680249u, 2934667388u, 2938704459u, 2909776914u, 2897069605u,
+    2817622296u, 2788420399u, 2759153014u, 2780249921u, 2700618180u, 2704950259u, 2742877610u, 2730399645u,
+    3049550800u, 3020298727u, 3057690558u, 3078802825u, 2999835404u, 3004150075u, 2974355298u, 2961925461u,
+    3151438440u, 3121956959u, 3092510214u, 3113327665u, 3168701108u, 3172786307u, 3210370778u, 3197646061u
+  },
+  {
+             0u, 3099354981u, 2852767883u,  313896942u, 2405603159u,  937357362u,  627793884u, 2648127673u,
+    3316918511u, 2097696650u, 1874714724u, 3607201537u, 1255587768u, 4067088605u, 3772741427u, 1482887254u,
+    1343838111u, 3903140090u, 4195393300u, 1118632049u, 3749429448u, 1741137837u, 1970407491u, 3452858150u,
+    2511175536u,  756094997u, 1067759611u, 2266550430u,  449832999u, 2725482306u, 2965774508u,  142231497u,
+    2687676222u,  412010587u,  171665333u, 2995192016u,  793786473u, 2548850444u, 2237264098u, 1038456711u,
+    1703315409u, 3711623348u, 3482275674u, 1999841343u, 3940814982u, 1381529571u, 1089329165u, 4166106984u,
+    4029413537u, 1217896388u, 1512189994u, 3802027855u, 2135519222u, 3354724499u, 3577784189u, 1845280792u,
+     899665998u, 2367928107u, 2677414085u,  657096608u, 3137160985u,   37822588u,  284462994u, 2823350519u,
+    2601801789u,  598228824u,  824021174u, 2309093331u,  343330666u, 2898962447u, 3195996129u,  113467524u,
+    1587572946u, 3860600759u, 4104763481u, 1276501820u, 3519211397u, 1769898208u, 2076913422u, 3279374443u,
+    3406630818u, 1941006535u, 1627703081u, 3652755532u, 1148164341u, 4241751952u, 3999682686u, 1457141531u,
+     247015245u, 3053797416u, 2763059142u,  470583459u, 2178658330u,  963106687u,  735213713u, 2473467892u,
+     992409347u, 2207944806u, 2435792776u,  697522413u, 3024379988u,  217581361u,  508405983u, 2800865210u,
+    4271038444u, 1177467017u, 1419450215u, 3962007554u, 1911572667u, 3377213406u, 3690561584u, 1665525589u,
+    1799331996u, 3548628985u, 3241568279u, 2039091058u, 3831314379u, 1558270126u, 1314193216u, 4142438437u,
+    2928380019u,  372764438u,   75645176u, 3158189981u,  568925988u, 2572515393u, 2346768303u,  861712586u,
+    3982079547u, 1441124702u, 1196457648u, 4293663189u, 1648042348u, 3666298377u, 3358779879u, 1888390786u,
+     686661332u, 2421291441u, 2196002399u,  978858298u, 2811169155u,  523464422u,  226935048u, 3040519789u,
+    3175145892u,  100435649u,  390670639u, 2952089162u,  841119475u, 2325614998u, 2553003640u,  546822429u,
+    2029308235u, 3225988654u, 3539796416u, 1782671013u, 4153826844u, 1328167289u, 1570739863u, 3844338162u,
+    1298864389u, 4124540512u, 3882013070u, 1608431339u, 3255406162u, 2058742071u, 1744848601u, 3501990332u,
+    2296328682u,  811816591u,  584513889u, 2590678532u,  129869501u, 3204563416u, 2914283062u,  352848211u,
+     494030490u, 2781751807u, 3078325777u,  264757620u, 2450577869u,  715964072u,  941166918u, 2158327331u,
+    3636881013u, 1618608400u, 1926213374u, 3396585883u, 1470427426u, 4011365959u, 4255988137u, 1158766284u,
+    1984818694u, 3471935843u, 3695453837u, 1693991400u, 4180638033u, 1100160564u, 1395044826u, 3952793279u,
+    3019491049u,  189112716u,  435162722u, 2706139399u, 1016811966u, 2217162459u, 2526189877u,  774831696u,
+     643086745u, 2666061564u, 2354934034u,  887166583u, 2838900430u,  294275499u,   54519365u, 3145957664u,
+    3823145334u, 1532818963u, 1240029693u, 4048895640u, 1820460577u, 3560857924u, 3331051178u, 2117577167u,
+    3598663992u, 1858283101u, 2088143283u, 3301633750u, 1495127663u, 3785470218u, 4078182116u, 1269332353u,
+     332098007u, 2876706482u, 3116540252u,   25085497u, 2628386432u,  605395429u,  916469259u, 2384220526u,
+    2254837415u, 1054503362u,  745528876u, 2496903497u,  151290352u, 2981684885u, 2735556987u,  464596510u,
+    1137851976u, 4218313005u, 3923506883u, 1365741990u, 3434129695u, 1946996346u, 1723425172u, 3724871409u
+  },
+  {
+             0u, 1029712304u, 2059424608u, 1201699536u, 4118849216u, 3370159984u, 2403399072u, 2988497936u,
+     812665793u,  219177585u, 1253054625u, 2010132753u, 3320900865u, 4170237105u, 3207642721u, 2186319825u,
+    1625331586u, 1568718386u,  438355170u,  658566482u, 2506109250u, 2818578674u, 4020265506u, 3535817618u,
+    1351670851u, 1844508147u,  709922595u,  389064339u, 2769320579u, 2557498163u, 3754961379u, 3803185235u,
+    3250663172u, 4238411444u, 3137436772u, 2254525908u,  876710340u,  153198708u, 1317132964u, 1944187668u,
+    4054934725u, 3436268917u, 2339452837u, 3054575125u,   70369797u,  961670069u, 2129760613u, 1133623509u,
+    2703341702u, 2621542710u, 3689016294u, 3867263574u, 1419845190u, 1774270454u,  778128678u,  318858390u,
+    2438067015u, 2888948471u, 3952189479u, 3606153623u, 1691440519u, 1504803895u,  504432359u,  594620247u,
+    1492342857u, 1704161785u,  573770537u,  525542041u, 2910060169u, 2417219385u, 3618876905u, 3939730521u,
+    1753420680u, 1440954936u,  306397416u,  790849880u, 2634265928u, 2690882808u, 3888375336u, 3668168600u,
+     940822475u,   91481723u, 1121164459u, 2142483739u, 3448989963u, 4042473659u, 3075684971u, 2318603227u,
+     140739594u,  889433530u, 1923340138u, 1338244826u, 4259521226u, 3229813626u, 2267247018u, 3124975642u,
+    2570221389u, 2756861693u, 3824297005u, 3734113693u, 1823658381u, 1372780605u,  376603373u,  722643805u,
+    2839690380u, 2485261628u, 3548540908u, 4007806556u, 1556257356u, 1638052860u,  637716780u,  459464860u,
+    4191346895u, 3300051327u, 2199040943u, 3195181599u,  206718479u,  825388991u, 1989285231u, 1274166495u,
+    3382881038u, 4106388158u, 3009607790u, 2382549470u, 1008864718u,   21111934u, 1189240494u, 2072147742u,
+    2984685714u, 2357631266u, 3408323570u, 4131834434u, 1147541074u, 2030452706u, 1051084082u,   63335554u,
+    2174155603u, 3170292451u, 4216760371u, 3325460867u, 1947622803u, 1232499747u,  248909555u,  867575619u,
+    3506841360u, 3966111392u, 2881909872u, 2527485376u,  612794832u,  434546784u, 1581699760u, 1663499008u,
+    3782634705u, 3692447073u, 2612412337u, 2799048193u,  351717905u,  697754529u, 1849071985u, 1398190273u,
+    1881644950u, 1296545318u,  182963446u,  931652934u, 2242328918u, 3100053734u, 4284967478u, 3255255942u,
+    1079497815u, 2100821479u,  983009079u,  133672583u, 3050795671u, 2293717799u, 3474399735u, 4067887175u,
+     281479188u,  765927844u, 1778867060u, 1466397380u, 3846680276u, 3626469220u, 2676489652u, 2733102084u,
+     548881365u,  500656741u, 1517752501u, 1729575173u, 3577210133u, 3898068133u, 2952246901u, 2459410373u,
+    3910527195u, 3564487019u, 2480257979u, 2931134987u,  479546907u,  569730987u, 1716854139u, 1530213579u,
+    3647316762u, 3825568426u, 2745561210u, 2663766474u,  753206746u,  293940330u, 1445287610u, 1799716618u,
+    2314567513u, 3029685993u, 4080348217u, 3461678473u, 2088098201u, 1091956777u,  112560889u, 1003856713u,
+    3112514712u, 2229607720u, 3276105720u, 4263857736u, 1275433560u, 1902492648u,  918929720u,  195422344u,
+     685033439u,  364179055u, 1377080511u, 1869921551u, 3713294623u, 3761522863u, 2811507327u, 2599689167u,
+     413436958u,  633644462u, 1650777982u, 1594160846u, 3978570462u, 3494118254u, 2548332990u, 2860797966u,
+    1211387997u, 1968470509u,  854852413u,  261368461u, 3182753437u, 2161434413u, 3346310653u, 4195650637u,
+    2017729436u, 1160000044u,   42223868u, 1071931724u, 2378480988u, 2963576044u, 4144295484u, 3395602316u
+  },
+  {
+             0u, 3411858341u, 1304994059u, 2257875630u, 2609988118u, 1355649459u, 3596215069u,  486879416u,
+    3964895853u,  655315400u, 2711298918u, 1791488195u, 2009251963u, 3164476382u,  973758832u, 4048990933u,
+      64357019u, 3364540734u, 1310630800u, 2235723829u, 2554806413u, 1394316072u, 3582976390u,  517157411u,
+    4018503926u,  618222419u, 2722963965u, 1762783832u, 1947517664u, 3209171269u,  970744811u, 4068520014u,
+     128714038u, 3438335635u, 1248109629u, 2167961496u, 2621261600u, 1466012805u, 3522553387u,  447296910u,
+    3959392091u,  547575038u, 2788632144u, 1835791861u, 1886307661u, 3140622056u, 1034314822u, 4143626211u,
+      75106221u, 3475428360u, 1236444838u, 2196665603u, 2682996155u, 1421317662u, 3525567664u,  427767573u,
+    3895035328u,  594892389u, 2782995659u, 1857943406u, 1941489622u, 3101955187u, 1047553757u, 4113347960u,
+     257428076u, 3288652233u, 1116777319u, 2311878850u, 2496219258u, 1603640287u, 3640781169u,  308099796u,
+    3809183745u,  676813732u, 2932025610u, 1704983215u, 2023410199u, 3016104370u,  894593820u, 4262377657u,
+     210634999u, 3352484690u, 1095150076u, 2316991065u, 2535410401u, 1547934020u, 3671583722u,  294336591u,
+    3772615322u,  729897279u, 2903845777u, 1716123700u, 2068629644u, 2953845545u,  914647431u, 4258839074u,
+     150212442u, 3282623743u, 1161604689u, 2388688372u, 2472889676u, 1480171241u, 3735940167u,  368132066u,
+    3836185911u,  805002898u, 2842635324u, 1647574937u, 2134298401u, 3026852996u,  855535146u, 4188192143u,
+     186781121u, 3229539940u, 1189784778u, 2377547631u, 2427670487u, 1542429810u, 3715886812u,  371670393u,
+    3882979244u,  741170185u, 2864262823u, 1642462466u, 2095107514u, 3082559007u,  824732849u, 4201955092u,
+     514856152u, 3589064573u, 1400419795u, 2552522358u, 2233554638u, 1316849003u, 3370776517u,   62202976u,
+    4075001525u,  968836368u, 3207280574u, 1954014235u, 1769133219u, 2720925446u,  616199592u, 4024870413u,
+     493229635u, 3594175974u, 1353627464u, 2616354029u, 2264355925u, 1303087088u, 3409966430u,    6498043u,
+    4046820398u,  979978123u, 3170710821u, 2007099008u, 1789187640u, 2717386141u,  661419827u, 3962610838u,
+     421269998u, 3527459403u, 1423225061u, 2676515648u, 2190300152u, 1238466653u, 3477467891u,   68755798u,
+    4115633027u, 1041448998u, 3095868040u, 1943789869u, 1860096405u, 2776760880u,  588673182u, 3897205563u,
+     449450869u, 3516317904u, 1459794558u, 2623431131u, 2170245475u, 1242006214u, 3432247400u,  131015629u,
+    4137259288u, 1036337853u, 3142660115u, 1879958454u, 1829294862u, 2790523051u,  549483013u, 3952910752u,
+     300424884u, 3669282065u, 1545650111u, 2541513754u, 2323209378u, 1092980487u, 3350330793u,  216870412u,
+    4256931033u,  921128828u, 2960342482u, 2066738807u, 1714085583u, 2910195050u,  736264132u, 3770592353u,
+     306060335u, 3647131530u, 1610005796u, 2494197377u, 2309971513u, 1123257756u, 3295149874u,  255536279u,
+    4268596802u,  892423655u, 3013951305u, 2029645036u, 1711070292u, 2929725425u,  674528607u, 3815288570u,
+     373562242u, 3709388839u, 1535949449u, 2429577516u, 2379569556u, 1183418929u, 3223189663u,  188820282u,
+    4195850735u,  827017802u, 3084859620u, 2089020225u, 1636228089u, 2866415708u,  743340786u, 3876759895u,
+     361896217u, 3738094268u, 1482340370u, 2466671543u, 2382584591u, 1163888810u, 3284924932u,  144124321u,
+    4190215028u,  849168593u, 3020503679u, 2136336858u, 1649465698u, 2836138695u,  798521449u, 3838094284u
+  },
+  {
+             0u, 2792819636u, 2543784233u,  837294749u, 4098827283u, 1379413927u, 1674589498u, 3316072078u,
+     871321191u, 2509784531u, 2758827854u,   34034938u, 3349178996u, 1641505216u, 1346337629u, 4131942633u,
+    1742642382u, 3249117050u, 4030828007u, 1446413907u, 2475800797u,  904311657u,   68069876u, 2725880384u,
+    1412551337u, 4064729373u, 3283010432u, 1708771380u, 2692675258u,  101317902u,  937551763u, 2442587175u,
+    3485284764u, 1774858792u, 1478633653u, 4266992385u, 1005723023u, 2642744891u, 2892827814u,  169477906u,
+    4233263099u, 1512406095u, 1808623314u, 3451546982u,  136139752u, 2926205020u, 2676114113u,  972376437u,
+    2825102674u,  236236518u, 1073525883u, 2576072655u, 1546420545u, 4200303349u, 3417542760u, 1841601500u,
+    2609703733u, 1039917185u,  202635804u, 2858742184u, 1875103526u, 3384067218u, 4166835727u, 1579931067u,
+    1141601657u, 3799809741u, 3549717584u, 1977839588u, 2957267306u,  372464350u,  668680259u, 2175552503u,
+    2011446046u, 3516084394u, 3766168119u, 1175200131u, 2209029901u,  635180217u,  338955812u, 2990736784u,
+     601221559u, 2242044419u, 3024812190u,  306049834u, 3617246628u, 1911408144u, 1074125965u, 3866285881u,
+     272279504u, 3058543716u, 2275784441u,  567459149u, 3832906691u, 1107462263u, 1944752874u, 3583875422u,
+    2343980261u,  767641425u,  472473036u, 3126744696u, 2147051766u, 3649987394u, 3899029983u, 1309766251u,
+    3092841090u,  506333494u,  801510315u, 2310084639u, 1276520081u, 3932237093u, 3683203000u, 2113813516u,
+    3966292011u, 1243601823u, 2079834370u, 3716205238u,  405271608u, 3192979340u, 2411259153u,  701492901u,
+    3750207052u, 2045810168u, 1209569125u, 4000285905u,  734575199u, 2378150379u, 3159862134u,  438345922u,
+    2283203314u,  778166598u,  529136603u, 3120492655u, 2086260449u, 3660498261u, 3955679176u, 1303499900u,
+    3153699989u,  495890209u,  744928700u, 2316418568u, 1337360518u, 3921775410u, 3626602927u, 2120129051u,
+    4022892092u, 1237286280u, 2018993941u, 3726666913u,  461853231u, 3186645403u, 2350400262u,  711936178u,
+    3693557851u, 2052076527u, 1270360434u, 3989775046u,  677911624u, 2384402428u, 3220639073u,  427820757u,
+    1202443118u, 3789347034u, 3493118535u, 1984154099u, 3018127229u,  362020041u,  612099668u, 2181885408u,
+    1950653705u, 3526596285u, 3822816288u, 1168934804u, 2148251930u,  645706414u,  395618355u, 2984485767u,
+     544559008u, 2248295444u, 3085590153u,  295523645u, 3560598451u, 1917673479u, 1134918298u, 3855773998u,
+     328860103u, 3052210803u, 2214924526u,  577903450u, 3889505748u, 1101147744u, 1883911421u, 3594338121u,
+    3424493451u, 1785369663u, 1535282850u, 4260726038u,  944946072u, 2653270060u, 2949491377u,  163225861u,
+    4294103532u, 1501944408u, 1752023237u, 3457862513u,  196998655u, 2915761739u, 2619532502u,  978710370u,
+    2881684293u,  229902577u, 1012666988u, 2586515928u, 1603020630u, 4193987810u, 3356702335u, 1852063179u,
+    2553040162u, 1046169238u,  263412747u, 2848217023u, 1818454321u, 3390333573u, 4227627032u, 1569420204u,
+      60859927u, 2782375331u, 2487203646u,  843627658u, 4159668740u, 1368951216u, 1617990445u, 3322386585u,
+     810543216u, 2520310724u, 2815490393u,   27783917u, 3288386659u, 1652017111u, 1402985802u, 4125677310u,
+    1685994201u, 3255382381u, 4091620336u, 1435902020u, 2419138250u,  910562686u,  128847843u, 2715354199u,
+    1469150398u, 4058414858u, 3222168983u, 1719234083u, 2749255853u,   94984985u,  876691844u, 2453031472u
+  },
+  {
+             0u, 3433693342u, 1109723005u, 2391738339u, 2219446010u, 1222643300u, 3329165703u,  180685081u,
+    3555007413u,  525277995u, 2445286600u, 1567235158u, 1471092047u, 2600801745u,  361370162u, 3642757804u,
+    2092642603u, 2953916853u, 1050555990u, 4063508168u, 4176560081u,  878395215u, 3134470316u, 1987983410u,
+    2942184094u, 1676945920u, 3984272867u,  567356797u,  722740324u, 3887998202u, 1764827929u, 2778407815u,
+    4185285206u,  903635656u, 3142804779u, 2012833205u, 2101111980u, 2979425330u, 1058630609u, 4088621903u,
+     714308067u, 3862526333u, 1756790430u, 2753330688u, 2933487385u, 1651734407u, 3975966820u,  542535930u,
+    2244825981u, 1231508451u, 3353891840u,  188896414u,   25648519u, 3442302233u, 1134713594u, 2399689316u,
+    1445480648u, 2592229462u,  336416693u, 3634843435u, 3529655858u,  516441772u, 2420588879u, 1559052753u,
+     698204909u, 3845636723u, 1807271312u, 2803025166u, 2916600855u, 1635634313u, 4025666410u,  593021940u,
+    4202223960u,  919787974u, 3093159461u, 1962401467u, 2117261218u, 2996361020u, 1008193759u, 4038971457u,
+    1428616134u, 2576151384u,  386135227u, 3685348389u, 3513580860u,  499580322u, 2471098945u, 1608776415u,
+    2260985971u, 1248454893u, 3303468814u,  139259792u,   42591881u, 3458459159u, 1085071860u, 2349261162u,
+    3505103035u,  474062885u, 2463016902u, 1583654744u, 1419882049u, 2550902495u,  377792828u, 3660491170u,
+      51297038u, 3483679632u, 1093385331u, 2374089965u, 2269427188u, 1273935210u, 3311514249u,  164344343u,
+    2890961296u, 1627033870u, 4000683757u,  585078387u,  672833386u, 3836780532u, 1782552599u, 2794821769u,
+    2142603813u, 3005188795u, 1032883544u, 4047146438u, 4227826911u,  928351297u, 3118105506u, 1970307900u,
+    1396409818u, 2677114180u,  287212199u, 3719594553u, 3614542624u,  467372990u, 2505346141u, 1509854403u,
+    2162073199u, 1282711281u, 3271268626u,  240228748u,   76845205u, 3359543307u, 1186043880u, 2317064054u,
+     796964081u, 3811226735u, 1839575948u, 2702160658u, 2882189835u, 1734392469u, 3924802934u,  625327592u,
+    4234522436u,  818917338u, 3191908409u, 1927981223u, 2016387518u, 3028656416u,  973776579u, 4137723485u,
+    2857232268u, 1726474002u, 3899187441u,  616751215u,  772270454u, 3803048424u, 1814228491u, 2693328533u,
+    2041117753u, 3036871847u,  999160644u, 4146592730u, 4259508931u,  826864221u, 3217552830u, 1936586016u,
+    3606501031u,  442291769u, 2496909786u, 1484378436u, 1388107869u, 2652297411u,  278519584u, 3694387134u,
+      85183762u, 3384397196u, 1194773103u, 2342308593u, 2170143720u, 1307820918u, 3279733909u,  265733131u,
+    2057717559u, 3054258089u,  948125770u, 4096344276u, 4276898253u,  843467091u, 3167309488u, 1885556270u,
+    2839764098u, 1709792284u, 3949353983u,  667704161u,  755585656u, 3785577190u, 1865176325u, 2743489947u,
+     102594076u, 3401021058u, 1144549729u, 2291298815u, 2186770662u, 1325234296u, 3228729243u,  215514885u,
+    3589828009u,  424832311u, 2547870420u, 1534552650u, 1370645331u, 2635621325u,  328688686u, 3745342640u,
+    2211456353u, 1333405183u, 3254067740u,  224338562u,  127544219u, 3408931589u, 1170156774u, 2299866232u,
+    1345666772u, 2627681866u,  303053225u, 3736746295u, 3565105198u,  416624816u, 2522494803u, 1525692365u,
+    4285207626u,  868291796u, 3176010551u, 1910772649u, 2065767088u, 3079346734u,  956571085u, 4121828691u,
+     747507711u, 3760459617u, 1856702594u, 2717976604u, 2831417605u, 1684930971u, 3940615800u,  642451174u
+  }
 };
 
+#ifdef LODEPNG_SIMD_X86
+/*
+Folds 64 bytes at a time with carry-less multiplications, as in "Fast CRC
+Computation for Generic Polynomials Using PCLMULQDQ Instruction" (Intel). The
+constants are the bit reflected ones of the paper for the CRC32 polynomial.
+length must be a multiple of 16 and at least 64. Takes and returns the CRC
+register, not inverted.
+*/
+__attribute__((target("sse2,pclmul")))
+static unsigned crc32_pclmul(unsigned r, const unsigned char* data, size_t length)
+{
+  const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596ll, 0x0154442bd4ll);
+  const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009ell, 0x01751997d0ll);
+  const __m128i k5 = _mm_set_epi64x(0, 0x0163cd6124ll);
+  const __m128i poly = _mm_set_epi64x(0x01f7011641ll, 0x01db710641ll);
+  const __m128i mask32 = _mm_setr_epi32(-1, 0, -1, 0);
+  __m128i x1 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)data), _mm_cvtsi32_si128((int)r));
+  __m128i x2 = _mm_loadu_si128((const __m128i*)(data + 16));
+  __m128i x3 = _mm_loadu_si128((const __m128i*)(data + 32));
+  __m128i x4 = _mm_loadu_si128((const __m128i*)(data + 48));
+  __m128i t;
+  data += 64;
+  length -= 64;
+
+  /*4 independent folds, the multiplications have a long latency*/
+  while(length >= 64)
+  {
+    __m128i t1 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+    __m128i t2 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+    __m128i t3 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+    __m128i t4 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k1k2, 0x11), t1);
+    x2 = _mm_xor_si128(_mm_clmulepi64_si128(x2, k1k2, 0x11), t2);
+    x3 = _mm_xor_si128(_mm_clmulepi64_si128(x3, k1k2, 0x11), t3);
+    x4 = _mm_xor_si128(_mm_clmulepi64_si128(x4, k1k2, 0x11), t4);
+    x1 = _mm_xor_si128(x1, _mm_loadu_si128((const __m128i*)data));
+    x2 = _mm_xor_si128(x2, _mm_loadu_si128((const __m128i*)(data + 16)));
+    x3 = _mm_xor_si128(x3, _mm_loadu_si128((const __m128i*)(data + 32)));
+    x4 = _mm_xor_si128(x4, _mm_loadu_si128((const __m128i*)(data + 48)));
+    data += 64;
+    length -= 64;
+  }
+
+  /*fold the 4 into one, then the remaining 16 byte blocks*/
+  t = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), t), x2);
+  t = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), t), x3);
+  t = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+  x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), t), x4);
+  while(length >= 16)
+  {
+    t = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), t);
+    x1 = _mm_xor_si128(x1, _mm_loadu_si128((const __m128i*)data));
+    data += 16;
+    length -= 16;
+  }
+
+  /*128 bits to 64*/
+  t = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), t);
+  t = _mm_srli_si128(x1, 4);
+  x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k5, 0x00);
+  x1 = _mm_xor_si128(x1, t);
+
+  /*Barrett reduction to 32 bits*/
+  t = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), poly, 0x10);
+  t = _mm_clmulepi64_si128(_mm_and_si128(t, mask32), poly, 0x00);
+  x1 = _mm_xor_si128(x1, t);
+  return (unsigned)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+}
+#endif /*LODEPNG_SIMD_X86*/
+
 /*Return the CRC of the bytes buf[0..len-1].*/
 unsigned lodepng_crc32(const unsigned char* data, size_t length)
 {
   unsigned r = 0xffffffffu;
-  size_t i;
-  for(i = 0; i < length; ++i)
-  {
-    r = lodepng_crc32_table[(r ^ data[i]) & 0xff] ^ (r >> 8);
+#ifdef LODEPNG_SIMD_X86
+  if(length >= 64 && (lodepng_cpu_features() & LODEPNG_CPU_PCLMUL))
+  {
+    size_t amount = length & ~(size_t)15;
+    r = crc32_pclmul(r, data, amount);
+    data += amount;
+    length -= amount;
+  }
+#endif /*LODEPNG_SIMD_X86*/
+  /*slicing by 8: one lookup per byte, but none depends on the previous one*/
+  while(length >= 8)
+  {
+    unsigned one = r ^ ((unsigned)data[0] | ((unsigned)data[1] << 8)
+                 | ((unsigned)data[2] << 16) | ((unsigned)data[3] << 24));
+    unsigned two = (unsigned)data[4] | ((unsigned)data[5] << 8)
+                 | ((unsigned)data[6] << 16) | ((unsigned)data[7] << 24);
+    r = lodepng_crc32_table[7][one & 0xff] ^ lodepng_crc32_table[6][(one >> 8) & 0xff]
+      ^ lodepng_crc32_table[5][(one >> 16) & 0xff] ^ lodepng_crc32_table[4][one >> 24]
+      ^ lodepng_crc32_table[3][two & 0xff] ^ lodepng_crc32_table[2][(two >> 8) & 0xff]
+      ^ lodepng_crc32_table[1][(two >> 16) & 0xff] ^ lodepng_crc32_table[0][two >> 24];
+    data += 8;
+    length -= 8;
+  }
+  while(length > 0)
+  {
+    r = lodepng_crc32_table[0][(r ^ *data++) & 0xff] ^ (r >> 8);
+    --length;
   }
   return r ^ 0xffffffffu;
 }
@@ -3288,12 +4495,198 @@ mode test cases, optimized to convert the colors much faster, when converting
 to RGBA or RGB with 8 bit per cannel. buffer must be RGBA or RGB output with
 enough memory, if has_alpha is true the output is RGBA. mode has the color mode
 of the input buffer.*/
+#ifdef LODEPNG_SIMD_X86
+/*
+Conversions to RGBA8 of the byte aligned color types, whole buffers at a time. The
+16-bit ones keep the high bytes first, then go through the 8-bit one of their type.
+*/
+typedef void (*ConvertRGBA8Func)(unsigned char* out, const unsigned char* in, size_t numpixels);
+
+__attribute__((target("ssse3")))
+static void convertRGB8_ssse3(unsigned char* out, const unsigned char* in, size_t numpixels)
+{
+  size_t i = 0;
+  const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+  const __m128i alpha = _mm_set1_epi32((int)0xff000000u);
+  /*4 pixels per load of 16 bytes, the last of the 16 pixels reads 4 bytes past them*/
+  for(; i + 18 <= numpixels; i += 16)
+  {
+    const unsigned char* p = &in[i * 3];
+    _mm_storeu_si128((__m128i*)&out[i * 4 + 0], _mm_or_si128(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p + 0)), shuffle), alpha));
+    _mm_storeu_si128((__m128i*)&out[i * 4 + 16], _mm_or_si128(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p + 12)), shuffle), alpha));
+    _mm_storeu_si128((__m128i*)&out[i * 4 + 32], _mm_or_si128(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p + 24)), shuffle), alpha));
+    _mm_storeu_si128((__m128i*)&out[i * 4 + 48], _mm_or_si128(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p + 36)), shuffle), alpha));
+  }
+  for(; i != numpixels; ++i)
+  {
+    out[i * 4 + 0] = in[i * 3 + 0];
+    out[i * 4 + 1] = in[i * 3 + 1];
+    out[i * 4 + 2] = in[i * 3 + 2];
+    out[i * 4 + 3] = 255;
+  }
+}
+
+__attribute__((target("sse2")))
+static void convertGrey8_sse2(unsigned char* out, const unsigned char* in, size_t numpixels)
+{
+  size_t i = 0;
+  const __m128i alpha = _mm_set1_epi8(-1);
+  for(; i + 16 <= numpixels; i += 16)
+  {
+    __m128i grey = _mm_loadu_si128((const __m128i*)&in[i]);
+    __m128i gg_lo = _mm_unpacklo_epi8(grey, grey), ga_lo = _mm_unpacklo_epi8(grey, alpha);
+    __m128i gg_hi = _mm_unpackhi_epi8(grey, grey), ga_hi = _mm_unpackhi_epi8(grey, alpha);
+    _mm_storeu_si128((__m128i*)&out[i * 4 + 0], _mm_unpacklo_epi16(gg_lo, ga_lo));
+    _mm_storeu_si128((__m128i*)&out[i * 4 + 16], _mm_unpackhi_epi16(gg_lo, ga_lo));
+    _mm_storeu_si128((__m128i*)&out[i * 4 + 32], _mm_unpacklo_epi16(gg_hi, ga_hi));
+    _mm_storeu_si128((__m128i*)&out[i * 4 + 48], _mm_unpackhi_epi16(gg_hi, ga_hi));
+  }
+  for(; i != numpixels; ++i)
+  {
+    out[i * 4 + 0] = out[i * 4 + 1] = out[i * 4 + 2] = in[i];
+    out[i * 4 + 3] = 255;
+  }
+}
+
+__attribute__((target("ssse3")))
+static void convertGreyAlpha8_ssse3(unsigned char* out, const unsigned char* in, size_t numpixels)
+{
+  size_t i = 0;
+  const __m128i shuffle_lo = _mm_setr_epi8(0, 0, 0, 1, 2, 2, 2, 3, 4, 4, 4, 5, 6, 6, 6, 7);
+  const __m128i shuffle_hi = _mm_setr_epi8(8, 8, 8, 9, 10, 10, 10, 11, 12, 12, 12, 13, 14, 14, 14, 15);
+  for(; i + 8 <= numpixels; i += 8)
+  {
+    __m128i ga = _mm_loadu_si128((const __m128i*)&in[i * 2]);
+    _mm_storeu_si128((__m128i*)&out[i * 4 + 0], _mm_shuffle_epi8(ga, shuffle_lo));
+    _mm_storeu_si128((__m128i*)&out[i * 4 + 16], _mm_shuffle_epi8(ga, shuffle_hi));
+  }
+  for(; i != numpixels; ++i)
+  {
+    out[i * 4 + 0] = out[i * 4 + 1] = out[i * 4 + 2] = in[i * 2 + 0];
+    out[i * 4 + 3] = in[i * 2 + 1];
+  }
+}
+
+static void convertRGBA8(unsigned char* out, const unsigned char* in, size_t numpixels)
+{
+  memcpy(out, in, numpixels * 4);
+}
+
+/*the high byte of each of the numbytes 16-bit big endian samples*/
+__attribute__((target("sse2")))
+static void keepHighBytes_sse2(unsigned char* out, const unsigned char* in, size_t numbytes)
+{
+  size_t i = 0;
+  const __m128i low = _mm_set1_epi16(0xff);
+  for(; i + 16 <= numbytes; i += 16)
+  {
+    __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i*)&in[i * 2]), low);
+    __m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i*)&in[i * 2 + 16]), low);
+    _mm_storeu_si128((__m128i*)&out[i], _mm_packus_epi16(a, b));
+  }
+  for(; i != numbytes; ++i) out[i] = in[i * 2];
+}
+
+/*16-bit samples to RGBA8, a block of pixels at a time through the 8-bit conversion of the same type*/
+static void convert16(unsigned char* out, const unsigned char* in, size_t numpixels,
+                      unsigned channels, ConvertRGBA8Func convert8)
+{
+  unsigned char block[256 * 4];
+  size_t i, n;
+  for(i = 0; i < numpixels; i += n)
+  {
+    n = numpixels - i < 256 ? numpixels - i : 256;
+    if(channels == 4) keepHighBytes_sse2(&out[i * 4], &in[i * 8], n * 4);
+    else
+    {
+      keepHighBytes_sse2(block, &in[i * channels * 2], n * channels);
+      convert8(&out[i * 4], block, n);
+    }
+  }
+}
+
+/*palette indices through a table of 256 colors, the ones past the palette black like the scalar code*/
+__attribute__((target("avx2")))
+static void convertPalette8_avx2(unsigned char* out, const unsigned char* in, size_t numpixels,
+                                 const unsigned* table)
+{
+  size_t i = 0;
+  for(; i + 8 <= numpixels; i += 8)
+  {
+    __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&in[i]));
+    _mm256_storeu_si256((__m256i*)&out[i * 4], _mm256_i32gather_epi32((const int*)table, index, 4));
+  }
+  for(; i != numpixels; ++i) memcpy(&out[i * 4], &table[in[i]], 4);
+}
+
+static void convertPalette8(unsigned char* out, const unsigned char* in, size_t numpixels,
+                            const LodePNGColorMode* mode)
+{
+  unsigned table[256];
+  size_t i;
+  const unsigned char black[4] = {0, 0, 0, 255};
+  for(i = 0; i != 256; ++i) memcpy(&table[i], i < mode->palettesize ? &mode->palette[i * 4] : black, 4);
+
+  if(lodepng_cpu_features() & LODEPNG_CPU_AVX2) convertPalette8_avx2(out, in, numpixels, table);
+  else for(i = 0; i != numpixels; ++i) memcpy(&out[i * 4], &table[in[i]], 4);
+}
+
+/*
+Converts to RGBA8 with the SIMD code for the color type, if there is one and the CPU
+has what it needs. Returns 0 if the scalar code must do it.
+*/
+static int convertRGBA8SIMD(unsigned char* out, const unsigned char* in, size_t numpixels,
+                            const LodePNGColorMode* mode)
+{
+  unsigned features = lodepng_cpu_features();
+  ConvertRGBA8Func convert8;
+  unsigned channels;
+  if(!(features & LODEPNG_CPU_SSSE3)) return 0;
+
+  switch(mode->colortype)
+  {
+    case LCT_GREY:
+      if(mode->key_defined) return 0;
+      convert8 = convertGrey8_sse2;
+      channels = 1;
+      break;
+    case LCT_RGB:
+      if(mode->key_defined) return 0;
+      convert8 = convertRGB8_ssse3;
+      channels = 3;
+      break;
+    case LCT_GREY_ALPHA:
+      convert8 = convertGreyAlpha8_ssse3;
+      channels = 2;
+      break;
+    case LCT_RGBA:
+      convert8 = convertRGBA8;
+      channels = 4;
+      break;
+    case LCT_PALETTE:
+      /*the table costs about as much as converting 64 pixels*/
+      if(mode->bitdepth != 8 || numpixels < 64) return 0;
+      convertPalette8(out, in, numpixels, mode);
+      return 1;
+    default: return 0;
+  }
+
+  if(mode->bitdepth == 8) convert8(out, in, numpixels);
+  else if(mode->bitdepth == 16) convert16(out, in, numpixels, channels, convert8);
+  else return 0;
+  return 1;
+}
+#endif /*LODEPNG_SIMD_X86*/
+
 static void getPixelColorsRGBA8(unsigned char* buffer, size_t numpixels,
                                 unsigned has_alpha, const unsigned char* in,
                                 const LodePNGColorMode* mode)
 {
   unsigned num_channels = has_alpha ? 4 : 3;
   size_t i;
+#ifdef LODEPNG_SIMD_X86
+  if(has_alpha && convertRGBA8SIMD(buffer, in, numpixels, mode)) return;
+#endif /*LODEPNG_SIMD_X86*/
   if(mode->colortype == LCT_GREY)
   {
     if(mode->bitdepth == 8)
@@ -3942,31 +5335,248 @@ unsigned lodepng_inspect(unsigned* w, unsigned* h, LodePNGState* state,
   info->filter_method = in[27];
   info->interlace_method = in[28];
 
-  if(*w == 0 || *h == 0)
+  if(*w == 0 || *h == 0)
+  {
+    CERROR_RETURN_ERROR(state->error, 93);
+  }
+
+  if(!state->decoder.ignore_crc)
+  {
+    unsigned CRC = lodepng_read32bitInt(&in[29]);
+    unsigned checksum = lodepng_crc32(&in[12], 17);
+    if(CRC != checksum)
+    {
+      CERROR_RETURN_ERROR(state->error, 57); /*invalid CRC*/
+    }
+  }
+
+  /*error: only compression method 0 is allowed in the specification*/
+  if(info->compression_method != 0) CERROR_RETURN_ERROR(state->error, 32);
+  /*error: only filter method 0 is allowed in the specification*/
+  if(info->filter_method != 0) CERROR_RETURN_ERROR(state->error, 33);
+  /*error: only interlace methods 0 and 1 exist in the specification*/
+  if(info->interlace_method > 1) CERROR_RETURN_ERROR(state->error, 34);
+
+  state->error = checkColorValidity(info->color.colortype, info->color.bitdepth);
+  return state->error;
+}
+
+#ifdef LODEPNG_SIMD_X86
+/*
+SIMD versions of the filters of unfilterScanline, same arguments. Up has no
+dependency between bytes and takes 16 or 32 at once. Sub is a prefix sum over
+the pixels, done 4 pixels at a time. Average and Paeth depend on the previous
+pixel in a way that can't be summed up, so they work on all the channels of one
+pixel at once. Everything stores exactly the bytes it reconstructed, recon may
+be scanline or just behind it.
+*/
+
+static unsigned lodepng_load32(const unsigned char* p)
+{
+  unsigned result;
+  memcpy(&result, p, 4);
+  return result;
+}
+
+/*stores the first bytewidth (3 or 4) bytes of v*/
+__attribute__((target("sse2")))
+static void storePixel_sse2(unsigned char* p, __m128i v, size_t bytewidth)
+{
+  unsigned pixel = (unsigned)_mm_cvtsi128_si32(v);
+  if(bytewidth == 4) memcpy(p, &pixel, 4);
+  else
+  {
+    memcpy(p, &pixel, 2);
+    p[2] = (unsigned char)(pixel >> 16);
+  }
+}
+
+__attribute__((target("sse2")))
+static void unfilterUp_sse2(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                            size_t length)
+{
+  size_t i = 0;
+  for(; i + 16 <= length; i += 16)
+  {
+    __m128i x = _mm_loadu_si128((const __m128i*)(scanline + i));
+    __m128i b = _mm_loadu_si128((const __m128i*)(precon + i));
+    _mm_storeu_si128((__m128i*)(recon + i), _mm_add_epi8(x, b));
+  }
+  for(; i != length; ++i) recon[i] = scanline[i] + precon[i];
+}
+
+__attribute__((target("avx2")))
+static void unfilterUp_avx2(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                            size_t length)
+{
+  size_t i = 0;
+  for(; i + 32 <= length; i += 32)
+  {
+    __m256i x = _mm256_loadu_si256((const __m256i*)(scanline + i));
+    __m256i b = _mm256_loadu_si256((const __m256i*)(precon + i));
+    _mm256_storeu_si256((__m256i*)(recon + i), _mm256_add_epi8(x, b));
+  }
+  unfilterUp_sse2(recon + i, scanline + i, precon + i, length - i);
+}
+
+/*Sub for 4 bytes per pixel: 4 pixels per step*/
+__attribute__((target("sse2")))
+static void unfilterSub4_sse2(unsigned char* recon, const unsigned char* scanline, size_t length)
+{
+  size_t i = 0;
+  __m128i last = _mm_setzero_si128(); /*the previous reconstructed pixel, in the first 4 bytes*/
+  for(; i + 16 <= length; i += 16)
+  {
+    __m128i x = _mm_loadu_si128((const __m128i*)(scanline + i));
+    x = _mm_add_epi8(x, last);
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+    _mm_storeu_si128((__m128i*)(recon + i), x);
+    last = _mm_srli_si128(x, 12);
+  }
+  for(; i != length; ++i) recon[i] = scanline[i] + (i >= 4 ? recon[i - 4] : 0);
+}
+
+/*Sub for 3 bytes per pixel: 4 pixels (12 bytes) per step, loading 16*/
+__attribute__((target("sse2")))
+static void unfilterSub3_sse2(unsigned char* recon, const unsigned char* scanline, size_t length)
+{
+  size_t i = 0;
+  __m128i last = _mm_setzero_si128(); /*the previous reconstructed pixel, in the first 3 bytes*/
+  for(; i + 16 <= length; i += 12)
+  {
+    __m128i x = _mm_loadu_si128((const __m128i*)(scanline + i));
+    x = _mm_add_epi8(x, last);
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 3));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 6));
+    _mm_storel_epi64((__m128i*)(recon + i), x);
+    storePixel_sse2(recon + i + 8, _mm_srli_si128(x, 8), 4);
+    /*bytes 9 to 11, without the 4 loaded past the 4 pixels*/
+    last = _mm_srli_si128(_mm_slli_si128(x, 4), 13);
+  }
+  for(; i != length; ++i) recon[i] = scanline[i] + (i >= 3 ? recon[i - 3] : 0);
+}
+
+/*Average, one pixel per step. precon must not be NULL*/
+__attribute__((target("sse2")))
+static void unfilterAverage_sse2(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                 size_t bytewidth, size_t length)
+{
+  size_t i = 0;
+  const __m128i ones = _mm_set1_epi8(1);
+  __m128i a = _mm_setzero_si128(); /*the previous reconstructed pixel*/
+  /*4 bytes are loaded even with 3 bytes per pixel*/
+  for(; i + 4 <= length; i += bytewidth)
+  {
+    __m128i x = _mm_cvtsi32_si128((int)lodepng_load32(scanline + i));
+    __m128i b = _mm_cvtsi32_si128((int)lodepng_load32(precon + i));
+    /*_mm_avg_epu8 rounds up, the filter rounds down*/
+    __m128i average = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), ones));
+    a = _mm_add_epi8(x, average);
+    storePixel_sse2(recon + i, a, bytewidth);
+  }
+  for(; i != length; ++i)
+  {
+    recon[i] = scanline[i] + (((i >= bytewidth ? recon[i - bytewidth] : 0) + precon[i]) >> 1);
+  }
+}
+
+/*
+Paeth, one pixel per step in 16-bit lanes. precon must not be NULL.
+The abs of SSSE3 is the only difference between both versions.
+*/
+#define LODEPNG_UNFILTER_PAETH(abs_epi16)\
+{\
+  size_t i = 0;\
+  const __m128i zero = _mm_setzero_si128();\
+  __m128i a = zero; /*the previous reconstructed pixel*/\
+  __m128i c = zero; /*the previous pixel of precon*/\
+  for(; i + 4 <= length; i += bytewidth)\
+  {\
+    __m128i x = _mm_cvtsi32_si128((int)lodepng_load32(scanline + i));\
+    __m128i b = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)lodepng_load32(precon + i)), zero);\
+    __m128i p = _mm_sub_epi16(b, c);\
+    __m128i q = _mm_sub_epi16(a, c);\
+    __m128i pa = abs_epi16(p);\
+    __m128i pb = abs_epi16(q);\
+    __m128i pc = abs_epi16(_mm_add_epi16(p, q));\
+    /*b if pb < pa else a, then c if pc is smaller than both*/\
+    __m128i use_b = _mm_cmplt_epi16(pb, pa);\
+    __m128i use_c = _mm_cmplt_epi16(pc, _mm_min_epi16(pa, pb));\
+    __m128i predicted = _mm_or_si128(_mm_and_si128(use_b, b), _mm_andnot_si128(use_b, a));\
+    predicted = _mm_or_si128(_mm_and_si128(use_c, c), _mm_andnot_si128(use_c, predicted));\
+    x = _mm_add_epi8(x, _mm_packus_epi16(predicted, predicted));\
+    storePixel_sse2(recon + i, x, bytewidth);\
+    a = _mm_unpacklo_epi8(x, zero);\
+    c = b;\
+  }\
+  for(; i != length; ++i)\
+  {\
+    if(i < bytewidth) recon[i] = scanline[i] + precon[i];\
+    else recon[i] = scanline[i] + paethPredictor(recon[i - bytewidth], precon[i], precon[i - bytewidth]);\
+  }\
+}
+
+__attribute__((target("sse2")))
+static __m128i abs_epi16_sse2(__m128i v)
+{
+  return _mm_max_epi16(v, _mm_sub_epi16(_mm_setzero_si128(), v));
+}
+
+__attribute__((target("sse2")))
+static void unfilterPaeth_sse2(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                               size_t bytewidth, size_t length)
+LODEPNG_UNFILTER_PAETH(abs_epi16_sse2)
+
+__attribute__((target("ssse3")))
+static void unfilterPaeth_ssse3(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                size_t bytewidth, size_t length)
+LODEPNG_UNFILTER_PAETH(_mm_abs_epi16)
+
+#undef LODEPNG_UNFILTER_PAETH
+
+/*
+Unfilters the scanline with the best SIMD version the CPU has, if there is one
+for this filter and pixel size. Returns 0 if the scalar code must do it.
+*/
+static int unfilterScanlineSIMD(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                size_t bytewidth, unsigned char filterType, size_t length)
+{
+  unsigned features = lodepng_cpu_features();
+  if(!(features & LODEPNG_CPU_SSE2)) return 0;
+
+  if(filterType == 2 && precon)
   {
-    CERROR_RETURN_ERROR(state->error, 93);
+    if(features & LODEPNG_CPU_AVX2) unfilterUp_avx2(recon, scanline, precon, length);
+    else unfilterUp_sse2(recon, scanline, precon, length);
+    return 1;
   }
 
-  if(!state->decoder.ignore_crc)
+  /*
+  Below 3 bytes per pixel, one pixel per step is no faster than the scalar code.
+  And 6 or 8 bytes per pixel (16-bit images) are rare.
+  */
+  if(bytewidth != 3 && bytewidth != 4) return 0;
+
+  switch(filterType)
   {
-    unsigned CRC = lodepng_read32bitInt(&in[29]);
-    unsigned checksum = lodepng_crc32(&in[12], 17);
-    if(CRC != checksum)
-    {
-      CERROR_RETURN_ERROR(state->error, 57); /*invalid CRC*/
-    }
+    case 1:
+      if(bytewidth == 4) unfilterSub4_sse2(recon, scanline, length);
+      else unfilterSub3_sse2(recon, scanline, length);
+      return 1;
+    case 3:
+      if(!precon) return 0;
+      unfilterAverage_sse2(recon, scanline, precon, bytewidth, length);
+      return 1;
+    case 4:
+      if(!precon) return 0;
+      if(features & LODEPNG_CPU_SSSE3) unfilterPaeth_ssse3(recon, scanline, precon, bytewidth, length);
+      else unfilterPaeth_sse2(recon, scanline, precon, bytewidth, length);
+      return 1;
+    default: return 0;
   }
-
-  /*error: only compression method 0 is allowed in the specification*/
-  if(info->compression_method != 0) CERROR_RETURN_ERROR(state->error, 32);
-  /*error: only filter method 0 is allowed in the specification*/
-  if(info->filter_method != 0) CERROR_RETURN_ERROR(state->error, 33);
-  /*error: only interlace methods 0 and 1 exist in the specification*/
-  if(info->interlace_method > 1) CERROR_RETURN_ERROR(state->error, 34);
-
-  state->error = checkColorValidity(info->color.colortype, info->color.bitdepth);
-  return state->error;
 }
+#endif /*LODEPNG_SIMD_X86*/
 
 static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
                                  size_t bytewidth, unsigned char filterType, size_t length)
@@ -3981,6 +5591,9 @@ static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scan
   */
 
   size_t i;
+#ifdef LODEPNG_SIMD_X86
+  if(unfilterScanlineSIMD(recon, scanline, precon, bytewidth, filterType, length)) return 0;
+#endif /*LODEPNG_SIMD_X86*/
   switch(filterType)
   {
     case 0:
@@ -4042,16 +5655,10 @@ static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scan
   return 0;
 }
 
-static unsigned unfilter(unsigned char* out, const unsigned char* in, unsigned w, unsigned h, unsigned bpp)
+/*same as unfilter, with outstride bytes from a row of out to the next, at least the width of a row*/
+static unsigned unfilterStrided(unsigned char* out, size_t outstride, const unsigned char* in,
+                                unsigned w, unsigned h, unsigned bpp)
 {
-  /*
-  For PNG filter method 0
-  this function unfilters a single image (e.g. without interlacing this is called once, with Adam7 seven times)
-  out must have enough bytes allocated already, in must have the scanlines + 1 filtertype byte per scanline
-  w and h are image dimensions or dimensions of reduced image, bpp is bits per pixel
-  in and out are allowed to be the same memory address (but aren't the same size since in has the extra filter bytes)
-  */
-
   unsigned y;
   unsigned char* prevline = 0;
 
@@ -4061,7 +5668,7 @@ static unsigned unfilter(unsigned char* out, const unsigned char* in, unsigned w
 
   for(y = 0; y < h; ++y)
   {
-    size_t outindex = linebytes * y;
+    size_t outindex = outstride * y;
     size_t inindex = (1 + linebytes) * y; /*the extra filterbyte added to each row*/
     unsigned char filterType = in[inindex];
 
@@ -4073,6 +5680,18 @@ static unsigned unfilter(unsigned char* out, const unsigned char* in, unsigned w
   return 0;
 }
 
+static unsigned unfilter(unsigned char* out, const unsigned char* in, unsigned w, unsigned h, unsigned bpp)
+{
+  /*
+  For PNG filter method 0
+  this function unfilters a single image (e.g. without interlacing this is called once, with Adam7 seven times)
+  out must have enough bytes allocated already, in must have the scanlines + 1 filtertype byte per scanline
+  w and h are image dimensions or dimensions of reduced image, bpp is bits per pixel
+  in and out are allowed to be the same memory address (but aren't the same size since in has the extra filter bytes)
+  */
+  return unfilterStrided(out, ((size_t)w * bpp + 7) / 8, in, w, h, bpp);
+}
+
 /*
 in: Adam7 interlaced image, with no padding bits between scanlines, but between
  reduced images so that each reduced image starts at a byte.
@@ -4521,18 +6140,41 @@ static unsigned readChunk_pHYs(LodePNGInfo* info, const unsigned char* data, siz
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
 
 /*read a PNG, the result will be in the same color type as the PNG (hence "generic")*/
-static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
-                          LodePNGState* state,
-                          const unsigned char* in, size_t insize)
+/*the size of the decompressed IDAT data: the filtered scanlines, with their filter type bytes*/
+static size_t predictScanlinesSize(unsigned w, unsigned h, const LodePNGInfo* info)
+{
+  const LodePNGColorMode* color = &info->color;
+  size_t predict = 0;
+  if(info->interlace_method == 0)
+  {
+    /*The extra h is added because this are the filter bytes every scanline starts with*/
+    predict = lodepng_get_raw_size_idat(w, h, color) + h;
+  }
+  else
+  {
+    /*Adam-7 interlaced: predicted size is the sum of the 7 sub-images sizes*/
+    predict += lodepng_get_raw_size_idat((w + 7) >> 3, (h + 7) >> 3, color) + ((h + 7) >> 3);
+    if(w > 4) predict += lodepng_get_raw_size_idat((w + 3) >> 3, (h + 7) >> 3, color) + ((h + 7) >> 3);
+    predict += lodepng_get_raw_size_idat((w + 3) >> 2, (h + 3) >> 3, color) + ((h + 3) >> 3);
+    if(w > 2) predict += lodepng_get_raw_size_idat((w + 1) >> 2, (h + 3) >> 2, color) + ((h + 3) >> 2);
+    predict += lodepng_get_raw_size_idat((w + 1) >> 1, (h + 1) >> 2, color) + ((h + 1) >> 2);
+    if(w > 1) predict += lodepng_get_raw_size_idat((w + 0) >> 1, (h + 1) >> 1, color) + ((h + 1) >> 1);
+    predict += lodepng_get_raw_size_idat((w + 0), (h + 0) >> 1, color) + ((h + 0) >> 1);
+  }
+  return predict;
+}
+
+/*reads the chunks and decompresses the IDAT data into scanlines, which the caller cleans up even on error*/
+static void decodeScanlines(ucvector* scanlines, unsigned* w, unsigned* h,
+                            LodePNGState* state,
+                            const unsigned char* in, size_t insize)
 {
   unsigned char IEND = 0;
   const unsigned char* chunk;
   size_t i;
   ucvector idat; /*the data from idat chunks*/
-  ucvector scanlines;
   size_t predict;
   size_t numpixels;
-  size_t outsize = 0;
 
   /*for unknown chunk order*/
   unsigned unknown = 0;
@@ -4540,8 +6182,7 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
   unsigned critical_pos = 1; /*1 = after IHDR, 2 = after PLTE, 3 = after IDAT*/
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
 
-  /*provide some proper output values if error will happen*/
-  *out = 0;
+  ucvector_init(scanlines);
 
   state->error = lodepng_inspect(w, h, state, in, insize); /*reads header and resets other parameters in state->info_png*/
   if(state->error) return;
@@ -4555,6 +6196,8 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
   if(numpixels > 268435455) CERROR_RETURN(state->error, 92);
 
   ucvector_init(&idat);
+  /*the IDAT chunks can't be bigger than the file, they are appended without reallocations*/
+  if(!ucvector_reserve(&idat, insize)) CERROR_RETURN(state->error, 83 /*alloc fail*/);
   chunk = &in[33]; /*first byte of the first chunk after the header*/
 
   /*loop through the chunks, ignoring unknown chunks and stopping at IEND chunk.
@@ -4689,36 +6332,30 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
     if(!IEND) chunk = lodepng_chunk_next_const(chunk);
   }
 
-  ucvector_init(&scanlines);
   /*predict output size, to allocate exact size for output buffer to avoid more dynamic allocation.
   If the decompressed size does not match the prediction, the image must be corrupt.*/
-  if(state->info_png.interlace_method == 0)
-  {
-    /*The extra *h is added because this are the filter bytes every scanline starts with*/
-    predict = lodepng_get_raw_size_idat(*w, *h, &state->info_png.color) + *h;
-  }
-  else
-  {
-    /*Adam-7 interlaced: predicted size is the sum of the 7 sub-images sizes*/
-    const LodePNGColorMode* color = &state->info_png.color;
-    predict = 0;
-    predict += lodepng_get_raw_size_idat((*w + 7) >> 3, (*h + 7) >> 3, color) + ((*h + 7) >> 3);
-    if(*w > 4) predict += lodepng_get_raw_size_idat((*w + 3) >> 3, (*h + 7) >> 3, color) + ((*h + 7) >> 3);
-    predict += lodepng_get_raw_size_idat((*w + 3) >> 2, (*h + 3) >> 3, color) + ((*h + 3) >> 3);
-    if(*w > 2) predict += lodepng_get_raw_size_idat((*w + 1) >> 2, (*h + 3) >> 2, color) + ((*h + 3) >> 2);
-    predict += lodepng_get_raw_size_idat((*w + 1) >> 1, (*h + 1) >> 2, color) + ((*h + 1) >> 2);
-    if(*w > 1) predict += lodepng_get_raw_size_idat((*w + 0) >> 1, (*h + 1) >> 1, color) + ((*h + 1) >> 1);
-    predict += lodepng_get_raw_size_idat((*w + 0), (*h + 0) >> 1, color) + ((*h + 0) >> 1);
-  }
-  if(!state->error && !ucvector_reserve(&scanlines, predict)) state->error = 83; /*alloc fail*/
+  predict = predictScanlinesSize(*w, *h, &state->info_png);
+  /*inflate wants room for a longest match past its position, 258 more bytes avoid a realloc at the end*/
+  if(!state->error && !ucvector_reserve(scanlines, predict + 258)) state->error = 83; /*alloc fail*/
   if(!state->error)
   {
-    state->error = zlib_decompress(&scanlines.data, &scanlines.size, idat.data,
-                                   idat.size, &state->decoder.zlibsettings);
-    if(!state->error && scanlines.size != predict) state->error = 91; /*decompressed size doesn't match prediction*/
+    state->error = zlib_decompressv(scanlines, idat.data, idat.size, &state->decoder.zlibsettings);
+    if(!state->error && scanlines->size != predict) state->error = 91; /*decompressed size doesn't match prediction*/
   }
   ucvector_cleanup(&idat);
+}
+
+static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
+                          LodePNGState* state,
+                          const unsigned char* in, size_t insize)
+{
+  ucvector scanlines;
+  size_t i, outsize = 0;
+
+  /*provide some proper output values if error will happen*/
+  *out = 0;
 
+  decodeScanlines(&scanlines, w, h, state, in, insize);
   if(!state->error)
   {
     outsize = lodepng_get_raw_size(*w, *h, &state->info_png.color);
@@ -4778,6 +6415,271 @@ unsigned lodepng_decode(unsigned char** out, unsigned* w, unsigned* h,
   return state->error;
 }
 
+/*
+Box filter from a sw * sh image to w * h, fed one RGBA8 row at a time. Everything is
+measured in units where a source pixel is w (or h) wide and a target one sw (or sh),
+so each target pixel is the average of the exact area of source it covers. Colors are
+weighted by their alpha, transparent pixels don't bleed into their neighbours.
+*/
+typedef struct BoxScaler
+{
+  unsigned sw, sh, w, h;
+  unsigned y; /*the target row being accumulated*/
+  unsigned flags;
+  unsigned char* out;
+  size_t rowstride;
+  unsigned long long* row; /*one source row reduced to w pixels: alpha weighted r, g, b, then alpha*/
+  unsigned long long* sum; /*the target row so far*/
+} BoxScaler;
+
+static void boxScalerEmitRow(BoxScaler* scaler)
+{
+  unsigned x, c;
+  unsigned long long area = (unsigned long long)scaler->sw * scaler->sh;
+  unsigned char* pixel = &scaler->out[scaler->y * scaler->rowstride];
+  for(x = 0; x != scaler->w; ++x, pixel += 4)
+  {
+    unsigned long long* sum = &scaler->sum[x * 4];
+    unsigned long long alpha = sum[3];
+    unsigned char rgb[3];
+    for(c = 0; c != 3; ++c)
+    {
+      if(scaler->flags & LODEPNG_PREMULTIPLIED) rgb[c] = (unsigned char)((sum[c] + area * 255 / 2) / (area * 255));
+      else rgb[c] = alpha ? (unsigned char)((sum[c] + alpha / 2) / alpha) : 0;
+      sum[c] = 0;
+    }
+    pixel[0] = rgb[(scaler->flags & LODEPNG_BGRA) ? 2 : 0];
+    pixel[1] = rgb[1];
+    pixel[2] = rgb[(scaler->flags & LODEPNG_BGRA) ? 0 : 2];
+    pixel[3] = (unsigned char)((alpha + area / 2) / area);
+    sum[3] = 0;
+  }
+  ++scaler->y;
+}
+
+static void boxScalerAddRow(BoxScaler* scaler, unsigned sy, const unsigned char* rgba)
+{
+  unsigned long long* row = scaler->row;
+  unsigned i, x = 0, c;
+  size_t pos, end, next;
+
+  for(i = 0; i != scaler->w * 4; ++i) row[i] = 0;
+  for(i = 0; i != scaler->sw; ++i, rgba += 4)
+  {
+    unsigned long long a = rgba[3];
+    unsigned long long r = rgba[0] * a, g = rgba[1] * a, b = rgba[2] * a;
+    for(pos = (size_t)i * scaler->w, end = pos + scaler->w; pos != end; pos = next)
+    {
+      size_t edge = (size_t)(x + 1) * scaler->sw;
+      unsigned long long part;
+      next = end < edge ? end : edge;
+      part = next - pos;
+      row[x * 4 + 0] += r * part;
+      row[x * 4 + 1] += g * part;
+      row[x * 4 + 2] += b * part;
+      row[x * 4 + 3] += a * part;
+      if(next == edge) ++x;
+    }
+  }
+
+  for(pos = (size_t)sy * scaler->h, end = pos + scaler->h; pos != end; pos = next)
+  {
+    size_t edge = (size_t)(scaler->y + 1) * scaler->sh;
+    unsigned long long part;
+    next = end < edge ? end : edge;
+    part = next - pos;
+    for(i = 0; i != scaler->w; ++i)
+    {
+      for(c = 0; c != 4; ++c) scaler->sum[i * 4 + c] += row[i * 4 + c] * part;
+    }
+    if(next == edge) boxScalerEmitRow(scaler);
+  }
+}
+
+unsigned lodepng_decode_scaled(unsigned char* out, size_t rowstride, unsigned w, unsigned h, unsigned flags,
+                               LodePNGState* state, const unsigned char* in, size_t insize)
+{
+  ucvector scanlines;
+  BoxScaler scaler;
+  LodePNGColorMode rgba;
+  unsigned sw, sh, y;
+  unsigned char* lines = 0; /*two unfiltered rows, the current one and the one above*/
+  unsigned char* converted = 0;
+  const LodePNGColorMode* color = &state->info_png.color;
+  unsigned bpp;
+  size_t linebytes;
+
+  lodepng_color_mode_init(&rgba);
+  state->error = lodepng_inspect(&sw, &sh, state, in, insize);
+  if(state->error) return state->error;
+  if(sw == w && sh == h) return lodepng_decode_into(out, rowstride, w, h, flags, state, in, insize);
+  if(w == 0 || h == 0 || rowstride / 4 < w) CERROR_RETURN_ERROR(state->error, 95);
+
+  decodeScanlines(&scanlines, &sw, &sh, state, in, insize);
+  bpp = lodepng_get_bpp(color);
+  linebytes = ((size_t)sw * bpp + 7) / 8;
+
+  scaler.sw = sw;
+  scaler.sh = sh;
+  scaler.w = w;
+  scaler.h = h;
+  scaler.y = 0;
+  scaler.flags = flags;
+  scaler.out = out;
+  scaler.rowstride = rowstride;
+  scaler.row = (unsigned long long*)lodepng_malloc((size_t)w * 4 * sizeof(unsigned long long));
+  scaler.sum = (unsigned long long*)lodepng_malloc((size_t)w * 4 * sizeof(unsigned long long));
+  if(!state->error && (!scaler.row || !scaler.sum)) state->error = 83; /*alloc fail*/
+  if(!state->error)
+  {
+    for(y = 0; y != w * 4; ++y) scaler.sum[y] = 0;
+  }
+
+  if(state->error) {}
+  else if(state->info_png.interlace_method == 0)
+  {
+    /*each row is unfiltered, converted and added to the target as it comes, the image is never whole*/
+    lines = (unsigned char*)lodepng_malloc(2 * linebytes);
+    converted = (unsigned char*)lodepng_malloc((size_t)sw * 4);
+    if(!lines || !converted) state->error = 83; /*alloc fail*/
+    for(y = 0; y != sh && !state->error; ++y)
+    {
+      unsigned char* line = &lines[(y & 1) * linebytes];
+      const unsigned char* prevline = y ? &lines[((y - 1) & 1) * linebytes] : 0;
+      const unsigned char* scanline = &scanlines.data[y * (linebytes + 1)];
+      state->error = unfilterScanline(line, scanline + 1, prevline, (bpp + 7) / 8, scanline[0], linebytes);
+      if(!state->error) state->error = lodepng_convert(converted, line, &rgba, color, sw, 1);
+      if(!state->error) boxScalerAddRow(&scaler, y, converted);
+    }
+  }
+  else
+  {
+    /*Adam7 only has the rows complete at the end, they are deinterlaced and converted first*/
+    size_t rawsize = lodepng_get_raw_size(sw, sh, color), i;
+    lines = (unsigned char*)lodepng_malloc(rawsize);
+    converted = (unsigned char*)lodepng_malloc((size_t)sw * sh * 4);
+    if(!lines || !converted) state->error = 83; /*alloc fail*/
+    if(!state->error)
+    {
+      for(i = 0; i != rawsize; ++i) lines[i] = 0; /*the bits of the pixels smaller than a byte are or'ed in*/
+      state->error = postProcessScanlines(lines, scanlines.data, sw, sh, &state->info_png);
+    }
+    if(!state->error) state->error = lodepng_convert(converted, lines, &rgba, color, sw, sh);
+    for(y = 0; y != sh && !state->error; ++y) boxScalerAddRow(&scaler, y, &converted[(size_t)y * sw * 4]);
+  }
+
+  lodepng_free(converted);
+  lodepng_free(lines);
+  lodepng_free(scaler.sum);
+  lodepng_free(scaler.row);
+  ucvector_cleanup(&scanlines);
+  return state->error;
+}
+
+#ifdef LODEPNG_COMPILE_ALLOCATORS
+size_t lodepng_decode_memory_size(const unsigned char* in, size_t insize, const LodePNGColorMode* info_raw)
+{
+  LodePNGState state;
+  unsigned w, h;
+  size_t size = 0;
+  lodepng_state_init(&state);
+  if(!lodepng_inspect(&w, &h, &state, in, insize) && (size_t)w * h <= 268435455)
+  {
+    /*the IDAT data, the scanlines and the room inflate wants past them, the pixels in the PNG color type
+    and in the asked one. The rest is for the huffman tables, the palette and the text chunks.*/
+    size = insize + predictScanlinesSize(w, h, &state.info_png) + 258
+         + lodepng_get_raw_size(w, h, &state.info_png.color) + lodepng_get_raw_size(w, h, info_raw) + 65536;
+  }
+  lodepng_state_cleanup(&state);
+  return size;
+}
+#endif /*LODEPNG_COMPILE_ALLOCATORS*/
+
+unsigned lodepng_decode_into(unsigned char* out, size_t rowstride, unsigned w, unsigned h, unsigned flags,
+                             LodePNGState* state, const unsigned char* in, size_t insize)
+{
+  ucvector scanlines;
+  unsigned pngw, pngh, x, y;
+  const LodePNGColorMode* color = &state->info_png.color;
+
+  decodeScanlines(&scanlines, &pngw, &pngh, state, in, insize);
+  if(!state->error && (pngw != w || pngh != h || rowstride / 4 < w)) state->error = 95;
+
+  if(state->error) {}
+  else if(color->colortype == LCT_RGBA && color->bitdepth == 8 && state->info_png.interlace_method == 0)
+  {
+    /*already the right pixels, the scanlines are unfiltered straight into the rows of out*/
+    state->error = unfilterStrided(out, rowstride, scanlines.data, w, h, 32);
+  }
+  else
+  {
+    /*the pixels as they are in the PNG first, then converted into out*/
+    LodePNGColorMode rgba;
+    size_t rawlinebits = (size_t)w * lodepng_get_bpp(color);
+    size_t rawsize = lodepng_get_raw_size(w, h, color), i;
+    unsigned char* raw = (unsigned char*)lodepng_malloc(rawsize);
+    unsigned char* converted = 0;
+    lodepng_color_mode_init(&rgba);
+    if(!raw) state->error = 83; /*alloc fail*/
+    if(!state->error)
+    {
+      /*the bits of the pixels smaller than a byte are or'ed in*/
+      for(i = 0; i != rawsize; ++i) raw[i] = 0;
+      state->error = postProcessScanlines(raw, scanlines.data, w, h, &state->info_png);
+    }
+
+    if(state->error) {}
+    else if(rowstride == (size_t)w * 4) state->error = lodepng_convert(out, raw, &rgba, color, w, h);
+    else if(rawlinebits % 8 == 0)
+    {
+      /*whole bytes per row, each row can be converted on its own*/
+      for(y = 0; y != h && !state->error; ++y)
+      {
+        state->error = lodepng_convert(&out[y * rowstride], &raw[y * (rawlinebits / 8)], &rgba, color, w, 1);
+      }
+    }
+    else
+    {
+      /*rows of bits not starting on a byte, converted all at once aside*/
+      converted = (unsigned char*)lodepng_malloc((size_t)w * h * 4);
+      if(!converted) state->error = 83; /*alloc fail*/
+      if(!state->error) state->error = lodepng_convert(converted, raw, &rgba, color, w, h);
+      for(y = 0; y != h && !state->error; ++y)
+      {
+        memcpy(&out[y * rowstride], &converted[(size_t)y * w * 4], (size_t)w * 4);
+      }
+    }
+    lodepng_free(converted);
+    lodepng_free(raw);
+  }
+  ucvector_cleanup(&scanlines);
+  if(state->error) return state->error;
+
+  if(flags & (LODEPNG_PREMULTIPLIED | LODEPNG_BGRA))
+  {
+    for(y = 0; y != h; ++y)
+    {
+      unsigned char* pixel = &out[y * rowstride];
+      for(x = 0; x != w; ++x, pixel += 4)
+      {
+        unsigned r = pixel[0], g = pixel[1], b = pixel[2], a = pixel[3];
+        if(flags & LODEPNG_PREMULTIPLIED)
+        {
+          /*the exact rounding of c * a / 255, as cairo and pixman do it*/
+          r = r * a + 128; r = (r + (r >> 8)) >> 8;
+          g = g * a + 128; g = (g + (g >> 8)) >> 8;
+          b = b * a + 128; b = (b + (b >> 8)) >> 8;
+        }
+        if(flags & LODEPNG_BGRA) { unsigned t = r; r = b; b = t; }
+        pixel[0] = (unsigned char)r;
+        pixel[1] = (unsigned char)g;
+        pixel[2] = (unsigned char)b;
+      }
+    }
+  }
+  return 0;
+}
+
 unsigned lodepng_decode_memory(unsigned char** out, unsigned* w, unsigned* h, const unsigned char* in,
                                size_t insize, LodePNGColorType colortype, unsigned bitdepth)
 {
@@ -5221,51 +7123,25 @@ static float flog2(float f)
   return result + 1.442695f * (f * f * f / 3 - 3 * f * f / 2 + 3 * f - 1.83333f);
 }
 
-static unsigned filter(unsigned char* out, const unsigned char* in, unsigned w, unsigned h,
-                       const LodePNGColorMode* info, const LodePNGEncoderSettings* settings)
+/*filters the scanlines y0 to y1 (excluded) of in to out with the given strategy, see filter*/
+static unsigned filterRows(unsigned char* out, const unsigned char* in, unsigned y0, unsigned y1,
+                           size_t linebytes, size_t bytewidth, LodePNGFilterStrategy strategy,
+                           const LodePNGEncoderSettings* settings)
 {
-  /*
-  For PNG filter method 0
-  out must be a buffer with as size: h + (w * h * bpp + 7) / 8, because there are
-  the scanlines with 1 extra byte per scanline
-  */
-
-  unsigned bpp = lodepng_get_bpp(info);
-  /*the width of a scanline in bytes, not including the filter type*/
-  size_t linebytes = (w * bpp + 7) / 8;
-  /*bytewidth is used for filtering, is 1 when bpp < 8, number of bytes per pixel otherwise*/
-  size_t bytewidth = (bpp + 7) / 8;
-  const unsigned char* prevline = 0;
+  /*the scanline above y0 is only read, so the rows can be done in any order*/
+  const unsigned char* prevline = y0 == 0 ? 0 : &in[(y0 - 1) * linebytes];
   unsigned x, y;
   unsigned error = 0;
-  LodePNGFilterStrategy strategy = settings->filter_strategy;
-
-  /*
-  There is a heuristic called the minimum sum of absolute differences heuristic, suggested by the PNG standard:
-   *  If the image type is Palette, or the bit depth is smaller than 8, then do not filter the image (i.e.
-      use fixed filtering, with the filter None).
-   * (The other case) If the image type is Grayscale or RGB (with or without Alpha), and the bit depth is
-     not smaller than 8, then use adaptive filtering heuristic as follows: independently for each row, apply
-     all five filters and select the filter that produces the smallest sum of absolute values per row.
-  This heuristic is used if filter strategy is LFS_MINSUM and filter_palette_zero is true.
-
-  If filter_palette_zero is true and filter_strategy is not LFS_MINSUM, the above heuristic is followed,
-  but for "the other case", whatever strategy filter_strategy is set to instead of the minimum sum
-  heuristic is used.
-  */
-  if(settings->filter_palette_zero &&
-     (info->colortype == LCT_PALETTE || info->bitdepth < 8)) strategy = LFS_ZERO;
-
-  if(bpp == 0) return 31; /*error: invalid color type*/
 
-  if(strategy == LFS_ZERO)
+  if(strategy >= LFS_ZERO && strategy <= LFS_FOUR)
   {
-    for(y = 0; y != h; ++y)
+    unsigned char type = (unsigned char)strategy;
+    for(y = y0; y != y1; ++y)
     {
       size_t outindex = (1 + linebytes) * y; /*the extra filterbyte added to each row*/
       size_t inindex = linebytes * y;
-      out[outindex] = 0; /*filter type byte*/
-      filterScanline(&out[outindex + 1], &in[inindex], prevline, linebytes, bytewidth, 0);
+      out[outindex] = type; /*filter type byte*/
+      filterScanline(&out[outindex + 1], &in[inindex], prevline, linebytes, bytewidth, type);
       prevline = &in[inindex];
     }
   }
@@ -5285,7 +7161,7 @@ static unsigned filter(unsigned char* out, const unsigned char* in, unsigned w,
 
     if(!error)
     {
-      for(y = 0; y != h; ++y)
+      for(y = y0; y != y1; ++y)
       {
         /*try the 5 filter types*/
         for(type = 0; type != 5; ++type)
@@ -5342,7 +7218,7 @@ static unsigned filter(unsigned char* out, const unsigned char* in, unsigned w,
       if(!attempt[type]) return 83; /*alloc fail*/
     }
 
-    for(y = 0; y != h; ++y)
+    for(y = y0; y != y1; ++y)
     {
       /*try the 5 filter types*/
       for(type = 0; type != 5; ++type)
@@ -5376,7 +7252,7 @@ static unsigned filter(unsigned char* out, const unsigned char* in, unsigned w,
   }
   else if(strategy == LFS_PREDEFINED)
   {
-    for(y = 0; y != h; ++y)
+    for(y = y0; y != y1; ++y)
     {
       size_t outindex = (1 + linebytes) * y; /*the extra filterbyte added to each row*/
       size_t inindex = linebytes * y;
@@ -5411,7 +7287,7 @@ static unsigned filter(unsigned char* out, const unsigned char* in, unsigned w,
       attempt[type] = (unsigned char*)lodepng_malloc(linebytes);
       if(!attempt[type]) return 83; /*alloc fail*/
     }
-    for(y = 0; y != h; ++y) /*try the 5 filter types*/
+    for(y = y0; y != y1; ++y) /*try the 5 filter types*/
     {
       for(type = 0; type != 5; ++type)
       {
@@ -5436,11 +7312,108 @@ static unsigned filter(unsigned char* out, const unsigned char* in, unsigned w,
     }
     for(type = 0; type != 5; ++type) lodepng_free(attempt[type]);
   }
-  else return 88; /* unknown filter strategy */
 
   return error;
 }
 
+#ifdef LODEPNG_PTHREADS
+/*bands of scanlines filtered on their own by filter, each on a thread*/
+typedef struct FilterBands
+{
+  unsigned char* out;
+  const unsigned char* in;
+  unsigned h;
+  unsigned bandheight;
+  size_t linebytes;
+  size_t bytewidth;
+  LodePNGFilterStrategy strategy;
+  const LodePNGEncoderSettings* settings;
+  unsigned* errors;
+} FilterBands;
+
+static void filterBand(void* context, size_t index)
+{
+  FilterBands* bands = (FilterBands*)context;
+  unsigned y0 = (unsigned)index * bands->bandheight;
+  unsigned y1 = y0 + bands->bandheight;
+  if(y1 > bands->h) y1 = bands->h;
+  bands->errors[index] = filterRows(bands->out, bands->in, y0, y1, bands->linebytes, bands->bytewidth,
+                                    bands->strategy, bands->settings);
+}
+
+/*bytes of input per band at least, below that starting a thread costs more than it saves*/
+#define FILTER_MIN_BAND_SIZE 65536
+#endif /*LODEPNG_PTHREADS*/
+
+static unsigned filter(unsigned char* out, const unsigned char* in, unsigned w, unsigned h,
+                       const LodePNGColorMode* info, const LodePNGEncoderSettings* settings)
+{
+  /*
+  For PNG filter method 0
+  out must be a buffer with as size: h + (w * h * bpp + 7) / 8, because there are
+  the scanlines with 1 extra byte per scanline
+  */
+
+  unsigned bpp = lodepng_get_bpp(info);
+  /*the width of a scanline in bytes, not including the filter type*/
+  size_t linebytes = (w * bpp + 7) / 8;
+  /*bytewidth is used for filtering, is 1 when bpp < 8, number of bytes per pixel otherwise*/
+  size_t bytewidth = (bpp + 7) / 8;
+  LodePNGFilterStrategy strategy = settings->filter_strategy;
+
+  /*
+  There is a heuristic called the minimum sum of absolute differences heuristic, suggested by the PNG standard:
+   *  If the image type is Palette, or the bit depth is smaller than 8, then do not filter the image (i.e.
+      use fixed filtering, with the filter None).
+   * (The other case) If the image type is Grayscale or RGB (with or without Alpha), and the bit depth is
+     not smaller than 8, then use adaptive filtering heuristic as follows: independently for each row, apply
+     all five filters and select the filter that produces the smallest sum of absolute values per row.
+  This heuristic is used if filter strategy is LFS_MINSUM and filter_palette_zero is true.
+
+  If filter_palette_zero is true and filter_strategy is not LFS_MINSUM, the above heuristic is followed,
+  but for "the other case", whatever strategy filter_strategy is set to instead of the minimum sum
+  heuristic is used.
+  */
+  if(settings->filter_palette_zero &&
+     (info->colortype == LCT_PALETTE || info->bitdepth < 8)) strategy = LFS_ZERO;
+
+  if(bpp == 0) return 31; /*error: invalid color type*/
+
+  if(strategy > LFS_FOUR && strategy != LFS_MINSUM && strategy != LFS_ENTROPY
+  && strategy != LFS_PREDEFINED && strategy != LFS_BRUTE_FORCE) return 88; /* unknown filter strategy */
+
+#ifdef LODEPNG_PTHREADS
+  /*each row only depends on the input, so bands of rows can be filtered on several threads*/
+  if(settings->zlibsettings.numthreads > 1 && (size_t)h * linebytes >= 2 * FILTER_MIN_BAND_SIZE)
+  {
+    FilterBands bands;
+    size_t numbands = (size_t)h * linebytes / FILTER_MIN_BAND_SIZE, i;
+    unsigned error = 0;
+    if(numbands > 4 * settings->zlibsettings.numthreads) numbands = 4 * settings->zlibsettings.numthreads;
+    if(numbands > h) numbands = h;
+
+    bands.out = out;
+    bands.in = in;
+    bands.h = h;
+    bands.bandheight = (unsigned)((h + numbands - 1) / numbands);
+    bands.linebytes = linebytes;
+    bands.bytewidth = bytewidth;
+    bands.strategy = strategy;
+    bands.settings = settings;
+    bands.errors = (unsigned*)lodepng_malloc(numbands * sizeof(unsigned));
+    if(!bands.errors) return 83; /*alloc fail*/
+
+    numbands = (h + bands.bandheight - 1) / bands.bandheight;
+    lodepng_parallel_for(filterBand, &bands, numbands, settings->zlibsettings.numthreads);
+    for(i = 0; i != numbands && !error; ++i) error = bands.errors[i];
+    lodepng_free(bands.errors);
+    return error;
+  }
+#endif /*LODEPNG_PTHREADS*/
+
+  return filterRows(out, in, 0, h, linebytes, bytewidth, strategy, settings);
+}
+
 static void addPaddingBits(unsigned char* out, const unsigned char* in,
                            size_t olinebits, size_t ilinebits, unsigned h)
 {
@@ -5908,6 +7881,16 @@ void lodepng_encoder_settings_init(LodePNGEncoderSettings* settings)
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
 }
 
+void lodepng_encoder_settings_set_level(LodePNGEncoderSettings* settings, unsigned level)
+{
+  lodepng_compress_settings_set_level(&settings->zlibsettings, level);
+  /*level 1 uses Paeth on every row: usually the best single filter for photos and icons*/
+  if(level == 0) settings->filter_strategy = LFS_ZERO;
+  else if(level == 1) settings->filter_strategy = LFS_FOUR;
+  else if(level <= 8) settings->filter_strategy = LFS_MINSUM;
+  else settings->filter_strategy = LFS_ENTROPY;
+}
+
 #endif /*LODEPNG_COMPILE_ENCODER*/
 #endif /*LODEPNG_COMPILE_PNG*/
 
@@ -6013,6 +7996,7 @@ const char* lodepng_error_text(unsigned code)
     case 92: return "too many pixels, not supported";
     case 93: return "zero width or height is invalid";
     case 94: return "header chunk must have a size of 13 bytes";
+    case 95: return "the image size is not the one given, or the row stride is smaller than the width";
   }
   return "unknown error code";
 }
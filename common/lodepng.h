@@ -74,6 +74,16 @@ source files with custom allocators.*/
 #ifndef LODEPNG_NO_COMPILE_ALLOCATORS
 #define LODEPNG_COMPILE_ALLOCATORS
 #endif
+/*use SSE2, SSSE3 and AVX2 code paths on x86 with gcc or clang. They are picked
+at runtime from what the CPU supports, the binary still runs on any x86 CPU.*/
+#ifndef LODEPNG_NO_COMPILE_SIMD
+#define LODEPNG_COMPILE_SIMD
+#endif
+/*let the encoder use several threads (pthreads, link with -pthread), see numthreads
+in LodePNGCompressSettings. Without it, numthreads is ignored.*/
+#ifndef LODEPNG_NO_COMPILE_THREADS
+#define LODEPNG_COMPILE_THREADS
+#endif
 /*compile the C++ version (you can disable the C++ wrapper here even when compiling for C++)*/
 #ifdef __cplusplus
 #ifndef LODEPNG_NO_COMPILE_CPP
@@ -250,6 +260,36 @@ unsigned encode(const std::string& filename,
 const char* lodepng_error_text(unsigned code);
 #endif /*LODEPNG_COMPILE_ERROR_TEXT*/
 
+#ifdef LODEPNG_COMPILE_ALLOCATORS
+/*
+A block of memory the default allocators take from instead of malloc, on a thread
+that uses it (see lodepng_arena_use). Allocating moves a pointer forward and the
+last allocation grows in place, so the vectors lodepng grows are not reallocated.
+What doesn't fit goes to malloc.
+
+Memory is only given back all at once by lodepng_arena_reset. Buffers taken from
+the arena must be freed while it is in use, or not at all: copy the results out,
+clean up the LodePNGState, then stop using it or reset it. Results of the C
+functions, such as the image of lodepng_decode_memory, are freed with lodepng_free.
+*/
+typedef struct LodePNGArena
+{
+  unsigned char* data;
+  size_t capacity;
+  size_t used;
+  size_t last; /*where the last allocation starts, the one that can grow in place*/
+} LodePNGArena;
+
+void lodepng_arena_init(LodePNGArena* arena);
+void lodepng_arena_cleanup(LodePNGArena* arena);
+/*forgets every allocation in O(1), and makes room for capacity bytes. Returns 83 if that can't be allocated*/
+unsigned lodepng_arena_reset(LodePNGArena* arena, size_t capacity);
+/*the default allocators of this thread take from arena, or malloc if 0. Returns the arena used before.*/
+LodePNGArena* lodepng_arena_use(LodePNGArena* arena);
+/*frees a buffer lodepng allocated, with free or in the arena in use on this thread, the one it came from*/
+void lodepng_free(void* ptr);
+#endif /*LODEPNG_COMPILE_ALLOCATORS*/
+
 #ifdef LODEPNG_COMPILE_DECODER
 /*Settings for zlib decompression*/
 typedef struct LodePNGDecompressSettings LodePNGDecompressSettings;
@@ -291,6 +331,14 @@ struct LodePNGCompressSettings /*deflate = compress*/
   unsigned minmatch; /*mininum lz77 length. 3 is normally best, 6 can be better for some PNGs. Default: 0*/
   unsigned nicematch; /*stop searching if >= this length found. Set to 258 for best compression. Default: 128*/
   unsigned lazymatching; /*use lazy matching: better compression but a bit slower. Default: true*/
+  /*greedy LZ77 with a single candidate per hash instead of the hash chains: several
+  times faster, compresses less. nicematch and lazymatching are ignored. Default: false*/
+  unsigned fastlz77;
+  /*threads to use, counting the calling one. Big inputs are deflated in segments
+  joined with sync flushes, compressing a bit less, and the PNG encoder filters
+  the scanlines in parallel, which doesn't change its output. 0 or 1: no threads.
+  Not changed by lodepng_compress_settings_set_level. Default: 1*/
+  unsigned numthreads;
 
   /*use custom zlib encoder instead of built in one (default: null)*/
   unsigned (*custom_zlib)(unsigned char**, size_t*,
@@ -308,6 +356,17 @@ struct LodePNGCompressSettings /*deflate = compress*/
 
 extern const LodePNGCompressSettings lodepng_default_compress_settings;
 void lodepng_compress_settings_init(LodePNGCompressSettings* settings);
+/*
+Sets the LZ77 settings for a speed level: 0 stores the data uncompressed, 1 and 2
+use fastlz77, 3 to 9 compress more and more slowly. 6 is the default settings.
+level:        1, 2   3     4     5     6     7     8      9
+windowsize:   32768  1024  2048  2048  2048  8192  16384  32768
+nicematch:    -      16    64    64    128   128   258    258
+lazymatching: -      0     0     1     1     1     1      1
+fastlz77 has nothing else worth tuning, so 1 and 2 are the same here. They differ
+in the filter strategy, see lodepng_encoder_settings_set_level.
+*/
+void lodepng_compress_settings_set_level(LodePNGCompressSettings* settings, unsigned level);
 #endif /*LODEPNG_COMPILE_ENCODER*/
 
 #ifdef LODEPNG_COMPILE_PNG
@@ -543,7 +602,12 @@ void lodepng_decoder_settings_init(LodePNGDecoderSettings* settings);
 typedef enum LodePNGFilterStrategy
 {
   /*every filter at zero*/
-  LFS_ZERO,
+  LFS_ZERO = 0,
+  /*every filter at 1, 2, 3 or 4 (Paeth). Fast, LFS_FOUR compresses close to LFS_MINSUM on photos*/
+  LFS_ONE = 1,
+  LFS_TWO = 2,
+  LFS_THREE = 3,
+  LFS_FOUR = 4,
   /*Use filter that gives minimum sum, as described in the official PNG filter heuristic.*/
   LFS_MINSUM,
   /*Use the filter type that gives smallest Shannon entropy for this scanline. Depending
@@ -618,6 +682,12 @@ typedef struct LodePNGEncoderSettings
 } LodePNGEncoderSettings;
 
 void lodepng_encoder_settings_init(LodePNGEncoderSettings* settings);
+/*
+Sets the zlib settings (see lodepng_compress_settings_set_level) and the filter
+strategy for a speed level from 0 to 9. 1 is the fastest that still compresses,
+9 the densest. Other settings are left as they are.
+*/
+void lodepng_encoder_settings_set_level(LodePNGEncoderSettings* settings, unsigned level);
 #endif /*LODEPNG_COMPILE_ENCODER*/
 
 
@@ -663,6 +733,38 @@ information is placed in the info_png field of the LodePNGState.
 unsigned lodepng_inspect(unsigned* w, unsigned* h,
                          LodePNGState* state,
                          const unsigned char* in, size_t insize);
+
+/*for lodepng_decode_into: multiplies the colors by the alpha*/
+#define LODEPNG_PREMULTIPLIED 1
+/*for lodepng_decode_into: B, G, R, A byte order. Premultiplied, it is cairo's CAIRO_FORMAT_ARGB32 on little endian.*/
+#define LODEPNG_BGRA 2
+
+/*
+Decodes to 8-bit RGBA into a buffer of the caller, such as the pixels of a GdkPixbuf
+with alpha: h rows of rowstride bytes, of which the first 4 * w are written. w and h
+must be the size of the image, as lodepng_inspect gives it, or it's error 95.
+flags is 0 or LODEPNG_PREMULTIPLIED and LODEPNG_BGRA or'ed together. state->info_raw
+isn't used. Non-interlaced RGBA8 PNGs are unfiltered straight into out, no copy.
+*/
+unsigned lodepng_decode_into(unsigned char* out, size_t rowstride, unsigned w, unsigned h, unsigned flags,
+                             LodePNGState* state, const unsigned char* in, size_t insize);
+
+/*
+Same as lodepng_decode_into, but w and h are the size wanted, the image is resized to
+it with a box filter: each pixel is the average of the part of the image it covers,
+weighted by alpha. Non-interlaced images are reduced a row at a time while they are
+unfiltered, they are never whole. Made for thumbnails, smaller than the image.
+*/
+unsigned lodepng_decode_scaled(unsigned char* out, size_t rowstride, unsigned w, unsigned h, unsigned flags,
+                               LodePNGState* state, const unsigned char* in, size_t insize);
+
+#ifdef LODEPNG_COMPILE_ALLOCATORS
+/*
+Memory lodepng_decode uses at most to decode in to the info_raw color type, from
+the header. Made to size a LodePNGArena. Returns 0 if in isn't a PNG.
+*/
+size_t lodepng_decode_memory_size(const unsigned char* in, size_t insize, const LodePNGColorMode* info_raw);
+#endif /*LODEPNG_COMPILE_ALLOCATORS*/
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 
@@ -1614,6 +1716,28 @@ yyyymmdd.
 Some changes aren't backwards compatible. Those are indicated with a (!)
 symbol.
 
+*) 19 oct 2026 (SAM Rewritten copy): table based huffman decoding instead of
+   walking the tree bit by bit. (!) Incomplete huffman trees are refused with
+   error 55, like zlib does.
+*) 19 oct 2026 (SAM Rewritten copy): inflate reads its bits through a 64-bit
+   buffer refilled a word at a time.
+*) 19 oct 2026 (SAM Rewritten copy): SSE2/SSSE3/AVX2 unfiltering for 3 and 4
+   bytes per pixel, disabled with LODEPNG_NO_COMPILE_SIMD.
+*) 19 oct 2026 (SAM Rewritten copy): CRC32 sliced by 8 bytes or folded with
+   PCLMULQDQ, Adler-32 with SSSE3/AVX2.
+*) 19 oct 2026 (SAM Rewritten copy): speed levels for the encoder, with a greedy
+   LZ77 for the fastest. LFS_ONE to LFS_FOUR filter strategies. Huffman code
+   lengths only use package-merge when the unlimited ones are too long.
+*) 19 oct 2026 (SAM Rewritten copy): numthreads to filter and deflate on several
+   threads, disabled with LODEPNG_NO_COMPILE_THREADS.
+*) 19 oct 2026 (SAM Rewritten copy): LodePNGArena for the default allocators, and
+   lodepng_decode_memory_size to size it. The decoder reserves the IDAT and
+   scanline buffers once instead of growing them.
+*) 19 oct 2026 (SAM Rewritten copy): lodepng_decode_into, to RGBA8 in a buffer of
+   the caller with a row stride, optionally premultiplied.
+*) 19 oct 2026 (SAM Rewritten copy): lodepng_decode_scaled, box filtered to any size.
+*) 19 oct 2026 (SAM Rewritten copy): SIMD conversion to RGBA8 from the 8 and 16-bit
+   grey, RGB, grey alpha and RGBA images, and from 8-bit palettes.
 *) 14 jan 2018: allow optionally ignoring a few more recoverable errors
 *) 17 sep 2017: fix memory leak for some encoder input error cases
 *) 27 nov 2016: grey+alpha auto color model detection bugfix